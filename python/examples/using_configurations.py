@@ -41,4 +41,4 @@ hhmm.train(training_set)
 # Print model parameters after training
 for label in labels:
     print('The HMM for for class %s has %i states' %
-          (labels[i], hhmm.models[label].parameters.states.get()))
+          (labels[i], hhmm.getClass(label).parameters.states.get()))
@@ -94,13 +94,12 @@ namespace std {
     %template(vectorgauss) vector<xmm::GaussianDistribution>;
     %template(vectorgmm) vector<xmm::SingleClassGMM>;
     %template(vectorhmm) vector<xmm::SingleClassHMM>;
-    %template(mapgmm) map<string, xmm::SingleClassGMM>;
-    %template(maphmm) map<string, xmm::SingleClassHMM>;
 };
 
 %include ../xmm_doc.i
 
 %include "xmmMatrix.hpp"
+%template(SparseMatrix_double) xmm::SparseMatrix<double>;
 %include "xmmCircularbuffer.hpp"
 %include "xmmJson.hpp"
 %include "xmmAttribute.hpp"
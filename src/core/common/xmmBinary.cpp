@@ -0,0 +1,568 @@
+/*
+ * xmmBinary.cpp
+ *
+ * Binary Model Format
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "xmmBinary.hpp"
+#include "xmmMatrix.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+/**
+ @brief magic string of the binary model files
+ */
+const char kMagic[8] = {'X', 'M', 'M', 'M', 'O', 'D', 'E', 'L'};
+
+/**
+ @brief size of the arrays which size is not checked
+ */
+const std::size_t kAnySize = std::numeric_limits<std::size_t>::max();
+
+bool littleEndianHost() {
+    const uint32_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+void store32(char* buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) buffer[i] = char((value >> (8 * i)) & 0xFF);
+}
+
+void store64(char* buffer, uint64_t value) {
+    for (int i = 0; i < 8; i++) buffer[i] = char((value >> (8 * i)) & 0xFF);
+}
+
+uint32_t load32(const char* buffer) {
+    uint32_t value(0);
+    for (int i = 0; i < 4; i++)
+        value |= uint32_t(static_cast<unsigned char>(buffer[i])) << (8 * i);
+    return value;
+}
+
+uint64_t load64(const char* buffer) {
+    uint64_t value(0);
+    for (int i = 0; i < 8; i++)
+        value |= uint64_t(static_cast<unsigned char>(buffer[i])) << (8 * i);
+    return value;
+}
+
+/**
+ @brief CRC-32 checksum (IEEE 802.3 polynomial)
+ */
+uint32_t crc32(const char* data, std::size_t size) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; i++)
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^
+              (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ @brief encodes an array of 32-bit values in little-endian byte order
+ */
+template <typename T>
+void encode32(char* buffer, const T* values, std::size_t size) {
+    if (littleEndianHost()) {
+        std::memcpy(buffer, values, size * 4);
+        return;
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        uint32_t value;
+        std::memcpy(&value, values + i, 4);
+        store32(buffer + 4 * i, value);
+    }
+}
+
+/**
+ @brief encodes an array of 64-bit values in little-endian byte order
+ */
+template <typename T>
+void encode64(char* buffer, const T* values, std::size_t size) {
+    if (littleEndianHost()) {
+        std::memcpy(buffer, values, size * 8);
+        return;
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        uint64_t value;
+        std::memcpy(&value, values + i, 8);
+        store64(buffer + 8 * i, value);
+    }
+}
+
+/**
+ @brief decodes an array of 32-bit values stored in little-endian byte order
+ */
+template <typename T>
+void decode32(T* values, const char* buffer, std::size_t size) {
+    if (littleEndianHost()) {
+        std::memcpy(values, buffer, size * 4);
+        return;
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        uint32_t value = load32(buffer + 4 * i);
+        std::memcpy(values + i, &value, 4);
+    }
+}
+
+/**
+ @brief decodes an array of 64-bit values stored in little-endian byte order
+ */
+template <typename T>
+void decode64(T* values, const char* buffer, std::size_t size) {
+    if (littleEndianHost()) {
+        std::memcpy(values, buffer, size * 8);
+        return;
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        uint64_t value = load64(buffer + 8 * i);
+        std::memcpy(values + i, &value, 8);
+    }
+}
+
+/**
+ @brief converts a single-precision value to half precision (round to
+ nearest even)
+ */
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t float_exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (float_exponent == 0xFF)  // infinity or NaN
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    int exponent = int(float_exponent) - 127 + 15;
+    if (exponent >= 31) return sign | 0x7C00;
+    uint32_t half, remainder, halfway;
+    if (exponent <= 0) {  // subnormal half
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1FFF;
+        halfway = 0x1000;
+    }
+    // a carry into the exponent rounds to the next power of two (or infinity)
+    if (remainder > halfway || (remainder == halfway && (half & 1))) half++;
+    return sign | static_cast<uint16_t>(half);
+}
+
+/**
+ @brief converts a half-precision value to single precision
+ */
+float halfToFloat(uint16_t half) {
+    uint32_t sign = uint32_t(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {  // subnormal half: normalize the mantissa
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+/**
+ @brief scale of a tensor quantized with a given precision
+ @details half-precision tensors are scaled by a power of two (which does not
+ alter their mantissa) so that their largest magnitude is below 2^15. 8-bit
+ tensors are scaled so that their largest magnitude maps to 127.
+ */
+template <typename T>
+float quantizationScale(const T* values, std::size_t size,
+                        xmm::BinaryPrecision precision) {
+    double max_magnitude(0.);
+    for (std::size_t i = 0; i < size; i++) {
+        if (!std::isfinite(values[i]))
+            throw std::runtime_error("Cannot quantize non-finite parameters");
+        max_magnitude = std::max(max_magnitude, std::fabs(double(values[i])));
+    }
+    float scale;
+    if (precision == xmm::BinaryPrecision::Float16) {
+        int exponent(0);
+        if (max_magnitude > 0.) std::frexp(max_magnitude, &exponent);
+        scale = static_cast<float>(std::ldexp(1., exponent - 15));
+    } else {
+        scale = static_cast<float>(max_magnitude / 127.);
+    }
+    if (!std::isfinite(scale) || (max_magnitude > 0. && scale == 0.f))
+        throw std::runtime_error("Cannot quantize parameters");
+    return scale;
+}
+
+/**
+ @brief checks if a nonzero value of a tensor is quantized to zero
+ @details the values that are much smaller than the largest magnitude of the
+ tensor are flushed to zero, which would turn e.g. a small precision into an
+ invalid parameter.
+ */
+template <typename T>
+bool quantizesToZero(const T* values, std::size_t size, float scale,
+                     xmm::BinaryPrecision precision) {
+    for (std::size_t i = 0; i < size; i++) {
+        if (values[i] == 0) continue;
+        double scaled = double(values[i]) / scale;
+        if (precision == xmm::BinaryPrecision::Float16
+                ? (floatToHalf(static_cast<float>(scaled)) & 0x7FFF) == 0
+                : std::fabs(scaled) < 0.5)
+            return true;
+    }
+    return false;
+}
+}
+
+#pragma mark -
+#pragma mark Writer
+xmm::BinaryWriter::BinaryWriter(bool compact, BinaryPrecision precision)
+    : compact_(compact), precision_(precision) {
+    if (compact_) writeUInt(static_cast<unsigned int>(precision_));
+}
+
+char* xmm::BinaryWriter::append(std::size_t size) {
+    std::size_t offset = payload_.size();
+    payload_.resize(offset + size);
+    return payload_.data() + offset;
+}
+
+void xmm::BinaryWriter::writeBool(bool value) {
+    *append(1) = value ? 1 : 0;
+}
+
+void xmm::BinaryWriter::writeUInt(unsigned int value) {
+    store32(append(4), value);
+}
+
+void xmm::BinaryWriter::writeDouble(double value) {
+    encode64(append(8), &value, 1);
+}
+
+void xmm::BinaryWriter::writeString(std::string const& value) {
+    writeUInt(static_cast<unsigned int>(value.size()));
+    if (!value.empty())
+        std::memcpy(append(value.size()), value.data(), value.size());
+}
+
+void xmm::BinaryWriter::writeVector(std::vector<float> const& values) {
+    writeUInt(static_cast<unsigned int>(values.size()));
+    if (!values.empty())
+        encode32(append(4 * values.size()), values.data(), values.size());
+}
+
+void xmm::BinaryWriter::writeVector(std::vector<double> const& values) {
+    writeUInt(static_cast<unsigned int>(values.size()));
+    if (!values.empty())
+        encode64(append(8 * values.size()), values.data(), values.size());
+}
+
+void xmm::BinaryWriter::writeVector(std::vector<unsigned int> const& values) {
+    writeUInt(static_cast<unsigned int>(values.size()));
+    if (!values.empty())
+        encode32(append(4 * values.size()), values.data(), values.size());
+}
+
+void xmm::BinaryWriter::writeVector(std::vector<std::string> const& values) {
+    writeUInt(static_cast<unsigned int>(values.size()));
+    for (auto const& value : values) writeString(value);
+}
+
+void xmm::BinaryWriter::writeParameters(std::vector<float> const& values) {
+    if (!compact_ || precision_ == BinaryPrecision::Full) {
+        writeVector(values);
+        return;
+    }
+    writeUInt(static_cast<unsigned int>(values.size()));
+    writeQuantized(values.data(), values.size(), false);
+}
+
+void xmm::BinaryWriter::writeParameters(std::vector<double> const& values,
+                                        bool preserve_nonzero) {
+    if (!compact_ || precision_ == BinaryPrecision::Full) {
+        writeVector(values);
+        return;
+    }
+    writeUInt(static_cast<unsigned int>(values.size()));
+    writeQuantized(values.data(), values.size(), preserve_nonzero);
+}
+
+template <typename T>
+void xmm::BinaryWriter::writeQuantized(const T* values, std::size_t size,
+                                       bool preserve_nonzero) {
+    // 8-bit tensors whose dynamic range is too large are stored in half
+    // precision, which is signaled by a negative scale
+    BinaryPrecision precision = precision_;
+    float scale = quantizationScale(values, size, precision);
+    if (precision == BinaryPrecision::Int8 &&
+        quantizesToZero(values, size, scale, precision)) {
+        precision = BinaryPrecision::Float16;
+        scale = quantizationScale(values, size, precision);
+    }
+    if (preserve_nonzero && quantizesToZero(values, size, scale, precision))
+        throw std::runtime_error(
+            "Cannot quantize parameters: the dynamic range of the values "
+            "exceeds half precision");
+    float stored_scale = (precision != precision_) ? -scale : scale;
+    encode32(append(4), &stored_scale, 1);
+    if (size == 0) return;
+    if (precision == BinaryPrecision::Float16) {
+        char* buffer = append(2 * size);
+        for (std::size_t i = 0; i < size; i++) {
+            uint16_t half = floatToHalf(static_cast<float>(values[i] / scale));
+            buffer[2 * i] = char(half & 0xFF);
+            buffer[2 * i + 1] = char(half >> 8);
+        }
+    } else {
+        char* buffer = append(size);
+        for (std::size_t i = 0; i < size; i++) {
+            long q = (scale > 0.f) ? std::lround(values[i] / scale) : 0;
+            buffer[i] = static_cast<char>(
+                static_cast<signed char>(std::min(127L, std::max(-127L, q))));
+        }
+    }
+}
+
+void xmm::BinaryWriter::save(std::ostream& stream,
+                             unsigned int model_type) const {
+    std::vector<char> header(HEADER_SIZE(), 0);
+    std::memcpy(header.data(), kMagic, 8);
+    store32(header.data() + 8, compact_ ? VERSION() : 1);
+    store32(header.data() + 12, model_type);
+    store64(header.data() + 16, payload_.size());
+    store32(header.data() + 24, crc32(payload_.data(), payload_.size()));
+    store32(header.data() + 28, crc32(header.data(), 28));
+    stream.write(header.data(), header.size());
+    stream.write(payload_.data(), payload_.size());
+    if (!stream) throw std::runtime_error("Error while writing model file");
+}
+
+#pragma mark -
+#pragma mark Reader
+xmm::BinaryReader::BinaryReader(std::istream& stream, unsigned int model_type)
+    : position_(0), precision_(BinaryPrecision::Full) {
+    std::vector<char> header(BinaryWriter::HEADER_SIZE());
+    if (!stream.read(header.data(), header.size()) ||
+        std::memcmp(header.data(), kMagic, 8) != 0)
+        throw std::runtime_error("Not a model file");
+    if (load32(header.data() + 28) != crc32(header.data(), 28))
+        throw std::runtime_error("Corrupted model file");
+    version_ = load32(header.data() + 8);
+    if (version_ == 0 || version_ > BinaryWriter::VERSION())
+        throw std::runtime_error("Unsupported model file version");
+    if (load32(header.data() + 12) != model_type)
+        throw std::runtime_error("Wrong model type");
+    uint64_t payload_size = load64(header.data() + 16);
+    if (payload_size > std::numeric_limits<std::size_t>::max())
+        throw std::runtime_error("Corrupted model file");
+    payload_.resize(static_cast<std::size_t>(payload_size));
+    if (!stream.read(payload_.data(), payload_.size()))
+        throw std::runtime_error("Truncated model file");
+    if (load32(header.data() + 24) != crc32(payload_.data(), payload_.size()))
+        throw std::runtime_error("Corrupted model file");
+    if (compact()) {
+        unsigned int precision = readUInt();
+        if (precision > static_cast<unsigned int>(BinaryPrecision::Int8))
+            throw std::runtime_error("Corrupted model file");
+        precision_ = static_cast<BinaryPrecision>(precision);
+    }
+}
+
+const char* xmm::BinaryReader::take(std::size_t size) {
+    if (size > payload_.size() - position_)
+        throw std::runtime_error("Corrupted model file");
+    const char* data = payload_.data() + position_;
+    position_ += size;
+    return data;
+}
+
+std::size_t xmm::BinaryReader::readArraySize(std::size_t element_size,
+                                             std::size_t expected_size) {
+    std::size_t size = readUInt();
+    if ((expected_size != kAnySize && size != expected_size) ||
+        size > (payload_.size() - position_) / element_size)
+        throw std::runtime_error("Corrupted model file");
+    return size;
+}
+
+bool xmm::BinaryReader::readBool() {
+    char value = *take(1);
+    if (value != 0 && value != 1)
+        throw std::runtime_error("Corrupted model file");
+    return value == 1;
+}
+
+unsigned int xmm::BinaryReader::readUInt() { return load32(take(4)); }
+
+unsigned int xmm::BinaryReader::readSize() {
+    return static_cast<unsigned int>(readArraySize(1, kAnySize));
+}
+
+double xmm::BinaryReader::readDouble() {
+    double value;
+    decode64(&value, take(8), 1);
+    return value;
+}
+
+std::string xmm::BinaryReader::readString() {
+    std::size_t size = readArraySize(1, kAnySize);
+    const char* data = take(size);
+    return std::string(data, size);
+}
+
+void xmm::BinaryReader::readVector(std::vector<float>& values) {
+    readVector(values, kAnySize);
+}
+
+void xmm::BinaryReader::readVector(std::vector<float>& values,
+                                   std::size_t size) {
+    size = readArraySize(4, size);
+    values.resize(size);
+    if (size > 0) decode32(values.data(), take(4 * size), size);
+}
+
+void xmm::BinaryReader::readVector(std::vector<double>& values) {
+    readVector(values, kAnySize);
+}
+
+void xmm::BinaryReader::readVector(std::vector<double>& values,
+                                   std::size_t size) {
+    size = readArraySize(8, size);
+    values.resize(size);
+    if (size > 0) decode64(values.data(), take(8 * size), size);
+}
+
+void xmm::BinaryReader::readVector(std::vector<unsigned int>& values) {
+    readVector(values, kAnySize);
+}
+
+void xmm::BinaryReader::readVector(std::vector<unsigned int>& values,
+                                   std::size_t size) {
+    size = readArraySize(4, size);
+    values.resize(size);
+    if (size > 0) decode32(values.data(), take(4 * size), size);
+}
+
+void xmm::BinaryReader::readVector(std::vector<std::string>& values) {
+    values.resize(readArraySize(4, kAnySize));
+    for (auto& value : values) value = readString();
+}
+
+void xmm::BinaryReader::readParameters(std::vector<float>& values,
+                                       std::size_t size) {
+    if (!compact() || precision_ == BinaryPrecision::Full)
+        readVector(values, size);
+    else
+        readQuantized(values, size);
+}
+
+void xmm::BinaryReader::readParameters(std::vector<double>& values,
+                                       std::size_t size) {
+    if (!compact() || precision_ == BinaryPrecision::Full)
+        readVector(values, size);
+    else
+        readQuantized(values, size);
+}
+
+void xmm::BinaryReader::readSymmetric(std::vector<double>& values,
+                                      unsigned int dimension) {
+    readParameters(values);
+    if (values.size() == dimension || values.size() == packedSize(dimension))
+        return;
+    if (values.size() != std::size_t(dimension) * dimension)
+        throw std::runtime_error("Corrupted model file");
+    std::vector<double> square;
+    square.swap(values);
+    values.resize(packedSize(dimension));
+    packSymmetric(square.data(), dimension, values.data());
+}
+
+template <typename T>
+void xmm::BinaryReader::readQuantized(std::vector<T>& values,
+                                      std::size_t expected_size) {
+    std::size_t size = readArraySize(1, expected_size);
+    float scale;
+    decode32(&scale, take(4), 1);
+    if (!std::isfinite(scale)) throw std::runtime_error("Corrupted model file");
+    // a negative scale marks an 8-bit tensor stored in half precision
+    bool half_precision = (precision_ == BinaryPrecision::Float16);
+    if (scale < 0.f) {
+        if (half_precision) throw std::runtime_error("Corrupted model file");
+        half_precision = true;
+        scale = -scale;
+    }
+    std::size_t element_size = half_precision ? 2 : 1;
+    const char* buffer = take(element_size * size);
+    values.resize(size);
+    for (std::size_t i = 0; i < size; i++) {
+        if (half_precision) {
+            uint16_t half = static_cast<uint16_t>(
+                static_cast<unsigned char>(buffer[2 * i]) |
+                (static_cast<unsigned char>(buffer[2 * i + 1]) << 8));
+            values[i] = static_cast<T>(halfToFloat(half)) * scale;
+        } else {
+            values[i] = static_cast<T>(static_cast<signed char>(buffer[i])) *
+                        scale;
+        }
+    }
+}
+
+void xmm::BinaryReader::checkEnd() const {
+    if (position_ != payload_.size())
+        throw std::runtime_error("Corrupted model file");
+}
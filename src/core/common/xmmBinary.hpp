@@ -0,0 +1,421 @@
+/*
+ * xmmBinary.hpp
+ *
+ * Binary Model Format
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef xmmBinary_h
+#define xmmBinary_h
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace xmm {
+/**
+ @ingroup Common
+ @brief Storage precision of the parameters of compact binary model files
+ */
+enum class BinaryPrecision {
+    /**
+     @brief Parameters are stored without loss, with their own precision
+     */
+    Full = 0,
+
+    /**
+     @brief Half-precision floating point values with a per-tensor
+     power-of-two scale
+     */
+    Float16 = 1,
+
+    /**
+     @brief 8-bit integers with a per-tensor scale (symmetric quantization)
+     @details the tensors whose small nonzero values would be rounded to zero
+     are stored in half precision.
+     */
+    Int8 = 2
+};
+
+/**
+ @ingroup Common
+ @brief Writer of the binary model format
+ @details The binary format is a compact alternative to the JSON
+ serialization of the models, designed for fast loading. A file is composed
+ of a header of 32 bytes followed by the payload:
+ - the magic string "XMMMODEL";
+ - the format version (32 bits);
+ - the type of the model (32 bits, 1: GMM, 2: HierarchicalHMM);
+ - the size of the payload (64 bits);
+ - the CRC-32 checksum of the payload (32 bits);
+ - the CRC-32 checksum of the first 28 bytes of the header (32 bits).
+
+ The payload is a sequence of fields written by the writeBinary() methods of
+ the models, in the same order as their JSON members. Integers and floating
+ point values are stored in little-endian byte order, whatever the byte order
+ of the host. Strings and arrays are prefixed by their number of elements.
+
+ Version 2 files are compact, inference-only models: their payload starts
+ with the storage precision of the parameters (32 bits), the models omit the
+ data that is only used for training, and the parameters are written with
+ writeParameters(). In 8-bit files, a negative scale marks a tensor stored in
+ half precision. Complete models are still written in version 1.
+
+ Symmetric matrices are stored in packed storage (upper triangle, see
+ packedSize()). Square matrices written by previous versions of the library
+ are packed by BinaryReader::readSymmetric().
+ */
+class BinaryWriter {
+  public:
+    /**
+     @brief Version of the binary format
+     */
+    static unsigned int VERSION() { return 2; }
+
+    /**
+     @brief Size of the header of the binary files
+     */
+    static std::size_t HEADER_SIZE() { return 32; }
+
+    /**
+     @brief Constructor
+     @param compact defines if the file is a compact, inference-only model
+     @param precision storage precision of the parameters of compact files
+     */
+    explicit BinaryWriter(bool compact = false,
+                          BinaryPrecision precision = BinaryPrecision::Full);
+
+    /**
+     @brief Checks if the file is a compact, inference-only model
+     @return true if the training data must be omitted
+     */
+    bool compact() const { return compact_; }
+
+    /**
+     @brief Appends a boolean to the payload
+     @param value value to write
+     */
+    void writeBool(bool value);
+
+    /**
+     @brief Appends an unsigned integer to the payload (32 bits)
+     @param value value to write
+     */
+    void writeUInt(unsigned int value);
+
+    /**
+     @brief Appends a double-precision floating point value to the payload
+     @param value value to write
+     */
+    void writeDouble(double value);
+
+    /**
+     @brief Appends a string to the payload
+     @param value value to write
+     */
+    void writeString(std::string const& value);
+
+    /**
+     @brief Appends an array of single-precision values to the payload
+     @param values values to write
+     */
+    void writeVector(std::vector<float> const& values);
+
+    /**
+     @brief Appends an array of double-precision values to the payload
+     @param values values to write
+     */
+    void writeVector(std::vector<double> const& values);
+
+    /**
+     @brief Appends an array of unsigned integers to the payload
+     @param values values to write
+     */
+    void writeVector(std::vector<unsigned int> const& values);
+
+    /**
+     @brief Appends an array of strings to the payload
+     @param values values to write
+     */
+    void writeVector(std::vector<std::string> const& values);
+
+    /**
+     @brief Appends an array of parameters to the payload
+     @details the values of quantized compact files are stored with the
+     precision of the file and a per-tensor scale. Otherwise, the array is
+     written with writeVector().
+     @param values values to write
+     @throws runtime_error if quantized values are not finite
+     */
+    void writeParameters(std::vector<float> const& values);
+
+    /**
+     @brief Appends an array of parameters to the payload
+     @details the values of quantized compact files are stored with the
+     precision of the file and a per-tensor scale. Otherwise, the array is
+     written with writeVector().
+     @param values values to write
+     @param preserve_nonzero if true, the nonzero values must not be flushed
+     to zero by the quantization (e.g. variances or precisions)
+     @throws runtime_error if quantized values are not finite, or if a
+     nonzero value that must be preserved is below the range of half
+     precision relative to the largest value
+     */
+    void writeParameters(std::vector<double> const& values,
+                         bool preserve_nonzero = false);
+
+    /**
+     @brief Writes the header and the payload to a stream
+     @param stream output stream (opened in binary mode)
+     @param model_type type of the model
+     @throws runtime_error if the stream cannot be written
+     */
+    void save(std::ostream& stream, unsigned int model_type) const;
+
+  protected:
+    /**
+     @brief Appends raw bytes to the payload
+     */
+    char* append(std::size_t size);
+
+    /**
+     @brief Appends quantized values to the payload
+     */
+    template <typename T>
+    void writeQuantized(const T* values, std::size_t size,
+                        bool preserve_nonzero);
+
+    /**
+     @brief Payload of the file
+     */
+    std::vector<char> payload_;
+
+    /**
+     @brief Defines if the file is a compact, inference-only model
+     */
+    bool compact_;
+
+    /**
+     @brief Storage precision of the parameters of compact files
+     */
+    BinaryPrecision precision_;
+};
+
+/**
+ @ingroup Common
+ @brief Reader of the binary model format
+ @details The payload is read from the stream in a single block, and its
+ checksum is verified before any field is decoded. The fields are then read
+ sequentially, in the order in which they were written by a BinaryWriter.
+ @see BinaryWriter
+ */
+class BinaryReader {
+  public:
+    /**
+     @brief Constructor: reads and verifies a binary model file
+     @param stream input stream (opened in binary mode)
+     @param model_type expected type of the model
+     @throws runtime_error if the stream is not a binary model file of the
+     given type, or if the file is truncated or corrupted
+     */
+    BinaryReader(std::istream& stream, unsigned int model_type);
+
+    /**
+     @brief Get the version of the format of the file
+     */
+    unsigned int version() const { return version_; }
+
+    /**
+     @brief Checks if the file is a compact, inference-only model
+     @return true if the training data was omitted
+     */
+    bool compact() const { return version_ >= 2; }
+
+    /**
+     @brief Get the storage precision of the parameters
+     */
+    BinaryPrecision precision() const { return precision_; }
+
+    /**
+     @brief Reads a boolean from the payload
+     */
+    bool readBool();
+
+    /**
+     @brief Reads an unsigned integer from the payload (32 bits)
+     */
+    unsigned int readUInt();
+
+    /**
+     @brief Reads a number of elements from the payload
+     @details the number is checked against the size of the remaining
+     payload, so that it can be used to allocate memory.
+     */
+    unsigned int readSize();
+
+    /**
+     @brief Reads a double-precision floating point value from the payload
+     */
+    double readDouble();
+
+    /**
+     @brief Reads a string from the payload
+     */
+    std::string readString();
+
+    /**
+     @brief Reads an array of single-precision values from the payload
+     @param values vector in which the values are read (resized)
+     */
+    void readVector(std::vector<float>& values);
+
+    /**
+     @brief Reads an array of single-precision values of known size
+     @param values vector in which the values are read (resized)
+     @param size expected number of elements
+     @throws runtime_error if the array does not have the expected size
+     */
+    void readVector(std::vector<float>& values, std::size_t size);
+
+    /**
+     @brief Reads an array of double-precision values from the payload
+     @param values vector in which the values are read (resized)
+     */
+    void readVector(std::vector<double>& values);
+
+    /**
+     @brief Reads an array of double-precision values of known size
+     @param values vector in which the values are read (resized)
+     @param size expected number of elements
+     @throws runtime_error if the array does not have the expected size
+     */
+    void readVector(std::vector<double>& values, std::size_t size);
+
+    /**
+     @brief Reads an array of unsigned integers from the payload
+     @param values vector in which the values are read (resized)
+     */
+    void readVector(std::vector<unsigned int>& values);
+
+    /**
+     @brief Reads an array of unsigned integers of known size
+     @param values vector in which the values are read (resized)
+     @param size expected number of elements
+     @throws runtime_error if the array does not have the expected size
+     */
+    void readVector(std::vector<unsigned int>& values, std::size_t size);
+
+    /**
+     @brief Reads an array of strings from the payload
+     @param values vector in which the values are read (resized)
+     */
+    void readVector(std::vector<std::string>& values);
+
+    /**
+     @brief Reads an array of parameters written by
+     BinaryWriter::writeParameters()
+     @param values vector in which the values are read (resized)
+     @param size expected number of elements (any size if omitted)
+     @throws runtime_error if the array does not have the expected size
+     */
+    void readParameters(std::vector<float>& values,
+                        std::size_t size = static_cast<std::size_t>(-1));
+
+    /**
+     @brief Reads an array of parameters written by
+     BinaryWriter::writeParameters()
+     @param values vector in which the values are read (resized)
+     @param size expected number of elements (any size if omitted)
+     @throws runtime_error if the array does not have the expected size
+     */
+    void readParameters(std::vector<double>& values,
+                        std::size_t size = static_cast<std::size_t>(-1));
+
+    /**
+     @brief Reads a symmetric matrix written by
+     BinaryWriter::writeParameters()
+     @details the matrix can be diagonal or packed, and square matrices are
+     packed
+     @param values vector in which the matrix is read (resized to
+     packedSize(dimension), or to dimension for diagonal matrices)
+     @param dimension dimension of the matrix
+     @throws runtime_error if the array does not have a valid size
+     */
+    void readSymmetric(std::vector<double>& values, unsigned int dimension);
+
+    /**
+     @brief Checks that the whole payload has been read
+     @throws runtime_error if some data remains in the payload
+     */
+    void checkEnd() const;
+
+  protected:
+    /**
+     @brief Consumes raw bytes from the payload
+     @throws runtime_error if the payload contains less than size bytes
+     */
+    const char* take(std::size_t size);
+
+    /**
+     @brief Reads the size of an array and checks it
+     */
+    std::size_t readArraySize(std::size_t element_size,
+                              std::size_t expected_size);
+
+    /**
+     @brief Reads quantized values from the payload
+     */
+    template <typename T>
+    void readQuantized(std::vector<T>& values, std::size_t expected_size);
+
+    /**
+     @brief Payload of the file
+     */
+    std::vector<char> payload_;
+
+    /**
+     @brief Position of the next field in the payload
+     */
+    std::size_t position_;
+
+    /**
+     @brief Version of the format of the file
+     */
+    unsigned int version_;
+
+    /**
+     @brief Storage precision of the parameters
+     */
+    BinaryPrecision precision_;
+};
+}
+
+#endif
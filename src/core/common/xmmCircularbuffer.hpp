@@ -33,7 +33,10 @@
 #ifndef xmmCircularbuffer_h
 #define xmmCircularbuffer_h
 
+#include <cmath>
 #include <exception>
+#include <functional>
+#include <limits>
 #include <stdexcept>
 #include <vector>
 
@@ -41,7 +44,13 @@ namespace xmm {
 /**
  @ingroup Common
  @brief Simple CircularBuffer Class
- @details Multichannel Circular Buffer
+ @details Multichannel Circular Buffer. The buffer maintains running
+ aggregates of its content (sum, mean, variance, minimum and maximum of each
+ channel), updated in constant amortized time when an element is pushed. The
+ sums are compensated and resynchronized with the content of the buffer once
+ per revolution. Non-finite values are counted separately and propagate to
+ the sum, mean and variance as in a direct summation; NaN values are ignored
+ by the minimum and maximum.
  @tparam T Data type
  @tparam channels number of channels
  */
@@ -56,9 +65,12 @@ class CircularBuffer {
         length_ = length;
         for (int c = 0; c < channels; c++) {
             data_[c].resize(length_);
+            minima_[c].resize(length_);
+            maxima_[c].resize(length_);
         }
         current_index_ = 0;
         full_ = false;
+        clearAggregates();
     }
 
     /**
@@ -80,6 +92,7 @@ class CircularBuffer {
     void clear() {
         current_index_ = 0;
         full_ = false;
+        clearAggregates();
     }
 
     /**
@@ -90,37 +103,20 @@ class CircularBuffer {
     void push(T const value) {
         if (channels > 1)
             throw std::invalid_argument("You must pass a vector or array");
-        data_[0][current_index_] = value;
-        current_index_++;
-        if (current_index_ == length_) full_ = true;
-        current_index_ %= length_;
+        pushValues(&value);
     }
 
     /**
      @brief Add an element to the buffer (multi-channel method)
      @param value element to add to the buffer
      */
-    void push(T const *value) {
-        for (int c = 0; c < channels; c++) {
-            data_[c][current_index_] = value[c];
-        }
-        current_index_++;
-        if (current_index_ == length_) full_ = true;
-        current_index_ %= length_;
-    }
+    void push(T const *value) { pushValues(value); }
 
     /**
      @brief Add an element to the buffer (multi-channel method)
      @param value element to add to the buffer
      */
-    void push(std::vector<T> const &value) {
-        for (int c = 0; c < channels; c++) {
-            data_[c][current_index_] = value[c];
-        }
-        current_index_++;
-        if (current_index_ == length_) full_ = true;
-        current_index_ %= length_;
-    }
+    void push(std::vector<T> const &value) { pushValues(&value[0]); }
 
     /**
      @brief Get the size of the CircularBuffer
@@ -137,6 +133,8 @@ class CircularBuffer {
 
     /**
      @brief Resize the buffer to a specific length
+     @details the running aggregates are recomputed from the content of the
+     buffer
      @param length target length of the CircularBuffer
      */
     void resize(unsigned int length) {
@@ -150,7 +148,10 @@ class CircularBuffer {
         length_ = length;
         for (int c = 0; c < channels; c++) {
             data_[c].resize(length_);
+            minima_[c].resize(length_);
+            maxima_[c].resize(length_);
         }
+        rebuildAggregates();
     }
 
     /**
@@ -159,17 +160,304 @@ class CircularBuffer {
      */
     std::vector<T> mean() const {
         std::vector<T> _mean(channels, 0.0);
-        int size = full_ ? length_ : current_index_;
         for (int c = 0; c < channels; c++) {
-            for (int i = 0; i < size; i++) {
-                _mean[c] += data_[c][i];
-            }
-            _mean[c] /= T(size);
+            _mean[c] = mean(c);
         }
         return _mean;
     }
 
+    /** @name Running aggregates */
+    ///@{
+
+    /**
+     @brief Get the sum of a channel of the buffer
+     @param channel channel index
+     @return sum of the elements of the channel
+     */
+    T sum(unsigned int channel) const {
+        T non_finite;
+        if (nonFiniteAggregate(channel, non_finite)) return non_finite;
+        Aggregates const &a = aggregates_[channel];
+        return a.shift * T(finiteSize(channel)) + a.sum + a.sum_compensation;
+    }
+
+    /**
+     @brief Get the mean of a channel of the buffer
+     @param channel channel index
+     @return mean of the elements of the channel (NaN if the buffer is empty)
+     */
+    T mean(unsigned int channel) const {
+        if (size_t() == 0) return std::numeric_limits<T>::quiet_NaN();
+        T non_finite;
+        if (nonFiniteAggregate(channel, non_finite)) return non_finite;
+        Aggregates const &a = aggregates_[channel];
+        return a.shift + (a.sum + a.sum_compensation) / T(size_t());
+    }
+
+    /**
+     @brief Get the (biased) variance of a channel of the buffer
+     @param channel channel index
+     @return variance of the elements of the channel (NaN if the buffer is
+     empty or contains non-finite values)
+     */
+    T variance(unsigned int channel) const {
+        checkChannel(channel);
+        Aggregates const &a = aggregates_[channel];
+        if (size_t() == 0 || a.nan_count > 0 || a.positive_inf_count > 0 ||
+            a.negative_inf_count > 0)
+            return std::numeric_limits<T>::quiet_NaN();
+        T n = T(size_t());
+        T centered_mean = (a.sum + a.sum_compensation) / n;
+        T v = (a.sum_squares + a.sum_squares_compensation) / n -
+              centered_mean * centered_mean;
+        return (v > T(0)) ? v : T(0);
+    }
+
+    /**
+     @brief Get the minimum of a channel of the buffer
+     @param channel channel index
+     @return minimum of the (non-NaN) elements of the channel
+     @throws out_of_range if the channel contains no value
+     */
+    T min(unsigned int channel) const {
+        checkChannel(channel);
+        return minima_[channel].front();
+    }
+
+    /**
+     @brief Get the maximum of a channel of the buffer
+     @param channel channel index
+     @return maximum of the (non-NaN) elements of the channel
+     @throws out_of_range if the channel contains no value
+     */
+    T max(unsigned int channel) const {
+        checkChannel(channel);
+        return maxima_[channel].front();
+    }
+
+    ///@}
+
   protected:
+    /**
+     @brief Running aggregates of a channel
+     @details the finite values are accumulated relative to a shift (the mean
+     of the buffer at the last resynchronization) to limit the cancellation in
+     the variance.
+     */
+    struct Aggregates {
+        T shift;
+        T sum;
+        T sum_compensation;
+        T sum_squares;
+        T sum_squares_compensation;
+        unsigned int nan_count;
+        unsigned int positive_inf_count;
+        unsigned int negative_inf_count;
+    };
+
+    /**
+     @brief Monotonic queue of (value, stamp) pairs, stored in a preallocated
+     ring (sliding-window minimum or maximum)
+     @tparam Compare strict ordering: the front of the queue is the extremum
+     */
+    template <typename Compare>
+    class MonotonicQueue {
+      public:
+        MonotonicQueue() : head_(0), size_(0) {}
+
+        void resize(unsigned int capacity) {
+            values_.resize(capacity);
+            stamps_.resize(capacity);
+            clear();
+        }
+
+        void clear() {
+            head_ = 0;
+            size_ = 0;
+        }
+
+        /**
+         @brief push a value and discard the values older than the window
+         */
+        void push(T value, unsigned long stamp, unsigned int window) {
+            while (size_ > 0 && stamps_[head_] + window <= stamp) {
+                head_ = (head_ + 1) % values_.size();
+                size_--;
+            }
+            if (value != value) return;  // NaN
+            while (size_ > 0 && !Compare()(values_[back()], value)) size_--;
+            unsigned int tail = (head_ + size_) % values_.size();
+            values_[tail] = value;
+            stamps_[tail] = stamp;
+            size_++;
+        }
+
+        T front() const {
+            if (size_ == 0)
+                throw std::out_of_range("CircularBuffer: no value in buffer");
+            return values_[head_];
+        }
+
+      protected:
+        unsigned int back() const {
+            return (head_ + size_ - 1) % values_.size();
+        }
+
+        std::vector<T> values_;
+        std::vector<unsigned long> stamps_;
+        unsigned int head_;
+        unsigned int size_;
+    };
+
+    /**
+     @brief Add an element to the buffer and update the running aggregates
+     */
+    void pushValues(T const *value) {
+        for (int c = 0; c < channels; c++) {
+            if (size_t() == 0)
+                aggregates_[c].shift = std::isfinite(value[c]) ? value[c] : 0;
+            if (full_) accumulate(c, data_[c][current_index_], -1);
+            data_[c][current_index_] = value[c];
+            accumulate(c, value[c], 1);
+            minima_[c].push(value[c], stamp_, length_);
+            maxima_[c].push(value[c], stamp_, length_);
+        }
+        stamp_++;
+        current_index_++;
+        if (current_index_ == length_) full_ = true;
+        current_index_ %= length_;
+        if (current_index_ == 0) resynchronize();
+    }
+
+    /**
+     @brief Add (sign = 1) or remove (sign = -1) a value from the aggregates
+     */
+    void accumulate(unsigned int channel, T value, int sign) {
+        Aggregates &a = aggregates_[channel];
+        if (value != value) {
+            a.nan_count += sign;
+        } else if (std::isinf(value)) {
+            if (value > 0)
+                a.positive_inf_count += sign;
+            else
+                a.negative_inf_count += sign;
+        } else {
+            T centered = value - a.shift;
+            compensatedAdd(a.sum, a.sum_compensation, sign * centered);
+            compensatedAdd(a.sum_squares, a.sum_squares_compensation,
+                           sign * centered * centered);
+        }
+    }
+
+    /**
+     @brief Neumaier compensated summation
+     */
+    static void compensatedAdd(T &sum, T &compensation, T value) {
+        T t = sum + value;
+        if (std::fabs(sum) >= std::fabs(value))
+            compensation += (sum - t) + value;
+        else
+            compensation += (value - t) + sum;
+        sum = t;
+    }
+
+    /**
+     @brief Recompute the sums from the content of the buffer (removes the
+     drift of the incremental updates)
+     */
+    void resynchronize() {
+        unsigned int size = size_t();
+        for (int c = 0; c < channels; c++) {
+            Aggregates &a = aggregates_[c];
+            T sum(0), compensation(0);
+            unsigned int finite(0);
+            for (unsigned int i = 0; i < size; i++) {
+                if (std::isfinite(data_[c][i])) {
+                    compensatedAdd(sum, compensation, data_[c][i]);
+                    finite++;
+                }
+            }
+            T shift = (finite > 0) ? (sum + compensation) / T(finite) : T(0);
+            a = Aggregates();
+            a.shift = shift;
+            for (unsigned int i = 0; i < size; i++)
+                accumulate(c, data_[c][i], 1);
+        }
+    }
+
+    /**
+     @brief Recompute all aggregates (including the extrema) from the content
+     of the buffer
+     */
+    void rebuildAggregates() {
+        unsigned int size = size_t();
+        unsigned int oldest = full_ ? current_index_ : 0;
+        stamp_ = 0;
+        for (int c = 0; c < channels; c++) {
+            minima_[c].clear();
+            maxima_[c].clear();
+        }
+        for (unsigned int i = 0; i < size; i++, stamp_++) {
+            unsigned int index = (oldest + i) % length_;
+            for (int c = 0; c < channels; c++) {
+                minima_[c].push(data_[c][index], stamp_, length_);
+                maxima_[c].push(data_[c][index], stamp_, length_);
+            }
+        }
+        resynchronize();
+    }
+
+    /**
+     @brief Reset the aggregates of an empty buffer
+     */
+    void clearAggregates() {
+        stamp_ = 0;
+        for (int c = 0; c < channels; c++) {
+            aggregates_[c] = Aggregates();
+            minima_[c].clear();
+            maxima_[c].clear();
+        }
+    }
+
+    /**
+     @brief Get the sum or mean of a channel containing non-finite values
+     @return true if the channel contains non-finite values
+     */
+    bool nonFiniteAggregate(unsigned int channel, T &value) const {
+        checkChannel(channel);
+        Aggregates const &a = aggregates_[channel];
+        if (a.nan_count > 0 ||
+            (a.positive_inf_count > 0 && a.negative_inf_count > 0)) {
+            value = std::numeric_limits<T>::quiet_NaN();
+            return true;
+        }
+        if (a.positive_inf_count > 0 || a.negative_inf_count > 0) {
+            value = (a.positive_inf_count > 0)
+                        ? std::numeric_limits<T>::infinity()
+                        : -std::numeric_limits<T>::infinity();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     @brief Get the number of finite values of a channel
+     */
+    unsigned int finiteSize(unsigned int channel) const {
+        Aggregates const &a = aggregates_[channel];
+        return size_t() - a.nan_count - a.positive_inf_count -
+               a.negative_inf_count;
+    }
+
+    /**
+     @brief Checks the channel index
+     @throws out_of_range if the channel does not exist
+     */
+    void checkChannel(unsigned int channel) const {
+        if (channel >= channels)
+            throw std::out_of_range("CircularBuffer: channel out of bounds");
+    }
+
     /**
      @brief buffer data
      */
@@ -189,7 +477,27 @@ class CircularBuffer {
      @brief Defines if the CircularBuffer is already full
      */
     bool full_;
+
+    /**
+     @brief Number of elements pushed since the buffer was cleared
+     */
+    unsigned long stamp_;
+
+    /**
+     @brief Running sums of each channel
+     */
+    Aggregates aggregates_[channels];
+
+    /**
+     @brief Sliding-window minimum of each channel
+     */
+    MonotonicQueue<std::less<T> > minima_[channels];
+
+    /**
+     @brief Sliding-window maximum of each channel
+     */
+    MonotonicQueue<std::greater<T> > maxima_[channels];
 };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -35,6 +35,7 @@
 
 #include "../../../dependencies/jsoncpp/include/json.h"
 #include <fstream>
+#include <stdexcept>
 #include <vector>
 
 namespace xmm {
@@ -67,6 +68,32 @@ class Writable {
      */
     virtual void fromJson(Json::Value const& root) = 0;
 
+    /**
+     @brief Write the object to a stream in JSON format
+     @details the default implementation writes the result of toJson().
+     Classes holding large amounts of data write their JSON representation
+     incrementally.
+     @param stream output stream
+     */
+    virtual void writeJson(std::ostream& stream) const { stream << toJson(); }
+
+    /**
+     @brief Read the object from a stream in JSON format
+     @details the default implementation parses the complete document before
+     calling fromJson(). Classes holding large amounts of data build their
+     data as the document is parsed.
+     @param stream input stream
+     @throws runtime_error if the document cannot be parsed
+     @throws JsonException if the JSON value has a wrong format
+     */
+    virtual void readJson(std::istream& stream) {
+        Json::Value root;
+        Json::Reader reader;
+        if (!reader.parse(stream, root))
+            throw std::runtime_error("Cannot Parse Json File");
+        fromJson(root);
+    }
+
 ///@}
 
 #ifdef SWIGPYTHON
@@ -81,7 +108,7 @@ class Writable {
     void writeFile(char* fileName) const {
         std::ofstream outStream;
         outStream.open(fileName);
-        outStream << this->toJson();
+        this->writeJson(outStream);
         outStream.close();
     }
 
@@ -91,22 +118,9 @@ class Writable {
      @warning only defined if SWIGPYTHON is defined
      */
     void readFile(char* fileName) {
-        std::string jsonstring;
         std::ifstream inStream;
         inStream.open(fileName);
-        //            inStream.seekg(0, std::ios::end);
-        //            jsonstring.reserve(inStream.tellg());
-        //            inStream.seekg(0, std::ios::beg);
-        //
-        //            jsonstring.assign((std::istreambuf_iterator<char>(inStream)),
-        //                              std::istreambuf_iterator<char>());
-        Json::Value root;
-        Json::Reader reader;
-        if (reader.parse(inStream, root)) {
-            this->fromJson(root);
-        } else {
-            throw std::runtime_error("Cannot Parse Json File");
-        }
+        this->readJson(inStream);
         inStream.close();
     }
 
@@ -0,0 +1,594 @@
+/*
+ * xmmJsonStream.cpp
+ *
+ * Streaming JSON Writer and Reader
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "xmmJsonStream.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+/**
+ @brief printf format of the double-precision values (same as jsoncpp)
+ */
+const char* kDoubleFormat = "%.17g";
+
+/**
+ @brief printf format of the single-precision values
+ */
+const char* kFloatFormat = "%.9g";
+
+/**
+ @brief Appends a unicode code point to a string, encoded in UTF-8
+ */
+void appendUtf8(std::string& s, unsigned int code) {
+    if (code < 0x80) {
+        s += static_cast<char>(code);
+    } else if (code < 0x800) {
+        s += static_cast<char>(0xC0 | (code >> 6));
+        s += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        s += static_cast<char>(0xE0 | (code >> 12));
+        s += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        s += static_cast<char>(0xF0 | (code >> 18));
+        s += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        s += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+}
+
+#pragma mark -
+#pragma mark Writer
+xmm::JsonStreamWriter::JsonStreamWriter(std::ostream& stream)
+    : stream_(stream), after_key_(false) {}
+
+void xmm::JsonStreamWriter::beginObject() {
+    separate();
+    stream_.put('{');
+    empty_.push_back(true);
+}
+
+void xmm::JsonStreamWriter::endObject() { close('}'); }
+
+void xmm::JsonStreamWriter::beginArray() {
+    separate();
+    stream_.put('[');
+    empty_.push_back(true);
+}
+
+void xmm::JsonStreamWriter::endArray() { close(']'); }
+
+void xmm::JsonStreamWriter::key(std::string const& name) {
+    value(name);
+    stream_.put(':');
+    after_key_ = true;
+}
+
+void xmm::JsonStreamWriter::value(bool value) {
+    separate();
+    if (value)
+        stream_.write("true", 4);
+    else
+        stream_.write("false", 5);
+}
+
+void xmm::JsonStreamWriter::value(int value) {
+    separate();
+    char buffer[16];
+    int length = snprintf(buffer, sizeof(buffer), "%d", value);
+    stream_.write(buffer, length);
+}
+
+void xmm::JsonStreamWriter::value(unsigned int value) {
+    separate();
+    char buffer[16];
+    int length = snprintf(buffer, sizeof(buffer), "%u", value);
+    stream_.write(buffer, length);
+}
+
+void xmm::JsonStreamWriter::value(float value) {
+    separate();
+    number(kFloatFormat, value);
+}
+
+void xmm::JsonStreamWriter::value(double value) {
+    separate();
+    number(kDoubleFormat, value);
+}
+
+void xmm::JsonStreamWriter::value(std::string const& value) {
+    separate();
+    stream_.put('"');
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                stream_.write("\\\"", 2);
+                break;
+            case '\\':
+                stream_.write("\\\\", 2);
+                break;
+            case '\b':
+                stream_.write("\\b", 2);
+                break;
+            case '\f':
+                stream_.write("\\f", 2);
+                break;
+            case '\n':
+                stream_.write("\\n", 2);
+                break;
+            case '\r':
+                stream_.write("\\r", 2);
+                break;
+            case '\t':
+                stream_.write("\\t", 2);
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x",
+                             static_cast<unsigned int>(c));
+                    stream_.write(buffer, 6);
+                } else {
+                    stream_.put(c);
+                }
+        }
+    }
+    stream_.put('"');
+}
+
+void xmm::JsonStreamWriter::value(char const* value) {
+    this->value(std::string(value));
+}
+
+void xmm::JsonStreamWriter::value(Json::Value const& value) {
+    switch (value.type()) {
+        case Json::nullValue:
+            separate();
+            stream_.write("null", 4);
+            break;
+        case Json::intValue:
+            separate();
+            stream_ << value.asLargestInt();
+            break;
+        case Json::uintValue:
+            separate();
+            stream_ << value.asLargestUInt();
+            break;
+        case Json::realValue:
+            this->value(value.asDouble());
+            break;
+        case Json::stringValue:
+            this->value(value.asString());
+            break;
+        case Json::booleanValue:
+            this->value(value.asBool());
+            break;
+        case Json::arrayValue:
+            beginArray();
+            for (Json::ArrayIndex i = 0; i < value.size(); i++)
+                this->value(value[i]);
+            endArray();
+            break;
+        case Json::objectValue:
+            beginObject();
+            for (auto const& name : value.getMemberNames()) {
+                key(name);
+                this->value(value[name]);
+            }
+            endObject();
+            break;
+    }
+}
+
+void xmm::JsonStreamWriter::array(float const* values, std::size_t size) {
+    beginArray();
+    for (std::size_t i = 0; i < size; i++) value(values[i]);
+    endArray();
+}
+
+void xmm::JsonStreamWriter::array(std::vector<float> const& values) {
+    array(values.data(), values.size());
+}
+
+void xmm::JsonStreamWriter::array(std::vector<double> const& values) {
+    beginArray();
+    for (double v : values) value(v);
+    endArray();
+}
+
+void xmm::JsonStreamWriter::array(std::vector<unsigned int> const& values) {
+    beginArray();
+    for (unsigned int v : values) value(v);
+    endArray();
+}
+
+void xmm::JsonStreamWriter::array(std::vector<std::string> const& values) {
+    beginArray();
+    for (auto const& v : values) value(v);
+    endArray();
+}
+
+void xmm::JsonStreamWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (empty_.empty()) return;
+    if (!empty_.back()) stream_.put(',');
+    empty_.back() = false;
+}
+
+void xmm::JsonStreamWriter::close(char delimiter) {
+    stream_.put(delimiter);
+    empty_.pop_back();
+    if (empty_.empty() && !stream_)
+        throw std::runtime_error("Cannot write Json stream");
+}
+
+void xmm::JsonStreamWriter::number(char const* format, double value) {
+    char buffer[32];
+    int length;
+    if (std::isfinite(value))
+        length = snprintf(buffer, sizeof(buffer), format, value);
+    else if (value != value)
+        length = snprintf(buffer, sizeof(buffer), "null");
+    else
+        length = snprintf(buffer, sizeof(buffer),
+                          (value < 0) ? "-1e+9999" : "1e+9999");
+    stream_.write(buffer, length);
+}
+
+#pragma mark -
+#pragma mark Reader
+xmm::JsonStreamReader::JsonStreamReader(std::istream& stream)
+    : buffer_(stream.rdbuf()), position_(0) {
+    if (!buffer_ || !stream) fail("invalid stream");
+}
+
+xmm::JsonStreamReader::Type xmm::JsonStreamReader::peek() {
+    int c = peekChar();
+    switch (c) {
+        case '{':
+            return Type::Object;
+        case '[':
+            return Type::Array;
+        case '"':
+            return Type::String;
+        case 't':
+        case 'f':
+            return Type::Bool;
+        case 'n':
+            return Type::Null;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) return Type::Number;
+    }
+    if (c == EOF) fail("unexpected end of stream");
+    fail("unexpected character");
+    return Type::Null;
+}
+
+void xmm::JsonStreamReader::beginObject() {
+    if (peek() != Type::Object)
+        throw JsonException(JsonException::JsonErrorType::JsonTypeError);
+    get();
+    first_.push_back(true);
+}
+
+bool xmm::JsonStreamReader::nextMember(std::string& name) {
+    if (peekChar() == '}') {
+        get();
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back()) expect(',');
+    first_.back() = false;
+    if (peekChar() != '"') fail("expected member name");
+    name = readString();
+    expect(':');
+    return true;
+}
+
+void xmm::JsonStreamReader::beginArray() {
+    if (peek() != Type::Array)
+        throw JsonException(JsonException::JsonErrorType::JsonTypeError);
+    get();
+    first_.push_back(true);
+}
+
+bool xmm::JsonStreamReader::nextElement() {
+    if (peekChar() == ']') {
+        get();
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back()) expect(',');
+    first_.back() = false;
+    return true;
+}
+
+bool xmm::JsonStreamReader::readBool() {
+    if (peek() != Type::Bool)
+        throw JsonException(JsonException::JsonErrorType::JsonTypeError);
+    if (peekChar() == 't') {
+        expectLiteral("true");
+        return true;
+    }
+    expectLiteral("false");
+    return false;
+}
+
+int xmm::JsonStreamReader::readInt() {
+    double value = readDouble();
+    if (value < -2147483648. || value > 2147483647.)
+        throw JsonException(JsonException::JsonErrorType::JsonValueError);
+    return static_cast<int>(value);
+}
+
+unsigned int xmm::JsonStreamReader::readUInt() {
+    double value = readDouble();
+    if (value < 0. || value > 4294967295.)
+        throw JsonException(JsonException::JsonErrorType::JsonValueError);
+    return static_cast<unsigned int>(value);
+}
+
+double xmm::JsonStreamReader::readDouble() {
+    Type type = peek();
+    if (type == Type::Null) {
+        expectLiteral("null");
+        return 0.;
+    }
+    if (type != Type::Number)
+        throw JsonException(JsonException::JsonErrorType::JsonTypeError);
+    std::string token = readNumberToken();
+    char* end;
+    double value = std::strtod(token.c_str(), &end);
+    if (*end != '\0') fail("invalid number");
+    return value;
+}
+
+std::string xmm::JsonStreamReader::readString() {
+    if (peek() != Type::String)
+        throw JsonException(JsonException::JsonErrorType::JsonTypeError);
+    get();
+    std::string value;
+    while (true) {
+        int c = get();
+        if (c == '"') break;
+        if (c != '\\') {
+            value += static_cast<char>(c);
+            continue;
+        }
+        c = get();
+        switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                value += static_cast<char>(c);
+                break;
+            case 'b':
+                value += '\b';
+                break;
+            case 'f':
+                value += '\f';
+                break;
+            case 'n':
+                value += '\n';
+                break;
+            case 'r':
+                value += '\r';
+                break;
+            case 't':
+                value += '\t';
+                break;
+            case 'u': {
+                unsigned int code = 0;
+                for (int i = 0; i < 4; i++) {
+                    c = get();
+                    code <<= 4;
+                    if (c >= '0' && c <= '9')
+                        code += c - '0';
+                    else if (c >= 'a' && c <= 'f')
+                        code += c - 'a' + 10;
+                    else if (c >= 'A' && c <= 'F')
+                        code += c - 'A' + 10;
+                    else
+                        fail("invalid unicode escape");
+                }
+                if (code >= 0xD800 && code < 0xDC00) {
+                    // surrogate pair
+                    expect('\\');
+                    expect('u');
+                    unsigned int low = 0;
+                    for (int i = 0; i < 4; i++) {
+                        c = get();
+                        low <<= 4;
+                        if (c >= '0' && c <= '9')
+                            low += c - '0';
+                        else if (c >= 'a' && c <= 'f')
+                            low += c - 'a' + 10;
+                        else if (c >= 'A' && c <= 'F')
+                            low += c - 'A' + 10;
+                        else
+                            fail("invalid unicode escape");
+                    }
+                    if (low < 0xDC00 || low >= 0xE000)
+                        fail("invalid unicode surrogate pair");
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(value, code);
+                break;
+            }
+            default:
+                fail("invalid escape sequence");
+        }
+    }
+    return value;
+}
+
+void xmm::JsonStreamReader::readArray(std::vector<float>& values) {
+    values.clear();
+    beginArray();
+    while (nextElement()) values.push_back(static_cast<float>(readDouble()));
+}
+
+void xmm::JsonStreamReader::readArray(std::vector<std::string>& values) {
+    values.clear();
+    beginArray();
+    while (nextElement()) values.push_back(readString());
+}
+
+Json::Value xmm::JsonStreamReader::readValue() {
+    switch (peek()) {
+        case Type::Null:
+            expectLiteral("null");
+            return Json::Value();
+        case Type::Bool:
+            return Json::Value(readBool());
+        case Type::String:
+            return Json::Value(readString());
+        case Type::Number: {
+            std::string token = readNumberToken();
+            char* end;
+            if (token.find_first_of(".eE") == std::string::npos) {
+                errno = 0;
+                long long value = std::strtoll(token.c_str(), &end, 10);
+                if (*end == '\0' && errno == 0) {
+                    if (value >= -2147483648LL && value <= 2147483647LL)
+                        return Json::Value(static_cast<Json::Int>(value));
+                    return Json::Value(static_cast<Json::LargestInt>(value));
+                }
+                errno = 0;
+                unsigned long long uvalue =
+                    std::strtoull(token.c_str(), &end, 10);
+                if (*end == '\0' && errno == 0 && token[0] != '-')
+                    return Json::Value(static_cast<Json::LargestUInt>(uvalue));
+            }
+            double value = std::strtod(token.c_str(), &end);
+            if (*end != '\0') fail("invalid number");
+            return Json::Value(value);
+        }
+        case Type::Array: {
+            Json::Value value(Json::arrayValue);
+            beginArray();
+            while (nextElement()) value.append(readValue());
+            return value;
+        }
+        case Type::Object: {
+            Json::Value value(Json::objectValue);
+            std::string name;
+            beginObject();
+            while (nextMember(name)) value[name] = readValue();
+            return value;
+        }
+    }
+    return Json::Value();
+}
+
+void xmm::JsonStreamReader::skipValue() {
+    std::string name;
+    switch (peek()) {
+        case Type::Null:
+            expectLiteral("null");
+            break;
+        case Type::Bool:
+            readBool();
+            break;
+        case Type::Number:
+            readNumberToken();
+            break;
+        case Type::String:
+            readString();
+            break;
+        case Type::Array:
+            beginArray();
+            while (nextElement()) skipValue();
+            break;
+        case Type::Object:
+            beginObject();
+            while (nextMember(name)) skipValue();
+            break;
+    }
+}
+
+void xmm::JsonStreamReader::checkEnd() {
+    if (peekChar() != EOF) fail("unexpected characters after the document");
+}
+
+int xmm::JsonStreamReader::peekChar() {
+    while (true) {
+        int c = buffer_->sgetc();
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return c;
+        buffer_->sbumpc();
+        position_++;
+    }
+}
+
+int xmm::JsonStreamReader::get() {
+    int c = buffer_->sbumpc();
+    if (c == EOF) fail("unexpected end of stream");
+    position_++;
+    return c;
+}
+
+void xmm::JsonStreamReader::expect(char c) {
+    if (peekChar() != c) fail(std::string("expected '") + c + "'");
+    get();
+}
+
+void xmm::JsonStreamReader::expectLiteral(char const* literal) {
+    peekChar();
+    for (char const* c = literal; *c != '\0'; c++)
+        if (get() != *c) fail("invalid literal");
+}
+
+std::string xmm::JsonStreamReader::readNumberToken() {
+    std::string token;
+    int c = peekChar();
+    while ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+           c == 'e' || c == 'E') {
+        token += static_cast<char>(get());
+        c = buffer_->sgetc();
+    }
+    if (token.empty()) fail("expected a number");
+    return token;
+}
+
+void xmm::JsonStreamReader::fail(std::string const& message) const {
+    throw std::runtime_error("Cannot Parse Json: " + message +
+                             " (at character " + std::to_string(position_) +
+                             ")");
+}
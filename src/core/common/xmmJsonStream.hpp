@@ -0,0 +1,371 @@
+/*
+ * xmmJsonStream.hpp
+ *
+ * Streaming JSON Writer and Reader
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef xmmJsonStream_h
+#define xmmJsonStream_h
+
+#include "xmmJson.hpp"
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace xmm {
+/**
+ @ingroup Common
+ @brief Streaming JSON writer
+ @details Writes a JSON document to a stream token by token, without building
+ the Json::Value of the complete document. The output is compact JSON that
+ can be read by Json::Reader as well as by JsonStreamReader. Floating point
+ values are written with the precision used by jsoncpp (17 significant digits
+ for double-precision values, 9 for single-precision values), so that they
+ are read back exactly.
+ */
+class JsonStreamWriter {
+  public:
+    /**
+     @brief Constructor
+     @param stream output stream
+     */
+    explicit JsonStreamWriter(std::ostream& stream);
+
+    /**
+     @brief Opens an object
+     */
+    void beginObject();
+
+    /**
+     @brief Closes the current object
+     @throws runtime_error if the document is complete and the stream cannot
+     be written
+     */
+    void endObject();
+
+    /**
+     @brief Opens an array
+     */
+    void beginArray();
+
+    /**
+     @brief Closes the current array
+     @throws runtime_error if the document is complete and the stream cannot
+     be written
+     */
+    void endArray();
+
+    /**
+     @brief Writes the name of the next member of the current object
+     @param name member name
+     */
+    void key(std::string const& name);
+
+    /**
+     @brief Writes a boolean
+     @param value value to write
+     */
+    void value(bool value);
+
+    /**
+     @brief Writes an integer
+     @param value value to write
+     */
+    void value(int value);
+
+    /**
+     @brief Writes an unsigned integer
+     @param value value to write
+     */
+    void value(unsigned int value);
+
+    /**
+     @brief Writes a single-precision floating point value
+     @param value value to write
+     */
+    void value(float value);
+
+    /**
+     @brief Writes a double-precision floating point value
+     @param value value to write
+     */
+    void value(double value);
+
+    /**
+     @brief Writes a string
+     @param value value to write
+     */
+    void value(std::string const& value);
+
+    /**
+     @brief Writes a string
+     @param value value to write
+     */
+    void value(char const* value);
+
+    /**
+     @brief Writes a Json Value (e.g. the parameters of a model)
+     @param value value to write
+     */
+    void value(Json::Value const& value);
+
+    /**
+     @brief Writes an array of single-precision values
+     @param values array
+     @param size size of the array
+     */
+    void array(float const* values, std::size_t size);
+
+    /**
+     @brief Writes an array of single-precision values
+     @param values values to write
+     */
+    void array(std::vector<float> const& values);
+
+    /**
+     @brief Writes an array of double-precision values
+     @param values values to write
+     */
+    void array(std::vector<double> const& values);
+
+    /**
+     @brief Writes an array of unsigned integers
+     @param values values to write
+     */
+    void array(std::vector<unsigned int> const& values);
+
+    /**
+     @brief Writes an array of strings
+     @param values values to write
+     */
+    void array(std::vector<std::string> const& values);
+
+  protected:
+    /**
+     @brief Writes the separator preceding a value, if needed
+     */
+    void separate();
+
+    /**
+     @brief Closes the current object or array
+     */
+    void close(char delimiter);
+
+    /**
+     @brief Writes a number formatted with printf
+     */
+    void number(char const* format, double value);
+
+    /**
+     @brief Output stream
+     */
+    std::ostream& stream_;
+
+    /**
+     @brief Specifies, for each open object or array, if it is still empty
+     */
+    std::vector<bool> empty_;
+
+    /**
+     @brief Specifies if a member name has just been written
+     */
+    bool after_key_;
+};
+
+/**
+ @ingroup Common
+ @brief Streaming JSON reader
+ @details Pull parser reading a JSON document from a stream token by token.
+ The readers of the models and training sets use it to fill their data
+ arrays as they are parsed, without building the Json::Value of the complete
+ document. Subtrees of limited size can still be read as Json::Value with
+ readValue().
+
+ Syntax errors throw runtime_error; values that do not have the expected type
+ throw JsonException.
+ */
+class JsonStreamReader {
+  public:
+    /**
+     @brief Type of a JSON value
+     */
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    /**
+     @brief Constructor
+     @param stream input stream
+     */
+    explicit JsonStreamReader(std::istream& stream);
+
+    /**
+     @brief Get the type of the next value
+     @return type of the next value
+     @throws runtime_error if the stream does not contain a value
+     */
+    Type peek();
+
+    /**
+     @brief Opens an object
+     @throws JsonException if the next value is not an object
+     */
+    void beginObject();
+
+    /**
+     @brief Reads the name of the next member of the current object
+     @details the object is closed when all its members have been read
+     @param name name of the member
+     @return false if the object has no more members
+     */
+    bool nextMember(std::string& name);
+
+    /**
+     @brief Opens an array
+     @throws JsonException if the next value is not an array
+     */
+    void beginArray();
+
+    /**
+     @brief Moves to the next element of the current array
+     @details the array is closed when all its elements have been read
+     @return false if the array has no more elements
+     */
+    bool nextElement();
+
+    /**
+     @brief Reads a boolean
+     @return value
+     */
+    bool readBool();
+
+    /**
+     @brief Reads an integer
+     @return value
+     */
+    int readInt();
+
+    /**
+     @brief Reads an unsigned integer
+     @return value
+     */
+    unsigned int readUInt();
+
+    /**
+     @brief Reads a floating point value (null values are read as 0)
+     @return value
+     */
+    double readDouble();
+
+    /**
+     @brief Reads a string
+     @return value
+     */
+    std::string readString();
+
+    /**
+     @brief Reads an array of single-precision values
+     @param values values (the vector is resized to the size of the array)
+     */
+    void readArray(std::vector<float>& values);
+
+    /**
+     @brief Reads an array of strings
+     @param values values (the vector is resized to the size of the array)
+     */
+    void readArray(std::vector<std::string>& values);
+
+    /**
+     @brief Reads the next value as a Json Value
+     @return value
+     */
+    Json::Value readValue();
+
+    /**
+     @brief Skips the next value
+     */
+    void skipValue();
+
+    /**
+     @brief Checks that the document is complete
+     @throws runtime_error if the stream contains more than one value
+     */
+    void checkEnd();
+
+  protected:
+    /**
+     @brief Get the next non-whitespace character, without consuming it
+     */
+    int peekChar();
+
+    /**
+     @brief Consumes the next character
+     */
+    int get();
+
+    /**
+     @brief Consumes an expected character
+     */
+    void expect(char c);
+
+    /**
+     @brief Consumes an expected literal (true, false, null)
+     */
+    void expectLiteral(char const* literal);
+
+    /**
+     @brief Reads the characters of a number
+     */
+    std::string readNumberToken();
+
+    /**
+     @brief Throws a syntax error
+     */
+    void fail(std::string const& message) const;
+
+    /**
+     @brief Input stream buffer
+     */
+    std::streambuf* buffer_;
+
+    /**
+     @brief Number of characters consumed
+     */
+    std::size_t position_;
+
+    /**
+     @brief Specifies, for each open object or array, if no member or element
+     has been read yet
+     */
+    std::vector<bool> first_;
+};
+}
+
+#endif
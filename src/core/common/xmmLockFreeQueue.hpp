@@ -0,0 +1,252 @@
+/*
+ * xmmLockFreeQueue.hpp
+ *
+ * Wait-free single-producer single-consumer ring buffer
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef xmmLockFreeQueue_h
+#define xmmLockFreeQueue_h
+
+#include <atomic>
+#include <vector>
+
+namespace xmm {
+/**
+ @ingroup Common
+ @brief Bounded Single-Producer Single-Consumer Queue
+ @details Ring of preallocated slots shared by exactly one producer thread and
+ one consumer thread, without locks. The producer only writes the tail index
+ and the consumer only writes the head index, so that both sides complete in
+ a bounded number of steps. The elements are copy-assigned into the existing
+ slots: when the slots are built from a prototype of the right size (e.g.
+ vectors of the dimension of the observations), pushing and popping elements
+ does not allocate.
+
+ The methods of the producer (push, writeSlot, commit) and of the consumer
+ (front, pop) can be called concurrently. All the other methods (resize,
+ clear, copy and assignment) require that no thread uses the queue.
+ @tparam T Data type
+ */
+template <typename T>
+class LockFreeQueue {
+  public:
+    /**
+     @brief Constructor
+     @param capacity maximum number of elements in the queue
+     @param prototype value used to initialize the slots
+     */
+    explicit LockFreeQueue(unsigned int capacity = 0, T const& prototype = T())
+        : slots_(capacity + 1, prototype), head_(0), tail_(0) {}
+
+    /**
+     @brief Copy Constructor
+     @details the elements of the source queue are copied
+     @param src Source Queue
+     */
+    LockFreeQueue(LockFreeQueue<T> const& src)
+        : slots_(src.slots_),
+          head_(src.head_.load(std::memory_order_acquire)),
+          tail_(src.tail_.load(std::memory_order_acquire)) {}
+
+    /**
+     @brief Assignment
+     @param src Source Queue
+     */
+    LockFreeQueue<T>& operator=(LockFreeQueue<T> const& src) {
+        if (this != &src) {
+            slots_ = src.slots_;
+            head_.store(src.head_.load(std::memory_order_acquire),
+                        std::memory_order_release);
+            tail_.store(src.tail_.load(std::memory_order_acquire),
+                        std::memory_order_release);
+        }
+        return *this;
+    }
+
+    /**
+     @brief Reallocates the queue
+     @details the queue is emptied and all the slots are set to the prototype
+     @param capacity maximum number of elements in the queue
+     @param prototype value used to initialize the slots
+     */
+    void resize(unsigned int capacity, T const& prototype = T()) {
+        slots_.assign(capacity + 1, prototype);
+        clear();
+    }
+
+    /**
+     @brief Empties the queue
+     */
+    void clear() {
+        head_.store(0, std::memory_order_release);
+        tail_.store(0, std::memory_order_release);
+    }
+
+    /**
+     @brief Get the maximum number of elements in the queue
+     @return capacity of the queue
+     */
+    unsigned int capacity() const {
+        return slots_.empty() ? 0 : static_cast<unsigned int>(slots_.size()) - 1;
+    }
+
+    /**
+     @brief Get the number of elements in the queue
+     @details the value is only a snapshot when the queue is used concurrently
+     @return number of elements in the queue
+     */
+    unsigned int size() const {
+        unsigned int head = head_.load(std::memory_order_acquire);
+        unsigned int tail = tail_.load(std::memory_order_acquire);
+        return (tail >= head)
+                   ? tail - head
+                   : tail + static_cast<unsigned int>(slots_.size()) - head;
+    }
+
+    /**
+     @brief Checks if the queue is empty
+     @return true if the queue contains no element
+     */
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) ==
+               tail_.load(std::memory_order_acquire);
+    }
+
+    /** @name Producer */
+    ///@{
+
+    /**
+     @brief Get the slot of the next element to write
+     @details the element is published by a call to commit()
+     @return a pointer to the slot, or NULL if the queue is full
+     */
+    T* writeSlot() {
+        if (slots_.empty()) return NULL;
+        unsigned int tail = tail_.load(std::memory_order_relaxed);
+        if (next(tail) == head_.load(std::memory_order_acquire)) return NULL;
+        return &slots_[tail];
+    }
+
+    /**
+     @brief Publishes the element written in the slot returned by writeSlot()
+     */
+    void commit() {
+        tail_.store(next(tail_.load(std::memory_order_relaxed)),
+                    std::memory_order_release);
+    }
+
+    /**
+     @brief Pushes an element at the end of the queue
+     @param value element to push
+     @return false if the queue is full (the element is not pushed)
+     */
+    bool push(T const& value) {
+        T* slot = writeSlot();
+        if (!slot) return false;
+        *slot = value;
+        commit();
+        return true;
+    }
+
+    ///@}
+
+    /** @name Consumer */
+    ///@{
+
+    /**
+     @brief Get the first element of the queue
+     @return a pointer to the first element, or NULL if the queue is empty
+     */
+    T const* front() const {
+        unsigned int head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return NULL;
+        return &slots_[head];
+    }
+
+    /**
+     @brief Removes the first element of the queue
+     @warning the queue must not be empty
+     */
+    void pop() {
+        head_.store(next(head_.load(std::memory_order_relaxed)),
+                    std::memory_order_release);
+    }
+
+    /**
+     @brief Pops the first element of the queue
+     @param value copy of the first element
+     @return false if the queue is empty (the value is not modified)
+     */
+    bool pop(T& value) {
+        T const* slot = front();
+        if (!slot) return false;
+        value = *slot;
+        pop();
+        return true;
+    }
+
+    ///@}
+
+  protected:
+    /**
+     @brief Index of the slot following a given slot
+     */
+    unsigned int next(unsigned int index) const {
+        return (index + 1 == slots_.size()) ? 0 : index + 1;
+    }
+
+    /**
+     @brief Preallocated slots (one slot is kept empty to distinguish a full
+     queue from an empty queue)
+     */
+    std::vector<T> slots_;
+
+    /**
+     @brief Padding separating the indices from the slots
+     */
+    char padding_slots_[64];
+
+    /**
+     @brief Index of the first element (written by the consumer)
+     */
+    std::atomic<unsigned int> head_;
+
+    /**
+     @brief Padding separating the indices of the producer and consumer
+     */
+    char padding_head_[64];
+
+    /**
+     @brief Index of the next element to write (written by the producer)
+     */
+    std::atomic<unsigned int> tail_;
+};
+}
+
+#endif
@@ -34,9 +34,12 @@
 #define xmmMatrix_h
 
 #include <cmath>
+#include <cstddef>
 #include <exception>
 #include <iostream>
+#include <map>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace xmm {
@@ -354,6 +357,320 @@ class Matrix {
         }
     }
 };
+
+/**
+ @ingroup Common
+ @brief Sparse Matrix in Compressed Sparse Row (CSR) format
+ @details Only non-zero elements are stored: for each row i, the column indices
+ and values of its non-zero elements are stored in column_indices and values
+ between positions row_pointers[i] and row_pointers[i+1]. Column indices are
+ sorted within each row.
+ @tparam T data type of the matrix (should be used with float/double)
+ */
+template <typename T>
+class SparseMatrix {
+  public:
+    /**
+     @brief number of rows of the matrix
+     */
+    unsigned int nrows;
+
+    /**
+     @brief number of columns of the matrix
+     */
+    unsigned int ncols;
+
+    /**
+     @brief Offset of the first non-zero element of each row (size nrows+1)
+     */
+    std::vector<unsigned int> row_pointers;
+
+    /**
+     @brief Column index of each non-zero element
+     */
+    std::vector<unsigned int> column_indices;
+
+    /**
+     @brief Value of each non-zero element
+     */
+    std::vector<T> values;
+
+    /**
+     @brief Constructor (empty matrix, no non-zero elements)
+     @param nrows_ Number of rows
+     @param ncols_ Number of columns
+     */
+    SparseMatrix(unsigned int nrows_ = 0, unsigned int ncols_ = 0) {
+        resize(nrows_, ncols_);
+    }
+
+    /**
+     @brief Resize the matrix and remove all non-zero elements
+     @param nrows_ Number of rows
+     @param ncols_ Number of columns
+     */
+    void resize(unsigned int nrows_, unsigned int ncols_) {
+        nrows = nrows_;
+        ncols = ncols_;
+        row_pointers.assign(nrows + 1, 0);
+        column_indices.clear();
+        values.clear();
+    }
+
+    /**
+     @brief Remove all elements
+     */
+    void clear() { resize(0, 0); }
+
+    /**
+     @brief Fill the matrix with a constant value (all elements are stored)
+     @param nrows_ Number of rows
+     @param ncols_ Number of columns
+     @param value value of all elements
+     */
+    void assign(unsigned int nrows_, unsigned int ncols_, T value) {
+        nrows = nrows_;
+        ncols = ncols_;
+        row_pointers.resize(nrows + 1);
+        column_indices.resize(nrows * ncols);
+        values.assign(nrows * ncols, value);
+        for (unsigned int i = 0; i <= nrows; i++) row_pointers[i] = i * ncols;
+        for (unsigned int i = 0; i < nrows; i++)
+            for (unsigned int j = 0; j < ncols; j++)
+                column_indices[i * ncols + j] = j;
+    }
+
+    /**
+     @brief Set the matrix from its rows
+     @param rows non-zero elements of each row, indexed by column
+     @param ncols_ Number of columns
+     @throws out_of_range if a column index exceeds the number of columns
+     */
+    void setRows(std::vector<std::map<unsigned int, T>> const &rows,
+                 unsigned int ncols_) {
+        resize(static_cast<unsigned int>(rows.size()), ncols_);
+        for (unsigned int i = 0; i < nrows; i++) {
+            for (auto &elt : rows[i]) {
+                if (elt.first >= ncols)
+                    throw std::out_of_range("Column index out of bounds");
+                if (elt.second == T(0.0)) continue;
+                column_indices.push_back(elt.first);
+                values.push_back(elt.second);
+            }
+            row_pointers[i + 1] =
+                static_cast<unsigned int>(column_indices.size());
+        }
+    }
+
+    /**
+     @brief Set the matrix from a dense matrix (zeros are not stored)
+     @param dense dense matrix as a vector of rows
+     @throws runtime_error if the rows have different sizes
+     */
+    void setDense(std::vector<std::vector<T>> const &dense) {
+        resize(static_cast<unsigned int>(dense.size()),
+               dense.empty() ? 0 : static_cast<unsigned int>(dense[0].size()));
+        for (unsigned int i = 0; i < nrows; i++) {
+            if (dense[i].size() != ncols)
+                throw std::runtime_error("Rows have different sizes");
+            for (unsigned int j = 0; j < ncols; j++) {
+                if (dense[i][j] == T(0.0)) continue;
+                column_indices.push_back(j);
+                values.push_back(dense[i][j]);
+            }
+            row_pointers[i + 1] =
+                static_cast<unsigned int>(column_indices.size());
+        }
+    }
+
+    /**
+     @brief Get the dense representation of the matrix
+     @return dense matrix as a vector of rows
+     */
+    std::vector<std::vector<T>> toDense() const {
+        std::vector<std::vector<T>> dense(nrows, std::vector<T>(ncols, T(0.0)));
+        for (unsigned int i = 0; i < nrows; i++)
+            for (unsigned int p = row_pointers[i]; p < row_pointers[i + 1]; p++)
+                dense[i][column_indices[p]] = values[p];
+        return dense;
+    }
+
+    /**
+     @brief Get the value of an element
+     @param i row index
+     @param j column index
+     @return value of the element (0 if the element is not stored)
+     @throws out_of_range if the indices exceed the matrix dimensions
+     */
+    T operator()(unsigned int i, unsigned int j) const {
+        if (i >= nrows || j >= ncols)
+            throw std::out_of_range("Index out of bounds");
+        unsigned int lo(row_pointers[i]), hi(row_pointers[i + 1]);
+        while (lo < hi) {
+            unsigned int mid = (lo + hi) / 2;
+            if (column_indices[mid] == j) return values[mid];
+            if (column_indices[mid] < j)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return T(0.0);
+    }
+
+    /**
+     @brief Get the number of stored (non-zero) elements
+     @return number of non-zero elements
+     */
+    unsigned int nonZeros() const {
+        return static_cast<unsigned int>(values.size());
+    }
+
+    /**
+     @brief Checks the row pointers of the matrix (e.g. read from a file)
+     @details the row pointers must start at 0 and never decrease, and each
+     row has at most ncols elements, so that the number of non-zero elements
+     row_pointers[nrows] can be trusted before allocating the elements.
+     @return true if the row pointers are consistent with the dimensions
+     */
+    bool validRowPointers() const {
+        if (row_pointers.size() != nrows + 1 || row_pointers[0] != 0)
+            return false;
+        for (unsigned int i = 0; i < nrows; i++)
+            if (row_pointers[i] > row_pointers[i + 1] ||
+                row_pointers[i + 1] - row_pointers[i] > ncols)
+                return false;
+        return true;
+    }
+
+    /**
+     @brief Checks the structure of the matrix (e.g. read from a file)
+     @details in addition to validRowPointers(), the column indices of each
+     row must be sorted, unique and lower than ncols.
+     @return true if the matrix has a valid CSR structure
+     */
+    bool validStructure() const {
+        if (!validRowPointers() ||
+            column_indices.size() != row_pointers[nrows] ||
+            values.size() != row_pointers[nrows])
+            return false;
+        for (unsigned int i = 0; i < nrows; i++)
+            for (unsigned int p = row_pointers[i]; p < row_pointers[i + 1];
+                 p++)
+                if (column_indices[p] >= ncols ||
+                    (p > row_pointers[i] &&
+                     column_indices[p] <= column_indices[p - 1]))
+                    return false;
+        return true;
+    }
+
+    /**
+     @brief Normalize each row to sum to one (empty rows are left unchanged)
+     */
+    void normalizeRows() {
+        for (unsigned int i = 0; i < nrows; i++) {
+            T sum(0.0);
+            for (unsigned int p = row_pointers[i]; p < row_pointers[i + 1]; p++)
+                sum += values[p];
+            if (sum > T(0.0))
+                for (unsigned int p = row_pointers[i]; p < row_pointers[i + 1];
+                     p++)
+                    values[p] /= sum;
+        }
+    }
+};
+
+/** @name Packed symmetric matrices */
+///@{
+
+/**
+ @ingroup Common
+ @brief Number of elements of a symmetric matrix in packed storage
+ @details the packed storage only contains the upper triangle of the matrix,
+ row by row: (0,0), (0,1), ..., (0,n-1), (1,1), (1,2), ..., (n-1,n-1).
+ @param dimension number of rows (and columns) of the matrix
+ @return dimension * (dimension + 1) / 2
+ */
+inline std::size_t packedSize(unsigned int dimension) {
+    return std::size_t(dimension) * (dimension + 1) / 2;
+}
+
+/**
+ @ingroup Common
+ @brief Index of an element of a symmetric matrix in packed storage
+ @param row row index
+ @param column column index (the indices can be given in any order)
+ @param dimension number of rows (and columns) of the matrix
+ @return index of the element in the packed storage
+ */
+inline std::size_t packedIndex(unsigned int row, unsigned int column,
+                               unsigned int dimension) {
+    if (row > column) std::swap(row, column);
+    return std::size_t(row) * (2 * dimension - row - 1) / 2 + column;
+}
+
+/**
+ @ingroup Common
+ @brief Packs the upper triangle of a square matrix
+ @param matrix matrix stored row by row (size: dimension * dimension)
+ @param dimension number of rows (and columns) of the matrix
+ @param packed packed matrix (size: packedSize(dimension))
+ @tparam InputIterator random access iterator (or pointer)
+ @tparam OutputIterator output iterator (or pointer)
+ */
+template <typename InputIterator, typename OutputIterator>
+void packSymmetric(InputIterator matrix, unsigned int dimension,
+                   OutputIterator packed) {
+    for (unsigned int i = 0; i < dimension; i++)
+        for (unsigned int j = i; j < dimension; j++)
+            *packed++ = matrix[i * dimension + j];
+}
+
+/**
+ @ingroup Common
+ @brief Unpacks a symmetric matrix into a square matrix
+ @param packed packed matrix (size: packedSize(dimension))
+ @param dimension number of rows (and columns) of the matrix
+ @param matrix matrix stored row by row (size: dimension * dimension)
+ @tparam InputIterator input iterator (or pointer)
+ @tparam OutputIterator random access iterator (or pointer)
+ */
+template <typename InputIterator, typename OutputIterator>
+void unpackSymmetric(InputIterator packed, unsigned int dimension,
+                     OutputIterator matrix) {
+    for (unsigned int i = 0; i < dimension; i++) {
+        for (unsigned int j = i; j < dimension; j++) {
+            matrix[i * dimension + j] = *packed;
+            matrix[j * dimension + i] = *packed++;
+        }
+    }
+}
+
+/**
+ @ingroup Common
+ @brief Quadratic form x' A x of a packed symmetric matrix
+ @details each off-diagonal element is visited once, which halves the number
+ of multiplications compared to a square matrix.
+ @param packed packed matrix A (size: packedSize(dimension))
+ @param dimension number of rows (and columns) of the matrix
+ @param x function returning the i-th element of the vector
+ @return value of the quadratic form
+ */
+template <typename T, typename Vector>
+T packedQuadraticForm(const T* packed, unsigned int dimension,
+                      Vector const& x) {
+    T result(0);
+    for (unsigned int i = 0; i < dimension; i++) {
+        T x_i = x(i);
+        T off_diagonal(0);
+        for (unsigned int j = i + 1; j < dimension; j++)
+            off_diagonal += packed[j - i] * x(j);
+        result += x_i * (packed[0] * x_i + 2 * off_diagonal);
+        packed += dimension - i;
+    }
+    return result;
+}
+
+///@}
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,174 @@
+/*
+ * xmmWorkerPool.cpp
+ *
+ * Persistent pool of worker threads for parallel filtering
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xmmWorkerPool.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+inline void cpu_relax() {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_ia32_pause();
+#endif
+}
+}
+
+xmm::WorkerPool::WorkerPool(unsigned int num_threads,
+                            unsigned int spin_iterations, bool pin_threads)
+    : pinned_(false),
+      spin_iterations_(spin_iterations),
+      task_(nullptr),
+      num_tasks_(0),
+      generation_(0),
+      pending_(0),
+      sleeping_workers_(0),
+      caller_waiting_(false),
+      stop_(false) {
+    // the workers are pinned to the CPUs on which the process is allowed to
+    // run (affinity mask, cpusets of the container)
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (pin_threads && num_threads > 1 &&
+        sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    }
+#endif
+    pinned_ = !cpus.empty();
+    for (unsigned int i = 1; i < num_threads; i++) {
+        workers_.push_back(std::thread(&WorkerPool::workerLoop, this, i));
+#ifdef __linux__
+        if (!cpus.empty()) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(cpus[i % cpus.size()], &cpuset);
+            // a worker that cannot be pinned keeps running on any allowed CPU
+            if (pthread_setaffinity_np(workers_.back().native_handle(),
+                                       sizeof(cpu_set_t), &cpuset) != 0)
+                pinned_ = false;
+        }
+#endif
+    }
+}
+
+xmm::WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        generation_++;
+    }
+    start_condition_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+unsigned int xmm::WorkerPool::size() const {
+    return static_cast<unsigned int>(workers_.size()) + 1;
+}
+
+bool xmm::WorkerPool::pinned() const { return pinned_; }
+
+void xmm::WorkerPool::run(unsigned int num_tasks, Task const& task) {
+    if (workers_.empty() || num_tasks < 2) {
+        task(0, num_tasks);
+        return;
+    }
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    exception_ = nullptr;
+    pending_ = static_cast<unsigned int>(workers_.size());
+    generation_++;
+    if (sleeping_workers_ > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_condition_.notify_all();
+    }
+
+    runRange(0);
+
+    for (unsigned int i = 0; i < spin_iterations_ && pending_ > 0; i++)
+        cpu_relax();
+    if (pending_ > 0) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        caller_waiting_ = true;
+        done_condition_.wait(lock, [this] { return pending_ == 0; });
+        caller_waiting_ = false;
+    }
+    task_ = nullptr;
+    if (exception_) std::rethrow_exception(exception_);
+}
+
+void xmm::WorkerPool::workerLoop(unsigned int thread_index) {
+    unsigned int last_generation(0);
+    while (true) {
+        unsigned int generation = generation_;
+        for (unsigned int i = 0;
+             i < spin_iterations_ && generation == last_generation; i++) {
+            cpu_relax();
+            generation = generation_;
+        }
+        if (generation == last_generation) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_workers_++;
+            start_condition_.wait(
+                lock, [this, last_generation] {
+                    return generation_ != last_generation;
+                });
+            sleeping_workers_--;
+            generation = generation_;
+        }
+        if (stop_) return;
+        last_generation = generation;
+
+        runRange(thread_index);
+
+        if (--pending_ == 0 && caller_waiting_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_condition_.notify_one();
+        }
+    }
+}
+
+void xmm::WorkerPool::runRange(unsigned int thread_index) {
+    unsigned int num_threads = size();
+    unsigned int begin = thread_index * num_tasks_ / num_threads;
+    unsigned int end = (thread_index + 1) * num_tasks_ / num_threads;
+    if (begin >= end) return;
+    try {
+        (*task_)(begin, end);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(exception_mutex_);
+        if (!exception_) exception_ = std::current_exception();
+    }
+}
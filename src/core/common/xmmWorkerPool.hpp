@@ -0,0 +1,205 @@
+/*
+ * xmmWorkerPool.hpp
+ *
+ * Persistent pool of worker threads for parallel filtering
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef xmmWorkerPool_h
+#define xmmWorkerPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xmm {
+/**
+ @ingroup Common
+ @brief Persistent pool of worker threads for low-latency fork-join
+ parallelism
+ @details The pool is designed for the per-frame filtering of multiclass
+ models: a set of tasks is split into contiguous ranges that are processed in
+ parallel by the worker threads and the calling thread. Worker threads are
+ created once and, unless disabled, pinned to one of the CPUs on which the
+ process is allowed to run (on Linux).
+ Between two parallel sections, workers spin for a short time before blocking,
+ so that successive frames are dispatched without system calls.
+ */
+class WorkerPool {
+  public:
+    /**
+     @brief Type of the parallel task
+     @details the task is called with a range [begin, end) of task indices
+     */
+    typedef std::function<void(unsigned int, unsigned int)> Task;
+
+    /**
+     @brief Default number of iterations of the spin-wait before blocking
+     */
+    static const unsigned int DEFAULT_SPIN_ITERATIONS = 20000;
+
+    /**
+     @brief Constructor
+     @param num_threads total number of threads running the tasks (including
+     the calling thread)
+     @param spin_iterations number of iterations of the spin-wait before
+     blocking
+     @param pin_threads defines if the worker threads are pinned to a CPU.
+     Short-lived pools should not pin their threads.
+     */
+    explicit WorkerPool(unsigned int num_threads,
+                        unsigned int spin_iterations = DEFAULT_SPIN_ITERATIONS,
+                        bool pin_threads = true);
+
+    /**
+     @brief Destructor (joins the worker threads)
+     */
+    ~WorkerPool();
+
+    /**
+     @brief Get the total number of threads (including the calling thread)
+     @return number of threads running the tasks
+     */
+    unsigned int size() const;
+
+    /**
+     @brief Checks if the worker threads are pinned to a CPU
+     @return false if pinning is disabled, not supported by the platform, or
+     if a worker could not be pinned
+     */
+    bool pinned() const;
+
+    /**
+     @brief Run a set of tasks in parallel
+     @details the tasks are split in contiguous ranges across threads. The
+     function returns when all tasks are completed.
+     @param num_tasks number of tasks
+     @param task task function, called with a range of task indices
+     @throws the first exception thrown by a task
+     */
+    void run(unsigned int num_tasks, Task const& task);
+
+  private:
+    WorkerPool(WorkerPool const& src) = delete;
+    WorkerPool& operator=(WorkerPool const& src) = delete;
+
+    /**
+     @brief Main loop of the worker threads
+     @param thread_index index of the worker thread (the calling thread has
+     index 0)
+     */
+    void workerLoop(unsigned int thread_index);
+
+    /**
+     @brief Run the range of tasks associated with a given thread
+     @param thread_index index of the thread
+     */
+    void runRange(unsigned int thread_index);
+
+    /**
+     @brief Worker threads
+     */
+    std::vector<std::thread> workers_;
+
+    /**
+     @brief Defines if all worker threads are pinned to a CPU
+     */
+    bool pinned_;
+
+    /**
+     @brief Number of iterations of the spin-wait before blocking
+     */
+    unsigned int spin_iterations_;
+
+    /**
+     @brief Current task
+     */
+    Task const* task_;
+
+    /**
+     @brief Number of tasks of the current parallel section
+     */
+    unsigned int num_tasks_;
+
+    /**
+     @brief Index of the current parallel section (incremented at each run)
+     */
+    std::atomic<unsigned int> generation_;
+
+    /**
+     @brief Number of workers that have not finished the current section
+     */
+    std::atomic<unsigned int> pending_;
+
+    /**
+     @brief Number of workers blocked on the condition variable
+     */
+    std::atomic<unsigned int> sleeping_workers_;
+
+    /**
+     @brief Defines if the calling thread is blocked waiting for the workers
+     */
+    std::atomic<bool> caller_waiting_;
+
+    /**
+     @brief Defines if the workers must stop
+     */
+    std::atomic<bool> stop_;
+
+    /**
+     @brief Mutex associated with the condition variables
+     */
+    std::mutex mutex_;
+
+    /**
+     @brief Condition variable used to wake up the workers
+     */
+    std::condition_variable start_condition_;
+
+    /**
+     @brief Condition variable used to wake up the calling thread
+     */
+    std::condition_variable done_condition_;
+
+    /**
+     @brief Exception thrown by a task (rethrown in the calling thread)
+     */
+    std::exception_ptr exception_;
+
+    /**
+     @brief Mutex protecting the exception pointer
+     */
+    std::mutex exception_mutex_;
+};
+}
+
+#endif
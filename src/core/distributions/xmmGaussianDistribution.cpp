@@ -43,6 +43,41 @@
 
 #include <math.h>
 
+namespace {
+/**
+ @brief writes a covariance or precision matrix to a Json Value
+ @details packed symmetric matrices are written as square matrices, so that
+ the Json format does not depend on the storage of the matrices.
+ */
+Json::Value matrix2json(std::vector<double> const& values,
+                        unsigned int dimension, bool packed) {
+    if (!packed || dimension < 2) return xmm::vector2json(values);
+    std::vector<double> square(dimension * dimension);
+    xmm::unpackSymmetric(values.data(), dimension, square.data());
+    return xmm::vector2json(square);
+}
+
+/**
+ @brief reads a covariance or precision matrix from a Json Value
+ @details symmetric matrices can be given as square matrices or in packed
+ storage.
+ */
+void json2matrix(Json::Value const& root, std::vector<double>& values,
+                 unsigned int dimension, bool packed) {
+    unsigned int size = static_cast<unsigned int>(
+        packed ? xmm::packedSize(dimension) : values.size());
+    values.resize(size);
+    if (packed && dimension > 1 && root.isArray() &&
+        root.size() == dimension * dimension) {
+        std::vector<double> square(dimension * dimension);
+        xmm::json2vector(root, square, dimension * dimension);
+        xmm::packSymmetric(square.data(), dimension, values.data());
+    } else {
+        xmm::json2vector(root, values, size);
+    }
+}
+}
+
 #pragma mark Constructors
 xmm::GaussianDistribution::GaussianDistribution(bool bimodal,
                                                 unsigned int dimension_,
@@ -83,6 +118,27 @@ xmm::GaussianDistribution::GaussianDistribution(GaussianDistribution const& src)
     output_covariance = src.output_covariance;
 }
 
+xmm::GaussianDistribution::GaussianDistribution(
+    GaussianDistribution&& src) noexcept
+    : dimension(src.dimension),
+      dimension_input(src.dimension_input),
+      mean(std::move(src.mean)),
+      covariance_mode(src.covariance_mode),
+      covariance(std::move(src.covariance)),
+      output_covariance(std::move(src.output_covariance)),
+      bimodal_(src.bimodal_),
+      covariance_determinant_(src.covariance_determinant_),
+      inverse_covariance_(std::move(src.inverse_covariance_)),
+      covariance_determinant_input_(src.covariance_determinant_input_),
+      inverse_covariance_input_(std::move(src.inverse_covariance_input_)) {
+    dimension.onAttributeChange(this,
+                                &xmm::GaussianDistribution::onAttributeChange);
+    dimension_input.onAttributeChange(
+        this, &xmm::GaussianDistribution::onAttributeChange);
+    covariance_mode.onAttributeChange(
+        this, &xmm::GaussianDistribution::onAttributeChange);
+}
+
 xmm::GaussianDistribution::GaussianDistribution(Json::Value const& root)
     : covariance_determinant_(0.), covariance_determinant_input_(0.) {
     bimodal_ = root.get("bimodal", false).asBool();
@@ -91,21 +147,30 @@ xmm::GaussianDistribution::GaussianDistribution(Json::Value const& root)
     covariance_mode.set(
         static_cast<CovarianceMode>(root["covariance_mode"].asInt()));
 
+    // the arrays are allocated with the sizes of the covariance mode
     allocate();
 
+    bool full = (covariance_mode.get() == CovarianceMode::Full);
     json2vector(root["mean"], mean, dimension.get());
-    json2vector(root["covariance"], covariance,
-                dimension.get() * dimension.get());
+    json2matrix(root["covariance"], covariance, dimension.get(), full);
 
     // updateInverseCovariance();
     // read from json instead of calling updateInverseCovariance() :
-    json2vector(root["inverse_covariance"], inverse_covariance_,
-                dimension.get() * dimension.get());
+    json2matrix(root["inverse_covariance"], inverse_covariance_,
+                dimension.get(), full);
     covariance_determinant_ = root.get("covariance_determinant", 0.).asDouble();
-    json2vector(root["inverse_covariance_input"], inverse_covariance_input_,
-                dimension_input.get() * dimension_input.get());
+    json2matrix(root["inverse_covariance_input"], inverse_covariance_input_,
+                dimension_input.get(), full);
     covariance_determinant_input_ =
         root.get("covariance_determinant_input", 0.).asDouble();
+    if (bimodal_) {
+        unsigned int dimension_output = dimension.get() - dimension_input.get();
+        output_covariance.resize((covariance_mode.get() == CovarianceMode::Full)
+                                     ? dimension_output * dimension_output
+                                     : dimension_output);
+        json2vector(root["output_covariance"], output_covariance,
+                    static_cast<unsigned int>(output_covariance.size()));
+    }
 
     dimension.onAttributeChange(this,
                                 &xmm::GaussianDistribution::onAttributeChange);
@@ -134,6 +199,31 @@ xmm::GaussianDistribution& xmm::GaussianDistribution::operator=(
     return *this;
 };
 
+xmm::GaussianDistribution& xmm::GaussianDistribution::operator=(
+    GaussianDistribution&& src) noexcept {
+    if (this != &src) {
+        bimodal_ = src.bimodal_;
+        dimension = src.dimension;
+        dimension_input = src.dimension_input;
+        covariance_mode = src.covariance_mode;
+        dimension.onAttributeChange(
+            this, &xmm::GaussianDistribution::onAttributeChange);
+        dimension_input.onAttributeChange(
+            this, &xmm::GaussianDistribution::onAttributeChange);
+        covariance_mode.onAttributeChange(
+            this, &xmm::GaussianDistribution::onAttributeChange);
+
+        mean = std::move(src.mean);
+        covariance = std::move(src.covariance);
+        inverse_covariance_ = std::move(src.inverse_covariance_);
+        covariance_determinant_ = src.covariance_determinant_;
+        covariance_determinant_input_ = src.covariance_determinant_input_;
+        inverse_covariance_input_ = std::move(src.inverse_covariance_input_);
+        output_covariance = std::move(src.output_covariance);
+    }
+    return *this;
+}
+
 void xmm::GaussianDistribution::onAttributeChange(AttributeBase* attr_pointer) {
     if (attr_pointer == &dimension) {
         dimension_input.setLimitMax(dimension.get() - 1);
@@ -145,23 +235,25 @@ void xmm::GaussianDistribution::onAttributeChange(AttributeBase* attr_pointer) {
         if (covariance_mode.get() == CovarianceMode::Diagonal) {
             std::vector<double> new_covariance(dimension.get());
             for (unsigned int d = 0; d < dimension.get(); ++d) {
-                new_covariance[d] = covariance[d * dimension.get() + d];
+                new_covariance[d] =
+                    covariance[packedIndex(d, d, dimension.get())];
             }
             covariance = new_covariance;
             inverse_covariance_.resize(dimension.get());
             if (bimodal_)
                 inverse_covariance_input_.resize(dimension_input.get());
         } else if (covariance_mode.get() == CovarianceMode::Full) {
-            std::vector<double> new_covariance(
-                dimension.get() * dimension.get(), 0.0);
+            std::vector<double> new_covariance(packedSize(dimension.get()),
+                                               0.0);
             for (unsigned int d = 0; d < dimension.get(); ++d) {
-                new_covariance[d * dimension.get() + d] = covariance[d];
+                new_covariance[packedIndex(d, d, dimension.get())] =
+                    covariance[d];
             }
             covariance = new_covariance;
-            inverse_covariance_.resize(dimension.get() * dimension.get());
+            inverse_covariance_.resize(packedSize(dimension.get()));
             if (bimodal_)
-                inverse_covariance_input_.resize(dimension_input.get() *
-                                                 dimension_input.get());
+                inverse_covariance_input_.resize(
+                    packedSize(dimension_input.get()));
         }
         updateInverseCovariance();
         if (bimodal_) {
@@ -178,14 +270,9 @@ double xmm::GaussianDistribution::likelihood(const float* observation) const {
 
     double euclidianDistance(0.0);
     if (covariance_mode.get() == CovarianceMode::Full) {
-        for (int l = 0; l < dimension.get(); l++) {
-            double tmp(0.0);
-            for (int k = 0; k < dimension.get(); k++) {
-                tmp += inverse_covariance_[l * dimension.get() + k] *
-                       (observation[k] - mean[k]);
-            }
-            euclidianDistance += (observation[l] - mean[l]) * tmp;
-        }
+        euclidianDistance = packedQuadraticForm(
+            inverse_covariance_.data(), dimension.get(),
+            [&](unsigned int d) { return observation[d] - mean[d]; });
     } else {
         for (int l = 0; l < dimension.get(); l++) {
             euclidianDistance += inverse_covariance_[l] *
@@ -215,15 +302,9 @@ double xmm::GaussianDistribution::likelihood_input(
 
     double euclidianDistance(0.0);
     if (covariance_mode.get() == CovarianceMode::Full) {
-        for (int l = 0; l < dimension_input.get(); l++) {
-            double tmp(0.0);
-            for (int k = 0; k < dimension_input.get(); k++) {
-                tmp +=
-                    inverse_covariance_input_[l * dimension_input.get() + k] *
-                    (observation_input[k] - mean[k]);
-            }
-            euclidianDistance += (observation_input[l] - mean[l]) * tmp;
-        }
+        euclidianDistance = packedQuadraticForm(
+            inverse_covariance_input_.data(), dimension_input.get(),
+            [&](unsigned int d) { return observation_input[d] - mean[d]; });
     } else {
         for (int l = 0; l < dimension_input.get(); l++) {
             euclidianDistance += inverse_covariance_[l] *
@@ -250,28 +331,16 @@ double xmm::GaussianDistribution::likelihood_bimodal(
     if (covariance_determinant_ == 0.0)
         throw std::runtime_error("Covariance Matrix is not invertible");
 
-    unsigned int dimension_output = dimension.get() - dimension_input.get();
     double euclidianDistance(0.0);
     if (covariance_mode.get() == CovarianceMode::Full) {
-        for (int l = 0; l < dimension.get(); l++) {
-            double tmp(0.0);
-            for (int k = 0; k < dimension_input.get(); k++) {
-                tmp += inverse_covariance_[l * dimension.get() + k] *
-                       (observation_input[k] - mean[k]);
-            }
-            for (int k = 0; k < dimension_output; k++) {
-                tmp +=
-                    inverse_covariance_[l * dimension.get() +
-                                        dimension_input.get() + k] *
-                    (observation_output[k] - mean[dimension_input.get() + k]);
-            }
-            if (l < dimension_input.get())
-                euclidianDistance += (observation_input[l] - mean[l]) * tmp;
-            else
-                euclidianDistance +=
-                    (observation_output[l - dimension_input.get()] - mean[l]) *
-                    tmp;
-        }
+        unsigned int dim_input = dimension_input.get();
+        euclidianDistance = packedQuadraticForm(
+            inverse_covariance_.data(), dimension.get(),
+            [&](unsigned int d) {
+                return (d < dim_input)
+                           ? observation_input[d] - mean[d]
+                           : observation_output[d - dim_input] - mean[d];
+            });
     } else {
         for (int l = 0; l < dimension_input.get(); l++) {
             euclidianDistance += inverse_covariance_[l] *
@@ -311,13 +380,13 @@ void xmm::GaussianDistribution::regression(
             for (int e = 0; e < dimension_input.get(); e++) {
                 float tmp = 0.;
                 for (int f = 0; f < dimension_input.get(); f++) {
-                    tmp += inverse_covariance_input_[e * dimension_input.get() +
-                                                     f] *
+                    tmp += inverse_covariance_input_[packedIndex(
+                               e, f, dimension_input.get())] *
                            (observation_input[f] - mean[f]);
                 }
                 predicted_output[d] +=
-                    covariance[(d + dimension_input.get()) * dimension.get() +
-                               e] *
+                    covariance[packedIndex(e, d + dimension_input.get(),
+                                           dimension.get())] *
                     tmp;
             }
         }
@@ -335,12 +404,15 @@ Json::Value xmm::GaussianDistribution::toJson() const {
     root["dimension"] = static_cast<int>(dimension.get());
     root["dimension_input"] = static_cast<int>(dimension_input.get());
     root["covariance_mode"] = static_cast<int>(covariance_mode.get());
+    bool full = (covariance_mode.get() == CovarianceMode::Full);
     root["mean"] = vector2json(mean);
-    root["covariance"] = vector2json(covariance);
+    root["covariance"] = matrix2json(covariance, dimension.get(), full);
 
-    root["inverse_covariance"] = vector2json(inverse_covariance_);
+    root["inverse_covariance"] =
+        matrix2json(inverse_covariance_, dimension.get(), full);
     root["covariance_determinant"] = covariance_determinant_;
-    root["inverse_covariance_input"] = vector2json(inverse_covariance_input_);
+    root["inverse_covariance_input"] =
+        matrix2json(inverse_covariance_input_, dimension_input.get(), full);
     root["covariance_determinant_input"] = covariance_determinant_input_;
     
     root["output_covariance"] = vector2json(output_covariance);
@@ -351,21 +423,120 @@ Json::Value xmm::GaussianDistribution::toJson() const {
 void xmm::GaussianDistribution::fromJson(Json::Value const& root) {
     try {
         GaussianDistribution tmp(root);
-        *this = tmp;
+        *this = std::move(tmp);
     } catch (JsonException& e) {
         throw e;
     }
 }
 
+#pragma mark Binary I/O
+void xmm::GaussianDistribution::writeBinary(BinaryWriter& writer) const {
+    writer.writeBool(bimodal_);
+    writer.writeUInt(dimension.get());
+    writer.writeUInt(dimension_input.get());
+    writer.writeUInt(static_cast<unsigned int>(covariance_mode.get()));
+    if (writer.compact()) {
+        // recognition only needs the precision matrix, whereas regression
+        // derives all its terms from the covariance
+        writer.writeParameters(mean);
+        if (bimodal_) {
+            writer.writeParameters(covariance, true);
+        } else {
+            writer.writeParameters(inverse_covariance_, true);
+            writer.writeDouble(covariance_determinant_);
+        }
+        return;
+    }
+    writer.writeVector(mean);
+    writer.writeVector(covariance);
+    writer.writeVector(inverse_covariance_);
+    writer.writeDouble(covariance_determinant_);
+    writer.writeVector(inverse_covariance_input_);
+    writer.writeDouble(covariance_determinant_input_);
+    writer.writeVector(output_covariance);
+}
+
+void xmm::GaussianDistribution::readBinary(BinaryReader& reader) {
+    bimodal_ = reader.readBool();
+    dimension.setLimits(bimodal_ ? 2 : 1);
+    dimension.set(reader.readUInt(), true);
+    dimension_input.setLimits(0, bimodal_ ? dimension.get() - 1 : 0);
+    dimension_input.set(reader.readUInt(), true);
+    covariance_mode.set(static_cast<CovarianceMode>(reader.readUInt()), true);
+    if (reader.compact()) {
+        readCompactBinary(reader);
+        return;
+    }
+
+    // the inverse covariances are read instead of being computed, so that
+    // loading a model does not invert any matrix. The size of the arrays
+    // depends on the covariance mode of the model, that can differ from the
+    // covariance mode of the distribution.
+    reader.readVector(mean, dimension.get());
+    reader.readSymmetric(covariance, dimension.get());
+    reader.readSymmetric(inverse_covariance_, dimension.get());
+    covariance_determinant_ = reader.readDouble();
+    if (bimodal_)
+        reader.readSymmetric(inverse_covariance_input_, dimension_input.get());
+    else
+        reader.readVector(inverse_covariance_input_);
+    covariance_determinant_input_ = reader.readDouble();
+    reader.readVector(output_covariance);
+    unsigned int dimension_output = dimension.get() - dimension_input.get();
+    if (bimodal_ && output_covariance.size() != dimension_output &&
+        output_covariance.size() != dimension_output * dimension_output)
+        throw std::runtime_error("Corrupted model file");
+}
+
+void xmm::GaussianDistribution::readCompactBinary(BinaryReader& reader) {
+    reader.readParameters(mean, dimension.get());
+    if (bimodal_) {
+        // the arrays are allocated and inverted in the layout of the file
+        reader.readSymmetric(covariance, dimension.get());
+        CovarianceMode mode = covariance_mode.get();
+        covariance_mode.set((covariance.size() == dimension.get())
+                                 ? CovarianceMode::Diagonal
+                                 : CovarianceMode::Full,
+                             true);
+        allocate();
+        updateInverseCovariance();
+        covariance_mode.set(mode, true);
+        return;
+    }
+    reader.readSymmetric(inverse_covariance_, dimension.get());
+    covariance_determinant_ = reader.readDouble();
+    inverse_covariance_input_.clear();
+    covariance_determinant_input_ = 0.;
+    output_covariance.clear();
+    if (inverse_covariance_.size() == dimension.get()) {
+        covariance.resize(dimension.get());
+        for (unsigned int d = 0; d < dimension.get(); d++) {
+            if (inverse_covariance_[d] <= 0.)
+                throw std::runtime_error("Corrupted model file");
+            covariance[d] = 1. / inverse_covariance_[d];
+        }
+    } else {
+        Matrix<double> precision_matrix(dimension.get(), dimension.get(),
+                                        true);
+        unpackSymmetric(inverse_covariance_.begin(), dimension.get(),
+                        precision_matrix.data);
+        double det;
+        Matrix<double>* covariance_matrix = precision_matrix.pinv(&det);
+        covariance.resize(packedSize(dimension.get()));
+        packSymmetric(covariance_matrix->data, dimension.get(),
+                      covariance.begin());
+        delete covariance_matrix;
+    }
+}
+
 #pragma mark Utilities
 void xmm::GaussianDistribution::allocate() {
     mean.resize(dimension.get());
     if (covariance_mode.get() == CovarianceMode::Full) {
-        covariance.resize(dimension.get() * dimension.get());
-        inverse_covariance_.resize(dimension.get() * dimension.get());
+        covariance.resize(packedSize(dimension.get()));
+        inverse_covariance_.resize(packedSize(dimension.get()));
         if (bimodal_)
-            inverse_covariance_input_.resize(dimension_input.get() *
-                                             dimension_input.get());
+            inverse_covariance_input_.resize(packedSize(dimension_input.get()));
     } else {
         covariance.resize(dimension.get());
         inverse_covariance_.resize(dimension.get());
@@ -376,7 +547,7 @@ void xmm::GaussianDistribution::allocate() {
 void xmm::GaussianDistribution::regularize(std::vector<double> regularization) {
     if (covariance_mode.get() == CovarianceMode::Full) {
         for (int d = 0; d < dimension.get(); ++d) {
-            covariance[d * dimension.get() + d] += regularization[d];
+            covariance[packedIndex(d, d, dimension.get())] += regularization[d];
         }
     } else {
         for (int d = 0; d < dimension.get(); ++d) {
@@ -387,17 +558,17 @@ void xmm::GaussianDistribution::regularize(std::vector<double> regularization) {
 
 void xmm::GaussianDistribution::updateInverseCovariance() {
     if (covariance_mode.get() == CovarianceMode::Full) {
-        Matrix<double> cov_matrix(dimension.get(), dimension.get(), false);
+        // the matrices are inverted in square storage
+        Matrix<double> cov_matrix(dimension.get(), dimension.get(), true);
 
         Matrix<double>* inverseMat;
         double det;
 
-        cov_matrix.data = covariance.begin();
+        unpackSymmetric(covariance.begin(), dimension.get(), cov_matrix.data);
         inverseMat = cov_matrix.pinv(&det);
         covariance_determinant_ = det;
-        copy(inverseMat->data,
-             inverseMat->data + dimension.get() * dimension.get(),
-             inverse_covariance_.begin());
+        packSymmetric(inverseMat->data, dimension.get(),
+                      inverse_covariance_.begin());
         delete inverseMat;
         inverseMat = NULL;
 
@@ -409,15 +580,13 @@ void xmm::GaussianDistribution::updateInverseCovariance() {
             for (int d1 = 0; d1 < dimension_input.get(); d1++) {
                 for (int d2 = 0; d2 < dimension_input.get(); d2++) {
                     cov_matrix_input._data[d1 * dimension_input.get() + d2] =
-                        covariance[d1 * dimension.get() + d2];
+                        covariance[packedIndex(d1, d2, dimension.get())];
                 }
             }
             inverseMat = cov_matrix_input.pinv(&det);
             covariance_determinant_input_ = det;
-            copy(inverseMat->data,
-                 inverseMat->data +
-                     dimension_input.get() * dimension_input.get(),
-                 inverse_covariance_input_.begin());
+            packSymmetric(inverseMat->data, dimension_input.get(),
+                          inverse_covariance_input_.begin());
             delete inverseMat;
             inverseMat = NULL;
         }
@@ -465,22 +634,22 @@ void xmm::GaussianDistribution::updateOutputCovariance() {
     for (int d1 = 0; d1 < dimension_input.get(); d1++) {
         for (int d2 = 0; d2 < dimension_input.get(); d2++) {
             cov_matrix_input._data[d1 * dimension_input.get() + d2] =
-                covariance[d1 * dimension.get() + d2];
+                covariance[packedIndex(d1, d2, dimension.get())];
         }
     }
     inverseMat = cov_matrix_input.pinv(&det);
     Matrix<double> covariance_gs(dimension_input.get(), dimension_output, true);
     for (int d1 = 0; d1 < dimension_input.get(); d1++) {
         for (int d2 = 0; d2 < dimension_output; d2++) {
-            covariance_gs._data[d1 * dimension_output + d2] =
-                covariance[d1 * dimension.get() + dimension_input.get() + d2];
+            covariance_gs._data[d1 * dimension_output + d2] = covariance[
+                packedIndex(d1, dimension_input.get() + d2, dimension.get())];
         }
     }
     Matrix<double> covariance_sg(dimension_output, dimension_input.get(), true);
     for (int d1 = 0; d1 < dimension_output; d1++) {
         for (int d2 = 0; d2 < dimension_input.get(); d2++) {
-            covariance_sg._data[d1 * dimension_input.get() + d2] =
-                covariance[(dimension_input.get() + d1) * dimension.get() + d2];
+            covariance_sg._data[d1 * dimension_input.get() + d2] = covariance[
+                packedIndex(dimension_input.get() + d1, d2, dimension.get())];
         }
     }
     Matrix<double>* tmptmptmp = inverseMat->product(&covariance_gs);
@@ -489,8 +658,9 @@ void xmm::GaussianDistribution::updateOutputCovariance() {
     for (int d1 = 0; d1 < dimension_output; d1++) {
         for (int d2 = 0; d2 < dimension_output; d2++) {
             output_covariance[d1 * dimension_output + d2] =
-                covariance[(dimension_input.get() + d1) * dimension.get() +
-                           dimension_input.get() + d2] -
+                covariance[packedIndex(dimension_input.get() + d1,
+                                       dimension_input.get() + d2,
+                                       dimension.get())] -
                 covariance_mod->data[d1 * dimension_output + d2];
         }
     }
@@ -516,9 +686,9 @@ xmm::Ellipse xmm::GaussianDistribution::toEllipse(unsigned int dimension1,
     // |b c|
     double a, b, c;
     if (covariance_mode.get() == CovarianceMode::Full) {
-        a = covariance[dimension1 * dimension.get() + dimension1];
-        b = covariance[dimension1 * dimension.get() + dimension2];
-        c = covariance[dimension2 * dimension.get() + dimension2];
+        a = covariance[packedIndex(dimension1, dimension1, dimension.get())];
+        b = covariance[packedIndex(dimension1, dimension2, dimension.get())];
+        c = covariance[packedIndex(dimension2, dimension2, dimension.get())];
     } else {
         a = covariance[dimension1];
         b = 0.0;
@@ -559,10 +729,9 @@ void xmm::GaussianDistribution::fromEllipse(Ellipse const& gaussian_ellipse,
     a = eigenVal2 + b / tantheta;
 
     if (covariance_mode.get() == CovarianceMode::Full) {
-        covariance[dimension1 * dimension.get() + dimension1] = a;
-        covariance[dimension1 * dimension.get() + dimension2] = b;
-        covariance[dimension2 * dimension.get() + dimension1] = b;
-        covariance[dimension2 * dimension.get() + dimension2] = c;
+        covariance[packedIndex(dimension1, dimension1, dimension.get())] = a;
+        covariance[packedIndex(dimension1, dimension2, dimension.get())] = b;
+        covariance[packedIndex(dimension2, dimension2, dimension.get())] = c;
     } else {
         covariance[dimension1] = a;
         covariance[dimension2] = c;
@@ -702,6 +871,68 @@ xmm::Ellipse xmm::covariance2ellipse(double c_xx, double c_xy, double c_yy) {
     return gaussian_ellipse;
 }
 
+#pragma mark -
+#pragma mark Sufficient Statistics
+void xmm::GaussianDistribution::SufficientStatistics::reset(
+    std::vector<double> const& reference_point, bool full_covariance) {
+    std::size_t dimension = reference_point.size();
+    weight = 0.;
+    full = full_covariance;
+    reference = reference_point;
+    first_moment.assign(dimension, 0.);
+    second_moment.assign(
+        full ? packedSize(static_cast<unsigned int>(dimension)) : dimension,
+        0.);
+    centered_.resize(dimension);
+}
+
+void xmm::GaussianDistribution::SufficientStatistics::accumulate(
+    const float* observation, double observation_weight) {
+    std::size_t dimension = reference.size();
+    weight += observation_weight;
+    for (std::size_t d = 0; d < dimension; d++) {
+        centered_[d] = observation[d] - reference[d];
+        first_moment[d] += observation_weight * centered_[d];
+    }
+    if (full) {
+        double* packed = second_moment.data();
+        for (std::size_t d1 = 0; d1 < dimension; d1++) {
+            double weighted = observation_weight * centered_[d1];
+            for (std::size_t d2 = d1; d2 < dimension; d2++)
+                *packed++ += weighted * centered_[d2];
+        }
+    } else {
+        for (std::size_t d = 0; d < dimension; d++)
+            second_moment[d] +=
+                observation_weight * centered_[d] * centered_[d];
+    }
+}
+
+void xmm::GaussianDistribution::SufficientStatistics::estimate(
+    GaussianDistribution& distribution) const {
+    if (!(weight > 0.)) return;
+    std::size_t dimension = reference.size();
+    std::vector<double> shift(dimension);
+    distribution.mean.resize(dimension);
+    for (std::size_t d = 0; d < dimension; d++) {
+        shift[d] = first_moment[d] / weight;
+        distribution.mean[d] = reference[d] + shift[d];
+    }
+    distribution.covariance.resize(second_moment.size());
+    if (full) {
+        std::size_t index(0);
+        for (std::size_t d1 = 0; d1 < dimension; d1++) {
+            for (std::size_t d2 = d1; d2 < dimension; d2++, index++)
+                distribution.covariance[index] =
+                    second_moment[index] / weight - shift[d1] * shift[d2];
+        }
+    } else {
+        for (std::size_t d = 0; d < dimension; d++)
+            distribution.covariance[d] =
+                second_moment[d] / weight - shift[d] * shift[d];
+    }
+}
+
 template <>
 void xmm::checkLimits<xmm::GaussianDistribution::CovarianceMode>(
     xmm::GaussianDistribution::CovarianceMode const& value,
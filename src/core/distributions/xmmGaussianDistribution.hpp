@@ -34,7 +34,9 @@
 #define xmmGaussianDistribution_h
 
 #include "../common/xmmAttribute.hpp"
+#include "../common/xmmBinary.hpp"
 #include "../common/xmmJson.hpp"
+#include "../common/xmmMatrix.hpp"
 
 namespace xmm {
 /**
@@ -78,6 +80,8 @@ struct Ellipse {
  @details Full covariance, optionally multimodal with support for regression
  */
 class GaussianDistribution : public Writable {
+    friend class FrozenModel;
+
   public:
     /**
      @brief Covariance Mode
@@ -94,6 +98,73 @@ class GaussianDistribution : public Writable {
         Diagonal = 1
     };
 
+    /**
+     @brief Weighted sufficient statistics of a Gaussian distribution
+     @details Accumulates the total weight and the first and second order
+     moments of weighted observations, centered on a reference point (typically
+     the current mean of the distribution) for numerical stability. Separate
+     blocks of data can thus be accumulated in a single pass, and the mean and
+     covariance estimated once all blocks have been processed.
+     */
+    struct SufficientStatistics {
+        /**
+         @brief Resets the statistics
+         @param reference_point reference point of the moments
+         @param full_covariance accumulate the full second order moments (or
+         only their diagonal)
+         */
+        void reset(std::vector<double> const& reference_point,
+                   bool full_covariance);
+
+        /**
+         @brief Accumulates a weighted observation
+         @param observation observation vector
+         @param weight weight of the observation
+         */
+        void accumulate(const float* observation, double weight);
+
+        /**
+         @brief Estimates the mean and covariance of a distribution
+         @details the covariance is neither regularized nor inverted. The
+         distribution is not modified if the total weight is zero.
+         @param distribution target distribution
+         */
+        void estimate(GaussianDistribution& distribution) const;
+
+        /**
+         @brief total weight of the observations
+         */
+        double weight;
+
+        /**
+         @brief reference point of the moments
+         */
+        std::vector<double> reference;
+
+        /**
+         @brief weighted sum of the centered observations
+         */
+        std::vector<double> first_moment;
+
+        /**
+         @brief weighted sum of the outer products of the centered
+         observations (packed upper triangle), or of their squares in
+         diagonal mode
+         */
+        std::vector<double> second_moment;
+
+        /**
+         @brief defines if the full second order moments are accumulated
+         */
+        bool full;
+
+      private:
+        /**
+         @brief buffer for the centered observation
+         */
+        std::vector<double> centered_;
+    };
+
     /**
      @brief Default Constructor
      @param bimodal specify if the distribution is bimodal for use in regression
@@ -111,6 +182,13 @@ class GaussianDistribution : public Writable {
      */
     GaussianDistribution(GaussianDistribution const& src);
 
+    /**
+     @brief Move constructor
+     @details the parameter vectors are moved from the source distribution
+     @param src source distribution
+     */
+    GaussianDistribution(GaussianDistribution&& src) noexcept;
+
     /**
      @brief Constructor from Json Structure
      @param root Json Value
@@ -123,6 +201,12 @@ class GaussianDistribution : public Writable {
      */
     GaussianDistribution& operator=(GaussianDistribution const& src);
 
+    /**
+     @brief Move assignment
+     @param src source distribution
+     */
+    GaussianDistribution& operator=(GaussianDistribution&& src) noexcept;
+
     /** @name Likelihood & Regression */
     ///@{
 
@@ -225,6 +309,28 @@ class GaussianDistribution : public Writable {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @details compact files only store the mean and the precision matrix
+     (unimodal) or the covariance (bimodal), as symmetric matrices.
+     @param writer binary writer
+     */
+    void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @details the matrices omitted from compact files are restored by
+     inversion.
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readBinary(BinaryReader& reader);
+
+    ///@}
+
     //        /** @name Conversion & Extraction */
     //        ///@{
     //
@@ -307,6 +413,10 @@ class GaussianDistribution : public Writable {
 
     /**
      @brief Covariance Matrix of the Gaussian Distribution
+     @details in full mode, the symmetric matrix is stored in packed storage
+     (upper triangle, element (i, j) at packedIndex(i, j, dimension)). In
+     diagonal mode, only the diagonal is stored. The Json representation
+     always contains the full square matrix.
      */
     std::vector<double> covariance;
 
@@ -334,6 +444,13 @@ class GaussianDistribution : public Writable {
      */
     void updateOutputCovariance();
 
+    /**
+     @brief Read the parameters of a compact, inference-only binary model file
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readCompactBinary(BinaryReader& reader);
+
     /**
      @brief Defines if regression parameters need to be computed
      */
@@ -345,7 +462,7 @@ class GaussianDistribution : public Writable {
     double covariance_determinant_;
 
     /**
-     @brief Inverse covariance matrix
+     @brief Inverse covariance matrix (same storage as the covariance)
      */
     std::vector<double> inverse_covariance_;
 
@@ -355,7 +472,8 @@ class GaussianDistribution : public Writable {
     double covariance_determinant_input_;
 
     /**
-     @brief Inverse covariance matrix of the input modality
+     @brief Inverse covariance matrix of the input modality (same storage as
+     the covariance)
      */
     std::vector<double> inverse_covariance_input_;
 };
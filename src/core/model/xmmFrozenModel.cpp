@@ -0,0 +1,274 @@
+/*
+ * xmmFrozenModel.cpp
+ *
+ * Flat inference representation of trained Gaussian mixtures
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xmmFrozenModel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+/**
+ @brief number of doubles in an aligned block
+ */
+const std::size_t kBlockSize =
+    xmm::FrozenModel::ALIGNMENT() / sizeof(double);
+
+/**
+ @brief rounds a number of doubles up to a multiple of the alignment
+ */
+std::size_t alignedSize(std::size_t size) {
+    return ((size + kBlockSize - 1) / kBlockSize) * kBlockSize;
+}
+}
+
+#pragma mark -
+#pragma mark Constructors
+xmm::FrozenModel::FrozenModel()
+    : dimension_(0),
+      full_covariance_(true),
+      base_(0),
+      means_(0),
+      precisions_(0),
+      log_normalizers_(0),
+      log_weights_(0),
+      likelihoods_(0),
+      scratch_(0) {}
+
+xmm::FrozenModel::FrozenModel(FrozenModel const& src)
+    : group_offsets_(src.group_offsets_),
+      mixture_offsets_(src.mixture_offsets_),
+      dimension_(src.dimension_),
+      full_covariance_(src.full_covariance_),
+      base_(0),
+      means_(src.means_),
+      precisions_(src.precisions_),
+      log_normalizers_(src.log_normalizers_),
+      log_weights_(src.log_weights_),
+      likelihoods_(src.likelihoods_),
+      scratch_(src.scratch_) {
+    if (!src.storage_.empty()) {
+        std::size_t size = src.storage_.size() - kBlockSize;
+        allocate(size);
+        std::copy(src.block(0), src.block(0) + size, block(0));
+    }
+}
+
+xmm::FrozenModel& xmm::FrozenModel::operator=(FrozenModel const& src) {
+    if (this != &src) {
+        FrozenModel tmp(src);
+        pending_.clear();
+        group_offsets_.swap(tmp.group_offsets_);
+        mixture_offsets_.swap(tmp.mixture_offsets_);
+        dimension_ = tmp.dimension_;
+        full_covariance_ = tmp.full_covariance_;
+        // swapping the storage keeps the data address, and thus its alignment
+        storage_.swap(tmp.storage_);
+        base_ = tmp.base_;
+        means_ = tmp.means_;
+        precisions_ = tmp.precisions_;
+        log_normalizers_ = tmp.log_normalizers_;
+        log_weights_ = tmp.log_weights_;
+        likelihoods_ = tmp.likelihoods_;
+        scratch_ = tmp.scratch_;
+    }
+    return *this;
+}
+
+#pragma mark -
+#pragma mark Accessors
+void xmm::FrozenModel::clear() {
+    pending_.clear();
+    group_offsets_.clear();
+    mixture_offsets_.clear();
+    storage_.clear();
+    base_ = 0;
+}
+
+bool xmm::FrozenModel::empty() const { return storage_.empty(); }
+
+unsigned int xmm::FrozenModel::groups() const {
+    return group_offsets_.empty()
+               ? 0
+               : static_cast<unsigned int>(group_offsets_.size() - 1);
+}
+
+unsigned int xmm::FrozenModel::mixtures(unsigned int group) const {
+    return group_offsets_[group + 1] - group_offsets_[group];
+}
+
+#pragma mark -
+#pragma mark Compilation
+void xmm::FrozenModel::addGroup() {
+    if (!storage_.empty()) clear();
+    if (group_offsets_.empty()) group_offsets_.push_back(0);
+    group_offsets_.push_back(group_offsets_.back());
+}
+
+void xmm::FrozenModel::addMixture(
+    std::vector<float> const& weights,
+    std::vector<GaussianDistribution> const& components) {
+    if (group_offsets_.empty())
+        throw std::runtime_error("No group was declared for the mixture");
+    if (weights.size() != components.size())
+        throw std::runtime_error(
+            "The numbers of weights and components of the mixture differ");
+    PendingMixture mixture = {&weights, &components};
+    pending_.push_back(mixture);
+    group_offsets_.back()++;
+}
+
+void xmm::FrozenModel::compile(bool bimodal) {
+    // Layout
+    std::size_t num_components(0);
+    bool has_components(false);
+    for (auto const& mixture : pending_) {
+        for (auto const& component : *mixture.components) {
+            unsigned int dimension = bimodal ? component.dimension_input.get()
+                                             : component.dimension.get();
+            bool full_covariance =
+                (component.covariance_mode.get() ==
+                 GaussianDistribution::CovarianceMode::Full);
+            if (!has_components) {
+                dimension_ = dimension;
+                full_covariance_ = full_covariance;
+                has_components = true;
+            } else if (dimension != dimension_ ||
+                       full_covariance != full_covariance_) {
+                throw std::runtime_error(
+                    "Frozen components must share the same dimension and "
+                    "covariance mode");
+            }
+            num_components++;
+        }
+    }
+    std::size_t num_mixtures = pending_.size();
+    std::size_t precision_size =
+        full_covariance_ ? packedSize(dimension_) : dimension_;
+
+    means_ = 0;
+    precisions_ = means_ + alignedSize(num_components * dimension_);
+    log_normalizers_ =
+        precisions_ + alignedSize(num_components * precision_size);
+    log_weights_ = log_normalizers_ + alignedSize(num_components);
+    likelihoods_ = log_weights_ + alignedSize(num_components);
+    scratch_ = likelihoods_ + alignedSize(num_mixtures);
+    allocate(scratch_ + alignedSize(groups() * dimension_));
+
+    // Fill
+    mixture_offsets_.assign(1, 0);
+    std::size_t c(0);
+    for (auto const& mixture : pending_) {
+        for (std::size_t k = 0; k < mixture.components->size(); k++, c++) {
+            GaussianDistribution const& component = (*mixture.components)[k];
+            double determinant = bimodal
+                                     ? component.covariance_determinant_input_
+                                     : component.covariance_determinant_;
+            if (determinant == 0.0)
+                throw std::runtime_error(
+                    "Covariance Matrix is not invertible");
+            std::vector<double> const& inverse_covariance =
+                (bimodal && full_covariance_)
+                    ? component.inverse_covariance_input_
+                    : component.inverse_covariance_;
+
+            double* mean = block(means_) + c * dimension_;
+            double* precision = block(precisions_) + c * precision_size;
+            std::copy(component.mean.begin(),
+                      component.mean.begin() + dimension_, mean);
+            std::copy(inverse_covariance.begin(),
+                      inverse_covariance.begin() + precision_size, precision);
+            block(log_normalizers_)[c] =
+                -0.5 * (log(determinant) + dimension_ * log(2 * M_PI));
+            block(log_weights_)[c] = log(double((*mixture.weights)[k]));
+        }
+        mixture_offsets_.push_back(static_cast<unsigned int>(c));
+    }
+    pending_.clear();
+}
+
+void xmm::FrozenModel::allocate(std::size_t size) {
+    storage_.assign(size + kBlockSize, 0.0);
+    std::size_t misalignment =
+        reinterpret_cast<std::uintptr_t>(storage_.data()) % ALIGNMENT();
+    base_ = misalignment ? (ALIGNMENT() - misalignment) / sizeof(double) : 0;
+}
+
+#pragma mark -
+#pragma mark Inference
+const double* xmm::FrozenModel::evaluate(unsigned int group,
+                                         const float* observation,
+                                         double* posteriors) {
+    const double* means = block(means_);
+    const double* precisions = block(precisions_);
+    const double* log_normalizers = block(log_normalizers_);
+    const double* log_weights = block(log_weights_);
+    double* likelihoods = block(likelihoods_);
+    double* diff = block(scratch_) + group * dimension_;
+    std::size_t precision_size =
+        full_covariance_ ? packedSize(dimension_) : dimension_;
+
+    unsigned int first_component = mixture_offsets_[group_offsets_[group]];
+    for (unsigned int m = group_offsets_[group];
+         m < group_offsets_[group + 1]; m++) {
+        double likelihood(0.);
+        for (unsigned int c = mixture_offsets_[m];
+             c < mixture_offsets_[m + 1]; c++) {
+            const double* mean = means + c * dimension_;
+            const double* precision = precisions + c * precision_size;
+            for (unsigned int d = 0; d < dimension_; d++)
+                diff[d] = observation[d] - mean[d];
+            double distance(0.);
+            if (full_covariance_) {
+                distance = packedQuadraticForm(
+                    precision, dimension_,
+                    [diff](unsigned int d) { return diff[d]; });
+            } else {
+                for (unsigned int l = 0; l < dimension_; l++)
+                    distance += precision[l] * diff[l] * diff[l];
+            }
+            double log_likelihood = log_normalizers[c] - 0.5 * distance;
+            if (!(log_likelihood >= LOG_LIKELIHOOD_FLOOR()) ||
+                std::isinf(log_likelihood))
+                log_likelihood = LOG_LIKELIHOOD_FLOOR();
+            double p = exp(log_weights[c] + log_likelihood);
+            if (posteriors) posteriors[c - first_component] = p;
+            likelihood += p;
+        }
+        likelihoods[m] = likelihood;
+    }
+    return likelihoods + group_offsets_[group];
+}
+
+const double* xmm::FrozenModel::likelihoods(unsigned int group) const {
+    return block(likelihoods_) + group_offsets_[group];
+}
@@ -0,0 +1,258 @@
+/*
+ * xmmFrozenModel.hpp
+ *
+ * Flat inference representation of trained Gaussian mixtures
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef xmmFrozenModel_h
+#define xmmFrozenModel_h
+
+#include "../distributions/xmmGaussianDistribution.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace xmm {
+/**
+ @ingroup Model
+ @brief Compiled representation of a set of trained Gaussian mixtures for
+ low-latency inference
+ @details The mixtures are organized in groups (one group per class). The
+ parameters of all components (means, inverse covariances, log-normalizers and
+ log-weights) are copied into a single contiguous arena, as a
+ structure-of-arrays where each array starts on a 64-byte boundary. The
+ evaluation of a group only reads the arena, and writes the likelihood of each
+ mixture of the group in a contiguous buffer of the arena.
+
+ The representation is built in two steps: groups and mixtures are first
+ declared with addGroup() and addMixture(), then compile() allocates and fills
+ the arena at once. The declared mixtures must remain valid until compile() is
+ called.
+ */
+class FrozenModel {
+  public:
+    /**
+     @brief Alignment of the arrays of the arena (in bytes)
+     */
+    static std::size_t ALIGNMENT() { return 64; }
+
+    /**
+     @brief Minimum log-likelihood of a component (matches the floor of
+     GaussianDistribution likelihoods)
+     */
+    static double LOG_LIKELIHOOD_FLOOR() { return -414.4653167389282; }
+
+    /**
+     @brief Default Constructor
+     */
+    FrozenModel();
+
+    /**
+     @brief Copy Constructor
+     @param src Source Model
+     */
+    FrozenModel(FrozenModel const& src);
+
+    /**
+     @brief Assignment
+     @param src Source Model
+     */
+    FrozenModel& operator=(FrozenModel const& src);
+
+    /**
+     @brief Releases the arena
+     */
+    void clear();
+
+    /**
+     @brief Checks if the representation is compiled
+     @return true if no arena is compiled
+     */
+    bool empty() const;
+
+    /**
+     @brief Get the number of groups of mixtures
+     @return the number of groups
+     */
+    unsigned int groups() const;
+
+    /**
+     @brief Get the number of mixtures of a group
+     @param group index of the group
+     @return the number of mixtures in the group
+     */
+    unsigned int mixtures(unsigned int group) const;
+
+    /** @name Compilation */
+    ///@{
+
+    /**
+     @brief Starts a new group of mixtures
+     @details the existing arena is released
+     */
+    void addGroup();
+
+    /**
+     @brief Declares a mixture in the current group
+     @param weights mixture coefficients
+     @param components Gaussian components of the mixture
+     @throws runtime_error if no group was declared or if the sizes of the
+     weights and components do not match
+     */
+    void addMixture(std::vector<float> const& weights,
+                    std::vector<GaussianDistribution> const& components);
+
+    /**
+     @brief Allocates and fills the arena with the declared mixtures
+     @param bimodal if true, the likelihoods are computed on the input modality
+     @throws runtime_error if a covariance matrix is not invertible or if the
+     components do not share the same dimension and covariance mode
+     */
+    void compile(bool bimodal);
+
+    ///@}
+
+    /** @name Inference */
+    ///@{
+
+    /**
+     @brief Computes the likelihood of all mixtures of a group
+     @details groups can be evaluated concurrently from different threads.
+     @param group index of the group
+     @param observation observation vector (input modality if bimodal)
+     @param posteriors optional output: weighted likelihood of each component
+     of the group
+     @return pointer to the likelihoods of the mixtures of the group
+     */
+    const double* evaluate(unsigned int group, const float* observation,
+                           double* posteriors = NULL);
+
+    /**
+     @brief Get the likelihoods computed at the last evaluation of a group
+     @param group index of the group
+     @return pointer to the likelihoods of the mixtures of the group
+     */
+    const double* likelihoods(unsigned int group) const;
+
+    ///@}
+
+  protected:
+    /**
+     @brief Allocates the aligned storage for a given number of doubles
+     */
+    void allocate(std::size_t size);
+
+    /**
+     @brief Pointer to an array of the arena
+     */
+    double* block(std::size_t offset) { return &storage_[base_ + offset]; }
+
+    /**
+     @brief Pointer to an array of the arena
+     */
+    const double* block(std::size_t offset) const {
+        return &storage_[base_ + offset];
+    }
+
+    /**
+     @brief Mixture declared for compilation
+     */
+    struct PendingMixture {
+        std::vector<float> const* weights;
+        std::vector<GaussianDistribution> const* components;
+    };
+
+    /**
+     @brief Mixtures declared for compilation
+     */
+    std::vector<PendingMixture> pending_;
+
+    /**
+     @brief Index of the first mixture of each group (size: groups + 1)
+     */
+    std::vector<unsigned int> group_offsets_;
+
+    /**
+     @brief Index of the first component of each mixture (size: mixtures + 1)
+     */
+    std::vector<unsigned int> mixture_offsets_;
+
+    /**
+     @brief Dimension of the observations
+     */
+    unsigned int dimension_;
+
+    /**
+     @brief Defines if the components use full covariance matrices
+     */
+    bool full_covariance_;
+
+    /**
+     @brief Storage of the arena (over-allocated for alignment)
+     */
+    std::vector<double> storage_;
+
+    /**
+     @brief Index of the first aligned element of the storage
+     */
+    std::size_t base_;
+
+    /**
+     @brief Offset of the means (components x dimension)
+     */
+    std::size_t means_;
+
+    /**
+     @brief Offset of the inverse covariances (components x packed symmetric
+     matrices, or components x dimension for diagonal covariances)
+     */
+    std::size_t precisions_;
+
+    /**
+     @brief Offset of the log-normalizers of the components
+     */
+    std::size_t log_normalizers_;
+
+    /**
+     @brief Offset of the log-weights of the components
+     */
+    std::size_t log_weights_;
+
+    /**
+     @brief Offset of the likelihoods of the mixtures
+     */
+    std::size_t likelihoods_;
+
+    /**
+     @brief Offset of the per-group scratch vectors (groups x dimension)
+     */
+    std::size_t scratch_;
+};
+}
+
+#endif
@@ -34,11 +34,19 @@
 #ifndef xmmModel_h
 #define xmmModel_h
 
+#include "../common/xmmJsonStream.hpp"
+#include "../common/xmmLockFreeQueue.hpp"
+#include "../common/xmmWorkerPool.hpp"
+#include "xmmFrozenModel.hpp"
 #include "xmmModelConfiguration.hpp"
 #include "xmmModelResults.hpp"
 #include "xmmModelSingleClass.hpp"
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <memory>
 #include <thread>
+#include <unordered_map>
 
 namespace xmm {
 /**
@@ -60,7 +68,9 @@ class Model : public Writable {
           cancel_required_(false),
           is_training_(false),
           is_joining_(false),
-          models_still_training_(0) {
+          models_still_training_(0),
+          pruning_frame_index_(0),
+          regression_mass_(0.) {
         shared_parameters->bimodal.set(bimodal);
         if (shared_parameters->bimodal.get()) {
             shared_parameters->dimension.set(2, true);
@@ -83,19 +93,52 @@ class Model : public Writable {
           cancel_required_(false),
           is_training_(false),
           is_joining_(false),
-          models_still_training_(0) {
+          models_still_training_(0),
+          pruning_frame_index_(0),
+          regression_mass_(0.) {
         if (src.is_training_)
             throw std::runtime_error(
                 "Cannot copy: source model is still training");
         models = src.models;
+        class_ids_ = src.class_ids_;
+        class_inactive_frames_ = src.class_inactive_frames_;
+        pruning_frame_index_ = src.pruning_frame_index_;
+        frozen_ = src.frozen_;
+        results = src.results;
         for (auto& model : models) {
-            model.second.training_events.removeListeners();
-            model.second.training_events.addListener(
+            model.training_events.removeListeners();
+            model.training_events.addListener(
                 this,
                 &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
         }
     }
 
+    /**
+     @brief Move Constructor
+     @details the class models are moved from the source model, which is left
+     empty. The models of the classes notify the new model of their training
+     events.
+     @param src Source Model
+     @throws runtime_error if the source model is training
+     */
+    Model(Model<SingleClassModel, ModelType>&& src)
+        : shared_parameters(std::make_shared<SharedParameters>()),
+          configuration(src.configuration),
+          training_events(src.training_events),
+          cancel_required_(false),
+          is_training_(false),
+          is_joining_(false),
+          models_still_training_(0),
+          pruning_frame_index_(0),
+          regression_mass_(0.) {
+        if (src.is_training_)
+            throw std::runtime_error(
+                "Cannot move: source model is still training");
+        // the class models keep pointing to the moved shared parameters
+        shared_parameters.swap(src.shared_parameters);
+        moveClassesFrom(src);
+    }
+
     /**
      @brief Constructor from Json Structure
      @param root Json Value
@@ -105,19 +148,15 @@ class Model : public Writable {
           cancel_required_(false),
           is_training_(false),
           is_joining_(false),
-          models_still_training_(0) {
+          models_still_training_(0),
+          pruning_frame_index_(0),
+          regression_mass_(0.) {
         shared_parameters->fromJson(root["shared_parameters"]);
         configuration.fromJson(root["configuration"]);
         models.clear();
-        for (auto p : root["models"]) {
-            std::string l = p["label"].asString();
-            models.insert(std::pair<std::string, SingleClassModel>(
-                l, SingleClassModel(shared_parameters, p)));
-            models[l].training_events.removeListeners();
-            models[l].training_events.addListener(
-                this,
-                &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
-        }
+        std::unique_ptr<WorkerPool> pool;
+        addClassesFromJson(root["models"], pool);
+        updateClassIds();
     }
 
     /**
@@ -143,10 +182,16 @@ class Model : public Writable {
             models_still_training_ = 0;
 
             models.clear();
+            filtering_pool_.reset();
             models = src.models;
+            class_ids_ = src.class_ids_;
+            class_inactive_frames_ = src.class_inactive_frames_;
+            pruning_frame_index_ = src.pruning_frame_index_;
+            frozen_ = src.frozen_;
+            results = src.results;
             for (auto& model : this->models) {
-                model.second.training_events.removeListeners();
-                model.second.training_events.addListener(
+                model.training_events.removeListeners();
+                model.training_events.addListener(
                     this,
                     &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
             }
@@ -154,6 +199,37 @@ class Model : public Writable {
         return *this;
     }
 
+    /**
+     @brief Move Assignment
+     @details the class models are moved from the source model, which is left
+     empty.
+     @param src Source Model
+     @throws runtime_error if the source or target model is training
+     */
+    Model<SingleClassModel, ModelType>& operator=(
+        Model<SingleClassModel, ModelType>&& src) {
+        if (this != &src) {
+            if (is_training_)
+                throw std::runtime_error(
+                    "Cannot move: target model is still training");
+            if (src.is_training_)
+                throw std::runtime_error(
+                    "Cannot move: source model is still training");
+            shared_parameters.swap(src.shared_parameters);
+            configuration = src.configuration;
+            training_events = src.training_events;
+            is_joining_ = false;
+            is_training_ = false;
+            cancel_required_ = false;
+            models_still_training_ = 0;
+
+            models.clear();
+            filtering_pool_.reset();
+            moveClassesFrom(src);
+        }
+        return *this;
+    }
+
     /**
      @brief Destructor
      */
@@ -180,38 +256,70 @@ class Model : public Writable {
      */
     bool hasClass(std::string const& label) const {
         checkTraining();
-        return (models.count(label) > 0);
+        return (class_ids_.count(label) > 0);
     }
 
     /**
-     @brief Checks if a class exists
+     @brief Get the index (class ID) of a class
+     @details Class IDs are the indices of the classes in the models vector.
+     They are stable when classes are added or retrained, and are only
+     shifted when a class is removed.
      @param label class label
-     @return true if the class labeled 'label' exists
+     @return index of the class labeled 'label', or -1 if it does not exist
      */
     int getIndex(std::string const& label) const {
         checkTraining();
-        int i(-1);
-        for (auto& m : models) {
-            i++;
-            if (m.first == label) {
-                return i;
-            }
-        }
-        return -1;
+        auto it = class_ids_.find(label);
+        if (it == class_ids_.end()) return -1;
+        return static_cast<int>(it->second);
+    }
+
+    /**
+     @brief Get the model of a class by label
+     @param label class label
+     @return a reference to the model of the class labeled 'label'
+     @throws out_of_range if the class does not exist
+     */
+    SingleClassModel& getClass(std::string const& label) {
+        auto it = class_ids_.find(label);
+        if (it == class_ids_.end())
+            throw std::out_of_range("Class " + label + " does not exist");
+        return models[it->second];
+    }
+
+    /**
+     @brief Get the model of a class by label
+     @param label class label
+     @return a const reference to the model of the class labeled 'label'
+     @throws out_of_range if the class does not exist
+     */
+    SingleClassModel const& getClass(std::string const& label) const {
+        auto it = class_ids_.find(label);
+        if (it == class_ids_.end())
+            throw std::out_of_range("Class " + label + " does not exist");
+        return models[it->second];
     }
 
     /**
      @brief Remove a specific class by label
+     @details the indices of the following classes are shifted
      @param label label of the class to remove
+     @throws out_of_range if the class does not exist
+     @throws runtime_error if other classes are still training
      */
     virtual void removeClass(std::string const& label) {
         while (is_joining_) {
         }
         cancelTraining(label);
-        auto it = models.find(label);
-        if (it == models.end())
+        auto it = class_ids_.find(label);
+        if (it == class_ids_.end())
             throw std::out_of_range("Class " + label + " does not exist");
-        models.erase(it);
+        if (is_training_)
+            throw std::runtime_error(
+                "Cannot remove a class while the model is training");
+        unfreeze();
+        models.erase(models.begin() + it->second);
+        updateClassIds();
         reset();
     }
 
@@ -220,7 +328,9 @@ class Model : public Writable {
      */
     virtual void clear() {
         if (is_training_) cancelTraining();
+        unfreeze();
         models.clear();
+        class_ids_.clear();
         reset();
     }
 
@@ -251,7 +361,7 @@ class Model : public Writable {
         is_training_ = true;
 
         // Fetch training set parameters
-        shared_parameters->dimension = trainingSet->dimension.get();
+        shared_parameters->dimension.set(trainingSet->dimension.get());
         if (shared_parameters->bimodal.get()) {
             shared_parameters->dimension_input.set(
                 trainingSet->dimension_input.get());
@@ -260,37 +370,92 @@ class Model : public Writable {
         shared_parameters->column_names.set(trainingSet->column_names.get());
         
         // Update models
-        bool contLoop(true);
-        while (contLoop) {
-            contLoop = false;
-            for (auto it = models.begin(); it != models.end(); ++it) {
-                if (trainingSet->labels().count(it->first) == 0) {
-                    models.erase(it->first);
-                    contLoop = true;
-                    break;
-                }
-            }
-        }
+        models.reserve(trainingSet->labels().size());
         for (typename std::set<std::string>::iterator it =
                  trainingSet->labels().begin();
              it != trainingSet->labels().end(); ++it) {
             addModelForClass(*it);
         }
+        // Compute the statistics of all classes in a single pass, before the
+        // training threads read them concurrently
+        trainingSet->statistics();
+        trainSharedParameters(trainingSet);
         // Start class training
-        for (auto it = this->models.begin(); it != this->models.end(); ++it) {
-            it->second.is_training_ = true;
-            it->second.cancel_training_ = false;
+        void (SingleClassProbabilisticModel::*trainClass)(TrainingSet*) =
+            &SingleClassProbabilisticModel::train;
+        unsigned int concurrent_trainings = concurrentTrainings();
+        for (auto& model : models) {
+            model.is_training_ = true;
+            model.cancel_training_ = false;
+            model.concurrent_trainings_ = concurrent_trainings;
             models_still_training_++;
             if ((configuration.multithreading ==
                  MultithreadingMode::Parallel) ||
                 (configuration.multithreading ==
                  MultithreadingMode::Background)) {
                     training_threads_.insert(std::pair<std::string, std::thread>(
-                    it->first,
-                    std::thread(&SingleClassModel::train, &it->second,
-                                trainingSet->getPhrasesOfClass(it->first))));
+                    model.label,
+                    std::thread(trainClass, &model,
+                                trainingSet->getPhrasesOfClass(model.label))));
             } else {
-                it->second.train(trainingSet->getPhrasesOfClass(it->first));
+                model.train(trainingSet->getPhrasesOfClass(model.label));
+            }
+        }
+        if (configuration.multithreading == MultithreadingMode::Parallel) {
+            joinTraining();
+        }
+        if (configuration.multithreading == MultithreadingMode::Sequential) {
+            is_training_ = false;
+        }
+    }
+
+    /**
+     @brief Train all classes from a phrase store (out-of-core training)
+     @details the phrases of each class are streamed from the store by chunks,
+     so that the memory used by the training of each class is bounded by the
+     chunk size of the store.
+     @param store Phrase Store
+     @see SingleClassProbabilisticModel::train(PhraseStore const*)
+     */
+    virtual void train(PhraseStore const* store) {
+        if (!store || store->size() < 1) return;
+        cancelTraining();
+        clear();
+
+        is_training_ = true;
+
+        // Fetch training set parameters
+        shared_parameters->dimension.set(store->dimension());
+        if (shared_parameters->bimodal.get()) {
+            shared_parameters->dimension_input.set(store->dimension_input());
+        }
+        shared_parameters->column_names.resize(store->dimension());
+        shared_parameters->column_names.set(store->column_names());
+
+        // Update models
+        models.reserve(store->labels().size());
+        for (auto const& label : store->labels()) addModelForClass(label);
+        trainSharedParameters(store);
+
+        // Start class training
+        void (SingleClassProbabilisticModel::*trainClass)(PhraseStore const*) =
+            &SingleClassProbabilisticModel::train;
+        unsigned int concurrent_trainings = concurrentTrainings();
+        for (auto& model : models) {
+            model.is_training_ = true;
+            model.cancel_training_ = false;
+            model.concurrent_trainings_ = concurrent_trainings;
+            models_still_training_++;
+            if ((configuration.multithreading ==
+                 MultithreadingMode::Parallel) ||
+                (configuration.multithreading ==
+                 MultithreadingMode::Background)) {
+                training_threads_.insert(std::pair<std::string, std::thread>(
+                    model.label,
+                    std::thread(trainClass, &model,
+                                store->getPhrasesOfClass(model.label))));
+            } else {
+                model.train(store->getPhrasesOfClass(model.label));
             }
         }
         if (configuration.multithreading == MultithreadingMode::Parallel) {
@@ -330,10 +495,17 @@ class Model : public Writable {
                     "models");
         }
 
+        // Adding a class can reallocate the models of the classes that are
+        // still training
+        if (is_training_ && class_ids_.count(label) == 0)
+            throw std::runtime_error(
+                "Cannot add a class while the model is training");
+
         is_training_ = true;
+        unfreeze();
 
         // Fetch training set parameters
-        shared_parameters->dimension = trainingSet->dimension.get();
+        shared_parameters->dimension.set(trainingSet->dimension.get());
         if (shared_parameters->bimodal.get()) {
             shared_parameters->dimension_input.set(
                 trainingSet->dimension_input.get());
@@ -342,16 +514,22 @@ class Model : public Writable {
         shared_parameters->column_names.set(trainingSet->column_names.get());
         
         addModelForClass(label);
+        trainingSet->getPhrasesOfClass(label)->statistics();
+        trainSharedParameters(trainingSet);
 
         // Start class training
-        models[label].is_training_ = true;
-        models[label].cancel_training_ = false;
+        SingleClassModel& model = models[class_ids_[label]];
+        model.is_training_ = true;
+        model.cancel_training_ = false;
+        model.concurrent_trainings_ = concurrentTrainings();
         models_still_training_++;
         if (configuration.multithreading == MultithreadingMode::Sequential) {
-            models[label].xmm::SingleClassProbabilisticModel::train(trainingSet->getPhrasesOfClass(label));
+            model.xmm::SingleClassProbabilisticModel::train(trainingSet->getPhrasesOfClass(label));
         } else {
+            void (SingleClassProbabilisticModel::*trainClass)(TrainingSet*) =
+                &SingleClassProbabilisticModel::train;
             training_threads_[label] =
-                std::thread(&SingleClassModel::train, &(this->models[label]),
+                std::thread(trainClass, &model,
                             trainingSet->getPhrasesOfClass(label));
         }
         if (configuration.multithreading == MultithreadingMode::Parallel) {
@@ -367,10 +545,10 @@ class Model : public Writable {
      */
     void cancelTraining() {
         if (is_training_) {
-            for (auto& it : this->models) {
+            for (auto& model : this->models) {
                 cancel_required_ = true;
-                it.second.cancelTraining();
-                while (it.second.isTraining()) {
+                model.cancelTraining();
+                while (model.isTraining()) {
                 }
             }
             joinTraining();
@@ -383,10 +561,11 @@ class Model : public Writable {
      @param label label of the class to cancel
      */
     void cancelTraining(std::string const& label) {
-        if (is_training_ && (this->models.count(label) > 0)) {
+        if (is_training_ && (class_ids_.count(label) > 0)) {
             cancel_required_ = true;
-            models[label].cancelTraining();
-            while (models[label].isTraining()) {
+            SingleClassModel& model = models[class_ids_[label]];
+            model.cancelTraining();
+            while (model.isTraining()) {
             }
             if (models_still_training_ == 0) {
                 joinTraining();
@@ -406,9 +585,12 @@ class Model : public Writable {
     virtual void reset() {
         checkTraining();
         // checkConfigurationChanges();
-        for (auto it = this->models.begin(); it != this->models.end(); ++it) {
-            it->second.reset();
+        for (auto& model : models) {
+            model.reset();
         }
+        class_inactive_frames_.assign(size(), 0);
+        pruning_frame_index_ = 0;
+        regression_classes_.reserve(size());
     }
 
     /**
@@ -422,6 +604,67 @@ class Model : public Writable {
         // checkConfigurationChanges();
     }
 
+    /**
+     @brief Allocates the queues of asynchronous filtering
+     @details The queues are used to decouple the acquisition of the
+     observations from the inference: a producer thread pushes the
+     observations to pending_observations, a filtering thread calls
+     filterPending(), and a consumer thread pops the results from
+     pending_results. The slots are allocated from the current state of the
+     model, so that the three threads run without locks nor allocations. The
+     method must be called after reset(), when no thread uses the queues.
+     @param capacity maximum number of pending observations and results
+     */
+    void allocateQueues(unsigned int capacity) {
+        unsigned int dimension =
+            shared_parameters->bimodal.get()
+                ? shared_parameters->dimension_input.get()
+                : shared_parameters->dimension.get();
+        pending_observations.resize(capacity, std::vector<float>(dimension));
+        std::size_t label_length(0);
+        for (auto const& model : models)
+            label_length = std::max(label_length, model.label.size());
+        // the slots are copy-constructed from the prototype: the strings and
+        // vectors are filled to their maximum size to reserve their capacity
+        Results<ModelType> prototype(results);
+        prototype.likeliest.assign(label_length, ' ');
+        prototype.evaluated_classes.assign(size(), 0);
+        pending_results.resize(capacity, prototype);
+    }
+
+    /**
+     @brief Filters all the pending observations
+     @details the observations are popped from pending_observations in order.
+     The results of each observation are pushed to pending_results, or dropped
+     if the queue of results is full.
+     @return the number of filtered observations
+     */
+    unsigned int filterPending() {
+        unsigned int filtered(0);
+        while (std::vector<float> const* observation =
+                   pending_observations.front()) {
+            filter(*observation);
+            pending_observations.pop();
+            pending_results.push(results);
+            filtered++;
+        }
+        return filtered;
+    }
+
+    /**
+     @brief Checks if the model is frozen
+     @details a frozen model filters from a flat representation of its
+     parameters, compiled by the freeze() method of the derived model. The
+     representation is discarded when the classes are trained or removed.
+     @return true if the model is frozen
+     */
+    bool frozen() const { return !frozen_.empty(); }
+
+    /**
+     @brief Discards the compiled representation of a frozen model
+     */
+    virtual void unfreeze() { frozen_.clear(); }
+
     ///@}
 
     /** @name Json I/O */
@@ -429,17 +672,24 @@ class Model : public Writable {
 
     /**
      @brief Write the object to a JSON Structure
+     @details the classes are encoded in parallel unless the multithreading
+     mode is sequential
      @return Json value containing the object's information
      */
     virtual Json::Value toJson() const {
         Json::Value root;
         root["shared_parameters"] = shared_parameters->toJson();
         root["configuration"] = configuration.toJson();
+        std::vector<Json::Value> classes(size());
+        std::unique_ptr<WorkerPool> pool;
+        runOnClasses(size(), [this, &classes](unsigned int begin,
+                                              unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+                classes[i] = models[i].toJson();
+        }, pool);
         root["models"].resize(static_cast<Json::ArrayIndex>(size()));
-        Json::ArrayIndex modelIndex(0);
-        for (auto& it : models) {
-            root["models"][modelIndex++] = it.second.toJson();
-        }
+        for (Json::ArrayIndex i = 0; i < classes.size(); i++)
+            root["models"][i].swap(classes[i]);
         return root;
     }
 
@@ -452,15 +702,278 @@ class Model : public Writable {
         try {
             EventGenerator<TrainingEvent> _tmp_training_events(training_events);
             Model<SingleClassModel, ModelType> tmp(root);
-            *this = tmp;
+            *this = std::move(tmp);
             training_events = _tmp_training_events;
         } catch (JsonException& e) {
             throw e;
         }
     }
 
+    /**
+     @brief Write the model to a stream in JSON format
+     @details the classes are written one after the other, without building
+     the Json::Value of the complete model. The document has the same schema
+     as toJson(), with the shared parameters written before the classes.
+     Batches of classes are encoded in parallel unless the multithreading mode
+     is sequential.
+     @param stream output stream
+     @throws runtime_error if the model is training or if the stream cannot be
+     written
+     */
+    virtual void writeJson(std::ostream& stream) const {
+        checkTraining();
+        JsonStreamWriter writer(stream);
+        writer.beginObject();
+        writer.key("shared_parameters");
+        writer.value(shared_parameters->toJson());
+        writer.key("configuration");
+        writer.value(configuration.toJson());
+        writeJsonMembers(writer);
+        writer.key("models");
+        writer.beginArray();
+        unsigned int batch_size = jsonBatchSize();
+        std::vector<Json::Value> batch(std::min(batch_size, size()));
+        std::unique_ptr<WorkerPool> pool;
+        for (unsigned int first = 0; first < size(); first += batch_size) {
+            unsigned int num_classes = std::min(batch_size, size() - first);
+            runOnClasses(num_classes, [this, &batch, first](unsigned int begin,
+                                                            unsigned int end) {
+                for (unsigned int i = begin; i < end; i++)
+                    batch[i] = models[first + i].toJson();
+            }, pool);
+            for (unsigned int i = 0; i < num_classes; i++)
+                writer.value(batch[i]);
+        }
+        writer.endArray();
+        writer.endObject();
+    }
+
+    /**
+     @brief Read the model in place from a stream in JSON format
+     @details the classes are constructed in the models vector by batches as
+     they are parsed, so that only the Json::Value of a few classes is held in
+     memory at a time. The classes of a batch are decoded in parallel unless
+     the multithreading mode is sequential. This requires the shared
+     parameters to precede the classes in the document (as written by
+     writeJson()): otherwise, all the classes are parsed before being
+     constructed. The listeners of the training events are
+     preserved. A document with inconsistent parameters leaves the model
+     empty.
+     @param stream input stream
+     @throws runtime_error if the model is training or if the document cannot
+     be parsed
+     @throws JsonException if the JSON value has a wrong format
+     */
+    virtual void readJson(std::istream& stream) {
+        checkTraining();
+        JsonStreamReader reader(stream);
+        clear();
+        try {
+            Json::Value root(Json::objectValue);
+            Json::Value pending_classes(Json::arrayValue);
+            bool has_shared_parameters(false);
+            std::unique_ptr<WorkerPool> pool;
+            std::string name;
+            reader.beginObject();
+            while (reader.nextMember(name)) {
+                if (name == "shared_parameters") {
+                    shared_parameters->fromJson(reader.readValue());
+                    has_shared_parameters = true;
+                } else if (name == "models") {
+                    reader.beginArray();
+                    while (reader.nextElement()) {
+                        Json::Value class_root = reader.readValue();
+                        pending_classes.append(Json::Value()).swap(class_root);
+                        if (has_shared_parameters &&
+                            pending_classes.size() >= jsonBatchSize()) {
+                            addClassesFromJson(pending_classes, pool);
+                            pending_classes = Json::Value(Json::arrayValue);
+                        }
+                    }
+                } else {
+                    root[name] = reader.readValue();
+                }
+            }
+            reader.checkEnd();
+            if (!has_shared_parameters)
+                shared_parameters->fromJson(root["shared_parameters"]);
+            addClassesFromJson(pending_classes, pool);
+            configuration.fromJson(root["configuration"]);
+            updateClassIds();
+            readJsonMembers(root);
+        } catch (...) {
+            clear();
+            throw;
+        }
+        reset();
+    }
+
+    ///@}
+
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the model to a stream in the binary model format
+     @details the binary format is a compact, versioned and checksummed
+     alternative to toJson(), designed for fast loading.
+     @param stream output stream (opened in binary mode)
+     @throws runtime_error if the model is training or if the stream cannot be
+     written
+     @see BinaryWriter
+     */
+    void writeBinary(std::ostream& stream) const {
+        checkTraining();
+        BinaryWriter writer;
+        writeBinaryPayload(writer);
+        writer.save(stream, binaryType());
+    }
+
+    /**
+     @brief Write an inference-only model to a stream in the compact binary
+     model format
+     @details the data that is only used for training is omitted: the column
+     names, the covariances of unimodal models (the precision matrices suffice
+     for recognition), the precision matrices of bimodal models (restored from
+     the covariances when loading), and the lower triangle of the symmetric
+     matrices. The parameters can be stored in half precision or as 8-bit
+     integers with a per-tensor scale. 8-bit tensors whose small nonzero
+     values would be rounded to zero (e.g. the precisions of features with
+     very different scales) are stored in half precision. Compact files are
+     loaded by readBinary(), and compare() measures the accuracy of the loaded
+     model against the original model.
+     @param stream output stream (opened in binary mode)
+     @param precision storage precision of the parameters
+     @throws runtime_error if the model is training, if the stream cannot be
+     written, if quantized parameters are not finite, or if the dynamic range
+     of a covariance or precision matrix exceeds half precision
+     @see BinaryWriter
+     */
+    void writeCompactBinary(
+        std::ostream& stream,
+        BinaryPrecision precision = BinaryPrecision::Full) const {
+        checkTraining();
+        BinaryWriter writer(true, precision);
+        writeBinaryPayload(writer);
+        writer.save(stream, binaryType());
+    }
+
+    /**
+     @brief Read the model in place from a stream in the binary model format
+     @details Contrary to fromJson(), the classes are constructed directly in
+     the models vector, without building and copying a temporary model, and
+     the inverse covariances of the Gaussian distributions are read instead of
+     being recomputed. Compact files (see writeCompactBinary()) are also
+     accepted. The listeners of the training events are preserved.
+     The checksums are verified before the model is modified: a corrupted file
+     leaves the model unchanged, whereas a file with inconsistent parameters
+     leaves the model empty.
+     @param stream input stream (opened in binary mode)
+     @throws runtime_error if the model is training, if the stream does not
+     contain a binary file of this type of model, or if the file is corrupted
+     @throws domain_error if a parameter of the file is out of range
+     */
+    void readBinary(std::istream& stream) {
+        checkTraining();
+        BinaryReader reader(stream, binaryType());
+        clear();
+        try {
+            readBinaryPayload(reader);
+            reader.checkEnd();
+        } catch (...) {
+            clear();
+            throw;
+        }
+        reset();
+    }
+
     ///@}
 
+    /**
+     @brief Compares the results of the model with the results of a reference
+     model on a set of phrases
+     @details both models are reset before each phrase, and filter all its
+     frames (the input modality of bimodal models). The typical use is to
+     measure the accuracy of a model loaded from a compact binary file against
+     the full-precision model, on a held-out training set.
+     @param reference reference model (with the same classes)
+     @param trainingSet phrases to filter
+     @return differences between the results of the two models
+     @throws runtime_error if a model is training, if the models do not have
+     the same classes and dimensions, or if the training set has a lower
+     dimension than the models
+     */
+    AccuracyReport compare(Model<SingleClassModel, ModelType>& reference,
+                           TrainingSet* trainingSet) {
+        checkTraining();
+        reference.checkTraining();
+        bool bimodal = shared_parameters->bimodal.get();
+        unsigned int dimension = bimodal
+                                     ? shared_parameters->dimension_input.get()
+                                     : shared_parameters->dimension.get();
+        bool same_classes =
+            size() == reference.size() &&
+            bimodal == reference.shared_parameters->bimodal.get() &&
+            shared_parameters->dimension.get() ==
+                reference.shared_parameters->dimension.get() &&
+            shared_parameters->dimension_input.get() ==
+                reference.shared_parameters->dimension_input.get();
+        for (unsigned int i = 0; same_classes && i < size(); i++)
+            same_classes = (models[i].label == reference.models[i].label);
+        if (!same_classes)
+            throw std::runtime_error(
+                "Cannot compare models with different classes");
+        AccuracyReport report;
+        if (!trainingSet) return report;
+        if (trainingSet->dimension.get() < dimension)
+            throw std::runtime_error(
+                "The training set has a lower dimension than the model");
+
+        std::vector<float> observation(dimension);
+        unsigned int agreements(0);
+        std::size_t likelihood_count(0), output_count(0);
+        for (auto it = trainingSet->begin(); it != trainingSet->end(); ++it) {
+            reset();
+            reference.reset();
+            for (unsigned int t = 0; t < it->second->size(); t++) {
+                for (unsigned int d = 0; d < dimension; d++)
+                    observation[d] = it->second->getValue(t, d);
+                filter(observation);
+                reference.filter(observation);
+                report.frames++;
+                if (results.likeliest == reference.results.likeliest)
+                    agreements++;
+                for (unsigned int c = 0; c < size(); c++) {
+                    double delta = std::fabs(
+                        results.smoothed_normalized_likelihoods[c] -
+                        reference.results.smoothed_normalized_likelihoods[c]);
+                    report.max_likelihood_delta =
+                        std::max(report.max_likelihood_delta, delta);
+                    report.mean_likelihood_delta += delta;
+                    likelihood_count++;
+                }
+                for (unsigned int d = 0; d < results.output_values.size();
+                     d++) {
+                    double delta =
+                        std::fabs(results.output_values[d] -
+                                  reference.results.output_values[d]);
+                    report.max_output_delta =
+                        std::max(report.max_output_delta, delta);
+                    report.mean_output_delta += delta;
+                    output_count++;
+                }
+            }
+        }
+        if (report.frames > 0)
+            report.label_agreement = double(agreements) / report.frames;
+        if (likelihood_count > 0)
+            report.mean_likelihood_delta /= likelihood_count;
+        if (output_count > 0) report.mean_output_delta /= output_count;
+        reset();
+        reference.reset();
+        return report;
+    }
+
     /**
      @brief Set of Parameters shared among classes
      */
@@ -477,11 +990,189 @@ class Model : public Writable {
     EventGenerator<TrainingEvent> training_events;
 
     /**
-     @brief models stored in a map. Each Model is associated with a label
+     @brief models of each class, indexed by class ID
+     @details the label of each class is stored in the label attribute of its
+     model. Use getIndex() or getClass() to access a class by label.
+     */
+    std::vector<SingleClassModel> models;
+
+    /**
+     @brief Results of the Filtering Process (Recognition + Regression)
+     */
+    Results<ModelType> results;
+
+    /**
+     @brief Observations waiting to be filtered by filterPending()
+     @details single producer, single consumer (see allocateQueues())
+     */
+    LockFreeQueue<std::vector<float>> pending_observations;
+
+    /**
+     @brief Results of the observations filtered by filterPending()
+     @details single producer, single consumer (see allocateQueues())
      */
-    std::map<std::string, SingleClassModel> models;
+    LockFreeQueue<Results<ModelType>> pending_results;
 
   protected:
+    /**
+     @brief Type of the model in the header of the binary model files
+     */
+    virtual unsigned int binaryType() const { return 0; }
+
+    /**
+     @brief Writes the parameters of the model to the payload of a binary
+     model file
+     @param writer binary writer
+     */
+    virtual void writeBinaryPayload(BinaryWriter& writer) const {
+        shared_parameters->writeBinary(writer);
+        configuration.writeBinary(writer);
+        writer.writeUInt(static_cast<unsigned int>(size()));
+        for (auto const& model : models) {
+            model.writeBinary(writer);
+        }
+    }
+
+    /**
+     @brief Reads the parameters of the model in place from the payload of a
+     binary model file
+     @details the model must be empty
+     @param reader binary reader
+     */
+    virtual void readBinaryPayload(BinaryReader& reader) {
+        shared_parameters->readBinary(reader);
+        configuration.readBinary(reader);
+        unsigned int num_models = reader.readSize();
+        models.reserve(num_models);
+        for (unsigned int i = 0; i < num_models; i++) {
+            models.emplace_back(shared_parameters);
+            models.back().readBinary(reader);
+            models.back().training_events.addListener(
+                this,
+                &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
+        }
+        updateClassIds();
+    }
+
+    /**
+     @brief Writes the members of the JSON object of the model that are
+     specific to a type of model (used by writeJson())
+     @param writer streaming JSON writer (inside the object of the model)
+     */
+    virtual void writeJsonMembers(JsonStreamWriter& writer) const {}
+
+    /**
+     @brief Reads the members of the JSON object of the model that are specific
+     to a type of model (used by readJson())
+     @details called once the classes are constructed
+     @param root members of the model, except the classes
+     */
+    virtual void readJsonMembers(Json::Value const& root) {}
+
+    /**
+     @brief Trains the parameters shared by the classes, before the training
+     of the classes
+     @details called by train() once the dimensions of the model are set, in
+     the calling thread. Does nothing by default.
+     @param trainingSet training set containing the phrases of all classes
+     */
+    virtual void trainSharedParameters(TrainingSet* trainingSet) {}
+
+    /**
+     @brief Trains the parameters shared by the classes from a phrase store,
+     before the training of the classes (out-of-core training)
+     @param store phrase store containing the phrases of all classes
+     */
+    virtual void trainSharedParameters(PhraseStore const* store) {}
+
+    /**
+     @brief Constructs classes at the end of the models vector from their JSON
+     structures
+     @details the classes are decoded in parallel unless the multithreading
+     mode is sequential. The models vector is left unchanged if a class cannot
+     be decoded.
+     @param roots Json array of the structures of the classes
+     @param pool worker pool reused across the batches of classes (created on
+     first use)
+     @throws JsonException if the JSON value of a class has a wrong format
+     */
+    void addClassesFromJson(Json::Value const& roots,
+                            std::unique_ptr<WorkerPool>& pool) {
+        std::size_t first = models.size();
+        unsigned int num_classes = roots.size();
+        if (models.capacity() < first + num_classes)
+            models.reserve(std::max(first + num_classes, 2 * models.capacity()));
+        for (unsigned int i = 0; i < num_classes; i++)
+            models.emplace_back(shared_parameters);
+        try {
+            runOnClasses(num_classes, [this, &roots, first](unsigned int begin,
+                                                            unsigned int end) {
+                for (unsigned int i = begin; i < end; i++)
+                    models[first + i].fromJson(roots[Json::ArrayIndex(i)]);
+            }, pool);
+        } catch (...) {
+            models.erase(models.begin() + first, models.end());
+            throw;
+        }
+        for (std::size_t i = first; i < models.size(); i++) {
+            models[i].training_events.removeListeners();
+            models[i].training_events.addListener(
+                this,
+                &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
+        }
+    }
+
+    /**
+     @brief Runs a task on a set of classes, in parallel unless the
+     multithreading mode is sequential
+     @details used for the JSON encoding and decoding of the classes, which
+     are independent. The tasks are run by a worker pool with one thread per
+     core, created on first use and reused by the caller for all the batches
+     of a serialization. Its threads are not pinned.
+     @param num_classes number of classes
+     @param task task function, called with a range of class indices
+     @param pool worker pool of the serialization
+     @throws the first exception thrown by a task
+     */
+    void runOnClasses(unsigned int num_classes, WorkerPool::Task const& task,
+                      std::unique_ptr<WorkerPool>& pool) const {
+        if (configuration.multithreading == MultithreadingMode::Sequential ||
+            num_classes < 2) {
+            task(0, num_classes);
+            return;
+        }
+        if (!pool) {
+            unsigned int num_threads =
+                std::min(std::max(std::thread::hardware_concurrency(), 1u),
+                         num_classes);
+            pool.reset(new WorkerPool(
+                num_threads, WorkerPool::DEFAULT_SPIN_ITERATIONS, false));
+        }
+        pool->run(num_classes, task);
+    }
+
+    /**
+     @brief Get the number of classes that can be trained concurrently
+     @details the classes share the memory budget of the moment cache. Unless
+     the multithreading mode is sequential, all classes are assumed to be
+     training at the same time.
+     @return number of classes trained concurrently
+     */
+    unsigned int concurrentTrainings() const {
+        if (configuration.multithreading == MultithreadingMode::Sequential)
+            return 1;
+        return std::max(size(), 1u);
+    }
+
+    /**
+     @brief Get the number of classes encoded or decoded together by the
+     streaming JSON I/O
+     @return number of classes of a batch (a few classes per core)
+     */
+    unsigned int jsonBatchSize() const {
+        return 4 * std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
     /**
      @brief Finishes the background training process by joining threads and
      deleting the models which training failed
@@ -494,21 +1185,16 @@ class Model : public Writable {
                 training_threads_.begin()->second.join();
                 training_threads_.erase(training_threads_.begin());
             }
-            bool classesUntrained(true);
-            while (classesUntrained) {
-                classesUntrained = false;
-                for (auto it = this->models.begin(); it != this->models.end();
-                     it++) {
-                    if (it->second.training_status.status ==
-                            TrainingEvent::Status::Cancel ||
-                        it->second.training_status.status ==
-                            TrainingEvent::Status::Error) {
-                        models.erase(it);
-                        classesUntrained = true;
-                        break;
-                    }
-                }
-            }
+            models.erase(
+                std::remove_if(models.begin(), models.end(),
+                               [](SingleClassModel const& model) {
+                                   return (model.training_status.status ==
+                                               TrainingEvent::Status::Cancel ||
+                                           model.training_status.status ==
+                                               TrainingEvent::Status::Error);
+                               }),
+                models.end());
+            updateClassIds();
             is_joining_ = false;
             is_training_ = false;
             reset();
@@ -573,28 +1259,189 @@ class Model : public Writable {
         }
     }
 
+    /**
+     @brief Checks if a class is suspended by class pruning
+     @param class_index index of the class
+     @return true if the class is suspended
+     */
+    inline bool isClassSuspended(unsigned int class_index) const {
+        return (configuration.pruning_threshold > 0. &&
+                class_inactive_frames_[class_index] >=
+                    configuration.pruning_delay);
+    }
+
+    /**
+     @brief Checks if a class must be evaluated on the current frame
+     @details active classes are always evaluated. Suspended classes are
+     evaluated every pruning_period frames (with an offset depending on the
+     class index to spread the evaluations over time)
+     @param class_index index of the class
+     @return true if the class must be evaluated
+     */
+    inline bool isClassEvaluated(unsigned int class_index) const {
+        if (!isClassSuspended(class_index)) return true;
+        return (configuration.pruning_period > 0 &&
+                (pruning_frame_index_ + class_index) %
+                        configuration.pruning_period ==
+                    0);
+    }
+
+    /**
+     @brief Update the activity of the classes evaluated on the current frame
+     @param normalized_likelihoods normalized likelihood of each class
+     @param evaluated_classes indices of the classes evaluated on the current
+     frame
+     */
+    void updateClassActivity(
+        std::vector<double> const& normalized_likelihoods,
+        std::vector<unsigned int> const& evaluated_classes) {
+        if (configuration.pruning_threshold > 0.) {
+            for (auto class_index : evaluated_classes) {
+                if (normalized_likelihoods[class_index] <
+                    configuration.pruning_threshold) {
+                    if (class_inactive_frames_[class_index] <
+                        configuration.pruning_delay)
+                        class_inactive_frames_[class_index]++;
+                } else {
+                    class_inactive_frames_[class_index] = 0;
+                }
+            }
+        }
+        pruning_frame_index_++;
+    }
+
+    /**
+     @brief Select the classes for which the regression is computed on the
+     current frame
+     @details With MultiClassRegressionEstimator::Likeliest, only the likeliest
+     class is selected. With MultiClassRegressionEstimator::Mixture, the
+     evaluated classes are selected by decreasing normalized likelihood until
+     their cumulative likelihood reaches the regression_mass_threshold of the
+     configuration (at least one class is selected). The selected classes are stored in regression_classes_ and
+     their cumulative likelihood in regression_mass_.
+     @param likeliest_index index of the likeliest class
+     @param normalized_likelihoods normalized likelihood of each class
+     @param evaluated_classes indices of the classes evaluated on the current
+     frame
+     */
+    void updateRegressionClasses(
+        unsigned int likeliest_index,
+        std::vector<double> const& normalized_likelihoods,
+        std::vector<unsigned int> const& evaluated_classes) {
+        regression_classes_.clear();
+        if (configuration.multiClass_regression_estimator ==
+            MultiClassRegressionEstimator::Likeliest) {
+            regression_classes_.push_back(likeliest_index);
+            regression_mass_ = normalized_likelihoods[likeliest_index];
+            return;
+        }
+        regression_classes_.assign(evaluated_classes.begin(),
+                                   evaluated_classes.end());
+        regression_mass_ = 0.;
+        if (configuration.regression_mass_threshold >= 1.) {
+            for (auto class_index : regression_classes_)
+                regression_mass_ += normalized_likelihoods[class_index];
+        } else {
+            std::sort(regression_classes_.begin(), regression_classes_.end(),
+                      [&normalized_likelihoods](unsigned int a,
+                                                unsigned int b) {
+                          return normalized_likelihoods[a] >
+                                 normalized_likelihoods[b];
+                      });
+            unsigned int num_selected(0);
+            while (num_selected < regression_classes_.size() &&
+                   (num_selected == 0 ||
+                    regression_mass_ <
+                        configuration.regression_mass_threshold)) {
+                regression_mass_ += normalized_likelihoods
+                    [regression_classes_[num_selected++]];
+            }
+            regression_classes_.resize(num_selected);
+        }
+        // avoid a division by zero when mixing the outputs of the classes
+        if (regression_mass_ <= 0.) regression_mass_ = 1.;
+    }
+
+    /**
+     @brief Update the thread pool used for parallel filtering
+     @details The pool is only allocated if multiple filtering threads are
+     requested in the configuration and if the amount of work per frame
+     exceeds the configured threshold.
+     @param work estimated amount of work per frame (number of Gaussian
+     components multiplied by the dimension)
+     */
+    void updateFilteringPool(unsigned int work) {
+        unsigned int num_threads =
+            std::min(configuration.filtering_threads, size());
+        if (num_threads > 1 &&
+            work >= configuration.filtering_work_threshold) {
+            if (!filtering_pool_ || filtering_pool_->size() != num_threads)
+                filtering_pool_.reset(new WorkerPool(num_threads));
+        } else {
+            filtering_pool_.reset();
+        }
+    }
+
     /**
      @brief Update training set for a specific label
      @param label label of the sub-training set to update
      @throws out_of_range if the label does not exist
      */
     virtual void addModelForClass(std::string const& label) {
-        if (models.count(label) > 0 && models[label].isTraining())
+        auto it = class_ids_.find(label);
+        if (it != class_ids_.end() && models[it->second].isTraining())
             throw std::runtime_error("The Model is already training");
 
-        if (models.find(label) == models.end()) {
-            models.insert(std::pair<std::string, SingleClassModel>(
-                label, shared_parameters));
-            models[label].training_events.addListener(
+        if (it == class_ids_.end()) {
+            models.push_back(SingleClassModel(shared_parameters));
+            models.back().training_events.addListener(
                 this,
                 &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
-            models[label].label = label;
+            models.back().label = label;
+            it = class_ids_.insert(std::make_pair(label, size() - 1)).first;
         }
+        SingleClassModel& model = models[it->second];
         if (configuration.class_parameters_.count(label) > 0) {
-            models[label].parameters = configuration.class_parameters_[label];
+            model.parameters = configuration.class_parameters_[label];
         } else {
-            models[label].parameters = configuration;
+            model.parameters = configuration;
+        }
+    }
+
+    /**
+     @brief Take the class models and the filtering state of another model
+     @details the source model is left without classes
+     @param src Source Model
+     */
+    void moveClassesFrom(Model<SingleClassModel, ModelType>& src) {
+        // unfreezing the source detaches its classes from its frozen
+        // parameters, which are re-attached to the copy on the next frame
+        frozen_ = src.frozen_;
+        src.unfreeze();
+        models = std::move(src.models);
+        class_ids_ = std::move(src.class_ids_);
+        class_inactive_frames_ = std::move(src.class_inactive_frames_);
+        pruning_frame_index_ = src.pruning_frame_index_;
+        results = std::move(src.results);
+        for (auto& model : models) {
+            model.training_events.removeListeners();
+            model.training_events.addListener(
+                this,
+                &xmm::Model<SingleClassModel, ModelType>::onTrainingEvent);
         }
+        src.models.clear();
+        src.class_ids_.clear();
+        src.class_inactive_frames_.clear();
+        src.pruning_frame_index_ = 0;
+    }
+
+    /**
+     @brief Rebuild the label -> class ID map from the models vector
+     */
+    void updateClassIds() {
+        class_ids_.clear();
+        for (unsigned int i = 0; i < size(); i++)
+            class_ids_[models[i].label] = i;
     }
 
     /**
@@ -629,6 +1476,46 @@ class Model : public Writable {
      @brief Mutex that prevents concurrent calls to onEvent()
      */
     std::mutex event_mutex_;
+
+    /**
+     @brief Number of consecutive frames during which each class had a
+     normalized likelihood below the pruning threshold
+     */
+    std::vector<unsigned int> class_inactive_frames_;
+
+    /**
+     @brief Frame index since the last reset (used for the periodic evaluation
+     of suspended classes)
+     */
+    unsigned int pruning_frame_index_;
+
+    /**
+     @brief Thread pool for parallel filtering (NULL if filtering is
+     sequential)
+     */
+    std::unique_ptr<WorkerPool> filtering_pool_;
+
+    /**
+     @brief Indices of the classes for which the regression is computed on the
+     current frame
+     */
+    std::vector<unsigned int> regression_classes_;
+
+    /**
+     @brief Cumulative normalized likelihood of the classes used for the
+     regression
+     */
+    double regression_mass_;
+
+    /**
+     @brief Compiled representation of the parameters of a frozen model
+     */
+    FrozenModel frozen_;
+
+    /**
+     @brief Class ID (index in the models vector) of each label
+     */
+    std::unordered_map<std::string, unsigned int> class_ids_;
 };
 }
 
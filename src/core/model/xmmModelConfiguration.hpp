@@ -92,12 +92,34 @@ class Configuration : public ClassParameters<ModelType> {
     template <typename SingleClassModel, typename ModelType_>
     friend class Model;
 
+    /**
+     @brief Default number of frames below the pruning threshold before a
+     class is suspended
+     */
+    static const unsigned int DEFAULT_PRUNING_DELAY = 50;
+
+    /**
+     @brief Default period (in frames) of the re-evaluation of suspended classes
+     */
+    static const unsigned int DEFAULT_PRUNING_PERIOD = 25;
+
+    /**
+     @brief Default minimum amount of work per frame for parallel filtering
+     */
+    static const unsigned int DEFAULT_FILTERING_WORK_THRESHOLD = 2000;
+
     /**
      @brief Default Constructor
      */
     Configuration()
         : multithreading(MultithreadingMode::Parallel),
-          multiClass_regression_estimator(MultiClassRegressionEstimator::Likeliest) {}
+          multiClass_regression_estimator(MultiClassRegressionEstimator::Likeliest),
+          regression_mass_threshold(1.),
+          pruning_threshold(0.),
+          pruning_delay(DEFAULT_PRUNING_DELAY),
+          pruning_period(DEFAULT_PRUNING_PERIOD),
+          filtering_threads(1),
+          filtering_work_threshold(DEFAULT_FILTERING_WORK_THRESHOLD) {}
 
     /**
      @brief Copy Constructor
@@ -107,6 +129,12 @@ class Configuration : public ClassParameters<ModelType> {
         : ClassParameters<ModelType>(src),
           multithreading(src.multithreading),
           multiClass_regression_estimator(src.multiClass_regression_estimator),
+          regression_mass_threshold(src.regression_mass_threshold),
+          pruning_threshold(src.pruning_threshold),
+          pruning_delay(src.pruning_delay),
+          pruning_period(src.pruning_period),
+          filtering_threads(src.filtering_threads),
+          filtering_work_threshold(src.filtering_work_threshold),
           class_parameters_(src.class_parameters_) {}
 
     /**
@@ -120,6 +148,17 @@ class Configuration : public ClassParameters<ModelType> {
         multiClass_regression_estimator =
             static_cast<MultiClassRegressionEstimator>(
                 root.get("multiClass_regression_estimator", 0).asInt());
+        regression_mass_threshold =
+            root.get("regression_mass_threshold", 1.).asDouble();
+        pruning_threshold = root.get("pruning_threshold", 0.).asDouble();
+        pruning_delay =
+            root.get("pruning_delay", DEFAULT_PRUNING_DELAY).asUInt();
+        pruning_period =
+            root.get("pruning_period", DEFAULT_PRUNING_PERIOD).asUInt();
+        filtering_threads = root.get("filtering_threads", 1).asUInt();
+        filtering_work_threshold =
+            root.get("filtering_work_threshold",
+                     DEFAULT_FILTERING_WORK_THRESHOLD).asUInt();
         class_parameters_.clear();
         std::vector<std::string> members = root["class_parameters"].getMemberNames();
         for (auto label : members) {
@@ -138,6 +177,12 @@ class Configuration : public ClassParameters<ModelType> {
             multithreading = src.multithreading;
             multiClass_regression_estimator =
                 src.multiClass_regression_estimator;
+            regression_mass_threshold = src.regression_mass_threshold;
+            pruning_threshold = src.pruning_threshold;
+            pruning_delay = src.pruning_delay;
+            pruning_period = src.pruning_period;
+            filtering_threads = src.filtering_threads;
+            filtering_work_threshold = src.filtering_work_threshold;
         }
         return *this;
     }
@@ -190,6 +235,12 @@ class Configuration : public ClassParameters<ModelType> {
         root["multithreading"] = static_cast<int>(multithreading);
         root["multiClass_regression_estimator"] =
             static_cast<int>(multiClass_regression_estimator);
+        root["regression_mass_threshold"] = regression_mass_threshold;
+        root["pruning_threshold"] = pruning_threshold;
+        root["pruning_delay"] = pruning_delay;
+        root["pruning_period"] = pruning_period;
+        root["filtering_threads"] = filtering_threads;
+        root["filtering_work_threshold"] = filtering_work_threshold;
         root["default_parameters"] = ClassParameters<ModelType>::toJson();
         for (auto p : class_parameters_) {
             root["class_parameters"][p.first] = p.second.toJson();
@@ -211,6 +262,60 @@ class Configuration : public ClassParameters<ModelType> {
         }
     }
 
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    void writeBinary(BinaryWriter& writer) const {
+        writer.writeUInt(static_cast<unsigned int>(multithreading));
+        writer.writeUInt(
+            static_cast<unsigned int>(multiClass_regression_estimator));
+        writer.writeDouble(regression_mass_threshold);
+        writer.writeDouble(pruning_threshold);
+        writer.writeUInt(pruning_delay);
+        writer.writeUInt(pruning_period);
+        writer.writeUInt(filtering_threads);
+        writer.writeUInt(filtering_work_threshold);
+        ClassParameters<ModelType>::writeBinary(writer);
+        writer.writeUInt(static_cast<unsigned int>(class_parameters_.size()));
+        for (auto const& p : class_parameters_) {
+            writer.writeString(p.first);
+            p.second.writeBinary(writer);
+        }
+    }
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readBinary(BinaryReader& reader) {
+        unsigned int multithreading_mode = reader.readUInt();
+        unsigned int regression_estimator = reader.readUInt();
+        if (multithreading_mode >
+                static_cast<unsigned int>(MultithreadingMode::Background) ||
+            regression_estimator >
+                static_cast<unsigned int>(
+                    MultiClassRegressionEstimator::Mixture))
+            throw std::runtime_error("Corrupted model file");
+        multithreading = static_cast<MultithreadingMode>(multithreading_mode);
+        multiClass_regression_estimator =
+            static_cast<MultiClassRegressionEstimator>(regression_estimator);
+        regression_mass_threshold = reader.readDouble();
+        pruning_threshold = reader.readDouble();
+        pruning_delay = reader.readUInt();
+        pruning_period = reader.readUInt();
+        filtering_threads = reader.readUInt();
+        filtering_work_threshold = reader.readUInt();
+        ClassParameters<ModelType>::readBinary(reader);
+        class_parameters_.clear();
+        unsigned int num_classes = reader.readSize();
+        for (unsigned int i = 0; i < num_classes; i++) {
+            std::string label = reader.readString();
+            class_parameters_[label].readBinary(reader);
+        }
+    }
+
     /**
      @brief Multithreading Training Mode
      */
@@ -222,6 +327,55 @@ class Configuration : public ClassParameters<ModelType> {
      */
     MultiClassRegressionEstimator multiClass_regression_estimator;
 
+    /**
+     @brief Mixture regression: minimum cumulative normalized likelihood of the
+     classes used for the regression
+     @details With MultiClassRegressionEstimator::Mixture, the regression is
+     only computed for the likeliest classes until their cumulative smoothed
+     normalized likelihood reaches this threshold, and their outputs are mixed
+     with renormalized weights. The default (1) uses all classes.
+     */
+    double regression_mass_threshold;
+
+    /**
+     @brief Class pruning: floor on the normalized likelihood of a class
+     @details A class whose normalized likelihood stays below this threshold
+     for pruning_delay frames is suspended: it is not evaluated anymore, except
+     every pruning_period frames, or when the class-level transition mass
+     towards it exceeds the threshold (hierarchical HMMs). Pruning is disabled
+     if the threshold is 0 (default).
+     */
+    double pruning_threshold;
+
+    /**
+     @brief Class pruning: number of frames below the threshold before a class
+     is suspended
+     */
+    unsigned int pruning_delay;
+
+    /**
+     @brief Class pruning: period (in frames) of the re-evaluation of suspended
+     classes (0 = never re-evaluated periodically)
+     */
+    unsigned int pruning_period;
+
+    /**
+     @brief Number of threads used for filtering (1 = sequential filtering)
+     @details If larger than 1, classes are split across a persistent pool of
+     threads at each frame. This only applies to GMMs and non-hierarchical
+     HMMs.
+     */
+    unsigned int filtering_threads;
+
+    /**
+     @brief Minimum amount of work per frame for parallel filtering
+     @details The work is estimated as the total number of Gaussian components
+     of all classes multiplied by the dimension. Parallel filtering is only used
+     if the work exceeds this threshold, smaller models are filtered
+     sequentially.
+     */
+    unsigned int filtering_work_threshold;
+
   protected:
     /**
      @brief Parameters for each class
@@ -34,6 +34,7 @@
 #define xmmModelParameters_h
 
 #include "../common/xmmAttribute.hpp"
+#include "../common/xmmBinary.hpp"
 #include "../common/xmmJson.hpp"
 
 namespace xmm {
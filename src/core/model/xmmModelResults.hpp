@@ -95,6 +95,8 @@ struct Results {
 
     /**
      @brief Normalized smoothed likelihood of each class
+     @details classes suspended by class pruning and not evaluated on the
+     last frame have a zero normalized likelihood
      */
     std::vector<double> smoothed_normalized_likelihoods;
 
@@ -105,9 +107,22 @@ struct Results {
 
     /**
      @brief Label of the likeliest class
+     @details the likeliest class is chosen among the classes evaluated on the
+     last frame
      */
     std::string likeliest;
 
+    /**
+     @brief Index of the likeliest class
+     */
+    unsigned int likeliest_index;
+
+    /**
+     @brief Indices of the classes evaluated on the last frame
+     @details all classes are evaluated unless class pruning is enabled
+     */
+    std::vector<unsigned int> evaluated_classes;
+
     /**
      @brief Output values estimated by regression
      @warning this variable is not allocated if the Model is not bimodal
@@ -120,6 +135,61 @@ struct Results {
      */
     std::vector<float> output_covariance;
 };
+
+/**
+ @ingroup Model
+ @brief Differences between the results of two models filtering the same
+ observations
+ @details used to assess the accuracy of a compact model against the
+ full-precision model it was exported from.
+ */
+struct AccuracyReport {
+    /**
+     @brief Default Constructor
+     */
+    AccuracyReport()
+        : frames(0),
+          label_agreement(1.),
+          max_likelihood_delta(0.),
+          mean_likelihood_delta(0.),
+          max_output_delta(0.),
+          mean_output_delta(0.) {}
+
+    /**
+     @brief Number of filtered frames
+     */
+    unsigned int frames;
+
+    /**
+     @brief Proportion of frames for which both models give the same
+     likeliest class
+     */
+    double label_agreement;
+
+    /**
+     @brief Maximum absolute difference of the normalized smoothed
+     likelihoods of the classes
+     */
+    double max_likelihood_delta;
+
+    /**
+     @brief Mean absolute difference of the normalized smoothed likelihoods
+     of the classes
+     */
+    double mean_likelihood_delta;
+
+    /**
+     @brief Maximum absolute difference of the output values estimated by
+     regression (bimodal models)
+     */
+    double max_output_delta;
+
+    /**
+     @brief Mean absolute difference of the output values estimated by
+     regression (bimodal models)
+     */
+    double mean_output_delta;
+};
 }
 
 #endif
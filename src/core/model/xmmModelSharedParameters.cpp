@@ -40,6 +40,7 @@ xmm::SharedParameters::SharedParameters()
       em_algorithm_min_iterations(10, 1),
       em_algorithm_max_iterations(0),
       em_algorithm_percent_chg(0.01, 0.),
+      em_algorithm_cache_size(0),
       likelihood_window(1, 1) {
     bimodal.onAttributeChange(this, &xmm::SharedParameters::onAttributeChange);
     dimension.onAttributeChange(this,
@@ -52,6 +53,8 @@ xmm::SharedParameters::SharedParameters()
         this, &xmm::SharedParameters::onAttributeChange);
     em_algorithm_percent_chg.onAttributeChange(
         this, &xmm::SharedParameters::onAttributeChange);
+    em_algorithm_cache_size.onAttributeChange(
+        this, &xmm::SharedParameters::onAttributeChange);
     likelihood_window.onAttributeChange(
         this, &xmm::SharedParameters::onAttributeChange);
     column_names.onAttributeChange(this,
@@ -66,6 +69,7 @@ xmm::SharedParameters::SharedParameters(SharedParameters const& src)
       em_algorithm_min_iterations(src.em_algorithm_min_iterations),
       em_algorithm_max_iterations(src.em_algorithm_max_iterations),
       em_algorithm_percent_chg(src.em_algorithm_percent_chg),
+      em_algorithm_cache_size(src.em_algorithm_cache_size),
       likelihood_window(src.likelihood_window) {
     bimodal.onAttributeChange(this, &xmm::SharedParameters::onAttributeChange);
     dimension.onAttributeChange(this,
@@ -78,6 +82,8 @@ xmm::SharedParameters::SharedParameters(SharedParameters const& src)
         this, &xmm::SharedParameters::onAttributeChange);
     em_algorithm_percent_chg.onAttributeChange(
         this, &xmm::SharedParameters::onAttributeChange);
+    em_algorithm_cache_size.onAttributeChange(
+        this, &xmm::SharedParameters::onAttributeChange);
     likelihood_window.onAttributeChange(
         this, &xmm::SharedParameters::onAttributeChange);
     column_names.onAttributeChange(this,
@@ -96,6 +102,8 @@ xmm::SharedParameters::SharedParameters(Json::Value const& root)
         root.get("em_algorithm_max_iterations", 0).asInt());
     em_algorithm_percent_chg.set(
         root.get("em_algorithm_percent_chg", 0.01).asFloat());
+    em_algorithm_cache_size.set(
+        root.get("em_algorithm_cache_size", 0).asUInt());
     likelihood_window.set(root.get("likelihood_window", 1).asInt());
     std::vector<std::string> tmpColNames(dimension.get());
     for (int i = 0; i < tmpColNames.size(); i++)
@@ -113,7 +121,26 @@ xmm::SharedParameters& xmm::SharedParameters::operator=(
         em_algorithm_min_iterations = src.em_algorithm_min_iterations;
         em_algorithm_max_iterations = src.em_algorithm_max_iterations;
         em_algorithm_percent_chg = src.em_algorithm_percent_chg;
+        em_algorithm_cache_size = src.em_algorithm_cache_size;
         likelihood_window = src.likelihood_window;
+        bimodal.onAttributeChange(this,
+                                  &xmm::SharedParameters::onAttributeChange);
+        dimension.onAttributeChange(this,
+                                    &xmm::SharedParameters::onAttributeChange);
+        dimension_input.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
+        em_algorithm_min_iterations.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
+        em_algorithm_max_iterations.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
+        em_algorithm_percent_chg.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
+        em_algorithm_cache_size.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
+        likelihood_window.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
+        column_names.onAttributeChange(
+            this, &xmm::SharedParameters::onAttributeChange);
     }
     return *this;
 }
@@ -128,6 +155,7 @@ Json::Value xmm::SharedParameters::toJson() const {
     root["em_algorithm_min_iterations"] = em_algorithm_min_iterations.get();
     root["em_algorithm_max_iterations"] = em_algorithm_max_iterations.get();
     root["em_algorithm_percent_chg"] = em_algorithm_percent_chg.get();
+    root["em_algorithm_cache_size"] = em_algorithm_cache_size.get();
     root["likelihood_window"] = static_cast<int>(likelihood_window.get());
     return root;
 }
@@ -141,6 +169,35 @@ void xmm::SharedParameters::fromJson(Json::Value const& root) {
     }
 }
 
+void xmm::SharedParameters::writeBinary(BinaryWriter& writer) const {
+    writer.writeBool(bimodal.get());
+    writer.writeUInt(dimension.get());
+    writer.writeUInt(dimension_input.get());
+    // the column names are not used for inference
+    writer.writeVector(writer.compact() ? std::vector<std::string>()
+                                        : column_names.get());
+    writer.writeUInt(em_algorithm_min_iterations.get());
+    writer.writeUInt(em_algorithm_max_iterations.get());
+    writer.writeDouble(em_algorithm_percent_chg.get());
+    // the size of the training cache does not affect the parameters of the
+    // model, and is not stored in binary files
+    writer.writeUInt(likelihood_window.get());
+}
+
+void xmm::SharedParameters::readBinary(BinaryReader& reader) {
+    bimodal.set(reader.readBool());
+    dimension.set(reader.readUInt());
+    dimension_input.set(reader.readUInt());
+    std::vector<std::string> tmpColNames;
+    reader.readVector(tmpColNames);
+    tmpColNames.resize(dimension.get());
+    column_names.set(tmpColNames);
+    em_algorithm_min_iterations.set(reader.readUInt());
+    em_algorithm_max_iterations.set(reader.readUInt());
+    em_algorithm_percent_chg.set(reader.readDouble());
+    likelihood_window.set(reader.readUInt());
+}
+
 void xmm::SharedParameters::onAttributeChange(AttributeBase* attr_pointer) {
     if (attr_pointer == &bimodal) {
         if (bimodal.get()) {
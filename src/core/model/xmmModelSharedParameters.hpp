@@ -33,6 +33,7 @@
 #ifndef xmmModelSharedParameters_h
 #define xmmModelSharedParameters_h
 
+#include "../common/xmmBinary.hpp"
 #include "../common/xmmEvents.hpp"
 #include "../trainingset/xmmTrainingSet.hpp"
 #include <mutex>
@@ -101,6 +102,24 @@ class SharedParameters : public Writable {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readBinary(BinaryReader& reader);
+
+    ///@}
+
     /**
      @brief defines if the phrase is bimodal (true) or unimodal (false)
      */
@@ -144,6 +163,16 @@ class SharedParameters : public Writable {
      */
     Attribute<double> em_algorithm_percent_chg;
 
+    /**
+     @brief Maximum size (in megabytes) of the cache of the second moments of
+     the training frames
+     @details the cache avoids recomputing the outer product of each frame at
+     each iteration of the EM algorithm (see MomentCache). The budget applies
+     to the whole model: when the classes are trained in parallel, it is
+     divided between them. The default value 0 disables the cache.
+     */
+    Attribute<unsigned int> em_algorithm_cache_size;
+
     /**
      @brief Size of the window (in samples) used to compute the likelihoods
      */
@@ -32,6 +32,7 @@
  */
 
 #include "xmmModelSingleClass.hpp"
+#include <algorithm>
 #include <cmath>
 
 #pragma mark -
@@ -42,7 +43,8 @@ xmm::SingleClassProbabilisticModel::SingleClassProbabilisticModel(
       shared_parameters(p),
       training_status(this, label),
       is_training_(false),
-      cancel_training_(false) {
+      cancel_training_(false),
+      concurrent_trainings_(1) {
     if (p == NULL) {
         throw std::runtime_error(
             "Cannot instantiate a probabilistic model without Shared "
@@ -57,7 +59,8 @@ xmm::SingleClassProbabilisticModel::SingleClassProbabilisticModel(
       shared_parameters(src.shared_parameters),
       training_status(this, label),
       is_training_(false),
-      cancel_training_(false) {
+      cancel_training_(false),
+      concurrent_trainings_(1) {
     if (is_training_)
         throw std::runtime_error("Cannot copy: target model is still training");
     if (src.is_training_)
@@ -70,7 +73,8 @@ xmm::SingleClassProbabilisticModel::SingleClassProbabilisticModel(
       shared_parameters(p),
       training_status(this, label),
       is_training_(false),
-      cancel_training_(false) {
+      cancel_training_(false),
+      concurrent_trainings_(1) {
     if (p == NULL) {
         throw std::runtime_error(
             "Cannot instantiate a probabilistic model without Shared "
@@ -94,6 +98,7 @@ operator=(SingleClassProbabilisticModel const& src) {
         shared_parameters = src.shared_parameters;
         is_training_ = false;
         cancel_training_ = false;
+        concurrent_trainings_ = 1;
     }
     return *this;
 };
@@ -109,15 +114,55 @@ bool xmm::SingleClassProbabilisticModel::isTraining() const {
     return is_training_;
 }
 
+std::size_t xmm::SingleClassProbabilisticModel::momentCacheBudget() const {
+    return (std::size_t(shared_parameters->em_algorithm_cache_size.get())
+            << 20) /
+           std::max(concurrent_trainings_, 1u);
+}
+
 #pragma mark -
 #pragma mark Training
 void xmm::SingleClassProbabilisticModel::train(TrainingSet* trainingSet) {
+    emAlgorithm(trainingSet && !trainingSet->empty(),
+                [this, trainingSet] {
+                    this->emAlgorithmInit(trainingSet);
+                    this->emAlgorithmCacheMoments(trainingSet);
+                },
+                [this, trainingSet] {
+                    return this->emAlgorithmUpdate(trainingSet);
+                });
+}
+
+void xmm::SingleClassProbabilisticModel::train(PhraseStore const* store) {
+    emAlgorithm(store && !store->empty(),
+                [this, store] {
+                    std::shared_ptr<TrainingSet> first_chunk =
+                        store->loadChunk(0);
+                    this->emAlgorithmInit(first_chunk.get());
+                },
+                [this, store] { return this->emAlgorithmUpdate(store); });
+}
+
+double xmm::SingleClassProbabilisticModel::emAlgorithmUpdate(
+    PhraseStore const* store) {
+    double log_prob(0.);
+    this->emAlgorithmResetStatistics();
+    store->forEachChunk([this, &log_prob](TrainingSet* chunk) {
+        log_prob += this->emAlgorithmAccumulate(chunk);
+    });
+    this->emAlgorithmEstimate();
+    return log_prob;
+}
+
+void xmm::SingleClassProbabilisticModel::emAlgorithm(
+    bool valid_data, std::function<void()> const& init,
+    std::function<double()> const& update) {
     training_mutex_.lock();
     bool trainingError(false);
 
     training_status.status = TrainingEvent::Status::Run;
 
-    if (trainingSet && !trainingSet->empty()) {
+    if (valid_data) {
         this->allocate();
     } else {
         trainingError = true;
@@ -126,7 +171,7 @@ void xmm::SingleClassProbabilisticModel::train(TrainingSet* trainingSet) {
     if (cancelTrainingIfRequested()) return;
     if (!trainingError) {
         try {
-            this->emAlgorithmInit(trainingSet);
+            init();
         } catch (std::exception& e) {
             trainingError = true;
         }
@@ -144,8 +189,7 @@ void xmm::SingleClassProbabilisticModel::train(TrainingSet* trainingSet) {
         old_log_prob = training_status.log_likelihood;
         if (!trainingError) {
             try {
-                training_status.log_likelihood =
-                    this->emAlgorithmUpdate(trainingSet);
+                training_status.log_likelihood = update();
             } catch (std::exception& e) {
                 trainingError = true;
             }
@@ -158,6 +202,7 @@ void xmm::SingleClassProbabilisticModel::train(TrainingSet* trainingSet) {
             trainingError = true;
 
         if (trainingError) {
+            moment_cache_.clear();
             is_training_ = false;
             training_mutex_.unlock();
             training_status.status = TrainingEvent::Status::Error;
@@ -199,6 +244,7 @@ bool xmm::SingleClassProbabilisticModel::emAlgorithmHasConverged(
 }
 
 void xmm::SingleClassProbabilisticModel::emAlgorithmTerminate() {
+    moment_cache_.clear();
     training_status.status = TrainingEvent::Status::Done;
     training_events.notifyListeners(training_status);
     this->is_training_ = false;
@@ -212,6 +258,7 @@ void xmm::SingleClassProbabilisticModel::cancelTraining() {
 
 bool xmm::SingleClassProbabilisticModel::cancelTrainingIfRequested() {
     if (!cancel_training_) return false;
+    moment_cache_.clear();
     training_mutex_.unlock();
     training_status.label = label;
     training_status.status = TrainingEvent::Status::Cancel;
@@ -236,3 +283,15 @@ Json::Value xmm::SingleClassProbabilisticModel::toJson() const {
     root["label"] = label;
     return root;
 }
+
+void xmm::SingleClassProbabilisticModel::writeBinary(
+    BinaryWriter& writer) const {
+    check_training();
+    writer.writeString(label);
+}
+
+void xmm::SingleClassProbabilisticModel::readBinary(BinaryReader& reader) {
+    check_training();
+    label = reader.readString();
+    training_status.label = label;
+}
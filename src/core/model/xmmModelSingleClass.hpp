@@ -36,6 +36,8 @@
 
 #include "../common/xmmCircularbuffer.hpp"
 #include "../common/xmmEvents.hpp"
+#include "../trainingset/xmmMomentCache.hpp"
+#include "../trainingset/xmmPhraseStore.hpp"
 #include "../trainingset/xmmTrainingSet.hpp"
 #include "xmmModelSharedParameters.hpp"
 #include <memory>
@@ -214,6 +216,15 @@ class SingleClassProbabilisticModel : public Writable {
      */
     bool isTraining() const;
 
+    /**
+     @brief Get the memory budget of the cache of the second moments
+     @details SharedParameters::em_algorithm_cache_size bounds the memory of
+     all the classes of a model: the budget is divided between the classes
+     that are trained concurrently.
+     @return maximum size of the cache of the class in bytes
+     */
+    std::size_t momentCacheBudget() const;
+
     /**
      @brief Main training method based on the EM algorithm
      @details the method performs a loop over the pure virtual method
@@ -225,6 +236,18 @@ class SingleClassProbabilisticModel : public Writable {
      */
     void train(TrainingSet* trainingSet);
 
+    /**
+     @brief Out-of-core training method based on the EM algorithm
+     @details the phrases are streamed from the store chunk by chunk, so that
+     the memory used for training is bounded by the chunk size of the store.
+     The parameters are initialized with the first chunk of the store. Each
+     iteration of the EM algorithm accumulates the sufficient statistics of all
+     chunks (E step) before re-estimating the parameters (M step).
+     @param store Phrase store to train the model.
+     @see PhraseStore
+     */
+    void train(PhraseStore const* store);
+
     /**
      @brief Cancels the training process : sets a flag so that the training
      stops at the next
@@ -274,6 +297,26 @@ class SingleClassProbabilisticModel : public Writable {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    virtual void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @details the parameters are allocated from the shared parameters, that
+     must be read beforehand.
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    virtual void readBinary(BinaryReader& reader);
+
+    ///@}
+
     /**
      @brief label associated with the given model
      */
@@ -307,6 +350,15 @@ class SingleClassProbabilisticModel : public Writable {
      */
     virtual void emAlgorithmInit(TrainingSet* trainingSet) = 0;
 
+    /**
+     @brief Fills the cache of the second moments of the training frames
+     @details called after emAlgorithmInit() when training on an in-memory
+     training set, within the budget given by momentCacheBudget(). The cache is
+     released when the training terminates.
+     @param trainingSet training set
+     */
+    virtual void emAlgorithmCacheMoments(TrainingSet* trainingSet) = 0;
+
     /**
      @brief Update Method of the EM algorithm
      @details performs E and M steps of the EM algorithm.
@@ -315,6 +367,44 @@ class SingleClassProbabilisticModel : public Writable {
      */
     virtual double emAlgorithmUpdate(TrainingSet* trainingSet) = 0;
 
+    /**
+     @brief Update Method of the EM algorithm over a phrase store
+     @details accumulates the sufficient statistics of each chunk of the store
+     and re-estimates the parameters.
+     @return likelihood of the training data given the current model parameters
+     (before re-estimation).
+     */
+    double emAlgorithmUpdate(PhraseStore const* store);
+
+    /**
+     @brief Resets the sufficient statistics of the EM algorithm
+     @details the statistics are centered on the current parameters
+     */
+    virtual void emAlgorithmResetStatistics() = 0;
+
+    /**
+     @brief Accumulates the sufficient statistics of a chunk of the training
+     data (E step)
+     @param trainingSet chunk of the training data
+     @return likelihood of the chunk given the current model parameters
+     */
+    virtual double emAlgorithmAccumulate(TrainingSet* trainingSet) = 0;
+
+    /**
+     @brief Re-estimates the parameters from the sufficient statistics (M
+     step)
+     */
+    virtual void emAlgorithmEstimate() = 0;
+
+    /**
+     @brief Runs the EM algorithm
+     @param valid_data false if the training data is empty or invalid
+     @param init initialization of the algorithm
+     @param update update of the algorithm, returns the log-likelihood
+     */
+    void emAlgorithm(bool valid_data, std::function<void()> const& init,
+                     std::function<double()> const& update);
+
     /**
      @brief Terminate the training algorithm
      */
@@ -348,10 +438,16 @@ class SingleClassProbabilisticModel : public Writable {
     }
 
     /**
-     @brief Likelihood buffer used for smoothing
+     @brief Likelihood buffer used for smoothing (the smoothed log-likelihood
+     is its running mean)
      */
     CircularBuffer<double> likelihood_buffer_;
 
+    /**
+     @brief Cache of the second moments of the training frames
+     */
+    MomentCache moment_cache_;
+
     /**
      @brief Mutex used in Concurrent Mode
      */
@@ -366,6 +462,12 @@ class SingleClassProbabilisticModel : public Writable {
      @brief defines if the model received a request to cancel training
      */
     bool cancel_training_;
+
+    /**
+     @brief Number of classes trained concurrently, which share the budget of
+     the moment cache
+     */
+    unsigned int concurrent_trainings_;
 };
 }
 
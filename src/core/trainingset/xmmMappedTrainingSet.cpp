@@ -0,0 +1,421 @@
+/*
+ * xmmMappedTrainingSet.cpp
+ *
+ * Memory-mapped binary storage of training sets
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "xmmMappedTrainingSet.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+/**
+ @brief magic string of the binary training set files
+ */
+const char kMagic[8] = {'X', 'M', 'M', 'T', 'R', 'S', 'E', 'T'};
+
+/**
+ @brief size of an entry of the column table
+ */
+const std::size_t kColumnEntrySize = 8;
+
+/**
+ @brief size of an entry of the phrase index
+ */
+const std::size_t kPhraseEntrySize = 40;
+
+/**
+ @brief alignment of the data arrays in the file
+ */
+const std::size_t kDataAlignment = 64;
+
+/**
+ @brief flag of the bimodal training sets
+ */
+const uint32_t kFlagBimodal = 1;
+
+bool littleEndianHost() {
+    const uint32_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+std::size_t aligned(std::size_t offset) {
+    return ((offset + kDataAlignment - 1) / kDataAlignment) * kDataAlignment;
+}
+
+void store32(char* buffer, uint32_t value) {
+    for (int i = 0; i < 4; i++) buffer[i] = char((value >> (8 * i)) & 0xFF);
+}
+
+void store64(char* buffer, uint64_t value) {
+    for (int i = 0; i < 8; i++) buffer[i] = char((value >> (8 * i)) & 0xFF);
+}
+
+uint32_t load32(const char* buffer) {
+    uint32_t value(0);
+    for (int i = 0; i < 4; i++)
+        value |= uint32_t(static_cast<unsigned char>(buffer[i])) << (8 * i);
+    return value;
+}
+
+uint64_t load64(const char* buffer) {
+    uint64_t value(0);
+    for (int i = 0; i < 8; i++)
+        value |= uint64_t(static_cast<unsigned char>(buffer[i])) << (8 * i);
+    return value;
+}
+
+/**
+ @brief checks that a section [offset, offset + size) lies in the file
+ */
+void checkSection(uint64_t offset, uint64_t size, std::size_t file_size) {
+    if (offset > file_size || size > file_size - offset)
+        throw std::runtime_error("Corrupted training set file");
+}
+
+/**
+ @brief writes an array of floats in little-endian byte order
+ */
+void writeFloats(std::ofstream& file, const float* data, std::size_t size) {
+    if (littleEndianHost()) {
+        file.write(reinterpret_cast<const char*>(data),
+                   size * sizeof(float));
+        return;
+    }
+    char buffer[4];
+    for (std::size_t i = 0; i < size; i++) {
+        uint32_t value;
+        std::memcpy(&value, data + i, sizeof(float));
+        store32(buffer, value);
+        file.write(buffer, 4);
+    }
+}
+}
+
+#pragma mark -
+#pragma mark Binary File
+void xmm::MappedTrainingSet::write(TrainingSet const& trainingSet,
+                                   std::string const& filename) {
+    unsigned int dimension = trainingSet.dimension.get();
+    unsigned int dimension_input =
+        trainingSet.bimodal() ? trainingSet.dimension_input.get() : 0;
+    unsigned int dimension_output = dimension - dimension_input;
+
+    // Layout
+    std::string strings;
+    std::vector<std::pair<uint32_t, uint32_t>> columns(dimension);
+    for (unsigned int d = 0; d < dimension; d++) {
+        std::string name = (d < trainingSet.column_names.size())
+                               ? trainingSet.column_names.at(d)
+                               : "";
+        columns[d] = std::make_pair(uint32_t(strings.size()),
+                                    uint32_t(name.size()));
+        strings += name;
+    }
+    std::size_t columns_offset = HEADER_SIZE();
+    std::size_t index_offset = columns_offset + dimension * kColumnEntrySize;
+    std::size_t strings_offset =
+        index_offset + trainingSet.size() * kPhraseEntrySize;
+    std::vector<char> index(trainingSet.size() * kPhraseEntrySize, 0);
+    std::vector<std::pair<std::size_t, std::size_t>> data_offsets;
+    std::size_t label_offset = strings.size();
+    for (auto it = trainingSet.cbegin(); it != trainingSet.cend(); ++it)
+        strings += it->second->label.get();
+    std::size_t offset = aligned(strings_offset + strings.size());
+    char* entry = index.data();
+    for (auto it = trainingSet.cbegin(); it != trainingSet.cend();
+         ++it, entry += kPhraseEntrySize) {
+        Phrase const& phrase = *it->second;
+        std::string const& label = phrase.label.get();
+        unsigned int length_input =
+            trainingSet.bimodal() ? phrase.inputSize() : phrase.size();
+        unsigned int length_output =
+            trainingSet.bimodal() ? phrase.outputSize() : 0;
+        std::size_t input_offset = offset;
+        offset = aligned(offset + std::size_t(length_input) *
+                                      (trainingSet.bimodal() ? dimension_input
+                                                             : dimension) *
+                                      sizeof(float));
+        std::size_t output_offset = trainingSet.bimodal() ? offset : 0;
+        offset = aligned(offset + std::size_t(length_output) *
+                                      dimension_output * sizeof(float));
+        data_offsets.push_back(std::make_pair(input_offset, output_offset));
+        store32(entry, uint32_t(int32_t(it->first)));
+        store32(entry + 4, length_input);
+        store32(entry + 8, length_output);
+        store32(entry + 12, uint32_t(label_offset));
+        store32(entry + 16, uint32_t(label.size()));
+        store64(entry + 24, input_offset);
+        store64(entry + 32, output_offset);
+        label_offset += label.size();
+    }
+    std::size_t file_size = offset;
+
+    // Header and tables
+    std::vector<char> header(HEADER_SIZE(), 0);
+    std::memcpy(header.data(), kMagic, sizeof(kMagic));
+    store32(header.data() + 8, VERSION());
+    store32(header.data() + 12, trainingSet.bimodal() ? kFlagBimodal : 0);
+    store32(header.data() + 16, dimension);
+    store32(header.data() + 20, dimension_input);
+    store32(header.data() + 24, trainingSet.size());
+    store32(header.data() + 28, uint32_t(strings_offset + strings.size()));
+    store64(header.data() + 32, columns_offset);
+    store64(header.data() + 40, index_offset);
+    store64(header.data() + 48, strings_offset);
+    store64(header.data() + 56, file_size);
+    std::vector<char> column_table(dimension * kColumnEntrySize);
+    for (unsigned int d = 0; d < dimension; d++) {
+        store32(column_table.data() + d * kColumnEntrySize, columns[d].first);
+        store32(column_table.data() + d * kColumnEntrySize + 4,
+                columns[d].second);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open file " + filename);
+    file.write(header.data(), header.size());
+    file.write(column_table.data(), column_table.size());
+    file.write(index.data(), index.size());
+    file.write(strings.data(), strings.size());
+
+    // Data
+    std::size_t position = strings_offset + strings.size();
+    const char padding[kDataAlignment] = {0};
+    auto writeArray = [&](std::size_t array_offset, const float* data,
+                          std::size_t size) {
+        file.write(padding, array_offset - position);
+        if (size > 0) writeFloats(file, data, size);
+        position = array_offset + size * sizeof(float);
+    };
+    std::size_t p(0);
+    for (auto it = trainingSet.cbegin(); it != trainingSet.cend(); ++it, p++) {
+        Phrase const& phrase = *it->second;
+        Phrase::FrameView frames = phrase.frames();
+        if (trainingSet.bimodal()) {
+            writeArray(data_offsets[p].first, frames.input(0),
+                       std::size_t(phrase.inputSize()) * dimension_input);
+            writeArray(data_offsets[p].second, frames.output(0),
+                       std::size_t(phrase.outputSize()) * dimension_output);
+        } else {
+            writeArray(data_offsets[p].first, frames.input(0),
+                       std::size_t(phrase.size()) * dimension);
+        }
+    }
+    file.write(padding, file_size - position);
+    if (!file.good())
+        throw std::runtime_error("Error while writing file " + filename);
+}
+
+#pragma mark -
+#pragma mark Mapping
+xmm::MappedTrainingSet::Mapping::Mapping(std::string const& filename)
+    : data(NULL), size(0) {
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open file " + filename);
+    size = static_cast<std::size_t>(file.tellg());
+    data = new char[size > 0 ? size : 1];
+    file.seekg(0);
+    file.read(data, size);
+    if (!file.good()) {
+        delete[] data;
+        throw std::runtime_error("Cannot read file " + filename);
+    }
+#else
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Cannot open file " + filename);
+    struct stat file_status;
+    if (fstat(descriptor, &file_status) != 0 || file_status.st_size <= 0) {
+        close(descriptor);
+        throw std::runtime_error("Cannot read file " + filename);
+    }
+    size = static_cast<std::size_t>(file_status.st_size);
+    // private mapping: the phrases can be modified without altering the file
+    void* address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         descriptor, 0);
+    close(descriptor);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Cannot map file " + filename);
+    data = static_cast<char*>(address);
+#endif
+}
+
+xmm::MappedTrainingSet::Mapping::Mapping(Mapping&& src)
+    : data(src.data), size(src.size) {
+    src.data = NULL;
+    src.size = 0;
+}
+
+xmm::MappedTrainingSet::Mapping::~Mapping() {
+    if (!data) return;
+#ifdef _WIN32
+    delete[] data;
+#else
+    munmap(data, size);
+#endif
+}
+
+#pragma mark -
+#pragma mark Index
+std::size_t xmm::MappedTrainingSet::metadataSize(const char* header) {
+    if (std::memcmp(header, kMagic, sizeof(kMagic)) != 0)
+        throw std::runtime_error("Not a training set file");
+    if (load32(header + 8) != VERSION())
+        throw std::runtime_error("Unsupported training set file version");
+    std::size_t size = load32(header + 28);
+    if (size < HEADER_SIZE() || size > load64(header + 56))
+        throw std::runtime_error("Corrupted training set file");
+    return size;
+}
+
+xmm::MappedTrainingSet::FileIndex xmm::MappedTrainingSet::readIndex(
+    const char* metadata, std::size_t size) {
+    if (size < HEADER_SIZE() || metadataSize(metadata) > size)
+        throw std::runtime_error("Truncated training set file");
+    FileIndex index;
+    index.bimodal = (load32(metadata + 12) & kFlagBimodal) != 0;
+    index.dimension = load32(metadata + 16);
+    index.dimension_input = load32(metadata + 20);
+    unsigned int num_phrases = load32(metadata + 24);
+    std::size_t metadata_size = load32(metadata + 28);
+    uint64_t columns_offset = load64(metadata + 32);
+    uint64_t index_offset = load64(metadata + 40);
+    uint64_t strings_offset = load64(metadata + 48);
+    index.file_size = load64(metadata + 56);
+    if (index.dimension < (index.bimodal ? 2u : 1u) ||
+        (index.bimodal && (index.dimension_input < 1 ||
+                           index.dimension_input >= index.dimension)) ||
+        (!index.bimodal && index.dimension_input != 0))
+        throw std::runtime_error("Invalid dimensions in training set file");
+    unsigned int dimension_output = index.dimension - index.dimension_input;
+    checkSection(columns_offset, uint64_t(index.dimension) * kColumnEntrySize,
+                 metadata_size);
+    checkSection(index_offset, uint64_t(num_phrases) * kPhraseEntrySize,
+                 metadata_size);
+    checkSection(strings_offset, 0, metadata_size);
+    auto readString = [&](const char* entry) {
+        uint32_t offset = load32(entry);
+        uint32_t length = load32(entry + 4);
+        checkSection(strings_offset + offset, length, metadata_size);
+        return std::string(metadata + strings_offset + offset, length);
+    };
+    auto checkArray = [&](uint64_t offset, unsigned int length,
+                          unsigned int width) {
+        checkSection(offset, uint64_t(length) * width * sizeof(float),
+                     index.file_size);
+        if (offset % sizeof(float) != 0)
+            throw std::runtime_error("Misaligned data in training set file");
+        return std::size_t(offset);
+    };
+
+    index.column_names.resize(index.dimension);
+    for (unsigned int d = 0; d < index.dimension; d++)
+        index.column_names[d] =
+            readString(metadata + columns_offset + d * kColumnEntrySize);
+    index.phrases.resize(num_phrases);
+    for (unsigned int p = 0; p < num_phrases; p++) {
+        const char* entry = metadata + index_offset + p * kPhraseEntrySize;
+        FileIndex::PhraseEntry& phrase = index.phrases[p];
+        phrase.index = int32_t(load32(entry));
+        phrase.length_input = load32(entry + 4);
+        phrase.length_output = load32(entry + 8);
+        phrase.label = readString(entry + 12);
+        phrase.input_offset =
+            checkArray(load64(entry + 24), phrase.length_input,
+                       index.bimodal ? index.dimension_input : index.dimension);
+        phrase.output_offset =
+            index.bimodal ? checkArray(load64(entry + 32),
+                                       phrase.length_output, dimension_output)
+                          : 0;
+    }
+    return index;
+}
+
+#pragma mark -
+#pragma mark Constructors
+xmm::MappedTrainingSet::MappedTrainingSet(std::string const& filename)
+    : MappedTrainingSet(Mapping(filename)) {}
+
+xmm::MappedTrainingSet::MappedTrainingSet(Mapping&& mapping)
+    : MappedTrainingSet(std::move(mapping),
+                        readIndex(mapping.data, mapping.size)) {}
+
+xmm::MappedTrainingSet::MappedTrainingSet(Mapping&& mapping,
+                                          FileIndex const& index)
+    : TrainingSet(MemoryMode::SharedMemory,
+                  index.bimodal ? Multimodality::Bimodal
+                                : Multimodality::Unimodal),
+      mapping_(std::move(mapping)) {
+    if (index.file_size != mapping_.size)
+        throw std::runtime_error("Truncated training set file");
+    if (!littleEndianHost())
+        throw std::runtime_error(
+            "Binary training sets can only be mapped on little-endian "
+            "platforms");
+    load(index);
+}
+
+xmm::MappedTrainingSet::~MappedTrainingSet() { clear(); }
+
+std::size_t xmm::MappedTrainingSet::fileSize() const { return mapping_.size; }
+
+void xmm::MappedTrainingSet::load(FileIndex const& index) {
+    dimension.set(index.dimension);
+    if (bimodal_) dimension_input.set(index.dimension_input);
+    column_names.set(index.column_names);
+    for (auto const& entry : index.phrases) {
+        addPhrase(entry.index, entry.label);
+        std::shared_ptr<Phrase> phrase = getPhrase(entry.index);
+        float* input =
+            reinterpret_cast<float*>(mapping_.data + entry.input_offset);
+        if (bimodal_) {
+            phrase->connect_input(input, entry.length_input);
+            phrase->connect_output(
+                reinterpret_cast<float*>(mapping_.data + entry.output_offset),
+                entry.length_output);
+        } else {
+            phrase->connect(input, entry.length_input);
+        }
+    }
+}
@@ -0,0 +1,265 @@
+/*
+ * xmmMappedTrainingSet.hpp
+ *
+ * Memory-mapped binary storage of training sets
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef xmmMappedTrainingSet_h
+#define xmmMappedTrainingSet_h
+
+#include "xmmTrainingSet.hpp"
+
+namespace xmm {
+/**
+ @ingroup TrainingSet
+ @brief Training Set loaded from a memory-mapped binary file
+ @details The binary format stores the data of the phrases as raw
+ little-endian float arrays, so that opening a file does not parse or copy the
+ data: the file is mapped in memory and the phrases of the training set are
+ connected (MemoryMode::SharedMemory) to the arrays of the mapping. Opening a
+ training set therefore takes a constant time, and the data is only read from
+ the disk when it is accessed.
+
+ The file is composed of:
+ - a header of 64 bytes: the magic string "XMMTRSET", the format version, the
+ flags (bit 0: bimodal), the dimensions, the number of phrases, the size of
+ the metadata (header, tables and strings), the offsets of the following
+ sections and the total size of the file;
+ - the table of the column names (offset and size in the string table);
+ - the index of the phrases: index, lengths, offset and size of the label in
+ the string table, and offsets of the data arrays;
+ - the string table;
+ - the data arrays of the phrases, aligned on 64 bytes.
+ All integers are stored in little-endian byte order.
+
+ The mapping is private: modifying the phrases (e.g. rescaling) does not
+ modify the file.
+ @warning the phrases are connected to the mapping: they must not be used after
+ the destruction of the training set.
+ */
+class MappedTrainingSet : public TrainingSet {
+  public:
+    /**
+     @brief Version of the binary format
+     */
+    static unsigned int VERSION() { return 1; }
+
+    /**
+     @brief Size of the header of the binary files
+     */
+    static std::size_t HEADER_SIZE() { return 64; }
+
+    /**
+     @brief Index of a binary training set file
+     */
+    struct FileIndex {
+        /**
+         @brief Entry of a phrase in the index
+         */
+        struct PhraseEntry {
+            /**
+             @brief index of the phrase in the training set
+             */
+            int index;
+
+            /**
+             @brief label of the phrase
+             */
+            std::string label;
+
+            /**
+             @brief length of the input modality (or of the phrase if
+             unimodal)
+             */
+            unsigned int length_input;
+
+            /**
+             @brief length of the output modality (0 if unimodal)
+             */
+            unsigned int length_output;
+
+            /**
+             @brief offset of the input data array in the file
+             */
+            std::size_t input_offset;
+
+            /**
+             @brief offset of the output data array in the file
+             */
+            std::size_t output_offset;
+        };
+
+        /**
+         @brief defines if the training set is bimodal
+         */
+        bool bimodal;
+
+        /**
+         @brief total dimension of the data
+         */
+        unsigned int dimension;
+
+        /**
+         @brief dimension of the input modality (0 if unimodal)
+         */
+        unsigned int dimension_input;
+
+        /**
+         @brief names of the columns
+         */
+        std::vector<std::string> column_names;
+
+        /**
+         @brief entries of the phrases, in the order of the file
+         */
+        std::vector<PhraseEntry> phrases;
+
+        /**
+         @brief total size of the file
+         */
+        std::size_t file_size;
+    };
+
+    /**
+     @brief Get the size of the metadata from the header of a file
+     @param header pointer to the header (HEADER_SIZE() bytes)
+     @return size of the metadata (header, tables and strings)
+     @throws runtime_error if the header is not a valid training set header
+     */
+    static std::size_t metadataSize(const char* header);
+
+    /**
+     @brief Reads the index of a binary file
+     @param metadata pointer to the beginning of the file
+     @param size number of bytes available (at least the size of the metadata)
+     @return index of the file
+     @throws runtime_error if the file is not a valid training set file
+     */
+    static FileIndex readIndex(const char* metadata, std::size_t size);
+
+    /**
+     @brief Writes a training set to a binary file
+     @param trainingSet training set to write
+     @param filename path of the file
+     @throws runtime_error if the file cannot be written
+     */
+    static void write(TrainingSet const& trainingSet,
+                      std::string const& filename);
+
+    /**
+     @brief Opens a binary training set file
+     @param filename path of the file
+     @throws runtime_error if the file cannot be opened, if it is not a valid
+     training set file, or if the platform is not little-endian
+     */
+    explicit MappedTrainingSet(std::string const& filename);
+
+    /**
+     @brief Destructor
+     @details the phrases are removed before the file is unmapped
+     */
+    virtual ~MappedTrainingSet();
+
+    /**
+     @brief Get the size of the mapped file
+     @return size of the file in bytes
+     */
+    std::size_t fileSize() const;
+
+  protected:
+    /**
+     @brief Memory mapping of a binary file
+     */
+    class Mapping {
+      public:
+        /**
+         @brief Maps a file in memory
+         @param filename path of the file
+         @throws runtime_error if the file cannot be mapped
+         */
+        explicit Mapping(std::string const& filename);
+
+        /**
+         @brief Move Constructor
+         @param src source mapping (left empty)
+         */
+        Mapping(Mapping&& src);
+
+        /**
+         @brief Destructor (unmaps the file)
+         */
+        ~Mapping();
+
+        /**
+         @brief pointer to the data of the file
+         */
+        char* data;
+
+        /**
+         @brief size of the file
+         */
+        std::size_t size;
+
+      private:
+        Mapping(Mapping const& src) = delete;
+        Mapping& operator=(Mapping const& src) = delete;
+    };
+
+    /**
+     @brief Constructor from an opened mapping
+     @param mapping mapping of the file
+     */
+    explicit MappedTrainingSet(Mapping&& mapping);
+
+    /**
+     @brief Constructor from an opened mapping and its index
+     @param mapping mapping of the file
+     @param index index of the file
+     */
+    MappedTrainingSet(Mapping&& mapping, FileIndex const& index);
+
+    /**
+     @brief Creates the phrases and connects them to the mapping
+     @param index index of the file
+     */
+    void load(FileIndex const& index);
+
+    /**
+     @brief Memory mapping of the file
+     */
+    Mapping mapping_;
+
+  private:
+    MappedTrainingSet(MappedTrainingSet const& src) = delete;
+    MappedTrainingSet& operator=(MappedTrainingSet const& src) = delete;
+};
+}
+
+#endif
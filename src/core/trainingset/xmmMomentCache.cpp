@@ -0,0 +1,128 @@
+/*
+ * xmmMomentCache.cpp
+ *
+ * Cache of the second moments of the frames of a training set
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xmmMomentCache.hpp"
+#include "../common/xmmMatrix.hpp"
+
+xmm::MomentCache::MomentCache()
+    : size_(0), dimension_(0), full_covariance_(false) {}
+
+void xmm::MomentCache::build(TrainingSet* trainingSet, bool full_covariance,
+                             std::size_t budget) {
+    clear();
+    if (!trainingSet || trainingSet->empty()) return;
+    dimension_ = trainingSet->dimension.get();
+    full_covariance_ = full_covariance;
+    std::size_t moment_size = momentSize();
+    std::size_t frames(0);
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); ++it)
+        frames += it->second->size();
+    std::size_t capacity = budget / (moment_size * sizeof(double));
+    size_ = (frames < capacity) ? frames : capacity;
+    if (size_ == 0) return;
+    moments_.resize(size_ * moment_size);
+
+    std::vector<float> frame_buffer(dimension_);
+    double* moment = moments_.data();
+    std::size_t index(0);
+    for (auto it = trainingSet->cbegin();
+         it != trainingSet->cend() && index < size_; ++it) {
+        Phrase::FrameView frames = it->second->frames();
+        for (unsigned int t = 0; t < frames.size() && index < size_;
+             t++, index++) {
+            const float* frame = frames.frame(t, frame_buffer.data());
+            for (unsigned int d1 = 0; d1 < dimension_; d1++) {
+                if (full_covariance_) {
+                    for (unsigned int d2 = d1; d2 < dimension_; d2++)
+                        *moment++ = double(frame[d1]) * frame[d2];
+                } else {
+                    *moment++ = double(frame[d1]) * frame[d1];
+                }
+            }
+        }
+    }
+}
+
+void xmm::MomentCache::clear() {
+    moments_.clear();
+    moments_.shrink_to_fit();
+    size_ = 0;
+}
+
+bool xmm::MomentCache::empty() const { return size_ == 0; }
+
+std::size_t xmm::MomentCache::size() const { return size_; }
+
+std::size_t xmm::MomentCache::momentSize() const {
+    return full_covariance_ ? packedSize(dimension_) : dimension_;
+}
+
+void xmm::MomentCache::accumulate(std::size_t index, const float* frame,
+                                  double weight, double* moment) const {
+    if (index < size_) {
+        std::size_t moment_size = momentSize();
+        const double* cached = moments_.data() + index * moment_size;
+        for (std::size_t k = 0; k < moment_size; k++)
+            moment[k] += weight * cached[k];
+        return;
+    }
+    for (unsigned int d1 = 0; d1 < dimension_; d1++) {
+        double weighted = weight * frame[d1];
+        if (full_covariance_) {
+            for (unsigned int d2 = d1; d2 < dimension_; d2++)
+                *moment++ += weighted * frame[d2];
+        } else {
+            *moment++ += weighted * frame[d1];
+        }
+    }
+}
+
+void xmm::MomentCache::toCovariance(std::vector<double>& moment,
+                                    std::vector<double> const& mean,
+                                    double weight_sum, bool full_covariance) {
+    unsigned int dimension = static_cast<unsigned int>(mean.size());
+    double* value = moment.data();
+    for (unsigned int d1 = 0; d1 < dimension; d1++) {
+        if (full_covariance) {
+            for (unsigned int d2 = d1; d2 < dimension; d2++, value++)
+                *value = *value / weight_sum - mean[d1] * mean[d2];
+        } else {
+            *value = *value / weight_sum - mean[d1] * mean[d1];
+            value++;
+        }
+        // the cancellation can yield slightly negative variances
+        double& variance =
+            full_covariance ? moment[packedIndex(d1, d1, dimension)]
+                            : moment[d1];
+        if (variance < 0.) variance = 0.;
+    }
+}
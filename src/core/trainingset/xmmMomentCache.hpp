@@ -0,0 +1,148 @@
+/*
+ * xmmMomentCache.hpp
+ *
+ * Cache of the second moments of the frames of a training set
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef xmmMomentCache_h
+#define xmmMomentCache_h
+
+#include "xmmTrainingSet.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace xmm {
+/**
+ @ingroup TrainingSet
+ @brief Cache of the raw second moments of the frames of a training set
+ @details The cache stores the second moment x x' of each frame of a training
+ set, as a packed symmetric matrix (see packedSize()) for full covariances or
+ as the squared values for diagonal covariances. The moments do not depend on
+ the parameters of the model: they are computed once before the EM algorithm,
+ and each re-estimation of the covariances becomes a weighted sum of cached
+ moments followed by a mean correction:
+ @f$ \Sigma = \frac{1}{W}\sum_t w_t x_t x_t' - \mu \mu' @f$.
+
+ The size of the cache is bounded by a memory budget. The frames are cached
+ in the order of the training set until the budget is exhausted, the
+ moments of the remaining frames are computed at each accumulation.
+ @warning the mean correction loses precision when the variance of the data
+ is small compared to its mean.
+ */
+class MomentCache {
+  public:
+    /**
+     @brief Default Constructor (empty cache)
+     */
+    MomentCache();
+
+    /**
+     @brief Computes the moments of the frames of a training set
+     @param trainingSet training set
+     @param full_covariance true to cache the packed moment matrices, false to
+     cache the squared values only
+     @param budget maximum size of the cache in bytes (0 disables the cache)
+     */
+    void build(TrainingSet* trainingSet, bool full_covariance,
+               std::size_t budget);
+
+    /**
+     @brief Empties the cache and releases its memory
+     */
+    void clear();
+
+    /**
+     @brief checks if the cache is empty
+     @return true if the cache was not built, or if its budget is too small
+     to contain the moment of a single frame
+     */
+    bool empty() const;
+
+    /**
+     @brief Get the number of cached frames
+     @return number of frames whose moment is cached
+     */
+    std::size_t size() const;
+
+    /**
+     @brief Get the size of the moment of a frame
+     @return packedSize(dimension) for full covariances, dimension otherwise
+     */
+    std::size_t momentSize() const;
+
+    /**
+     @brief Adds the weighted moment of a frame to an accumulator
+     @param index index of the frame in the training set (frames are indexed
+     in the order of the phrases of the training set)
+     @param frame values of the frame, only used if the frame is not cached
+     (can be NULL if index < size())
+     @param weight weight of the frame
+     @param moment accumulator (size: momentSize())
+     */
+    void accumulate(std::size_t index, const float* frame, double weight,
+                    double* moment) const;
+
+    /**
+     @brief Converts an accumulated moment to a covariance
+     @details computes moment / weight_sum - mean mean', where the mean is
+     the weighted mean of the frames
+     @param moment accumulated moment (packed or diagonal), replaced by the
+     covariance
+     @param mean weighted mean of the frames
+     @param weight_sum sum of the weights of the frames
+     @param full_covariance true if the moment is a packed matrix
+     */
+    static void toCovariance(std::vector<double>& moment,
+                             std::vector<double> const& mean,
+                             double weight_sum, bool full_covariance);
+
+  protected:
+    /**
+     @brief Moments of the cached frames (size x momentSize())
+     */
+    std::vector<double> moments_;
+
+    /**
+     @brief Number of cached frames
+     */
+    std::size_t size_;
+
+    /**
+     @brief Dimension of the frames
+     */
+    unsigned int dimension_;
+
+    /**
+     @brief Defines if the moments are packed matrices
+     */
+    bool full_covariance_;
+};
+}
+
+#endif
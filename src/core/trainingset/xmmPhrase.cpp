@@ -66,8 +66,10 @@ xmm::Phrase::Phrase(Phrase const& src)
       input_length_(src.input_length_),
       output_length_(src.output_length_),
       max_length_(src.max_length_) {
+    data_ = new float*[bimodal_ ? 2 : 1];
+    data_[0] = NULL;
+    if (bimodal_) data_[1] = NULL;
     if (own_memory_) {
-        data_ = new float*[bimodal_ ? 2 : 1];
         if (max_length_ > 0) {
             unsigned int modality_dim =
                 bimodal_ ? dimension_input.get() : dimension.get();
@@ -90,6 +92,35 @@ xmm::Phrase::Phrase(Phrase const& src)
     label.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
 }
 
+xmm::Phrase::Phrase(Phrase&& src)
+    : dimension(src.dimension),
+      dimension_input(src.dimension_input),
+      label(src.label),
+      column_names(std::move(src.column_names)),
+      own_memory_(src.own_memory_),
+      bimodal_(src.bimodal_),
+      empty_(src.empty_),
+      length_(src.length_),
+      input_length_(src.input_length_),
+      output_length_(src.output_length_),
+      max_length_(src.max_length_) {
+    data_ = new float*[bimodal_ ? 2 : 1];
+    data_[0] = src.data_[0];
+    src.data_[0] = NULL;
+    if (bimodal_) {
+        data_[1] = src.data_[1];
+        src.data_[1] = NULL;
+    }
+    src.empty_ = true;
+    src.length_ = 0;
+    src.input_length_ = 0;
+    src.output_length_ = 0;
+    src.max_length_ = 0;
+    dimension.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
+    dimension_input.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
+    label.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
+}
+
 xmm::Phrase::Phrase(Json::Value const& root)
     : own_memory_(true),
       bimodal_(false),
@@ -162,12 +193,12 @@ xmm::Phrase& xmm::Phrase::operator=(Phrase const& src) {
                 } catch (std::exception& e) {
                 }
             }
-            try {
-                delete[] data_;
-            } catch (std::exception& e) {
-            }
-            data_ = NULL;
         }
+        try {
+            delete[] data_;
+        } catch (std::exception& e) {
+        }
+        data_ = NULL;
         own_memory_ = src.own_memory_;
         bimodal_ = src.bimodal_;
         empty_ = src.empty_;
@@ -180,8 +211,10 @@ xmm::Phrase& xmm::Phrase::operator=(Phrase const& src) {
         column_names = src.column_names;
         label = src.label;
 
+        data_ = new float*[bimodal_ ? 2 : 1];
+        data_[0] = NULL;
+        if (bimodal_) data_[1] = NULL;
         if (own_memory_) {
-            data_ = new float*[bimodal_ ? 2 : 1];
             if (max_length_ > 0) {
                 unsigned int modality_dim =
                     bimodal_ ? dimension_input.get() : dimension.get();
@@ -204,6 +237,47 @@ xmm::Phrase& xmm::Phrase::operator=(Phrase const& src) {
         dimension_input.onAttributeChange(this,
                                           &xmm::Phrase::onAttributeChange);
         label.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
+        notifyDataChanged();
+    }
+    return *this;
+}
+
+xmm::Phrase& xmm::Phrase::operator=(Phrase&& src) {
+    if (this != &src) {
+        float** data = new float*[src.bimodal_ ? 2 : 1];
+        data[0] = src.data_[0];
+        src.data_[0] = NULL;
+        if (src.bimodal_) {
+            data[1] = src.data_[1];
+            src.data_[1] = NULL;
+        }
+        if (own_memory_) {
+            if (bimodal_) delete[] data_[1];
+            delete[] data_[0];
+        }
+        delete[] data_;
+        data_ = data;
+        own_memory_ = src.own_memory_;
+        bimodal_ = src.bimodal_;
+        empty_ = src.empty_;
+        dimension = src.dimension;
+        dimension_input = src.dimension_input;
+        max_length_ = src.max_length_;
+        length_ = src.length_;
+        input_length_ = src.input_length_;
+        output_length_ = src.output_length_;
+        column_names = std::move(src.column_names);
+        label = src.label;
+        src.empty_ = true;
+        src.length_ = 0;
+        src.input_length_ = 0;
+        src.output_length_ = 0;
+        src.max_length_ = 0;
+        dimension.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
+        dimension_input.onAttributeChange(this,
+                                          &xmm::Phrase::onAttributeChange);
+        label.onAttributeChange(this, &xmm::Phrase::onAttributeChange);
+        notifyDataChanged();
     }
     return *this;
 }
@@ -230,6 +304,8 @@ unsigned int xmm::Phrase::outputSize() const { return output_length_; }
 
 bool xmm::Phrase::empty() const { return empty_; }
 
+unsigned int xmm::Phrase::capacity() const { return max_length_; }
+
 float xmm::Phrase::getValue(unsigned int index, unsigned int dim) const {
     if (dim >= dimension.get())
         throw std::out_of_range("Phrase: dimension out of bounds");
@@ -279,6 +355,13 @@ float* xmm::Phrase::getPointer_output(unsigned int index) const {
     return data_[1] + index * (dimension.get() - dimension_input.get());
 }
 
+xmm::Phrase::FrameView xmm::Phrase::frames() const {
+    if (bimodal_)
+        return FrameView(data_[0], data_[1], dimension_input.get(),
+                         dimension.get() - dimension_input.get(), length_);
+    return FrameView(data_[0], NULL, dimension.get(), 0, length_);
+}
+
 void xmm::Phrase::connect(float* pointer_to_data, unsigned int length) {
     if (own_memory_)
         throw std::runtime_error("Cannot connect a phrase with own data");
@@ -291,6 +374,7 @@ void xmm::Phrase::connect(float* pointer_to_data, unsigned int length) {
     input_length_ = length;
     length_ = length;
     empty_ = false;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::connect(float* pointer_to_data_input,
@@ -306,6 +390,7 @@ void xmm::Phrase::connect(float* pointer_to_data_input,
     output_length_ = length;
     trim();
     empty_ = false;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::connect_input(float* pointer_to_data, unsigned int length) {
@@ -318,6 +403,7 @@ void xmm::Phrase::connect_input(float* pointer_to_data, unsigned int length) {
     input_length_ = length;
     trim();
     empty_ = false;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::connect_output(float* pointer_to_data, unsigned int length) {
@@ -330,6 +416,7 @@ void xmm::Phrase::connect_output(float* pointer_to_data, unsigned int length) {
     output_length_ = length;
     trim();
     empty_ = false;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::disconnect() {
@@ -341,78 +428,113 @@ void xmm::Phrase::disconnect() {
     input_length_ = 0;
     output_length_ = 0;
     empty_ = true;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::record(std::vector<float> const& observation) {
+    if (observation.size() != dimension.get())
+        throw std::invalid_argument("Observation has wrong dimension");
+    recordBlock(observation.data(), 1);
+}
+
+void xmm::Phrase::record_input(std::vector<float> const& observation) {
+    if (bimodal_ && observation.size() != dimension_input.get())
+        throw std::invalid_argument("Observation has wrong dimension");
+    recordBlock_input(observation.data(), 1);
+}
+
+void xmm::Phrase::record_output(std::vector<float> const& observation) {
+    if (bimodal_ &&
+        observation.size() != dimension.get() - dimension_input.get())
+        throw std::invalid_argument("Observation has wrong dimension");
+    recordBlock_output(observation.data(), 1);
+}
+
+void xmm::Phrase::reserve(unsigned int frames) {
+    if (!own_memory_)
+        throw std::runtime_error("Cannot reserve memory in shared data phrase");
+    if (frames <= max_length_) return;
+    unsigned int modality_dim =
+        bimodal_ ? dimension_input.get() : dimension.get();
+    data_[0] = reallocate<float>(data_[0], max_length_ * modality_dim,
+                                 frames * modality_dim);
+    if (bimodal_) {
+        modality_dim = dimension.get() - dimension_input.get();
+        data_[1] = reallocate<float>(data_[1], max_length_ * modality_dim,
+                                     frames * modality_dim);
+    }
+    max_length_ = frames;
+}
+
+void xmm::Phrase::recordBlock(const float* data, std::size_t frames) {
     if (!own_memory_)
         throw std::runtime_error("Cannot record in shared data phrase");
     if (bimodal_ && input_length_ != output_length_)
         throw std::runtime_error(
             "Cannot record bimodal_ phrase in synchronous mode: modalities "
             "have different length");
-    if (observation.size() != dimension.get())
-        throw std::invalid_argument("Observation has wrong dimension");
+    if (frames == 0) return;
 
-    if (length_ >= max_length_ || max_length_ == 0) {
-        reallocateLength();
-    }
+    reallocateLength(length_ + frames);
 
     if (bimodal_) {
-        copy(observation.begin(), observation.begin() + dimension_input.get(),
-             data_[0] + input_length_ * dimension_input.get());
-        copy(observation.begin() + dimension_input.get(),
-             observation.begin() + dimension.get(),
-             data_[1] +
-                 output_length_ * (dimension.get() - dimension_input.get()));
-        input_length_++;
-        output_length_++;
+        unsigned int dimension_output = dimension.get() - dimension_input.get();
+        float* input = data_[0] + input_length_ * dimension_input.get();
+        float* output = data_[1] + output_length_ * dimension_output;
+        for (std::size_t t = 0; t < frames; t++) {
+            std::copy(data, data + dimension_input.get(), input);
+            std::copy(data + dimension_input.get(), data + dimension.get(),
+                      output);
+            data += dimension.get();
+            input += dimension_input.get();
+            output += dimension_output;
+        }
+        input_length_ += frames;
+        output_length_ += frames;
     } else {
-        copy(observation.begin(), observation.end(),
-             data_[0] + length_ * dimension.get());
-        input_length_++;
+        std::copy(data, data + frames * dimension.get(),
+                  data_[0] + length_ * dimension.get());
+        input_length_ += frames;
     }
 
-    length_++;
+    length_ += frames;
     empty_ = false;
+    notifyDataChanged();
 }
 
-void xmm::Phrase::record_input(std::vector<float> const& observation) {
+void xmm::Phrase::recordBlock_input(const float* data, std::size_t frames) {
     if (!own_memory_)
         throw std::runtime_error("Cannot record in shared data phrase");
     if (!bimodal_)
         throw std::runtime_error("this phrase is unimodal, use 'record'");
-    if (observation.size() != dimension_input.get())
-        throw std::invalid_argument("Observation has wrong dimension");
+    if (frames == 0) return;
 
-    if (input_length_ >= max_length_ || max_length_ == 0) {
-        reallocateLength();
-    }
+    reallocateLength(input_length_ + frames);
 
-    copy(observation.begin(), observation.end(),
-         data_[0] + input_length_ * dimension_input.get());
-    input_length_++;
+    std::copy(data, data + frames * dimension_input.get(),
+              data_[0] + input_length_ * dimension_input.get());
+    input_length_ += frames;
     trim();
     empty_ = false;
+    notifyDataChanged();
 }
 
-void xmm::Phrase::record_output(std::vector<float> const& observation) {
+void xmm::Phrase::recordBlock_output(const float* data, std::size_t frames) {
     if (!own_memory_)
         throw std::runtime_error("Cannot record in shared data phrase");
     if (!bimodal_)
         throw std::runtime_error("this phrase is unimodal, use 'record'");
+    if (frames == 0) return;
 
-    if (observation.size() != dimension.get() - dimension_input.get())
-        throw std::invalid_argument("Observation has wrong dimension");
-
-    if (output_length_ >= max_length_ || max_length_ == 0) {
-        reallocateLength();
-    }
+    reallocateLength(output_length_ + frames);
 
-    copy(observation.begin(), observation.end(),
-         data_[1] + output_length_ * (dimension.get() - dimension_input.get()));
-    output_length_++;
+    unsigned int dimension_output = dimension.get() - dimension_input.get();
+    std::copy(data, data + frames * dimension_output,
+              data_[1] + output_length_ * dimension_output);
+    output_length_ += frames;
     trim();
     empty_ = false;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::clear() {
@@ -423,6 +545,7 @@ void xmm::Phrase::clear() {
     input_length_ = 0;
     output_length_ = 0;
     empty_ = true;
+    notifyDataChanged();
 }
 
 void xmm::Phrase::clearInput() {
@@ -431,6 +554,7 @@ void xmm::Phrase::clearInput() {
     if (!bimodal_) length_ = 0;
     input_length_ = 0;
     trim();
+    notifyDataChanged();
 }
 
 void xmm::Phrase::clearOutput() {
@@ -439,6 +563,7 @@ void xmm::Phrase::clearOutput() {
     if (!bimodal_) length_ = 0;
     output_length_ = 0;
     trim();
+    notifyDataChanged();
 }
 
 Json::Value xmm::Phrase::toJson() const {
@@ -464,12 +589,129 @@ Json::Value xmm::Phrase::toJson() const {
 void xmm::Phrase::fromJson(Json::Value const& root) {
     try {
         Phrase tmp(root);
-        *this = tmp;
+        *this = std::move(tmp);
     } catch (JsonException& e) {
         throw e;
     }
 }
 
+void xmm::Phrase::writeJson(std::ostream& stream) const {
+    JsonStreamWriter writer(stream);
+    writer.beginObject();
+    writeJsonMembers(writer);
+    writer.endObject();
+}
+
+void xmm::Phrase::readJson(std::istream& stream) {
+    JsonStreamReader reader(stream);
+    readJson(reader, nullptr);
+    reader.checkEnd();
+}
+
+void xmm::Phrase::writeJsonMembers(JsonStreamWriter& writer) const {
+    writer.key("bimodal");
+    writer.value(bimodal_);
+    writer.key("dimension");
+    writer.value(dimension.get());
+    writer.key("dimension_input");
+    writer.value(dimension_input.get());
+    writer.key("length");
+    writer.value(length_);
+    writer.key("label");
+    writer.value(label.get());
+    writer.key("column_names");
+    writer.array(column_names);
+    if (bimodal_) {
+        writer.key("data_input");
+        writer.array(data_[0], length_ * dimension_input.get());
+        writer.key("data_output");
+        writer.array(data_[1],
+                     length_ * (dimension.get() - dimension_input.get()));
+    } else {
+        writer.key("data");
+        writer.array(data_[0], length_ * dimension.get());
+    }
+}
+
+void xmm::Phrase::readJson(
+    JsonStreamReader& reader,
+    std::function<bool(std::string const&)> const& read_member) {
+    bool bimodal(false);
+    int dim(-1), dim_input(-1);
+    unsigned int length(0);
+    std::string phrase_label;
+    std::vector<std::string> names;
+    std::vector<float> data, data_input, data_output;
+    std::string name;
+    reader.beginObject();
+    while (reader.nextMember(name)) {
+        if (name == "bimodal") {
+            bimodal = reader.readBool();
+        } else if (name == "dimension") {
+            dim = reader.readInt();
+        } else if (name == "dimension_input") {
+            dim_input = reader.readInt();
+        } else if (name == "length") {
+            length = reader.readUInt();
+        } else if (name == "label") {
+            phrase_label = reader.readString();
+        } else if (name == "column_names") {
+            reader.readArray(names);
+        } else if (name == "data") {
+            if (dim > 0) data.reserve(length * dim);
+            reader.readArray(data);
+        } else if (name == "data_input") {
+            if (dim_input > 0) data_input.reserve(length * dim_input);
+            reader.readArray(data_input);
+        } else if (name == "data_output") {
+            if (dim > dim_input && dim_input >= 0)
+                data_output.reserve(length * (dim - dim_input));
+            reader.readArray(data_output);
+        } else if (!read_member || !read_member(name)) {
+            reader.skipValue();
+        }
+    }
+
+    Phrase tmp(MemoryMode::OwnMemory,
+               bimodal ? Multimodality::Bimodal : Multimodality::Unimodal);
+    tmp.dimension.set((dim < 0) ? (bimodal ? 2 : 1) : dim, true);
+    if (bimodal) {
+        tmp.dimension_input.setLimits(1, tmp.dimension.get() - 1);
+    } else {
+        tmp.dimension_input.setLimits(0, 0);
+    }
+    tmp.dimension_input.set((dim_input < 0) ? (bimodal ? 1 : 0) : dim_input,
+                            true);
+    tmp.column_names.resize(tmp.dimension.get(), "");
+    for (unsigned int i = 0; i < names.size() && i < tmp.dimension.get(); i++)
+        tmp.column_names[i] = names[i];
+    tmp.label.set(phrase_label);
+
+    tmp.length_ = length;
+    tmp.max_length_ = length;
+    tmp.input_length_ = length;
+    tmp.output_length_ = length;
+    tmp.empty_ = (length == 0);
+    auto fill = [&tmp, length](unsigned int modality,
+                               std::vector<float> const& values,
+                               unsigned int modality_dimension,
+                               std::string const& node) {
+        if (values.size() != length * modality_dimension)
+            throw JsonException(JsonException::JsonErrorType::JsonValueError,
+                                node);
+        tmp.data_[modality] = new float[values.size()];
+        std::copy(values.begin(), values.end(), tmp.data_[modality]);
+    };
+    if (bimodal) {
+        fill(0, data_input, tmp.dimension_input.get(), "data_input");
+        fill(1, data_output,
+             tmp.dimension.get() - tmp.dimension_input.get(), "data_output");
+    } else {
+        fill(0, data, tmp.dimension.get(), "data");
+    }
+    *this = std::move(tmp);
+}
+
 std::vector<float> xmm::Phrase::mean() const {
     std::vector<float> mean(dimension.get());
     for (unsigned int d = 0; d < dimension.get(); d++) {
@@ -532,6 +774,7 @@ void xmm::Phrase::rescale(std::vector<float> offset, std::vector<float> gain) {
             }
         }
     }
+    notifyDataChanged();
 }
 
 void xmm::Phrase::trim() {
@@ -541,19 +784,16 @@ void xmm::Phrase::trim() {
     }
 }
 
-void xmm::Phrase::reallocateLength() {
-    unsigned int modality_dim =
-        bimodal_ ? dimension_input.get() : dimension.get();
-    data_[0] =
-        reallocate<float>(data_[0], max_length_ * modality_dim,
-                          (max_length_ + AllocationBlockSize) * modality_dim);
-    if (bimodal_) {
-        modality_dim = dimension.get() - dimension_input.get();
-        data_[1] = reallocate<float>(
-            data_[1], max_length_ * modality_dim,
-            (max_length_ + AllocationBlockSize) * modality_dim);
-    }
-    max_length_ += AllocationBlockSize;
+void xmm::Phrase::reallocateLength(std::size_t length) {
+    if (length <= max_length_) return;
+    if (length > std::numeric_limits<unsigned int>::max())
+        throw std::length_error("Phrase: length exceeds the maximum length");
+    std::size_t allocated_length =
+        std::max<std::size_t>(2 * std::size_t(max_length_), AllocationBlockSize);
+    allocated_length = std::min<std::size_t>(
+        std::max(allocated_length, length),
+        std::numeric_limits<unsigned int>::max());
+    reserve(static_cast<unsigned int>(allocated_length));
 }
 
 void xmm::Phrase::onAttributeChange(xmm::AttributeBase* attr_pointer) {
@@ -574,6 +814,7 @@ void xmm::Phrase::onAttributeChange(xmm::AttributeBase* attr_pointer) {
             delete data_[1];
         }
         column_names.resize(dimension.get());
+        notifyDataChanged();
     }
     if (attr_pointer == &dimension)
         dimension_input.setLimitMax(dimension.get() - 1);
@@ -583,3 +824,8 @@ void xmm::Phrase::onAttributeChange(xmm::AttributeBase* attr_pointer) {
     }
     attr_pointer->changed = false;
 }
+
+void xmm::Phrase::notifyDataChanged() {
+    PhraseEvent event(this, PhraseEvent::Type::DataChanged);
+    events.notifyListeners(event);
+}
@@ -36,7 +36,10 @@
 #include "../common/xmmAttribute.hpp"
 #include "../common/xmmEvents.hpp"
 #include "../common/xmmJson.hpp"
+#include "../common/xmmJsonStream.hpp"
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 
 namespace xmm {
 /**
@@ -95,6 +98,12 @@ class PhraseEvent {
          @brief Thrown when the label if the phrase is modified.
          */
         LabelChanged,
+
+        /**
+         @brief Thrown when the data of the phrase is modified (recording,
+         clearing, connection, rescaling or change of dimension).
+         */
+        DataChanged
     };
 
     /**
@@ -134,6 +143,118 @@ class Phrase : public Writable {
   public:
     friend class TrainingSet;
 
+    /**
+     @brief Unchecked view over the frames of a phrase
+     @details The view gives direct access to the rows of the data arrays
+     without bounds checking, for the inner loops of the training algorithms.
+     The rows of a modality are contiguous: row t of the input modality (or of
+     the only modality of a unimodal phrase) starts at input(t), and the stride
+     between consecutive rows is dimension_input(). Bimodal phrases also present
+     the rows of the output modality with output(t).
+     @warning the view is invalidated when the phrase is reallocated
+     (recording, change of dimension, connection) or destroyed.
+     */
+    class FrameView {
+      public:
+        /**
+         @brief Constructor
+         @param input pointer to the data array of the input modality (or of
+         the only modality of a unimodal phrase)
+         @param output pointer to the data array of the output modality (NULL
+         if the phrase is unimodal)
+         @param dimension_input dimension of the input modality
+         @param dimension_output dimension of the output modality
+         @param length number of frames
+         */
+        FrameView(const float* input, const float* output,
+                  unsigned int dimension_input, unsigned int dimension_output,
+                  unsigned int length)
+            : input_(input),
+              output_(output),
+              dimension_input_(dimension_input),
+              dimension_output_(dimension_output),
+              length_(length) {}
+
+        /**
+         @brief get the number of frames in the view
+         @return the number of frames (minimal length of the modalities)
+         */
+        unsigned int size() const { return length_; }
+
+        /**
+         @brief get the total dimension of the frames
+         @return the total dimension across modalities
+         */
+        unsigned int dimension() const {
+            return dimension_input_ + dimension_output_;
+        }
+
+        /**
+         @brief get the dimension (row stride) of the input modality
+         @return the dimension of the input modality, or the total dimension if
+         the phrase is unimodal
+         */
+        unsigned int dimension_input() const { return dimension_input_; }
+
+        /**
+         @brief get the dimension (row stride) of the output modality
+         @return the dimension of the output modality (0 if the phrase is
+         unimodal)
+         */
+        unsigned int dimension_output() const { return dimension_output_; }
+
+        /**
+         @brief checks if the view presents two modalities
+         @return true if the phrase is bimodal
+         */
+        bool bimodal() const { return output_ != NULL; }
+
+        /**
+         @brief Get the row of the input modality (or of the only modality of
+         a unimodal phrase) at a given time index
+         @param index time index
+         @return pointer to the row
+         */
+        const float* input(unsigned int index) const {
+            return input_ + std::size_t(index) * dimension_input_;
+        }
+
+        /**
+         @brief Get the row of the output modality at a given time index
+         @param index time index
+         @return pointer to the row
+         @warning this method can be used only for bimodal phrases
+         */
+        const float* output(unsigned int index) const {
+            return output_ + std::size_t(index) * dimension_output_;
+        }
+
+        /**
+         @brief Get a contiguous frame at a given time index (full dimension)
+         @details The frame of a unimodal phrase is returned without copy. The
+         rows of the input and output modalities of a bimodal phrase are
+         concatenated in the buffer.
+         @param index time index
+         @param buffer array of size dimension(), used for bimodal phrases
+         @return pointer to the frame
+         */
+        const float* frame(unsigned int index, float* buffer) const {
+            if (!output_) return input(index);
+            const float* row = input(index);
+            std::copy(row, row + dimension_input_, buffer);
+            row = output(index);
+            std::copy(row, row + dimension_output_, buffer + dimension_input_);
+            return buffer;
+        }
+
+      protected:
+        const float* input_;
+        const float* output_;
+        unsigned int dimension_input_;
+        unsigned int dimension_output_;
+        unsigned int length_;
+    };
+
     /**
      @brief Constructor
      @param memoryMode Memory mode (owned vs shared)
@@ -148,6 +269,14 @@ class Phrase : public Writable {
      */
     Phrase(Phrase const& src);
 
+    /**
+     @brief Move Constructor
+     @details the data arrays are taken from the source Phrase, which is left
+     empty. As for copies, the listeners of the phrase events are not moved.
+     @param src source Phrase
+     */
+    Phrase(Phrase&& src);
+
     /**
      @brief Constructor from Json Structure
      @param root Json Value
@@ -160,6 +289,14 @@ class Phrase : public Writable {
      */
     Phrase& operator=(Phrase const& src);
 
+    /**
+     @brief Move Assignment
+     @details the data arrays are taken from the source Phrase, which is left
+     empty.
+     @param src source Phrase
+     */
+    Phrase& operator=(Phrase&& src);
+
     /**
      @brief Destructor.
      @details Data is only deleted if the memory is owned (construction with
@@ -213,6 +350,12 @@ class Phrase : public Writable {
      */
     bool empty() const;
 
+    /**
+     @brief get the number of frames that can be recorded without reallocation
+     @return the allocated length of the phrase (0 in shared memory)
+     */
+    unsigned int capacity() const;
+
     /**
      @brief Access data at a given time index and dimension.
      @param index time index
@@ -259,6 +402,12 @@ class Phrase : public Writable {
      */
     float* getPointer_output(unsigned int index) const;
 
+    /**
+     @brief Get an unchecked view over the frames of the phrase
+     @return a view presenting the rows of each modality
+     */
+    FrameView frames() const;
+
     ///@}
 
     /** @name Connect (MemoryMode = SharedData) */
@@ -367,6 +516,60 @@ class Phrase : public Writable {
      */
     void record_output(std::vector<float> const& observation);
 
+    /**
+     @brief Reserve memory for a given number of frames
+     @details Allocates the data arrays so that the phrase can hold at least
+     'frames' frames in each modality without reallocation. The memory is never
+     shrunk.\n
+     This method is only usable in Own Memory (construction with
+     MemoryMode::OwnMemory)
+     @param frames number of frames
+     @throws runtime_error if data is shared (construction with
+     MemoryMode::SharedMemory flag)
+     */
+    void reserve(unsigned int frames);
+
+    /**
+     @brief Record a block of observations
+     @details Appends 'frames' observations to the data array. The block is
+     stored frame by frame, each frame having the total dimension of the data
+     across all modalities. A unimodal block is appended in a single copy.\n
+     This method is only usable in Own Memory (construction with
+     MemoryMode::OwnMemory)
+     @param data pointer to the block (size frames * dimension)
+     @param frames number of frames in the block
+     @throws runtime_error if data is shared (construction with
+     MemoryMode::SharedMemory flag)
+     */
+    void recordBlock(const float* data, std::size_t frames);
+
+    /**
+     @brief Record a block of observations on input modality
+     @details Appends 'frames' observations to the data array of the input
+     modality in a single copy.\n
+     This method is only usable in Own Memory (construction with
+     MemoryMode::OwnMemory)
+     @param data pointer to the block (size frames * dimension_input)
+     @param frames number of frames in the block
+     @throws runtime_error if data is shared (construction with
+     MemoryMode::SharedMemory flag) or if the phrase is unimodal
+     */
+    void recordBlock_input(const float* data, std::size_t frames);
+
+    /**
+     @brief Record a block of observations on output modality
+     @details Appends 'frames' observations to the data array of the output
+     modality in a single copy.\n
+     This method is only usable in Own Memory (construction with
+     MemoryMode::OwnMemory)
+     @param data pointer to the block (size frames * (dimension -
+     dimension_input))
+     @param frames number of frames in the block
+     @throws runtime_error if data is shared (construction with
+     MemoryMode::SharedMemory flag) or if the phrase is unimodal
+     */
+    void recordBlock_output(const float* data, std::size_t frames);
+
     /**
      @brief Reset length of the phrase to 0 ==> empty phrase\n
      This method is only usable in Own Memory (construction with
@@ -397,6 +600,25 @@ class Phrase : public Writable {
      */
     void fromJson(Json::Value const& root);
 
+    /**
+     @brief Write the phrase to a stream in JSON format
+     @details the data is written incrementally, without building the
+     Json::Value of the phrase. The document has the same schema as toJson().
+     @param stream output stream
+     @throws runtime_error if the stream cannot be written
+     */
+    void writeJson(std::ostream& stream) const;
+
+    /**
+     @brief Read the phrase from a stream in JSON format
+     @details the data arrays are filled as they are parsed, without building
+     the Json::Value of the phrase.
+     @param stream input stream
+     @throws runtime_error if the document cannot be parsed
+     @throws JsonException if the JSON value has a wrong format
+     */
+    void readJson(std::istream& stream);
+
     ///@}
 
     /** @name Utilities */
@@ -451,6 +673,24 @@ class Phrase : public Writable {
     std::vector<std::string> column_names;
 
   protected:
+    /**
+     @brief Writes the members of the JSON object of the phrase
+     @details the metadata are written before the data arrays, so that the
+     readers can allocate the arrays before parsing them
+     @param writer streaming JSON writer (inside the object of the phrase)
+     */
+    void writeJsonMembers(JsonStreamWriter& writer) const;
+
+    /**
+     @brief Reads the JSON object of a phrase
+     @param reader streaming JSON reader (before the object of the phrase)
+     @param read_member function called with the name of the members that do
+     not belong to the phrase: it must read the value of the member and
+     return true, or return false for the value to be skipped.
+     */
+    void readJson(JsonStreamReader& reader,
+                  std::function<bool(std::string const&)> const& read_member);
+
     /**
      @brief trim phrase to minimal length of modalities
      */
@@ -458,17 +698,25 @@ class Phrase : public Writable {
 
     /**
      @brief Memory Allocation
-     @details used record mode (no SHARED_MEMORY flag), the data vector is
-     reallocated
-     with a block size ALLOC_BLOCKSIZE
+     @details used record mode (no SHARED_MEMORY flag): if the data arrays
+     cannot hold 'length' frames, they are reallocated with a geometric growth
+     (the allocated length is at least doubled, with a minimum of
+     AllocationBlockSize frames), so that recording is amortized linear in the
+     length of the phrase.
+     @param length number of frames that the data arrays must hold
      */
-    void reallocateLength();
+    void reallocateLength(std::size_t length);
 
     /**
      @brief notification function called when a member attribute is changed
      */
     virtual void onAttributeChange(AttributeBase* attr_pointer);
 
+    /**
+     @brief notifies the listeners that the data of the phrase is modified
+     */
+    void notifyDataChanged();
+
     static const unsigned int AllocationBlockSize = 256;
 
     /**
@@ -0,0 +1,232 @@
+/*
+ * xmmPhraseStore.cpp
+ *
+ * Chunked streaming of binary training set files
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "xmmPhraseStore.hpp"
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+bool littleEndianHost() {
+    const uint32_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+}
+
+#pragma mark -
+#pragma mark Constructors
+xmm::PhraseStore::PhraseStore(std::string const& filename,
+                              std::size_t chunk_size)
+    : filename_(filename), chunk_size_(chunk_size) {
+    if (!littleEndianHost())
+        throw std::runtime_error(
+            "Binary training sets can only be read on little-endian "
+            "platforms");
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open file " + filename);
+    std::vector<char> metadata(MappedTrainingSet::HEADER_SIZE());
+    if (!file.read(metadata.data(), metadata.size()))
+        throw std::runtime_error("Not a training set file");
+    metadata.resize(MappedTrainingSet::metadataSize(metadata.data()));
+    file.read(metadata.data() + MappedTrainingSet::HEADER_SIZE(),
+              metadata.size() - MappedTrainingSet::HEADER_SIZE());
+    if (!file) throw std::runtime_error("Truncated training set file");
+    index_ = std::make_shared<MappedTrainingSet::FileIndex>(
+        MappedTrainingSet::readIndex(metadata.data(), metadata.size()));
+
+    for (unsigned int p = 0; p < index_->phrases.size(); p++) {
+        phrases_.push_back(p);
+        labels_.insert(index_->phrases[p].label);
+    }
+    partition();
+    for (auto const& label : labels_)
+        sub_stores_.insert(std::pair<std::string, PhraseStore>(
+            label, PhraseStore(*this, label)));
+}
+
+xmm::PhraseStore::PhraseStore(PhraseStore const& src, std::string const& label)
+    : filename_(src.filename_),
+      chunk_size_(src.chunk_size_),
+      index_(src.index_) {
+    for (auto p : src.phrases_)
+        if (index_->phrases[p].label == label) phrases_.push_back(p);
+    labels_.insert(label);
+    partition();
+}
+
+void xmm::PhraseStore::partition() {
+    unsigned int dimension_input =
+        index_->bimodal ? index_->dimension_input : index_->dimension;
+    unsigned int dimension_output = index_->dimension - index_->dimension_input;
+    chunk_offsets_.clear();
+    std::size_t current_size(0);
+    for (unsigned int i = 0; i < phrases_.size(); i++) {
+        MappedTrainingSet::FileIndex::PhraseEntry const& entry =
+            index_->phrases[phrases_[i]];
+        std::size_t phrase_size =
+            (std::size_t(entry.length_input) * dimension_input +
+             std::size_t(entry.length_output) * dimension_output) *
+            sizeof(float);
+        if (chunk_offsets_.empty() ||
+            (current_size > 0 && current_size + phrase_size > chunk_size_)) {
+            chunk_offsets_.push_back(i);
+            current_size = 0;
+        }
+        current_size += phrase_size;
+    }
+    chunk_offsets_.push_back(static_cast<unsigned int>(phrases_.size()));
+}
+
+#pragma mark -
+#pragma mark Accessors
+bool xmm::PhraseStore::bimodal() const { return index_->bimodal; }
+
+unsigned int xmm::PhraseStore::dimension() const { return index_->dimension; }
+
+unsigned int xmm::PhraseStore::dimension_input() const {
+    return index_->dimension_input;
+}
+
+std::vector<std::string> const& xmm::PhraseStore::column_names() const {
+    return index_->column_names;
+}
+
+bool xmm::PhraseStore::empty() const { return phrases_.empty(); }
+
+unsigned int xmm::PhraseStore::size() const {
+    return static_cast<unsigned int>(phrases_.size());
+}
+
+std::set<std::string> const& xmm::PhraseStore::labels() const {
+    return labels_;
+}
+
+xmm::PhraseStore const* xmm::PhraseStore::getPhrasesOfClass(
+    std::string const& label) const {
+    if (sub_stores_.empty() && labels_.count(label) > 0) return this;
+    std::map<std::string, PhraseStore>::const_iterator it =
+        sub_stores_.find(label);
+    if (it == sub_stores_.end()) return NULL;
+    return &it->second;
+}
+
+#pragma mark -
+#pragma mark Chunks
+std::size_t xmm::PhraseStore::chunkSize() const { return chunk_size_; }
+
+unsigned int xmm::PhraseStore::chunks() const {
+    return static_cast<unsigned int>(chunk_offsets_.size()) - 1;
+}
+
+std::shared_ptr<xmm::TrainingSet> xmm::PhraseStore::loadChunk(
+    unsigned int chunk) const {
+    if (chunk >= chunks()) throw std::out_of_range("Chunk does not exist");
+    std::shared_ptr<TrainingSet> trainingSet = std::make_shared<TrainingSet>(
+        MemoryMode::OwnMemory,
+        index_->bimodal ? Multimodality::Bimodal : Multimodality::Unimodal);
+    trainingSet->dimension.set(index_->dimension);
+    if (index_->bimodal)
+        trainingSet->dimension_input.set(index_->dimension_input);
+    trainingSet->column_names.set(index_->column_names);
+
+    std::ifstream file(filename_, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open file " + filename_);
+    unsigned int dimension_output = index_->dimension - index_->dimension_input;
+    std::vector<float> buffer;
+    auto readArray = [&](std::size_t offset, unsigned int length,
+                         unsigned int width) {
+        buffer.resize(std::size_t(length) * width);
+        file.seekg(offset);
+        file.read(reinterpret_cast<char*>(buffer.data()),
+                  buffer.size() * sizeof(float));
+        if (!file)
+            throw std::runtime_error("Cannot read file " + filename_);
+        return buffer.data();
+    };
+    for (unsigned int i = chunk_offsets_[chunk]; i < chunk_offsets_[chunk + 1];
+         i++) {
+        MappedTrainingSet::FileIndex::PhraseEntry const& entry =
+            index_->phrases[phrases_[i]];
+        trainingSet->addPhrase(entry.index, entry.label);
+        std::shared_ptr<Phrase> phrase = trainingSet->getPhrase(entry.index);
+        if (index_->bimodal) {
+            phrase->recordBlock_input(
+                readArray(entry.input_offset, entry.length_input,
+                          index_->dimension_input),
+                entry.length_input);
+            phrase->recordBlock_output(
+                readArray(entry.output_offset, entry.length_output,
+                          dimension_output),
+                entry.length_output);
+        } else {
+            phrase->recordBlock(readArray(entry.input_offset,
+                                          entry.length_input,
+                                          index_->dimension),
+                                entry.length_input);
+        }
+    }
+    return trainingSet;
+}
+
+void xmm::PhraseStore::forEachChunk(
+    std::function<void(TrainingSet*)> const& callback) const {
+    if (chunks() == 0) return;
+    std::shared_ptr<TrainingSet> current = loadChunk(0);
+    for (unsigned int chunk = 0; chunk < chunks(); chunk++) {
+        std::shared_ptr<TrainingSet> next;
+        std::exception_ptr prefetch_error;
+        std::thread prefetch;
+        if (chunk + 1 < chunks()) {
+            prefetch = std::thread([&, chunk] {
+                try {
+                    next = loadChunk(chunk + 1);
+                } catch (...) {
+                    prefetch_error = std::current_exception();
+                }
+            });
+        }
+        try {
+            callback(current.get());
+        } catch (...) {
+            if (prefetch.joinable()) prefetch.join();
+            throw;
+        }
+        if (prefetch.joinable()) prefetch.join();
+        if (prefetch_error) std::rethrow_exception(prefetch_error);
+        current = next;
+    }
+}
@@ -0,0 +1,219 @@
+/*
+ * xmmPhraseStore.hpp
+ *
+ * Chunked streaming of binary training set files
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef xmmPhraseStore_h
+#define xmmPhraseStore_h
+
+#include "xmmMappedTrainingSet.hpp"
+#include <functional>
+
+namespace xmm {
+/**
+ @ingroup TrainingSet
+ @brief Chunked store of phrases for out-of-core training
+ @details The phrase store gives access to a binary training set file (see
+ MappedTrainingSet) without loading its data in memory: only the index of the
+ file is resident. The phrases are partitioned into chunks of bounded size,
+ that are loaded on demand as training sets with their own memory.
+ forEachChunk() streams all chunks while the next chunk is read from the disk
+ on a background thread, so that at most two chunks are in memory at any time.
+
+ Phrase stores are used to train models on data sets larger than the memory:
+ the EM algorithm accumulates the sufficient statistics of each chunk before
+ estimating the parameters of the model (see
+ SingleClassProbabilisticModel::train(PhraseStore*)).
+ */
+class PhraseStore {
+  public:
+    /**
+     @brief Default maximum size of a chunk in bytes
+     */
+    static std::size_t DEFAULT_CHUNK_SIZE() { return 64 * 1024 * 1024; }
+
+    /**
+     @brief Opens a binary training set file
+     @param filename path of the file
+     @param chunk_size maximum size of the data of a chunk in bytes (a phrase
+     larger than the chunk size forms its own chunk)
+     @throws runtime_error if the file cannot be opened, if it is not a valid
+     training set file, or if the platform is not little-endian
+     */
+    explicit PhraseStore(std::string const& filename,
+                         std::size_t chunk_size = DEFAULT_CHUNK_SIZE());
+
+    /** @name Accessors */
+    ///@{
+
+    /**
+     @brief checks if the phrases are bimodal
+     @return true if the phrases are bimodal
+     */
+    bool bimodal() const;
+
+    /**
+     @brief Get the total dimension of the data
+     @return dimension of the phrases
+     */
+    unsigned int dimension() const;
+
+    /**
+     @brief Get the dimension of the input modality
+     @return dimension of the input modality (0 if unimodal)
+     */
+    unsigned int dimension_input() const;
+
+    /**
+     @brief Get the names of the columns
+     @return names of the columns
+     */
+    std::vector<std::string> const& column_names() const;
+
+    /**
+     @brief checks if the store is empty
+     @return true if the store contains no phrase
+     */
+    bool empty() const;
+
+    /**
+     @brief Get the number of phrases in the store
+     @return number of phrases
+     */
+    unsigned int size() const;
+
+    /**
+     @brief Get the list of labels in the store
+     @return set of labels of the phrases
+     */
+    std::set<std::string> const& labels() const;
+
+    /**
+     @brief get the store of the phrases of a given class
+     @details the store of each class shares the index and chunk size of the
+     store
+     @param label target label
+     @return a pointer to the store of the phrases of the class, or NULL if the
+     label does not exist
+     */
+    PhraseStore const* getPhrasesOfClass(std::string const& label) const;
+
+    ///@}
+
+    /** @name Chunks */
+    ///@{
+
+    /**
+     @brief Get the maximum size of a chunk
+     @return maximum size of the data of a chunk in bytes
+     */
+    std::size_t chunkSize() const;
+
+    /**
+     @brief Get the number of chunks
+     @return number of chunks of the store
+     */
+    unsigned int chunks() const;
+
+    /**
+     @brief Loads a chunk of phrases from the disk
+     @param chunk index of the chunk
+     @return a training set (with its own memory) containing the phrases of the
+     chunk
+     @throws out_of_range if the chunk does not exist
+     @throws runtime_error if the file cannot be read
+     */
+    std::shared_ptr<TrainingSet> loadChunk(unsigned int chunk) const;
+
+    /**
+     @brief Calls a function on each chunk of the store
+     @details the chunks are processed in order. The next chunk is loaded on a
+     background thread while the function processes the current chunk.
+     @param callback function called with each chunk
+     @throws runtime_error if the file cannot be read. Exceptions thrown by the
+     function are propagated after the background thread has finished.
+     */
+    void forEachChunk(std::function<void(TrainingSet*)> const& callback) const;
+
+    ///@}
+
+  protected:
+    /**
+     @brief Constructor of the store of a class
+     @param src source store
+     @param label label of the class
+     */
+    PhraseStore(PhraseStore const& src, std::string const& label);
+
+    /**
+     @brief partitions the phrases into chunks
+     */
+    void partition();
+
+    /**
+     @brief path of the file
+     */
+    std::string filename_;
+
+    /**
+     @brief maximum size of a chunk in bytes
+     */
+    std::size_t chunk_size_;
+
+    /**
+     @brief index of the file (shared by the stores of each class)
+     */
+    std::shared_ptr<const MappedTrainingSet::FileIndex> index_;
+
+    /**
+     @brief positions of the phrases of the store in the index of the file
+     */
+    std::vector<unsigned int> phrases_;
+
+    /**
+     @brief position of the first phrase of each chunk in phrases_ (followed
+     by the number of phrases)
+     */
+    std::vector<unsigned int> chunk_offsets_;
+
+    /**
+     @brief labels of the phrases
+     */
+    std::set<std::string> labels_;
+
+    /**
+     @brief stores of the phrases of each class
+     */
+    std::map<std::string, PhraseStore> sub_stores_;
+};
+}
+
+#endif
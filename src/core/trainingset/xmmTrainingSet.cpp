@@ -32,11 +32,22 @@
 #include "xmmTrainingSet.hpp"
 #include <limits>
 #include <algorithm>
+#include <thread>
+#include <tuple>
+
+namespace {
+/**
+ @brief minimum number of values (frames x dimension) of a training set for
+ the parallel computation of its statistics
+ */
+const std::size_t kParallelStatisticsSize = 1 << 16;
+}
 
 xmm::TrainingSet::TrainingSet(MemoryMode memoryMode,
                               Multimodality multimodality)
     : own_memory_(memoryMode == MemoryMode::OwnMemory),
-      bimodal_(multimodality == Multimodality::Bimodal) {
+      bimodal_(multimodality == Multimodality::Bimodal),
+      statistics_valid_(false) {
     dimension.onAttributeChange(this, &xmm::TrainingSet::onAttributeChange);
     dimension_input.onAttributeChange(this,
                                       &xmm::TrainingSet::onAttributeChange);
@@ -56,7 +67,8 @@ xmm::TrainingSet::TrainingSet(TrainingSet const &src)
       own_memory_(src.own_memory_),
       bimodal_(src.bimodal_),
       labels_(src.labels_),
-      phrases_(src.phrases_) {
+      phrases_(src.phrases_),
+      statistics_valid_(false) {
     dimension.onAttributeChange(this, &xmm::TrainingSet::onAttributeChange);
     dimension_input.onAttributeChange(this,
                                       &xmm::TrainingSet::onAttributeChange);
@@ -70,8 +82,34 @@ xmm::TrainingSet::TrainingSet(TrainingSet const &src)
     update();
 }
 
+xmm::TrainingSet::TrainingSet(TrainingSet &&src)
+    : dimension(src.dimension),
+      dimension_input(src.dimension_input),
+      column_names(src.column_names),
+      own_memory_(src.own_memory_),
+      bimodal_(src.bimodal_),
+      labels_(std::move(src.labels_)),
+      phrases_(std::move(src.phrases_)),
+      sub_training_sets_(std::move(src.sub_training_sets_)),
+      phrase_labels_(std::move(src.phrase_labels_)),
+      phrase_indices_(std::move(src.phrase_indices_)),
+      statistics_(std::move(src.statistics_)),
+      statistics_valid_(src.statistics_valid_) {
+    dimension.onAttributeChange(this, &xmm::TrainingSet::onAttributeChange);
+    dimension_input.onAttributeChange(this,
+                                      &xmm::TrainingSet::onAttributeChange);
+    column_names.onAttributeChange(this, &xmm::TrainingSet::onAttributeChange);
+    for (auto &phrase : phrases_) {
+        phrase.second->events.removeListener(&src,
+                                             &xmm::TrainingSet::onPhraseEvent);
+        phrase.second->events.addListener(this,
+                                          &xmm::TrainingSet::onPhraseEvent);
+    }
+    src.clear();
+}
+
 xmm::TrainingSet::TrainingSet(Json::Value const &root)
-    : own_memory_(true), bimodal_(false) {
+    : own_memory_(true), bimodal_(false), statistics_valid_(false) {
     if (!own_memory_)
         throw std::runtime_error("Cannot read Training Set with Shared memory");
 
@@ -128,6 +166,39 @@ xmm::TrainingSet &xmm::TrainingSet::operator=(TrainingSet const &src) {
     return *this;
 }
 
+xmm::TrainingSet &xmm::TrainingSet::operator=(TrainingSet &&src) {
+    if (this != &src) {
+        for (auto &phrase : phrases_)
+            phrase.second->events.removeListener(
+                this, &xmm::TrainingSet::onPhraseEvent);
+        own_memory_ = src.own_memory_;
+        bimodal_ = src.bimodal_;
+        dimension = src.dimension;
+        dimension_input = src.dimension_input;
+        column_names = src.column_names;
+        dimension.onAttributeChange(this, &xmm::TrainingSet::onAttributeChange);
+        dimension_input.onAttributeChange(this,
+                                          &xmm::TrainingSet::onAttributeChange);
+        column_names.onAttributeChange(this,
+                                       &xmm::TrainingSet::onAttributeChange);
+        labels_ = std::move(src.labels_);
+        phrases_ = std::move(src.phrases_);
+        sub_training_sets_ = std::move(src.sub_training_sets_);
+        phrase_labels_ = std::move(src.phrase_labels_);
+        phrase_indices_ = std::move(src.phrase_indices_);
+        statistics_ = std::move(src.statistics_);
+        statistics_valid_ = src.statistics_valid_;
+        for (auto &phrase : phrases_) {
+            phrase.second->events.removeListener(
+                &src, &xmm::TrainingSet::onPhraseEvent);
+            phrase.second->events.addListener(this,
+                                              &xmm::TrainingSet::onPhraseEvent);
+        }
+        src.clear();
+    }
+    return *this;
+}
+
 xmm::TrainingSet::~TrainingSet() {}
 
 bool xmm::TrainingSet::ownMemory() const { return own_memory_; }
@@ -141,6 +212,8 @@ unsigned int xmm::TrainingSet::size() const {
 }
 
 void xmm::TrainingSet::onAttributeChange(xmm::AttributeBase *attr_pointer) {
+    if (attr_pointer == &dimension || attr_pointer == &dimension_input)
+        statistics_valid_ = false;
     if (attr_pointer == &dimension) {
         for (auto &phrase : phrases_) {
             phrase.second->dimension.set(dimension.get());
@@ -220,6 +293,7 @@ std::shared_ptr<xmm::Phrase> xmm::TrainingSet::getPhrase(int n) const {
 }
 
 void xmm::TrainingSet::addPhrase(int phraseIndex, std::string label) {
+    detachPhrase(phraseIndex);
     phrases_[phraseIndex] = std::make_shared<Phrase>(
         own_memory_ ? MemoryMode::OwnMemory : MemoryMode::SharedMemory,
         bimodal_ ? Multimodality::Bimodal : Multimodality::Unimodal);
@@ -229,49 +303,53 @@ void xmm::TrainingSet::addPhrase(int phraseIndex, std::string label) {
     phrases_[phraseIndex]->dimension_input.set(dimension_input.get());
     phrases_[phraseIndex]->column_names = this->column_names.get();
     phrases_[phraseIndex]->label.set(label, true);
-    update();
+    indexPhrase(phraseIndex);
+    statistics_valid_ = false;
 }
 
 void xmm::TrainingSet::addPhrase(int phraseIndex, Phrase const &phrase) {
+    detachPhrase(phraseIndex);
     phrases_[phraseIndex] = std::make_shared<Phrase>(phrase);
     phrases_[phraseIndex]->events.removeListeners();
     phrases_[phraseIndex]->events.addListener(this,
                                               &xmm::TrainingSet::onPhraseEvent);
-    update();
+    indexPhrase(phraseIndex);
+    statistics_valid_ = false;
 }
 
 void xmm::TrainingSet::addPhrase(int phraseIndex,
                                  std::shared_ptr<Phrase> phrase) {
+    detachPhrase(phraseIndex);
     phrases_[phraseIndex] = phrase;
     phrases_[phraseIndex]->events.addListener(this,
                                               &xmm::TrainingSet::onPhraseEvent);
-    update();
+    indexPhrase(phraseIndex);
+    statistics_valid_ = false;
 }
 
 void xmm::TrainingSet::removePhrase(int phraseIndex) {
+    detachPhrase(phraseIndex);
     phrases_.erase(phraseIndex);
-    update();
+    statistics_valid_ = false;
 }
 
 void xmm::TrainingSet::removePhrasesOfClass(std::string const &label) {
-    bool contLoop(true);
-    while (contLoop) {
-        contLoop = false;
-        for (auto &phrase : phrases_) {
-            if (phrase.second->label.get() == label) {
-                removePhrase(phrase.first);
-                contLoop = true;
-                break;
-            }
-        }
-    }
-    update();
+    std::map<std::string, TrainingSet>::iterator it =
+        sub_training_sets_.find(label);
+    if (it == sub_training_sets_.end()) return;
+    std::vector<int> phrase_indices;
+    for (auto &phrase : it->second.phrases_)
+        phrase_indices.push_back(phrase.first);
+    for (int phrase_index : phrase_indices) removePhrase(phrase_index);
 }
 
 void xmm::TrainingSet::clear() {
     sub_training_sets_.clear();
     phrases_.clear();
     labels_.clear();
+    phrase_labels_.clear();
+    phrase_indices_.clear();
+    statistics_valid_ = false;
 }
 
 xmm::TrainingSet *xmm::TrainingSet::getPhrasesOfClass(
@@ -284,111 +362,253 @@ xmm::TrainingSet *xmm::TrainingSet::getPhrasesOfClass(
 
 void xmm::TrainingSet::onPhraseEvent(PhraseEvent const &e) {
     if (e.type == PhraseEvent::Type::LabelChanged) {
-        update();
+        std::vector<int> phrase_indices;
+        auto range = phrase_indices_.equal_range(e.phrase);
+        for (auto it = range.first; it != range.second; ++it)
+            phrase_indices.push_back(it->second);
+        for (int phrase_index : phrase_indices) {
+            if (phrase_labels_[phrase_index] == e.phrase->label.get()) continue;
+            unindexPhrase(phrase_index);
+            indexPhrase(phrase_index);
+        }
+    }
+    if (e.type == PhraseEvent::Type::DataChanged) {
+        statistics_valid_ = false;
+        auto range = phrase_indices_.equal_range(e.phrase);
+        for (auto it = range.first; it != range.second; ++it)
+            sub_training_sets_[phrase_labels_[it->second]].statistics_valid_ =
+                false;
     }
 }
 
 void xmm::TrainingSet::update() {
+    statistics_valid_ = false;
     labels_.clear();
+    sub_training_sets_.clear();
+    phrase_labels_.clear();
+    phrase_indices_.clear();
     for (auto &phrase : phrases_) {
-        labels_.insert(phrase.second->label.get());
+        indexPhrase(phrase.first);
     }
-    sub_training_sets_.clear();
-    for (std::string label : labels_) {
-        sub_training_sets_.insert(std::pair<std::string, TrainingSet>(
-            label,
-            {own_memory_ ? MemoryMode::OwnMemory : MemoryMode::SharedMemory,
-             bimodal_ ? Multimodality::Bimodal : Multimodality::Unimodal}));
-        sub_training_sets_[label].dimension.set(dimension.get());
-        sub_training_sets_[label].dimension_input.set(dimension_input.get());
-        sub_training_sets_[label].column_names = this->column_names;
-        // int newPhraseIndex(0);
-        for (auto &phrase : phrases_) {
-            if (phrase.second->label.get() == label) {
-                sub_training_sets_[label].phrases_[phrase.first] =
-                    this->phrases_[phrase.first];
-                //                newPhraseIndex++;
-            }
+}
+
+void xmm::TrainingSet::indexPhrase(int phraseIndex) {
+    std::shared_ptr<Phrase> const &phrase = phrases_[phraseIndex];
+    std::string const &label = phrase->label.get();
+    std::map<std::string, TrainingSet>::iterator it =
+        sub_training_sets_.find(label);
+    if (it == sub_training_sets_.end()) {
+        it = sub_training_sets_
+                 .emplace(std::piecewise_construct,
+                          std::forward_as_tuple(label),
+                          std::forward_as_tuple(
+                              own_memory_ ? MemoryMode::OwnMemory
+                                          : MemoryMode::SharedMemory,
+                              bimodal_ ? Multimodality::Bimodal
+                                       : Multimodality::Unimodal))
+                 .first;
+        it->second.dimension.set(dimension.get());
+        it->second.dimension_input.set(dimension_input.get());
+        it->second.column_names = this->column_names;
+        labels_.insert(label);
+    }
+    it->second.phrases_[phraseIndex] = phrase;
+    it->second.statistics_valid_ = false;
+    phrase_labels_[phraseIndex] = label;
+    phrase_indices_.insert(
+        std::pair<Phrase const *, int>(phrase.get(), phraseIndex));
+}
+
+void xmm::TrainingSet::unindexPhrase(int phraseIndex) {
+    std::map<int, std::string>::iterator label_it =
+        phrase_labels_.find(phraseIndex);
+    if (label_it == phrase_labels_.end()) return;
+    std::map<std::string, TrainingSet>::iterator it =
+        sub_training_sets_.find(label_it->second);
+    it->second.phrases_.erase(phraseIndex);
+    it->second.statistics_valid_ = false;
+    if (it->second.phrases_.empty()) {
+        labels_.erase(label_it->second);
+        sub_training_sets_.erase(it);
+    }
+    phrase_labels_.erase(label_it);
+
+    Phrase const *phrase = phrases_[phraseIndex].get();
+    auto range = phrase_indices_.equal_range(phrase);
+    for (auto index_it = range.first; index_it != range.second; ++index_it) {
+        if (index_it->second == phraseIndex) {
+            phrase_indices_.erase(index_it);
+            break;
         }
     }
 }
 
-std::vector<float> xmm::TrainingSet::mean() const {
-    std::vector<float> mean(dimension.get(), 0.0);
-    unsigned int total_length(0);
-    for (auto &phrase : phrases_) {
-        for (unsigned int d = 0; d < dimension.get(); d++) {
-            for (unsigned int t = 0; t < phrase.second->size(); t++) {
-                mean[d] += phrase.second->getValue(t, d);
-            }
+void xmm::TrainingSet::detachPhrase(int phraseIndex) {
+    std::map<int, std::shared_ptr<Phrase>>::iterator it =
+        phrases_.find(phraseIndex);
+    if (it == phrases_.end()) return;
+    unindexPhrase(phraseIndex);
+    // a phrase that is not referenced anymore stops notifying this set
+    if (phrase_indices_.count(it->second.get()) == 0)
+        it->second->events.removeListener(this,
+                                          &xmm::TrainingSet::onPhraseEvent);
+}
+
+xmm::TrainingSet::Statistics::Statistics(unsigned int dimension)
+    : length(0),
+      mean(dimension, 0.0),
+      sum_squared_deviations(dimension, 0.0),
+      minimum(dimension, std::numeric_limits<float>::max()),
+      maximum(dimension, std::numeric_limits<float>::lowest()) {}
+
+void xmm::TrainingSet::Statistics::accumulate(Phrase const &phrase) {
+    Phrase::FrameView frames = phrase.frames();
+    unsigned int dimension = static_cast<unsigned int>(mean.size());
+    std::vector<float> frame_buffer(dimension);
+    double *mean_ = mean.data();
+    double *deviations = sum_squared_deviations.data();
+    for (unsigned int t = 0; t < frames.size(); t++) {
+        const float *frame = frames.frame(t, frame_buffer.data());
+        length++;
+        double weight = 1. / double(length);
+        for (unsigned int d = 0; d < dimension; d++) {
+            double delta = frame[d] - mean_[d];
+            mean_[d] += delta * weight;
+            deviations[d] += delta * (frame[d] - mean_[d]);
         }
-        total_length += phrase.second->size();
     }
 
-    for (unsigned int d = 0; d < dimension.get(); d++)
-        mean[d] /= float(total_length);
+    // the minimum and maximum of each modality cover all its frames
+    unsigned int dimension_input = frames.dimension_input();
+    unsigned int input_length =
+        phrase.bimodal() ? phrase.inputSize() : frames.size();
+    for (unsigned int t = 0; t < input_length; t++) {
+        const float *row = frames.input(t);
+        for (unsigned int d = 0; d < dimension_input; d++) {
+            minimum[d] = std::min(row[d], minimum[d]);
+            maximum[d] = std::max(row[d], maximum[d]);
+        }
+    }
+    if (!phrase.bimodal()) return;
+    float *output_minimum = minimum.data() + dimension_input;
+    float *output_maximum = maximum.data() + dimension_input;
+    for (unsigned int t = 0; t < phrase.outputSize(); t++) {
+        const float *row = frames.output(t);
+        for (unsigned int d = 0; d < frames.dimension_output(); d++) {
+            output_minimum[d] = std::min(row[d], output_minimum[d]);
+            output_maximum[d] = std::max(row[d], output_maximum[d]);
+        }
+    }
+}
 
-    return mean;
+void xmm::TrainingSet::Statistics::merge(Statistics const &other) {
+    for (std::size_t d = 0; d < mean.size(); d++) {
+        minimum[d] = std::min(other.minimum[d], minimum[d]);
+        maximum[d] = std::max(other.maximum[d], maximum[d]);
+    }
+    if (other.length == 0) return;
+    if (length == 0) {
+        length = other.length;
+        mean = other.mean;
+        sum_squared_deviations = other.sum_squared_deviations;
+        return;
+    }
+    double total = double(length) + double(other.length);
+    double weight = double(other.length) / total;
+    double cross = double(length) * double(other.length) / total;
+    for (std::size_t d = 0; d < mean.size(); d++) {
+        double delta = other.mean[d] - mean[d];
+        mean[d] += delta * weight;
+        sum_squared_deviations[d] +=
+            other.sum_squared_deviations[d] + delta * delta * cross;
+    }
+    length += other.length;
 }
 
-std::vector<float> xmm::TrainingSet::standardDeviation() const {
-    std::vector<float> stddev(dimension.get());
-    std::vector<float> _mean = mean();
-    unsigned int total_length(0);
+xmm::TrainingSet::Statistics const &xmm::TrainingSet::statistics() const {
+    if (!statistics_valid_) computeStatistics();
+    return statistics_;
+}
+
+void xmm::TrainingSet::computeStatistics() const {
+    std::vector<Phrase const *> phrases;
+    phrases.reserve(phrases_.size());
+    std::size_t total_size(0);
     for (auto &phrase : phrases_) {
-        for (unsigned int d = 0; d < dimension.get(); d++) {
-            for (unsigned int t = 0; t < phrase.second->size(); t++) {
-                stddev[d] += (phrase.second->getValue(t, d) - _mean[d]) *
-                             (phrase.second->getValue(t, d) - _mean[d]);
-            }
-        }
-        total_length += phrase.second->size();
+        phrases.push_back(phrase.second.get());
+        total_size += std::size_t(phrase.second->size()) * dimension.get();
     }
 
-    for (unsigned int d = 0; d < dimension.get(); d++) {
-        stddev[d] /= float(total_length);
-        stddev[d] = sqrtf(stddev[d]);
+    // statistics of each phrase
+    std::vector<Statistics> phrase_statistics(phrases.size(),
+                                              Statistics(dimension.get()));
+    unsigned int num_threads =
+        std::min(std::max(std::thread::hardware_concurrency(), 1u),
+                 static_cast<unsigned int>(phrases.size()));
+    if (total_size < kParallelStatisticsSize) num_threads = 1;
+    auto accumulate = [&](unsigned int thread_index) {
+        for (std::size_t i = thread_index; i < phrases.size();
+             i += num_threads)
+            phrase_statistics[i].accumulate(*phrases[i]);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int thread_index = 1; thread_index < num_threads;
+         thread_index++)
+        threads.push_back(std::thread(accumulate, thread_index));
+    if (num_threads > 0) accumulate(0);
+    for (auto &thread : threads) thread.join();
+
+    // combination in the order of the phrases (independent of the threads)
+    statistics_ = Statistics(dimension.get());
+    for (auto &partial : phrase_statistics) statistics_.merge(partial);
+    statistics_valid_ = true;
+
+    if (sub_training_sets_.empty()) return;
+    std::map<std::string, Statistics> class_statistics;
+    std::size_t i(0);
+    for (auto &phrase : phrases_) {
+        std::map<std::string, Statistics>::iterator it =
+            class_statistics
+                .insert(std::pair<std::string, Statistics>(
+                    phrase.second->label.get(), Statistics(dimension.get())))
+                .first;
+        it->second.merge(phrase_statistics[i++]);
     }
+    for (auto &subset : sub_training_sets_) {
+        if (subset.second.statistics_valid_ ||
+            class_statistics.count(subset.first) == 0)
+            continue;
+        subset.second.statistics_ = class_statistics[subset.first];
+        subset.second.statistics_valid_ = true;
+    }
+}
+
+std::vector<float> xmm::TrainingSet::mean() const {
+    Statistics const &stats = statistics();
+    std::vector<float> mean(dimension.get());
+    for (unsigned int d = 0; d < dimension.get(); d++)
+        mean[d] = (stats.length > 0)
+                      ? float(stats.mean[d])
+                      : std::numeric_limits<float>::quiet_NaN();
+    return mean;
+}
 
+std::vector<float> xmm::TrainingSet::standardDeviation() const {
+    Statistics const &stats = statistics();
+    std::vector<float> stddev(dimension.get());
+    for (unsigned int d = 0; d < dimension.get(); d++)
+        stddev[d] = (stats.length > 0)
+                        ? float(sqrt(stats.sum_squared_deviations[d] /
+                                     double(stats.length)))
+                        : std::numeric_limits<float>::quiet_NaN();
     return stddev;
 }
 
 std::vector<std::pair<float, float>> xmm::TrainingSet::minmax() const {
-    std::vector<std::pair<float, float>> minmax(
-        dimension.get(), {std::numeric_limits<float>::max(),
-                          std::numeric_limits<float>::lowest()});
-    if (bimodal_) {
-        for (auto &phrase : phrases_) {
-            for (unsigned int d = 0; d < dimension_input.get(); d++) {
-                for (unsigned int t = 0; t < phrase.second->inputSize(); t++) {
-                    minmax[d].first = std::min(phrase.second->getValue(t, d),
-                                               minmax[d].first);
-                    minmax[d].second = std::max(phrase.second->getValue(t, d),
-                                                minmax[d].second);
-                }
-            }
-            for (unsigned int d = dimension_input.get(); d < dimension.get();
-                 d++) {
-                for (unsigned int t = 0; t < phrase.second->outputSize(); t++) {
-                    minmax[d].first = std::min(phrase.second->getValue(t, d),
-                                               minmax[d].first);
-                    minmax[d].second = std::max(phrase.second->getValue(t, d),
-                                                minmax[d].second);
-                }
-            }
-        }
-    } else {
-        for (auto &phrase : phrases_) {
-            for (unsigned int d = 0; d < dimension.get(); d++) {
-                for (unsigned int t = 0; t < phrase.second->size(); t++) {
-                    minmax[d].first = std::min(phrase.second->getValue(t, d),
-                                               minmax[d].first);
-                    minmax[d].second = std::max(phrase.second->getValue(t, d),
-                                                minmax[d].second);
-                }
-            }
-        }
-    }
+    Statistics const &stats = statistics();
+    std::vector<std::pair<float, float>> minmax(dimension.get());
+    for (unsigned int d = 0; d < dimension.get(); d++)
+        minmax[d] = std::make_pair(stats.minimum[d], stats.maximum[d]);
     return minmax;
 }
 
@@ -429,8 +649,81 @@ Json::Value xmm::TrainingSet::toJson() const {
 void xmm::TrainingSet::fromJson(Json::Value const &root) {
     try {
         TrainingSet tmp(root);
-        *this = tmp;
+        *this = std::move(tmp);
     } catch (JsonException &e) {
         throw e;
     }
 }
+
+void xmm::TrainingSet::writeJson(std::ostream &stream) const {
+    JsonStreamWriter writer(stream);
+    writer.beginObject();
+    writer.key("bimodal");
+    writer.value(bimodal_);
+    writer.key("dimension");
+    writer.value(dimension.get());
+    writer.key("dimension_input");
+    writer.value(dimension_input.get());
+    writer.key("column_names");
+    writer.array(column_names.get());
+    writer.key("phrases");
+    writer.beginArray();
+    for (auto &phrase : phrases_) {
+        writer.beginObject();
+        writer.key("index");
+        writer.value(phrase.first);
+        phrase.second->writeJsonMembers(writer);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+}
+
+void xmm::TrainingSet::readJson(std::istream &stream) {
+    JsonStreamReader reader(stream);
+    bool bimodal(false);
+    int dim(-1), dim_input(-1);
+    std::vector<std::string> names;
+    std::map<int, std::shared_ptr<Phrase>> phrases;
+    std::string name;
+    reader.beginObject();
+    while (reader.nextMember(name)) {
+        if (name == "bimodal") {
+            bimodal = reader.readBool();
+        } else if (name == "dimension") {
+            dim = reader.readInt();
+        } else if (name == "dimension_input") {
+            dim_input = reader.readInt();
+        } else if (name == "column_names") {
+            reader.readArray(names);
+        } else if (name == "phrases") {
+            reader.beginArray();
+            while (reader.nextElement()) {
+                int index(0);
+                auto phrase = std::make_shared<Phrase>();
+                phrase->readJson(reader, [&](std::string const &member) {
+                    if (member != "index") return false;
+                    index = reader.readInt();
+                    return true;
+                });
+                phrases.insert(std::make_pair(index, phrase));
+            }
+        } else {
+            reader.skipValue();
+        }
+    }
+    reader.checkEnd();
+
+    TrainingSet tmp(MemoryMode::OwnMemory,
+                    bimodal ? Multimodality::Bimodal : Multimodality::Unimodal);
+    tmp.dimension.set((dim < 0) ? (bimodal ? 2 : 1) : dim);
+    tmp.dimension_input.set((dim_input < 0) ? (bimodal ? 1 : 0) : dim_input);
+    names.resize(tmp.dimension.get());
+    tmp.column_names.set(names);
+    tmp.phrases_ = std::move(phrases);
+    for (auto &phrase : tmp.phrases_)
+        phrase.second->events.addListener(&tmp,
+                                          &xmm::TrainingSet::onPhraseEvent);
+    tmp.update();
+    *this = std::move(tmp);
+}
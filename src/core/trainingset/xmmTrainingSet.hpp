@@ -46,6 +46,60 @@ namespace xmm {
  */
 class TrainingSet : public Writable {
   public:
+    /**
+     @brief Summary statistics of the frames of a training set
+     @details The mean and variance are accumulated with Welford's algorithm
+     within a phrase, and the statistics of several phrases are combined with
+     the pairwise update of Chan et al. The mean and variance are computed over
+     the synchronized frames of the phrases (minimal length of the
+     modalities). The minimum and maximum of each modality are computed over
+     all recorded frames of the modality.
+     */
+    struct Statistics {
+        /**
+         @brief Constructor
+         @param dimension total dimension of the frames
+         */
+        explicit Statistics(unsigned int dimension = 0);
+
+        /**
+         @brief Accumulates the frames of a phrase
+         @param phrase source phrase
+         */
+        void accumulate(Phrase const& phrase);
+
+        /**
+         @brief Combines with the statistics of another set of frames
+         @param other statistics of the other set of frames
+         */
+        void merge(Statistics const& other);
+
+        /**
+         @brief number of frames used for the mean and variance
+         */
+        unsigned int length;
+
+        /**
+         @brief mean of each dimension
+         */
+        std::vector<double> mean;
+
+        /**
+         @brief sum of squared deviations from the mean of each dimension
+         */
+        std::vector<double> sum_squared_deviations;
+
+        /**
+         @brief minimum of each dimension
+         */
+        std::vector<float> minimum;
+
+        /**
+         @brief maximum of each dimension
+         */
+        std::vector<float> maximum;
+    };
+
     /**
      @brief Constructor
      @param memoryMode Memory mode (owned vs shared)
@@ -60,6 +114,15 @@ class TrainingSet : public Writable {
      */
     TrainingSet(TrainingSet const& src);
 
+    /**
+     @brief Move Constructor
+     @details the phrases and the class index are taken from the source
+     Training Set, which is left empty. The phrases notify the new Training Set
+     of their changes.
+     @param src source Training Set
+     */
+    TrainingSet(TrainingSet&& src);
+
     /**
      @brief Constructor from Json Structure
      @param root Json Value
@@ -72,6 +135,14 @@ class TrainingSet : public Writable {
      */
     TrainingSet& operator=(TrainingSet const& src);
 
+    /**
+     @brief Move Assignment Operator
+     @details the phrases and the class index are taken from the source
+     Training Set, which is left empty.
+     @param src source Training Set
+     */
+    TrainingSet& operator=(TrainingSet&& src);
+
     /**
      @brief Destructor
      @warning phrases are only deleted if the training set is unlocked
@@ -212,6 +283,9 @@ class TrainingSet : public Writable {
     /**
      @brief get the pointer to the sub-training set containing all phrases with
      a given label
+     @details the sub-training sets are maintained incrementally: the pointer
+     remains valid until the last phrase with the given label is removed or
+     relabeled.
      @warning in order to protect the phrases in the current training set, the
      sub-training set returned is locked
      @param label target label
@@ -252,11 +326,44 @@ class TrainingSet : public Writable {
      */
     void fromJson(Json::Value const& root);
 
+    /**
+     @brief Write the training set to a stream in JSON format
+     @details the phrases are written incrementally, without building the
+     Json::Value of the training set. The document has the same schema as
+     toJson().
+     @param stream output stream
+     @throws runtime_error if the stream cannot be written
+     */
+    void writeJson(std::ostream& stream) const;
+
+    /**
+     @brief Read the training set from a stream in JSON format
+     @details the phrases are built as their data arrays are parsed, without
+     building the Json::Value of the training set.
+     @param stream input stream
+     @throws runtime_error if the document cannot be parsed
+     @throws JsonException if the JSON value has a wrong format
+     */
+    void readJson(std::istream& stream);
+
     ///@}
 
     /** @name Utilities */
     ///@{
 
+    /**
+     @brief Get the summary statistics of all data phrases
+     @details The statistics are computed in a single pass over the phrases,
+     in parallel for large training sets, and cached until a phrase is
+     recorded, cleared, rescaled, added, removed or relabeled. The pass also
+     fills the caches of the sub-training sets of each label. The data of the
+     phrases must not be modified through the pointers returned by
+     Phrase::getPointer(), and shared phrases must be reconnected when their
+     data changes.
+     @return reference to the cached statistics
+     */
+    Statistics const& statistics() const;
+
     /**
      @brief Compute the global mean of all data phrases along the time axis
      @return global mean of all phrases (along time axis, full-size)
@@ -321,10 +428,43 @@ class TrainingSet : public Writable {
 
     /**
      @brief create all the sub-training sets: one for each label
-     @details each subset contains only the phrase for the given label
+     @details each subset contains only the phrase for the given label. The
+     label index is rebuilt from scratch: this is only used when all phrases
+     are replaced (copy, JSON). Other modifications update the index
+     incrementally with indexPhrase() and unindexPhrase().
      */
     virtual void update();
 
+    /**
+     @brief adds a phrase to the label index and to the sub-training set of its
+     label
+     @param phraseIndex index of the phrase
+     */
+    void indexPhrase(int phraseIndex);
+
+    /**
+     @brief removes a phrase from the label index and from the sub-training set
+     of the label it was indexed with
+     @details the sub-training set is deleted if it becomes empty
+     @param phraseIndex index of the phrase
+     */
+    void unindexPhrase(int phraseIndex);
+
+    /**
+     @brief computes the statistics of the training set and of its
+     sub-training sets in a single pass over the phrases
+     */
+    void computeStatistics() const;
+
+    /**
+     @brief removes a phrase from the label index before it is replaced or
+     removed from the training set
+     @details the training set stops listening to the phrase if it is not
+     referenced at another index
+     @param phraseIndex index of the phrase
+     */
+    void detachPhrase(int phraseIndex);
+
     /**
      @brief defines if the phrase has its own memory
      */
@@ -351,6 +491,29 @@ class TrainingSet : public Writable {
      @brief Sub-ensembles of the training set for specific classes
      */
     std::map<std::string, TrainingSet> sub_training_sets_;
+
+    /**
+     @brief Label with which each phrase is indexed in the sub-training sets
+     @details a phrase notifies its new label only: the previous label is
+     needed to move the phrase between sub-training sets.
+     */
+    std::map<int, std::string> phrase_labels_;
+
+    /**
+     @brief Indices of each phrase in the training set (a shared phrase can be
+     added at several indices)
+     */
+    std::multimap<Phrase const*, int> phrase_indices_;
+
+    /**
+     @brief Cached summary statistics
+     */
+    mutable Statistics statistics_;
+
+    /**
+     @brief Defines if the cached statistics are up to date
+     */
+    mutable bool statistics_valid_;
 };
 }
 
@@ -36,15 +36,22 @@
 
 xmm::GMM::GMM(bool bimodal) : Model<SingleClassGMM, GMM>(bimodal) {}
 
-xmm::GMM::GMM(GMM const& src)
-    : Model<SingleClassGMM, GMM>(src), results(src.results) {}
+xmm::GMM::GMM(GMM const& src) : Model<SingleClassGMM, GMM>(src) {}
+
+xmm::GMM::GMM(GMM&& src) : Model<SingleClassGMM, GMM>(std::move(src)) {}
 
 xmm::GMM::GMM(Json::Value const& root) : Model<SingleClassGMM, GMM>(root) {}
 
 xmm::GMM& xmm::GMM::operator=(GMM const& src) {
     if (this != &src) {
         Model<SingleClassGMM, GMM>::operator=(src);
-        results = src.results;
+    }
+    return *this;
+}
+
+xmm::GMM& xmm::GMM::operator=(GMM&& src) {
+    if (this != &src) {
+        Model<SingleClassGMM, GMM>::operator=(std::move(src));
     }
     return *this;
 }
@@ -53,10 +60,16 @@ void xmm::GMM::updateResults() {
     double maxLogLikelihood = 0.0;
     double normconst_instant(0.0);
     double normconst_smoothed(0.0);
-    int i(0);
-    for (auto it = this->models.begin(); it != this->models.end(); ++it, ++i) {
-        results.instant_likelihoods[i] = it->second.results.instant_likelihood;
-        results.smoothed_log_likelihoods[i] = it->second.results.log_likelihood;
+    unsigned int likeliest_index(0);
+    unsigned int num_classes = size();
+    // suspended classes that were not evaluated on this frame have a zero
+    // mass: their smoothed likelihood is left over from their last evaluation
+    bool all_evaluated = results.evaluated_classes.empty();
+    unsigned int next_evaluated(0);
+    bool found_likeliest(false);
+    for (unsigned int i = 0; i < num_classes; ++i) {
+        results.instant_likelihoods[i] = models[i].results.instant_likelihood;
+        results.smoothed_log_likelihoods[i] = models[i].results.log_likelihood;
         results.smoothed_likelihoods[i] =
             exp(results.smoothed_log_likelihoods[i]);
 
@@ -64,18 +77,34 @@ void xmm::GMM::updateResults() {
             results.instant_likelihoods[i];
         results.smoothed_normalized_likelihoods[i] =
             results.smoothed_likelihoods[i];
+        if (!all_evaluated) {
+            if (next_evaluated < results.evaluated_classes.size() &&
+                results.evaluated_classes[next_evaluated] == i) {
+                next_evaluated++;
+            } else {
+                results.smoothed_normalized_likelihoods[i] = 0.0;
+                continue;
+            }
+        }
 
         normconst_instant += results.instant_normalized_likelihoods[i];
         normconst_smoothed += results.smoothed_normalized_likelihoods[i];
 
-        if (i == 0 || results.smoothed_log_likelihoods[i] > maxLogLikelihood) {
+        if (!found_likeliest ||
+            results.smoothed_log_likelihoods[i] > maxLogLikelihood) {
             maxLogLikelihood = results.smoothed_log_likelihoods[i];
-            results.likeliest = it->first;
+            likeliest_index = i;
+            found_likeliest = true;
         }
     }
+    // the label is only copied when the likeliest class changes
+    if (likeliest_index != results.likeliest_index ||
+        results.likeliest.empty()) {
+        results.likeliest_index = likeliest_index;
+        results.likeliest = models[likeliest_index].label;
+    }
 
-    i = 0;
-    for (auto it = this->models.begin(); it != this->models.end(); ++it, ++i) {
+    for (unsigned int i = 0; i < num_classes; ++i) {
         results.instant_normalized_likelihoods[i] /= normconst_instant;
         results.smoothed_normalized_likelihoods[i] /= normconst_smoothed;
     }
@@ -100,32 +129,95 @@ void xmm::GMM::reset() {
                 : dimension_output,
             0.0);
     }
+    results.evaluated_classes.reserve(size());
+    results.likeliest.clear();
+    results.likeliest_index = 0;
+    // the likeliest label is then copied without allocation
+    std::size_t label_length(0);
+    for (auto& model : models)
+        label_length = std::max(label_length, model.label.size());
+    results.likeliest.reserve(label_length);
+    Model<SingleClassGMM, GMM>::reset();
+    unsigned int work(0);
     for (auto& model : models) {
-        model.second.reset();
+        work += model.parameters.gaussians.get() *
+                shared_parameters->dimension.get();
     }
+    updateFilteringPool(work);
 }
 
-void xmm::GMM::filter(std::vector<float> const& observation) {
+void xmm::GMM::freeze() {
     checkTraining();
-    int i(0);
+    unfreeze();
     for (auto& model : models) {
-        results.instant_likelihoods[i] = model.second.filter(observation);
-        i++;
+        frozen_.addGroup();
+        frozen_.addMixture(model.mixture_coeffs, model.components);
+    }
+    frozen_.compile(shared_parameters->bimodal.get());
+}
+
+double xmm::GMM::filterClass(unsigned int class_index,
+                             std::vector<float> const& observation) {
+    SingleClassGMM& model = models[class_index];
+    if (frozen_.empty()) return model.filterLikelihood(observation);
+    double likelihood =
+        frozen_.evaluate(class_index, &observation[0], &model.beta[0])[0];
+    for (auto& posterior : model.beta) posterior /= likelihood;
+    model.results.instant_likelihood = likelihood;
+    model.updateResults();
+    return likelihood;
+}
+
+void xmm::GMM::filter(std::vector<float> const& observation) {
+    checkTraining();
+    results.evaluated_classes.clear();
+    if (filtering_pool_) {
+        filtering_pool_->run(size(), [this, &observation](unsigned int begin,
+                                                          unsigned int end) {
+            for (unsigned int i = begin; i < end; i++) {
+                if (isClassEvaluated(i))
+                    results.instant_likelihoods[i] =
+                        filterClass(i, observation);
+                else
+                    models[i].results.instant_likelihood = 0.0;
+            }
+        });
+        for (unsigned int i = 0; i < size(); i++) {
+            if (isClassEvaluated(i)) results.evaluated_classes.push_back(i);
+        }
+    } else {
+        for (unsigned int i = 0; i < size(); i++) {
+            if (isClassEvaluated(i)) {
+                results.instant_likelihoods[i] = filterClass(i, observation);
+                results.evaluated_classes.push_back(i);
+            } else {
+                models[i].results.instant_likelihood = 0.0;
+            }
+        }
     }
 
     updateResults();
+    updateClassActivity(results.instant_normalized_likelihoods,
+                        results.evaluated_classes);
 
     if (shared_parameters->bimodal.get()) {
         unsigned int dimension = shared_parameters->dimension.get();
         unsigned int dimension_input = shared_parameters->dimension_input.get();
         unsigned int dimension_output = dimension - dimension_input;
 
+        updateRegressionClasses(results.likeliest_index,
+                                results.smoothed_normalized_likelihoods,
+                                results.evaluated_classes);
+        for (auto class_index : regression_classes_) {
+            models[class_index].regression(observation);
+        }
+
         if (configuration.multiClass_regression_estimator ==
             MultiClassRegressionEstimator::Likeliest) {
             results.output_values =
-                models[results.likeliest].results.output_values;
+                models[results.likeliest_index].results.output_values;
             results.output_covariance =
-                models[results.likeliest].results.output_covariance;
+                models[results.likeliest_index].results.output_covariance;
 
         } else {
             results.output_values.assign(dimension_output, 0.0);
@@ -136,28 +228,28 @@ void xmm::GMM::filter(std::vector<float> const& observation) {
                     : dimension_output,
                 0.0);
 
-            int i(0);
-            for (auto& model : models) {
+            for (auto class_index : regression_classes_) {
+                SingleClassGMM const& model = models[class_index];
+                double weight =
+                    results.smoothed_normalized_likelihoods[class_index] /
+                    regression_mass_;
                 for (int d = 0; d < dimension_output; d++) {
                     results.output_values[d] +=
-                        results.smoothed_normalized_likelihoods[i] *
-                        model.second.results.output_values[d];
+                        weight * model.results.output_values[d];
                     if ((configuration.covariance_mode.get() ==
                          GaussianDistribution::CovarianceMode::Full)) {
                         for (int d2 = 0; d2 < dimension_output; d2++)
                             results
                                 .output_covariance[d * dimension_output + d2] +=
-                                results.smoothed_normalized_likelihoods[i] *
-                                model.second.results
+                                weight *
+                                model.results
                                     .output_covariance[d * dimension_output +
                                                        d2];
                     } else {
                         results.output_covariance[d] +=
-                            results.smoothed_normalized_likelihoods[i] *
-                            model.second.results.output_covariance[d];
+                            weight * model.results.output_covariance[d];
                     }
                 }
-                i++;
             }
         }
     }
@@ -58,6 +58,12 @@ class GMM : public Model<SingleClassGMM, GMM> {
      */
     GMM(GMM const& src);
 
+    /**
+     @brief Move Constructor
+     @param src Source Model
+     */
+    GMM(GMM&& src);
+
     /**
      @brief Constructor from Json Structure
      @param root Json Value
@@ -70,6 +76,12 @@ class GMM : public Model<SingleClassGMM, GMM> {
      */
     GMM& operator=(GMM const& src);
 
+    /**
+     @brief Move Assignment
+     @param src Source Model
+     */
+    GMM& operator=(GMM&& src);
+
     /** @name Performance */
     ///@{
 
@@ -86,6 +98,17 @@ class GMM : public Model<SingleClassGMM, GMM> {
      */
     virtual void filter(std::vector<float> const& observation);
 
+    /**
+     @brief Compiles the trained classes into a flat representation for
+     low-latency filtering
+     @details the means, inverse covariances, log-normalizers and log-weights
+     of all components are copied into a single aligned arena, that is the only
+     source of the likelihoods computed by filter(). The model stays frozen
+     until its classes are trained or removed, or until unfreeze() is called.
+     @throws runtime_error if the model is training
+     */
+    void freeze();
+
     ///@}
 
     //
@@ -142,16 +165,26 @@ class GMM : public Model<SingleClassGMM, GMM> {
     //         */
     //        GMM extract_inverse_model() const;
 
+  protected:
     /**
-     @brief Results of the Filtering Process (Recognition + Regression)
+     @brief Type of the model in the header of the binary model files
      */
-    Results<GMM> results;
+    virtual unsigned int binaryType() const { return 1; }
 
-  protected:
     /**
      @brief Update the results (Likelihoods)
      */
     virtual void updateResults();
+
+    /**
+     @brief Computes the likelihood of a class, from the frozen representation
+     if any
+     @param class_index index of the class
+     @param observation observation vector
+     @return instantaneous likelihood of the class
+     */
+    double filterClass(unsigned int class_index,
+                       std::vector<float> const& observation);
 };
 }
 
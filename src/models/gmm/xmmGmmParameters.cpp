@@ -125,6 +125,21 @@ void xmm::ClassParameters<xmm::GMM>::fromJson(Json::Value const& root) {
     }
 }
 
+void xmm::ClassParameters<xmm::GMM>::writeBinary(BinaryWriter& writer) const {
+    writer.writeUInt(gaussians.get());
+    writer.writeDouble(relative_regularization.get());
+    writer.writeDouble(absolute_regularization.get());
+    writer.writeUInt(static_cast<unsigned int>(covariance_mode.get()));
+}
+
+void xmm::ClassParameters<xmm::GMM>::readBinary(BinaryReader& reader) {
+    gaussians.set(reader.readUInt());
+    relative_regularization.set(reader.readDouble());
+    absolute_regularization.set(reader.readDouble());
+    covariance_mode.set(
+        static_cast<GaussianDistribution::CovarianceMode>(reader.readUInt()));
+}
+
 void xmm::ClassParameters<xmm::GMM>::onAttributeChange(
     AttributeBase* attr_pointer) {
     changed = true;
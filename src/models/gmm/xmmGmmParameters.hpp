@@ -94,6 +94,24 @@ class ClassParameters<GMM> : public Writable {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readBinary(BinaryReader& reader);
+
+    ///@}
+
     /**
      @brief specifies if parameters have changed (model is invalid)
      */
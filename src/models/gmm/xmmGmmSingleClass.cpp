@@ -45,6 +45,14 @@ xmm::SingleClassGMM::SingleClassGMM(SingleClassGMM const& src)
     beta.resize(parameters.gaussians.get());
 }
 
+xmm::SingleClassGMM::SingleClassGMM(SingleClassGMM&& src)
+    : SingleClassProbabilisticModel(src),
+      parameters(src.parameters),
+      components(std::move(src.components)),
+      mixture_coeffs(std::move(src.mixture_coeffs)) {
+    beta.resize(parameters.gaussians.get());
+}
+
 xmm::SingleClassGMM::SingleClassGMM(std::shared_ptr<SharedParameters> p,
                                     Json::Value const& root)
     : SingleClassProbabilisticModel(p, root) {
@@ -55,6 +63,8 @@ xmm::SingleClassGMM::SingleClassGMM(std::shared_ptr<SharedParameters> p,
     json2vector(root["mixture_coeffs"], mixture_coeffs,
                 parameters.gaussians.get());
 
+    // states of tied-mixture HMMs only store their mixture weights
+    if (root["components"].empty()) components.clear();
     int c(0);
     for (auto p : root["components"]) {
         components[c++].fromJson(p);
@@ -74,17 +84,47 @@ xmm::SingleClassGMM& xmm::SingleClassGMM::operator=(SingleClassGMM const& src) {
     return *this;
 };
 
-void xmm::SingleClassGMM::reset() { SingleClassProbabilisticModel::reset(); }
+xmm::SingleClassGMM& xmm::SingleClassGMM::operator=(SingleClassGMM&& src) {
+    if (this != &src) {
+        SingleClassProbabilisticModel::operator=(src);
+        parameters = src.parameters;
+        beta.resize(parameters.gaussians.get());
+        mixture_coeffs = std::move(src.mixture_coeffs);
+        components = std::move(src.components);
+    }
+    return *this;
+}
+
+void xmm::SingleClassGMM::reset() {
+    SingleClassProbabilisticModel::reset();
+    if (shared_parameters->bimodal.get()) {
+        unsigned int dimension_output =
+            shared_parameters->dimension.get() -
+            shared_parameters->dimension_input.get();
+        results.output_values.resize(dimension_output);
+        results.output_covariance.resize(
+            (parameters.covariance_mode.get() ==
+             GaussianDistribution::CovarianceMode::Full)
+                ? dimension_output * dimension_output
+                : dimension_output);
+        component_output_values_.resize(dimension_output);
+    }
+}
 
 double xmm::SingleClassGMM::filter(std::vector<float> const& observation) {
-    check_training();
-    double instantaneous_likelihood = likelihood(observation);
+    double instantaneous_likelihood = filterLikelihood(observation);
     if (shared_parameters->bimodal.get()) {
         regression(observation);
     }
     return instantaneous_likelihood;
 }
 
+double xmm::SingleClassGMM::filterLikelihood(
+    std::vector<float> const& observation) {
+    check_training();
+    return likelihood(observation);
+}
+
 void xmm::SingleClassGMM::emAlgorithmInit(TrainingSet* trainingSet) {
     initParametersToDefault(trainingSet->standardDeviation());
     initMeansWithKMeans(trainingSet);
@@ -93,14 +133,20 @@ void xmm::SingleClassGMM::emAlgorithmInit(TrainingSet* trainingSet) {
     updateInverseCovariances();
 }
 
+void xmm::SingleClassGMM::emAlgorithmCacheMoments(TrainingSet* trainingSet) {
+    moment_cache_.build(
+        trainingSet, parameters.covariance_mode.get() ==
+                         GaussianDistribution::CovarianceMode::Full,
+        momentCacheBudget());
+}
+
 Json::Value xmm::SingleClassGMM::toJson() const {
     check_training();
     Json::Value root = SingleClassProbabilisticModel::toJson();
     root["mixture_coeffs"] = vector2json(mixture_coeffs);
     root["parameters"] = parameters.toJson();
-    root["components"].resize(
-        static_cast<Json::ArrayIndex>(parameters.gaussians.get()));
-    for (int c = 0; c < parameters.gaussians.get(); c++) {
+    root["components"].resize(static_cast<Json::ArrayIndex>(components.size()));
+    for (int c = 0; c < components.size(); c++) {
         root["components"][c] = components[c].toJson();
     }
     return root;
@@ -110,12 +156,46 @@ void xmm::SingleClassGMM::fromJson(Json::Value const& root) {
     check_training();
     try {
         SingleClassGMM tmp(shared_parameters, root);
-        *this = tmp;
+        *this = std::move(tmp);
     } catch (JsonException& e) {
         throw e;
     }
 }
 
+void xmm::SingleClassGMM::writeBinary(BinaryWriter& writer) const {
+    SingleClassProbabilisticModel::writeBinary(writer);
+    parameters.writeBinary(writer);
+    writer.writeParameters(mixture_coeffs);
+    writer.writeUInt(static_cast<unsigned int>(components.size()));
+    for (auto const& component : components) {
+        component.writeBinary(writer);
+    }
+}
+
+void xmm::SingleClassGMM::readBinary(BinaryReader& reader) {
+    SingleClassProbabilisticModel::readBinary(reader);
+    parameters.readBinary(reader);
+
+    allocate();
+
+    reader.readParameters(mixture_coeffs, parameters.gaussians.get());
+
+    // states of tied-mixture HMMs only store their mixture weights
+    unsigned int num_components = reader.readUInt();
+    if (num_components == 0) {
+        components.clear();
+    } else if (num_components != parameters.gaussians.get()) {
+        throw std::runtime_error("Corrupted model file");
+    }
+    for (auto& component : components) {
+        component.readBinary(reader);
+        if (component.dimension.get() != shared_parameters->dimension.get() ||
+            component.dimension_input.get() !=
+                shared_parameters->dimension_input.get())
+            throw std::runtime_error("Corrupted model file");
+    }
+}
+
 // void xmm::SingleClassGMM::makeBimodal(unsigned int dimension_input)
 //{
 //    check_training();
@@ -226,7 +306,9 @@ void xmm::SingleClassGMM::allocate() {
     beta.resize(parameters.gaussians.get());
 
     GaussianDistribution mgaus(shared_parameters->bimodal.get(),
-                         shared_parameters->dimension.get());
+                               shared_parameters->dimension.get(),
+                               shared_parameters->dimension_input.get(),
+                               parameters.covariance_mode.get());
     components.assign(parameters.gaussians.get(),mgaus);
 }
 
@@ -312,7 +394,6 @@ void xmm::SingleClassGMM::initMeansWithKMeans(TrainingSet* trainingSet) {
 
 void xmm::SingleClassGMM::initCovariances_fullyObserved(
     TrainingSet* trainingSet) {
-    // TODO: simplify with covariance symmetricity
     // TODO: If Kmeans, covariances from cluster members
     if (!trainingSet || trainingSet->empty()) return;
     int dimension = static_cast<int>(shared_parameters->dimension.get());
@@ -320,7 +401,7 @@ void xmm::SingleClassGMM::initCovariances_fullyObserved(
     if (parameters.covariance_mode.get() ==
         GaussianDistribution::CovarianceMode::Full) {
         for (int n = 0; n < parameters.gaussians.get(); n++)
-            components[n].covariance.assign(dimension * dimension, 0.0);
+            components[n].covariance.assign(packedSize(dimension), 0.0);
     } else {
         for (int n = 0; n < parameters.gaussians.get(); n++)
             components[n].covariance.assign(dimension, 0.0);
@@ -328,27 +409,29 @@ void xmm::SingleClassGMM::initCovariances_fullyObserved(
 
     std::vector<double> gmeans(parameters.gaussians.get() * dimension, 0.0);
     std::vector<int> factor(parameters.gaussians.get(), 0);
+    std::vector<float> frame_buffer(dimension);
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
     for (auto phrase_it = trainingSet->begin(); phrase_it != trainingSet->end();
          phrase_it++) {
-        unsigned int step =
-            phrase_it->second->size() / parameters.gaussians.get();
+        Phrase::FrameView frames = phrase_it->second->frames();
+        unsigned int step = frames.size() / parameters.gaussians.get();
         unsigned int offset(0);
         for (int n = 0; n < parameters.gaussians.get(); n++) {
+            double* mean = &gmeans[n * dimension];
+            double* covariance = components[n].covariance.data();
             for (int t = 0; t < step; t++) {
+                const float* frame =
+                    frames.frame(offset + t, frame_buffer.data());
+                double* packed = covariance;
                 for (int d1 = 0; d1 < dimension; d1++) {
-                    gmeans[n * dimension + d1] +=
-                        phrase_it->second->getValue(offset + t, d1);
-                    if (parameters.covariance_mode.get() ==
-                        GaussianDistribution::CovarianceMode::Full) {
-                        for (int d2 = 0; d2 < dimension; d2++) {
-                            components[n].covariance[d1 * dimension + d2] +=
-                                phrase_it->second->getValue(offset + t, d1) *
-                                phrase_it->second->getValue(offset + t, d2);
+                    mean[d1] += frame[d1];
+                    if (full_covariance) {
+                        for (int d2 = d1; d2 < dimension; d2++) {
+                            *packed++ += frame[d1] * frame[d2];
                         }
                     } else {
-                        float value =
-                            phrase_it->second->getValue(offset + t, d1);
-                        components[n].covariance[d1] += value * value;
+                        covariance[d1] += frame[d1] * frame[d1];
                     }
                 }
             }
@@ -358,24 +441,18 @@ void xmm::SingleClassGMM::initCovariances_fullyObserved(
     }
 
     for (int n = 0; n < parameters.gaussians.get(); n++) {
-        for (int d1 = 0; d1 < dimension; d1++) {
+        for (int d1 = 0; d1 < dimension; d1++)
             gmeans[n * dimension + d1] /= factor[n];
-            if (parameters.covariance_mode.get() ==
-                GaussianDistribution::CovarianceMode::Full) {
-                for (int d2 = 0; d2 < dimension; d2++)
-                    components[n].covariance[d1 * dimension + d2] /= factor[n];
-            } else {
-                components[n].covariance[d1] /= factor[n];
-            }
-        }
+        for (auto& value : components[n].covariance) value /= factor[n];
     }
 
     for (int n = 0; n < parameters.gaussians.get(); n++) {
+        double* packed = components[n].covariance.data();
         for (int d1 = 0; d1 < dimension; d1++) {
             if (parameters.covariance_mode.get() ==
                 GaussianDistribution::CovarianceMode::Full) {
-                for (int d2 = 0; d2 < dimension; d2++)
-                    components[n].covariance[d1 * dimension + d2] -=
+                for (int d2 = d1; d2 < dimension; d2++)
+                    *packed++ -=
                         gmeans[n * dimension + d1] * gmeans[n * dimension + d2];
             } else {
                 components[n].covariance[d1] -=
@@ -436,69 +513,81 @@ double xmm::SingleClassGMM::emAlgorithmUpdate(TrainingSet* trainingSet) {
     }
 
     // Estimate means
-    for (int c = 0; c < parameters.gaussians.get(); c++) {
-        for (int d = 0; d < dimension; d++) {
-            components[c].mean[d] = 0.;
-            tbase = 0;
-            for (auto it = trainingSet->cbegin(); it != trainingSet->cend();
-                 ++it) {
-                unsigned int T = it->second->size();
-                for (int t = 0; t < T; t++) {
-                    components[c].mean[d] +=
-                        p[c][tbase + t] * it->second->getValue(t, d);
+    std::vector<float> frame_buffer(dimension);
+    for (int c = 0; c < parameters.gaussians.get(); c++)
+        components[c].mean.assign(dimension, 0.);
+    tbase = 0;
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); ++it) {
+        Phrase::FrameView frames = it->second->frames();
+        for (unsigned int t = 0; t < frames.size(); t++) {
+            const float* frame = frames.frame(t, frame_buffer.data());
+            for (int c = 0; c < parameters.gaussians.get(); c++) {
+                double weight = p[c][tbase + t];
+                double* mean = components[c].mean.data();
+                for (int d = 0; d < dimension; d++) {
+                    mean[d] += weight * frame[d];
                 }
-                tbase += T;
             }
+        }
+        tbase += frames.size();
+    }
+    for (int c = 0; c < parameters.gaussians.get(); c++) {
+        for (int d = 0; d < dimension; d++) {
             components[c].mean[d] /= E[c];
         }
     }
 
     // estimate covariances
-    if (parameters.covariance_mode.get() ==
-        GaussianDistribution::CovarianceMode::Full) {
-        for (int c = 0; c < parameters.gaussians.get(); c++) {
-            for (int d1 = 0; d1 < dimension; d1++) {
-                for (int d2 = d1; d2 < dimension; d2++) {
-                    components[c].covariance[d1 * dimension + d2] = 0.;
-                    tbase = 0;
-                    for (auto it = trainingSet->cbegin();
-                         it != trainingSet->cend(); ++it) {
-                        unsigned int T = it->second->size();
-                        for (int t = 0; t < T; t++) {
-                            components[c].covariance[d1 * dimension + d2] +=
-                                p[c][tbase + t] * (it->second->getValue(t, d1) -
-                                                   components[c].mean[d1]) *
-                                (it->second->getValue(t, d2) -
-                                 components[c].mean[d2]);
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
+    for (int c = 0; c < parameters.gaussians.get(); c++)
+        components[c].covariance.assign(
+            full_covariance ? packedSize(dimension) : dimension, 0.);
+    // with the moment cache, the raw second moments are accumulated and
+    // corrected by the means after the summation
+    bool use_cache = !moment_cache_.empty();
+    std::vector<double> centered(dimension);
+    tbase = 0;
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); ++it) {
+        Phrase::FrameView frames = it->second->frames();
+        for (unsigned int t = 0; t < frames.size(); t++) {
+            const float* frame = (tbase + t < moment_cache_.size())
+                                     ? NULL
+                                     : frames.frame(t, frame_buffer.data());
+            for (int c = 0; c < parameters.gaussians.get(); c++) {
+                double weight = p[c][tbase + t];
+                const double* mean = components[c].mean.data();
+                double* covariance = components[c].covariance.data();
+                if (use_cache) {
+                    moment_cache_.accumulate(tbase + t, frame, weight,
+                                             covariance);
+                } else if (full_covariance) {
+                    for (int d = 0; d < dimension; d++)
+                        centered[d] = frame[d] - mean[d];
+                    for (int d1 = 0; d1 < dimension; d1++) {
+                        double weighted = weight * centered[d1];
+                        for (int d2 = d1; d2 < dimension; d2++) {
+                            *covariance++ += weighted * centered[d2];
                         }
-                        tbase += T;
                     }
-                    components[c].covariance[d1 * dimension + d2] /= E[c];
-                    if (d1 != d2)
-                        components[c].covariance[d2 * dimension + d1] =
-                            components[c].covariance[d1 * dimension + d2];
-                }
-            }
-        }
-    } else {
-        for (int c = 0; c < parameters.gaussians.get(); c++) {
-            for (int d1 = 0; d1 < dimension; d1++) {
-                components[c].covariance[d1] = 0.;
-                tbase = 0;
-                for (auto it = trainingSet->cbegin(); it != trainingSet->cend();
-                     ++it) {
-                    unsigned int T = it->second->size();
-                    for (int t = 0; t < T; t++) {
-                        float value = (it->second->getValue(t, d1) -
-                                       components[c].mean[d1]);
-                        components[c].covariance[d1] +=
-                            p[c][tbase + t] * value * value;
+                } else {
+                    for (int d1 = 0; d1 < dimension; d1++) {
+                        float value = frame[d1] - mean[d1];
+                        covariance[d1] += weight * value * value;
                     }
-                    tbase += T;
                 }
-                components[c].covariance[d1] /= E[c];
             }
         }
+        tbase += frames.size();
+    }
+    for (int c = 0; c < parameters.gaussians.get(); c++) {
+        if (use_cache) {
+            MomentCache::toCovariance(components[c].covariance,
+                                      components[c].mean, E[c],
+                                      full_covariance);
+        } else {
+            for (auto& value : components[c].covariance) value /= E[c];
+        }
     }
 
     addCovarianceOffset();
@@ -507,6 +596,52 @@ double xmm::SingleClassGMM::emAlgorithmUpdate(TrainingSet* trainingSet) {
     return log_prob;
 }
 
+void xmm::SingleClassGMM::emAlgorithmResetStatistics() {
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
+    component_statistics_.resize(parameters.gaussians.get());
+    for (int c = 0; c < parameters.gaussians.get(); c++)
+        component_statistics_[c].reset(components[c].mean, full_covariance);
+    statistics_length_ = 0.;
+}
+
+double xmm::SingleClassGMM::emAlgorithmAccumulate(TrainingSet* trainingSet) {
+    int dimension = static_cast<int>(shared_parameters->dimension.get());
+    bool bimodal = shared_parameters->bimodal.get();
+    double log_prob(0.);
+    std::vector<double> p(parameters.gaussians.get());
+    std::vector<float> frame_buffer(dimension);
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); ++it) {
+        Phrase::FrameView frames = it->second->frames();
+        for (unsigned int t = 0; t < frames.size(); t++) {
+            double norm_const(0.);
+            for (int c = 0; c < parameters.gaussians.get(); c++) {
+                p[c] = bimodal ? obsProb_bimodal(frames.input(t),
+                                                 frames.output(t), c)
+                               : obsProb(frames.input(t), c);
+                if (p[c] == 0. || std::isnan(p[c]) || std::isinf(p[c]))
+                    p[c] = 1e-100;
+                norm_const += p[c];
+            }
+            const float* frame = frames.frame(t, frame_buffer.data());
+            for (int c = 0; c < parameters.gaussians.get(); c++)
+                component_statistics_[c].accumulate(frame, p[c] / norm_const);
+            log_prob += log(norm_const);
+        }
+        statistics_length_ += frames.size();
+    }
+    return log_prob;
+}
+
+void xmm::SingleClassGMM::emAlgorithmEstimate() {
+    for (int c = 0; c < parameters.gaussians.get(); c++) {
+        mixture_coeffs[c] = component_statistics_[c].weight / statistics_length_;
+        component_statistics_[c].estimate(components[c]);
+    }
+    addCovarianceOffset();
+    updateInverseCovariances();
+}
+
 void xmm::SingleClassGMM::initParametersToDefault(
     std::vector<float> const& dataStddev) {
     int dimension = static_cast<int>(shared_parameters->dimension.get());
@@ -522,7 +657,7 @@ void xmm::SingleClassGMM::initParametersToDefault(
         if (parameters.covariance_mode.get() ==
             GaussianDistribution::CovarianceMode::Full) {
             components[c].covariance.assign(
-                dimension * dimension,
+                packedSize(dimension),
                 parameters.absolute_regularization.get() / 2.);
         } else {
             components[c].covariance.assign(dimension, 0.);
@@ -581,12 +716,11 @@ void xmm::SingleClassGMM::regression(
             ? dimension_output * dimension_output
             : dimension_output,
         0.0);
-    std::vector<float> tmp_output_values(dimension_output, 0.0);
 
     for (int c = 0; c < parameters.gaussians.get(); c++) {
-        components[c].regression(observation_input, tmp_output_values);
+        components[c].regression(observation_input, component_output_values_);
         for (int d = 0; d < dimension_output; ++d) {
-            results.output_values[d] += beta[c] * tmp_output_values[d];
+            results.output_values[d] += beta[c] * component_output_values_[d];
             if (parameters.covariance_mode.get() ==
                 GaussianDistribution::CovarianceMode::Full) {
                 for (int d2 = 0; d2 < dimension_output; ++d2)
@@ -630,10 +764,5 @@ double xmm::SingleClassGMM::likelihood(
 
 void xmm::SingleClassGMM::updateResults() {
     likelihood_buffer_.push(log(results.instant_likelihood));
-    results.log_likelihood = 0.0;
-    unsigned int bufSize = likelihood_buffer_.size_t();
-    for (unsigned int i = 0; i < bufSize; i++) {
-        results.log_likelihood += likelihood_buffer_(0, i);
-    }
-    results.log_likelihood /= double(bufSize);
+    results.log_likelihood = likelihood_buffer_.mean(0);
 }
@@ -53,6 +53,7 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
   public:
     template <typename SingleClassModel, typename ModelType>
     friend class Model;
+    friend class GMM;
     friend class SingleClassHMM;
     friend class HierarchicalHMM;
 
@@ -68,6 +69,14 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
      */
     SingleClassGMM(SingleClassGMM const& src);
 
+    /**
+     @brief Move constructor
+     @details the Gaussian components are moved from the source GMM
+     @param src Source GMM
+     @throws runtime_error if the source model is training
+     */
+    SingleClassGMM(SingleClassGMM&& src);
+
     /**
      @brief Copy constructor
      @param p pointer to a shared parameters object (owned by a Model)
@@ -82,6 +91,13 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
      */
     SingleClassGMM& operator=(SingleClassGMM const& src);
 
+    /**
+     @brief Move assignment
+     @param src Source GMM
+     @throws runtime_error if the source or target model is training
+     */
+    SingleClassGMM& operator=(SingleClassGMM&& src);
+
     /** @name Performance */
     ///@{
 
@@ -99,6 +115,15 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
      */
     double filter(std::vector<float> const& observation);
 
+    /**
+     @brief filters a incoming observation without computing the regression
+     @details used by multi-class models, which only compute the regression
+     for the classes required by the multi-class regression estimator
+     @param observation observation vector
+     @return likelihood of the observation
+     */
+    double filterLikelihood(std::vector<float> const& observation);
+
     ///@}
 
     /** @name Json I/O */
@@ -119,6 +144,26 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @details the parameters are allocated from the shared parameters, that
+     must be read beforehand.
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readBinary(BinaryReader& reader);
+
+    ///@}
+
     //
     //        /**
     //         @brief Convert to bimodal GMM in place
@@ -256,12 +301,36 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
      */
     void emAlgorithmInit(TrainingSet* trainingSet);
 
+    /**
+     @brief Caches the second moments of the training frames, used to
+     re-estimate the covariances
+     */
+    void emAlgorithmCacheMoments(TrainingSet* trainingSet);
+
     /**
      @brief Update Function of the EM algorithm
      @return likelihood of the data given the current parameters (E-step)
      */
     double emAlgorithmUpdate(TrainingSet* trainingSet);
 
+    /**
+     @brief Resets the sufficient statistics of the components
+     */
+    void emAlgorithmResetStatistics();
+
+    /**
+     @brief Accumulates the posteriors and moments of each component over a
+     chunk of the training data
+     @return likelihood of the chunk given the current parameters
+     */
+    double emAlgorithmAccumulate(TrainingSet* trainingSet);
+
+    /**
+     @brief Estimates the mixture coefficients and the components from the
+     sufficient statistics
+     */
+    void emAlgorithmEstimate();
+
     /**
      @brief Initialize model parameters to default values.
      @details Mixture coefficients are then equiprobable
@@ -337,6 +406,23 @@ class SingleClassGMM : public SingleClassProbabilisticModel {
      training set
      */
     std::vector<double> current_regularization;
+
+    /**
+     @brief Output predicted by a single component (regression scratch buffer,
+     allocated by reset())
+     */
+    std::vector<float> component_output_values_;
+
+    /**
+     @brief Sufficient statistics of each component (out-of-core training)
+     */
+    std::vector<GaussianDistribution::SufficientStatistics>
+        component_statistics_;
+
+    /**
+     @brief Number of frames accumulated in the sufficient statistics
+     */
+    double statistics_length_;
 };
 }
 
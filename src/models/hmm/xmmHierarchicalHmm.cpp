@@ -34,71 +34,140 @@
 #include <algorithm>
 
 xmm::HierarchicalHMM::HierarchicalHMM(bool bimodal)
-    : Model<SingleClassHMM, HMM>(bimodal), forward_initialized_(false) {}
+    : Model<SingleClassHMM, HMM>(bimodal),
+      codebook(shared_parameters),
+      forward_initialized_(false) {}
 
 xmm::HierarchicalHMM::HierarchicalHMM(HierarchicalHMM const &src)
-    : Model<SingleClassHMM, HMM>(src) {
-    results = src.results;
+    : Model<SingleClassHMM, HMM>(src), codebook(src.codebook) {
     prior = src.prior;
     exit_transition = src.exit_transition;
     transition = src.transition;
+    codebook_likelihoods_ = src.codebook_likelihoods_;
+    attachCodebook();
     frontier_v1_ = src.frontier_v1_;
     frontier_v2_ = src.frontier_v2_;
+    transition_mass_ = src.transition_mass_;
     forward_initialized_ = false;
 }
 
+xmm::HierarchicalHMM::HierarchicalHMM(HierarchicalHMM &&src)
+    : Model<SingleClassHMM, HMM>(std::move(src)),
+      prior(std::move(src.prior)),
+      exit_transition(std::move(src.exit_transition)),
+      transition(std::move(src.transition)),
+      codebook(std::move(src.codebook)),
+      forward_initialized_(false) {
+    codebook_likelihoods_ = std::move(src.codebook_likelihoods_);
+    attachCodebook();
+    frontier_v1_ = std::move(src.frontier_v1_);
+    frontier_v2_ = std::move(src.frontier_v2_);
+    transition_mass_ = std::move(src.transition_mass_);
+    src.forward_initialized_ = false;
+}
+
 xmm::HierarchicalHMM::HierarchicalHMM(Json::Value const &root)
-    : Model<SingleClassHMM, HMM>(root), forward_initialized_(false) {
-    prior.resize(size());
-    json2vector(root["prior"], prior, size());
-    transition.resize(size());
-    for (int i = 0; i < size(); i++) {
-        transition[i].resize(size());
-        json2vector(root["transition"][i], transition[i], size());
-    }
-    exit_transition.resize(size());
-    json2vector(root["exit_transition"], exit_transition, size());
+    : Model<SingleClassHMM, HMM>(root),
+      codebook(shared_parameters),
+      forward_initialized_(false) {
+    HierarchicalHMM::readJsonMembers(root);
 }
 
 xmm::HierarchicalHMM &xmm::HierarchicalHMM::operator=(
     HierarchicalHMM const &src) {
     if (this != &src) {
         Model<SingleClassHMM, HMM>::operator=(src);
-        results = src.results;
         prior = src.prior;
         exit_transition = src.exit_transition;
         transition = src.transition;
+        codebook = src.codebook;
+        codebook_likelihoods_ = src.codebook_likelihoods_;
+        attachCodebook();
         frontier_v1_ = src.frontier_v1_;
         frontier_v2_ = src.frontier_v2_;
+        transition_mass_ = src.transition_mass_;
         forward_initialized_ = false;
     }
     return *this;
 }
 
+xmm::HierarchicalHMM &xmm::HierarchicalHMM::operator=(
+    HierarchicalHMM &&src) {
+    if (this != &src) {
+        Model<SingleClassHMM, HMM>::operator=(std::move(src));
+        prior = std::move(src.prior);
+        exit_transition = std::move(src.exit_transition);
+        transition = std::move(src.transition);
+        codebook = std::move(src.codebook);
+        codebook_likelihoods_ = std::move(src.codebook_likelihoods_);
+        attachCodebook();
+        frontier_v1_ = std::move(src.frontier_v1_);
+        frontier_v2_ = std::move(src.frontier_v2_);
+        transition_mass_ = std::move(src.transition_mass_);
+        forward_initialized_ = false;
+        src.forward_initialized_ = false;
+    }
+    return *this;
+}
+
 void xmm::HierarchicalHMM::clear() {
     Model<SingleClassHMM, HMM>::clear();
     prior.clear();
     transition.clear();
     exit_transition.clear();
+    codebook = SingleClassGMM(shared_parameters);
+    codebook_likelihoods_.clear();
 }
 
 void xmm::HierarchicalHMM::addExitPoint(int state, float proba) {
     // prevent_attribute_change();
     for (auto &model : models) {
-        model.second.addExitPoint(state, proba);
+        model.addExitPoint(state, proba);
+    }
+}
+
+void xmm::HierarchicalHMM::setTransitionGrammar(
+    std::map<std::string, std::vector<std::string>> const &grammar) {
+    checkTraining();
+    int num_classes = static_cast<int>(size());
+    std::vector<std::map<unsigned int, double>> rows(num_classes);
+    for (auto &successors : grammar) {
+        int src_model_index = getIndex(successors.first);
+        if (src_model_index < 0)
+            throw std::out_of_range("Class " + successors.first +
+                                    " does not exist");
+        for (auto &label : successors.second) {
+            int dst_model_index = getIndex(label);
+            if (dst_model_index < 0)
+                throw std::out_of_range("Class " + label + " does not exist");
+            rows[src_model_index][dst_model_index] = 1.;
+        }
+    }
+    transition.setRows(rows, num_classes);
+    transition.normalizeRows();
+}
+
+void xmm::HierarchicalHMM::estimateTransitions(TrainingSet *trainingSet) {
+    checkTraining();
+    if (!trainingSet) return;
+    int num_classes = static_cast<int>(size());
+    std::vector<std::map<unsigned int, double>> rows(num_classes);
+    int src_model_index(-1);
+    for (auto it = trainingSet->begin(); it != trainingSet->end(); ++it) {
+        int dst_model_index = getIndex(it->second->label.get());
+        if (src_model_index >= 0 && dst_model_index >= 0)
+            rows[src_model_index][dst_model_index] += 1.;
+        src_model_index = dst_model_index;
     }
+    transition.setRows(rows, num_classes);
+    transition.normalizeRows();
 }
 
 void xmm::HierarchicalHMM::normalizeTransitions() {
     double sumPrior(0.0);
     int num_models = static_cast<int>(size());
-    for (int i = 0; i < num_models; i++) {
-        sumPrior += prior[i];
-        double sumTrans(0.0);
-        for (int j = 0; j < num_models; j++) sumTrans += transition[i][j];
-        if (sumTrans > 0.0)
-            for (int j = 0; j < num_models; j++) transition[i][j] /= sumTrans;
-    }
+    for (int i = 0; i < num_models; i++) sumPrior += prior[i];
+    transition.normalizeRows();
     for (int i = 0; i < size(); i++) prior[i] /= sumPrior;
 }
 
@@ -125,76 +194,120 @@ void xmm::HierarchicalHMM::updatePrior() {
 void xmm::HierarchicalHMM::updateTransition() {
     int num_classes = static_cast<int>(size());
     exit_transition.assign(num_classes, DEFAULT_EXITTRANSITION());
-    transition.resize(num_classes);
-    for (int i = 0; i < num_classes; i++) {
-        transition[i].assign(num_classes,
-                             1. / static_cast<double>(num_classes));
-    }
+    transition.assign(num_classes, num_classes,
+                      1. / static_cast<double>(num_classes));
 }
 
 void xmm::HierarchicalHMM::updateExitProbabilities() {
     for (auto &model : models) {
-        model.second.updateExitProbabilities();
+        model.updateExitProbabilities();
     }
 }
 
 void xmm::HierarchicalHMM::addModelForClass(std::string const &label) {
     Model<SingleClassHMM, HMM>::addModelForClass(label);
+    SingleClassHMM &model = models[class_ids_[label]];
+    model.parameters.shared_codebook.set(configuration.shared_codebook.get());
+    if (configuration.shared_codebook.get()) {
+        model.parameters.tied_mixtures.set(true);
+        model.parameters.gaussians.set(configuration.gaussians.get());
+    }
+    // the other classes can be training: only the new class is attached
+    model.shared_codebook_ =
+        configuration.shared_codebook.get() ? &codebook : NULL;
+    model.shared_codebook_likelihoods_ = NULL;
     updateTransitionParameters();
 }
 
+void xmm::HierarchicalHMM::trainSharedParameters(TrainingSet *trainingSet) {
+    if (initSharedCodebook()) codebook.train(trainingSet);
+    if (codebook.training_status.status == TrainingEvent::Status::Error)
+        codebook = SingleClassGMM(shared_parameters);
+}
+
+void xmm::HierarchicalHMM::trainSharedParameters(PhraseStore const *store) {
+    if (initSharedCodebook()) codebook.train(store);
+    if (codebook.training_status.status == TrainingEvent::Status::Error)
+        codebook = SingleClassGMM(shared_parameters);
+}
+
+bool xmm::HierarchicalHMM::initSharedCodebook() {
+    if (!configuration.shared_codebook.get() || !codebook.components.empty())
+        return false;
+    // the classes that fail to find a trained codebook report a training error
+    codebook = SingleClassGMM(shared_parameters);
+    codebook.parameters.gaussians.set(configuration.gaussians.get());
+    codebook.parameters.relative_regularization.set(
+        configuration.relative_regularization.get());
+    codebook.parameters.absolute_regularization.set(
+        configuration.absolute_regularization.get());
+    codebook.parameters.covariance_mode.set(
+        configuration.covariance_mode.get());
+    return true;
+}
+
+void xmm::HierarchicalHMM::attachCodebook() {
+    for (auto &model : models) {
+        bool shared = model.parameters.tied_mixtures.get() &&
+                      model.parameters.shared_codebook.get();
+        model.shared_codebook_ = shared ? &codebook : NULL;
+        model.shared_codebook_likelihoods_ =
+            (shared && !codebook_likelihoods_.empty())
+                ? codebook_likelihoods_.data()
+                : NULL;
+    }
+}
+
+void xmm::HierarchicalHMM::updateCodebookLikelihoods(
+    std::vector<float> const &observation) {
+    if (codebook_likelihoods_.empty()) return;
+    for (unsigned int c = 0; c < codebook_likelihoods_.size(); c++)
+        codebook_likelihoods_[c] =
+            shared_parameters->bimodal.get()
+                ? codebook.components[c].likelihood_input(&observation[0])
+                : codebook.components[c].likelihood(&observation[0]);
+}
+
 void xmm::HierarchicalHMM::forward_init(std::vector<float> const &observation) {
     checkTraining();
     double norm_const(0.0);
 
     int model_index(0);
     for (auto &model : models) {
-        unsigned int N = model.second.parameters.states.get();
+        unsigned int N = model.parameters.states.get();
+        results.evaluated_classes.push_back(model_index);
 
         for (int i = 0; i < 3; i++) {
-            model.second.alpha_h[i].assign(N, 0.0);
+            model.alpha_h[i].assign(N, 0.0);
         }
 
         // Compute Emission probability and initialize on the first state of
         // the
         // primitive
-        if (model.second.parameters.transition_mode.get() ==
+        updateFrozenLikelihoods(model_index, observation);
+        model.updateCodebookLikelihoods(&observation[0]);
+        if (model.parameters.transition_mode.get() ==
             HMM::TransitionMode::Ergodic) {
-            for (int i = 0; i < model.second.parameters.states.get(); i++) {
-                if (shared_parameters->bimodal.get()) {
-                    model.second.alpha_h[0][i] =
-                        model.second.prior[i] *
-                        model.second.states[i].obsProb_input(&observation[0]);
-                } else {
-                    model.second.alpha_h[0][i] =
-                        model.second.prior[i] *
-                        model.second.states[i].obsProb(&observation[0]);
-                }
-                model.second.results.instant_likelihood +=
-                    model.second.alpha_h[0][i];
+            for (int i = 0; i < model.parameters.states.get(); i++) {
+                model.alpha_h[0][i] =
+                    model.prior[i] * model.obsProb(i, &observation[0]);
+                model.results.instant_likelihood += model.alpha_h[0][i];
             }
         } else {
-            model.second.alpha_h[0][0] = this->prior[model_index];
-            if (shared_parameters->bimodal.get()) {
-                model.second.alpha_h[0][0] *=
-                    model.second.states[0].obsProb_input(&observation[0]);
-            } else {
-                model.second.alpha_h[0][0] *=
-                    model.second.states[0].obsProb(&observation[0]);
-            }
-            model.second.results.instant_likelihood =
-                model.second.alpha_h[0][0];
+            model.alpha_h[0][0] = this->prior[model_index];
+            model.alpha_h[0][0] *= model.obsProb(0, &observation[0]);
+            model.results.instant_likelihood = model.alpha_h[0][0];
         }
-        norm_const += model.second.results.instant_likelihood;
+        norm_const += model.results.instant_likelihood;
         model_index++;
     }
 
     // Normalize Alpha variables
     for (auto &model : models) {
-        unsigned int N = model.second.parameters.states.get();
+        unsigned int N = model.parameters.states.get();
         for (unsigned int e = 0; e < 3; e++)
             for (unsigned int k = 0; k < N; k++)
-                model.second.alpha_h[e][k] /= norm_const;
+                model.alpha_h[e][k] /= norm_const;
     }
 
     forward_initialized_ = true;
@@ -207,8 +320,6 @@ void xmm::HierarchicalHMM::forward_update(
 
     // Frontier Algorithm: variables
     double tmp(0);
-    std::vector<double>
-        front;  // frontier variable : intermediate computation variable
 
     // Intermediate variables: compute the sum of probabilities of making a
     // transition to a new primitive
@@ -217,61 +328,78 @@ void xmm::HierarchicalHMM::forward_update(
 
     int num_classes = static_cast<int>(size());
 
+    // Class-level transitions: only non-zero transitions are visited
+    double root_mass(0.0);
+    transition_mass_.assign(num_classes, 0.0);
+    for (int src_model_index = 0; src_model_index < num_classes;
+         src_model_index++) {
+        root_mass += frontier_v2_[src_model_index];
+        if (frontier_v1_[src_model_index] == 0.0) continue;
+        for (unsigned int p = transition.row_pointers[src_model_index];
+             p < transition.row_pointers[src_model_index + 1]; p++) {
+            transition_mass_[transition.column_indices[p]] +=
+                frontier_v1_[src_model_index] * transition.values[p];
+        }
+    }
+
     // FORWARD UPDATE
     // --------------------------------------
     int dst_model_index(0);
     for (auto &dstModel : models) {
-        unsigned int N = dstModel.second.parameters.states.get();
+        unsigned int N = dstModel.parameters.states.get();
+
+        // Suspended classes keep their forward variable frozen, unless the
+        // class-level transitions bring enough probability mass
+        if (!isClassEvaluated(dst_model_index) &&
+            transition_mass_[dst_model_index] +
+                    this->prior[dst_model_index] * root_mass <
+                configuration.pruning_threshold) {
+            dstModel.results.instant_likelihood = 0.0;
+            dstModel.results.exit_likelihood = 0.0;
+            dst_model_index++;
+            continue;
+        }
+        results.evaluated_classes.push_back(dst_model_index);
 
         // 1) COMPUTE FRONTIER VARIABLE
         //    --------------------------------------
-        front.assign(N, 0.0);
+        front_.assign(N, 0.0);
 
-        if (dstModel.second.parameters.transition_mode.get() ==
+        if (dstModel.parameters.transition_mode.get() ==
             HMM::TransitionMode::Ergodic) {
             for (int k = 0; k < N; ++k) {
                 for (unsigned int j = 0; j < N; ++j) {
-                    front[k] += dstModel.second.transition[j * N + k] /
-                                (1 - dstModel.second.exit_probabilities_[j]) *
-                                dstModel.second.alpha_h[0][j];
+                    front_[k] += dstModel.transition[j * N + k] /
+                                (1 - dstModel.exit_probabilities_[j]) *
+                                dstModel.alpha_h[0][j];
                 }
 
-                for (int src_model_index = 0; src_model_index < num_classes;
-                     src_model_index++) {
-                    front[k] += dstModel.second.prior[k] *
-                                (frontier_v1_[src_model_index] *
-                                     this->transition[src_model_index]
-                                                     [dst_model_index] +
-                                 this->prior[dst_model_index] *
-                                     frontier_v2_[src_model_index]);
-                }
+                front_[k] += dstModel.prior[k] *
+                            (transition_mass_[dst_model_index] +
+                             this->prior[dst_model_index] * root_mass);
             }
         } else {
             // k=0: first state of the primitive
-            front[0] =
-                dstModel.second.transition[0] * dstModel.second.alpha_h[0][0];
-
-            for (int src_model_index = 0; src_model_index < num_classes;
-                 src_model_index++) {
-                front[0] += frontier_v1_[src_model_index] *
-                                transition[src_model_index][dst_model_index] +
-                            this->prior[dst_model_index] *
-                                frontier_v2_[src_model_index];
-            }
+            front_[0] = dstModel.transition[0] * dstModel.alpha_h[0][0];
+
+            front_[0] += transition_mass_[dst_model_index] +
+                        this->prior[dst_model_index] * root_mass;
 
             // k>0: rest of the primitive
+            unsigned int width = dstModel.transitionWidth();
             for (int k = 1; k < N; ++k) {
-                front[k] += dstModel.second.transition[k * 2] /
-                            (1 - dstModel.second.exit_probabilities_[k]) *
-                            dstModel.second.alpha_h[0][k];
-                front[k] += dstModel.second.transition[(k - 1) * 2 + 1] /
-                            (1 - dstModel.second.exit_probabilities_[k - 1]) *
-                            dstModel.second.alpha_h[0][k - 1];
+                unsigned int band = std::min(k + 1, static_cast<int>(width));
+                for (unsigned int skip = 0; skip < band; ++skip) {
+                    front_[k] +=
+                        dstModel.transition[(k - skip) * width + skip] /
+                        (1 - dstModel.exit_probabilities_[k - skip]) *
+                        dstModel.alpha_h[0][k - skip];
+                }
             }
 
             for (int i = 0; i < 3; i++) {
                 for (int k = 0; k < N; k++) {
-                    dstModel.second.alpha_h[i][k] = 0.0;
+                    dstModel.alpha_h[i][k] = 0.0;
                 }
             }
         }
@@ -279,49 +407,45 @@ void xmm::HierarchicalHMM::forward_update(
         // 2) UPDATE FORWARD VARIABLE
         //    --------------------------------------
 
-        dstModel.second.results.exit_likelihood = 0.0;
-        dstModel.second.results.instant_likelihood = 0.0;
+        dstModel.results.exit_likelihood = 0.0;
+        dstModel.results.instant_likelihood = 0.0;
 
         // end of the primitive: handle exit states
+        updateFrozenLikelihoods(dst_model_index, observation);
+        dstModel.updateCodebookLikelihoods(&observation[0]);
         for (int k = 0; k < N; ++k) {
-            if (shared_parameters->bimodal.get())
-                tmp = dstModel.second.states[k].obsProb_input(&observation[0]) *
-                      front[k];
-            else
-                tmp = dstModel.second.states[k].obsProb(&observation[0]) *
-                      front[k];
-
-            dstModel.second.alpha_h[2][k] =
+            tmp = dstModel.obsProb(k, &observation[0]) * front_[k];
+
+            dstModel.alpha_h[2][k] =
                 this->exit_transition[dst_model_index] *
-                dstModel.second.exit_probabilities_[k] * tmp;
-            dstModel.second.alpha_h[1][k] =
+                dstModel.exit_probabilities_[k] * tmp;
+            dstModel.alpha_h[1][k] =
                 (1 - this->exit_transition[dst_model_index]) *
-                dstModel.second.exit_probabilities_[k] * tmp;
-            dstModel.second.alpha_h[0][k] =
-                (1 - dstModel.second.exit_probabilities_[k]) * tmp;
+                dstModel.exit_probabilities_[k] * tmp;
+            dstModel.alpha_h[0][k] =
+                (1 - dstModel.exit_probabilities_[k]) * tmp;
 
-            dstModel.second.results.exit_likelihood +=
-                dstModel.second.alpha_h[1][k] + dstModel.second.alpha_h[2][k];
-            dstModel.second.results.instant_likelihood +=
-                dstModel.second.alpha_h[0][k] + dstModel.second.alpha_h[1][k] +
-                dstModel.second.alpha_h[2][k];
+            dstModel.results.exit_likelihood +=
+                dstModel.alpha_h[1][k] + dstModel.alpha_h[2][k];
+            dstModel.results.instant_likelihood +=
+                dstModel.alpha_h[0][k] + dstModel.alpha_h[1][k] +
+                dstModel.alpha_h[2][k];
 
             norm_const += tmp;
         }
 
-        dstModel.second.results.exit_ratio =
-            dstModel.second.results.exit_likelihood /
-            dstModel.second.results.instant_likelihood;
+        dstModel.results.exit_ratio = dstModel.results.exit_likelihood /
+                                      dstModel.results.instant_likelihood;
 
         dst_model_index++;
     }
 
     // Normalize Alpha variables
-    for (auto &model : models) {
-        unsigned int N = model.second.parameters.states.get();
+    for (auto model_index : results.evaluated_classes) {
+        unsigned int N = models[model_index].parameters.states.get();
         for (unsigned int e = 0; e < 3; e++)
             for (unsigned int k = 0; k < N; k++)
-                model.second.alpha_h[e][k] /= norm_const;
+                models[model_index].alpha_h[e][k] /= norm_const;
     }
 }
 
@@ -333,8 +457,8 @@ void xmm::HierarchicalHMM::likelihoodAlpha(
             likelihoodVector[l] = 0.0;
             for (unsigned int exit = 0; exit < 3; ++exit) {
                 for (unsigned int k = 0;
-                     k < model.second.parameters.states.get(); k++) {
-                    likelihoodVector[l] += model.second.alpha_h[exit][k];
+                     k < model.parameters.states.get(); k++) {
+                    likelihoodVector[l] += model.alpha_h[exit][k];
                 }
             }
             l++;
@@ -344,9 +468,13 @@ void xmm::HierarchicalHMM::likelihoodAlpha(
         unsigned int l(0);
         for (auto &model : models) {
             likelihoodVector[l] = 0.0;
-            for (unsigned int k = 0; k < model.second.parameters.states.get();
+            if (isClassSuspended(l)) {  // frozen forward variable
+                l++;
+                continue;
+            }
+            for (unsigned int k = 0; k < model.parameters.states.get();
                  k++) {
-                likelihoodVector[l] += model.second.alpha_h[exitNum][k];
+                likelihoodVector[l] += model.alpha_h[exitNum][k];
             }
             l++;
         }
@@ -359,6 +487,15 @@ void xmm::HierarchicalHMM::removeClass(std::string const &label) {
 }
 
 void xmm::HierarchicalHMM::reset() {
+    checkTraining();
+    bool shared_codebook(false);
+    for (auto &model : models)
+        if (model.parameters.tied_mixtures.get() &&
+            model.parameters.shared_codebook.get())
+            shared_codebook = true;
+    codebook_likelihoods_.assign(
+        shared_codebook ? codebook.components.size() : 0, 0.0);
+    attachCodebook();
     Model<SingleClassHMM, HMM>::reset();
     results.instant_likelihoods.resize(size());
     results.instant_normalized_likelihoods.resize(size());
@@ -379,51 +516,131 @@ void xmm::HierarchicalHMM::reset() {
     }
     frontier_v1_.resize(this->size());
     frontier_v2_.resize(this->size());
+    transition_mass_.resize(this->size());
+    unsigned int max_states(0);
+    for (auto &model : models)
+        max_states = std::max(max_states, model.parameters.states.get());
+    front_.reserve(max_states);
+    results.evaluated_classes.reserve(size());
+    results.likeliest.clear();
+    results.likeliest_index = 0;
+    // the likeliest label is then copied without allocation
+    std::size_t label_length(0);
+    for (auto &model : models)
+        label_length = std::max(label_length, model.label.size());
+    results.likeliest.reserve(label_length);
     forward_initialized_ = false;
+    unsigned int work = static_cast<unsigned int>(
+        codebook_likelihoods_.size() * shared_parameters->dimension.get());
     for (auto &model : models) {
-        model.second.is_hierarchical_ = configuration.hierarchical.get();
-        model.second.reset();
+        model.is_hierarchical_ = configuration.hierarchical.get();
+        model.reset();
+        if (model.shared_codebook_)
+            work += model.parameters.states.get() *
+                    model.parameters.gaussians.get();
+        else if (model.parameters.tied_mixtures.get())
+            work += model.parameters.gaussians.get() *
+                        shared_parameters->dimension.get() +
+                    model.parameters.states.get() *
+                        model.parameters.gaussians.get();
+        else
+            work += model.parameters.states.get() *
+                    model.parameters.gaussians.get() *
+                    shared_parameters->dimension.get();
     }
+    // the hierarchical forward algorithm couples the classes: only the
+    // non-hierarchical mode can be filtered in parallel
+    updateFilteringPool(configuration.hierarchical.get() ? 0 : work);
+}
+
+void xmm::HierarchicalHMM::freeze() {
+    checkTraining();
+    unfreeze();
+    for (auto &model : models) {
+        frozen_.addGroup();
+        if (model.parameters.tied_mixtures.get()) continue;
+        for (auto &state : model.states)
+            frozen_.addMixture(state.mixture_coeffs, state.components);
+    }
+    frozen_.compile(shared_parameters->bimodal.get());
+}
+
+void xmm::HierarchicalHMM::unfreeze() {
+    for (auto &model : models) model.frozen_likelihoods_ = NULL;
+    frozen_.clear();
+}
+
+void xmm::HierarchicalHMM::updateFrozenLikelihoods(
+    unsigned int class_index, std::vector<float> const &observation) {
+    if (frozen_.empty() || frozen_.mixtures(class_index) == 0) return;
+    models[class_index].frozen_likelihoods_ =
+        frozen_.evaluate(class_index, &observation[0]);
 }
 
 void xmm::HierarchicalHMM::filter(std::vector<float> const &observation) {
     checkTraining();
+    results.evaluated_classes.clear();
+    updateCodebookLikelihoods(observation);
     if (configuration.hierarchical.get()) {
         if (forward_initialized_) {
             this->forward_update(observation);
         } else {
             this->forward_init(observation);
         }
+    } else if (filtering_pool_) {
+        filtering_pool_->run(size(), [this, &observation](unsigned int begin,
+                                                          unsigned int end) {
+            for (unsigned int i = begin; i < end; i++) {
+                if (isClassEvaluated(i)) {
+                    updateFrozenLikelihoods(i, observation);
+                    results.instant_likelihoods[i] =
+                        models[i].filterLikelihood(observation);
+                } else
+                    models[i].results.instant_likelihood = 0.0;
+            }
+        });
+        for (unsigned int i = 0; i < size(); i++) {
+            if (isClassEvaluated(i)) results.evaluated_classes.push_back(i);
+        }
     } else {
-        int i(0);
-        for (auto &model : models) {
-            results.instant_likelihoods[i] = model.second.filter(observation);
-            i++;
+        for (unsigned int i = 0; i < size(); i++) {
+            if (isClassEvaluated(i)) {
+                updateFrozenLikelihoods(i, observation);
+                results.instant_likelihoods[i] = models[i].filterLikelihood(observation);
+                results.evaluated_classes.push_back(i);
+            } else {
+                models[i].results.instant_likelihood = 0.0;
+            }
         }
     }
 
     // Compute time progression
-    for (auto &model : models) {
-        model.second.updateAlphaWindow();
-        model.second.updateResults();
+    for (auto model_index : results.evaluated_classes) {
+        models[model_index].updateAlphaWindow();
+        models[model_index].updateResults();
     }
     updateResults();
+    updateClassActivity(results.instant_normalized_likelihoods,
+                        results.evaluated_classes);
 
     if (shared_parameters->bimodal.get()) {
         unsigned int dimension = shared_parameters->dimension.get();
         unsigned int dimension_input = shared_parameters->dimension_input.get();
         unsigned int dimension_output = dimension - dimension_input;
 
-        for (auto &model : models) {
-            model.second.regression(observation);
+        updateRegressionClasses(results.likeliest_index,
+                                results.smoothed_normalized_likelihoods,
+                                results.evaluated_classes);
+        for (auto class_index : regression_classes_) {
+            models[class_index].regression(observation);
         }
 
         if (configuration.multiClass_regression_estimator ==
             MultiClassRegressionEstimator::Likeliest) {
             results.output_values =
-                this->models[results.likeliest].results.output_values;
+                models[results.likeliest_index].results.output_values;
             results.output_covariance =
-                this->models[results.likeliest].results.output_covariance;
+                models[results.likeliest_index].results.output_covariance;
         } else {
             results.output_values.assign(dimension_output, 0.0);
             results.output_covariance.assign(
@@ -433,29 +650,28 @@ void xmm::HierarchicalHMM::filter(std::vector<float> const &observation) {
                     : dimension_output,
                 0.0);
 
-            int i(0);
-            for (auto &model : models) {
+            for (auto class_index : regression_classes_) {
+                SingleClassHMM const& model = models[class_index];
+                double weight =
+                    results.smoothed_normalized_likelihoods[class_index] /
+                    regression_mass_;
                 for (int d = 0; d < dimension_output; d++) {
                     results.output_values[d] +=
-                        results.smoothed_normalized_likelihoods[i] *
-                        model.second.results.output_values[d];
-
+                        weight * model.results.output_values[d];
                     if ((configuration.covariance_mode.get() ==
                          GaussianDistribution::CovarianceMode::Full)) {
                         for (int d2 = 0; d2 < dimension_output; d2++)
                             results
                                 .output_covariance[d * dimension_output + d2] +=
-                                results.smoothed_normalized_likelihoods[i] *
-                                model.second.results
+                                weight *
+                                model.results
                                     .output_covariance[d * dimension_output +
                                                        d2];
                     } else {
                         results.output_covariance[d] +=
-                            results.smoothed_normalized_likelihoods[i] *
-                            model.second.results.output_covariance[d];
+                            weight * model.results.output_covariance[d];
                     }
                 }
-                i++;
             }
         }
     }
@@ -465,38 +681,57 @@ void xmm::HierarchicalHMM::updateResults() {
     double maxlog_likelihood = 0.0;
     double normconst_instant(0.0);
     double normconst_smoothed(0.0);
-    int i(0);
-    results.instant_likelihoods.resize(shared_parameters->dimension.get());
-    results.smoothed_log_likelihoods.resize(shared_parameters->dimension.get());
-    results.smoothed_likelihoods.resize(shared_parameters->dimension.get());
-    results.instant_normalized_likelihoods.resize(shared_parameters->dimension.get());
-    results.smoothed_normalized_likelihoods.resize(shared_parameters->dimension.get());
-    
-    for (auto &model : models) {
-        results.instant_likelihoods[i] =
-            model.second.results.instant_likelihood;
-        results.smoothed_log_likelihoods[i] =
-            model.second.results.log_likelihood;
+    unsigned int likeliest_index(0);
+    unsigned int num_classes = size();
+    // suspended classes that were not evaluated on this frame have a zero
+    // mass: their smoothed likelihood is left over from their last evaluation
+    bool all_evaluated = results.evaluated_classes.empty();
+    unsigned int next_evaluated(0);
+    bool found_likeliest(false);
+    results.instant_likelihoods.resize(num_classes);
+    results.smoothed_log_likelihoods.resize(num_classes);
+    results.smoothed_likelihoods.resize(num_classes);
+    results.instant_normalized_likelihoods.resize(num_classes);
+    results.smoothed_normalized_likelihoods.resize(num_classes);
+
+    for (unsigned int i = 0; i < num_classes; i++) {
+        results.instant_likelihoods[i] = models[i].results.instant_likelihood;
+        results.smoothed_log_likelihoods[i] = models[i].results.log_likelihood;
         results.smoothed_likelihoods[i] =
             exp(results.smoothed_log_likelihoods[i]);
-    
+
         results.instant_normalized_likelihoods[i] =
             results.instant_likelihoods[i];
         results.smoothed_normalized_likelihoods[i] =
             results.smoothed_likelihoods[i];
+        if (!all_evaluated) {
+            if (next_evaluated < results.evaluated_classes.size() &&
+                results.evaluated_classes[next_evaluated] == i) {
+                next_evaluated++;
+            } else {
+                results.smoothed_normalized_likelihoods[i] = 0.0;
+                continue;
+            }
+        }
 
         normconst_instant += results.instant_normalized_likelihoods[i];
         normconst_smoothed += results.smoothed_normalized_likelihoods[i];
 
-        if (i == 0 || results.smoothed_log_likelihoods[i] > maxlog_likelihood) {
+        if (!found_likeliest ||
+            results.smoothed_log_likelihoods[i] > maxlog_likelihood) {
             maxlog_likelihood = results.smoothed_log_likelihoods[i];
-            results.likeliest = model.first;
+            likeliest_index = i;
+            found_likeliest = true;
         }
-        i++;
+    }
+    // the label is only copied when the likeliest class changes
+    if (likeliest_index != results.likeliest_index ||
+        results.likeliest.empty()) {
+        results.likeliest_index = likeliest_index;
+        results.likeliest = models[likeliest_index].label;
     }
 
-    i = 0;
-    for (auto it = this->models.begin(); it != this->models.end(); ++it, ++i) {
+    for (unsigned int i = 0; i < num_classes; i++) {
         results.instant_normalized_likelihoods[i] /= normconst_instant;
         results.smoothed_normalized_likelihoods[i] /= normconst_smoothed;
     }
@@ -513,11 +748,12 @@ Json::Value xmm::HierarchicalHMM::toJson() const {
     //            transition_flat[i * num_models + j] = transition[i][j];
     //        }
     //    }
-    root["transition"].resize(static_cast<Json::ArrayIndex>(size()));
-    for (int i = 0; i < size(); i++) {
-        root["transition"][i] = vector2json(transition[i]);
-    }
+    root["transition"]["row_pointers"] = vector2json(transition.row_pointers);
+    root["transition"]["column_indices"] =
+        vector2json(transition.column_indices);
+    root["transition"]["values"] = vector2json(transition.values);
     root["exit_transition"] = vector2json(exit_transition);
+    if (!codebook.components.empty()) root["codebook"] = codebook.toJson();
 
     return root;
 }
@@ -526,12 +762,114 @@ void xmm::HierarchicalHMM::fromJson(Json::Value const &root) {
     checkTraining();
     try {
         HierarchicalHMM tmp(root);
-        *this = tmp;
+        *this = std::move(tmp);
     } catch (JsonException &e) {
         throw e;
     }
 }
 
+void xmm::HierarchicalHMM::writeJsonMembers(JsonStreamWriter &writer) const {
+    writer.key("prior");
+    writer.array(prior);
+    writer.key("transition");
+    writer.beginObject();
+    writer.key("row_pointers");
+    writer.array(transition.row_pointers);
+    writer.key("column_indices");
+    writer.array(transition.column_indices);
+    writer.key("values");
+    writer.array(transition.values);
+    writer.endObject();
+    writer.key("exit_transition");
+    writer.array(exit_transition);
+    if (!codebook.components.empty()) {
+        writer.key("codebook");
+        writer.value(codebook.toJson());
+    }
+}
+
+void xmm::HierarchicalHMM::readJsonMembers(Json::Value const &root) {
+    prior.resize(size());
+    json2vector(root["prior"], prior, size());
+    if (root["transition"].isArray()) {  // dense transition matrix
+        std::vector<std::vector<double>> dense_transition(size());
+        for (int i = 0; i < size(); i++) {
+            dense_transition[i].resize(size());
+            json2vector(root["transition"][i], dense_transition[i], size());
+        }
+        transition.setDense(dense_transition);
+    } else {
+        transition.resize(size(), size());
+        json2vector(root["transition"]["row_pointers"], transition.row_pointers,
+                    size() + 1);
+        if (!transition.validRowPointers())
+            throw JsonException(JsonException::JsonErrorType::JsonValueError,
+                                "transition");
+        unsigned int nnz = transition.row_pointers[size()];
+        transition.column_indices.resize(nnz);
+        json2vector(root["transition"]["column_indices"],
+                    transition.column_indices, nnz);
+        transition.values.resize(nnz);
+        json2vector(root["transition"]["values"], transition.values, nnz);
+        if (!transition.validStructure())
+            throw JsonException(JsonException::JsonErrorType::JsonValueError,
+                                "transition");
+    }
+    exit_transition.resize(size());
+    json2vector(root["exit_transition"], exit_transition, size());
+    codebook = SingleClassGMM(shared_parameters);
+    if (root.isMember("codebook")) codebook.fromJson(root["codebook"]);
+    for (auto &model : models)
+        if (model.parameters.tied_mixtures.get() &&
+            model.parameters.shared_codebook.get() &&
+            codebook.components.size() != model.parameters.gaussians.get())
+            throw JsonException(JsonException::JsonErrorType::JsonValueError,
+                                "codebook");
+    codebook_likelihoods_.clear();
+    attachCodebook();
+    forward_initialized_ = false;
+}
+
+void xmm::HierarchicalHMM::writeBinaryPayload(BinaryWriter &writer) const {
+    Model<SingleClassHMM, HMM>::writeBinaryPayload(writer);
+    writer.writeParameters(prior);
+    writer.writeVector(transition.row_pointers);
+    writer.writeVector(transition.column_indices);
+    writer.writeParameters(transition.values);
+    writer.writeParameters(exit_transition);
+    writer.writeBool(!codebook.components.empty());
+    if (!codebook.components.empty()) codebook.writeBinary(writer);
+}
+
+void xmm::HierarchicalHMM::readBinaryPayload(BinaryReader &reader) {
+    Model<SingleClassHMM, HMM>::readBinaryPayload(reader);
+    reader.readParameters(prior, size());
+    transition.resize(size(), size());
+    reader.readVector(transition.row_pointers, size() + 1);
+    if (!transition.validRowPointers())
+        throw std::runtime_error("Corrupted model file");
+    unsigned int nnz = transition.row_pointers[size()];
+    reader.readVector(transition.column_indices, nnz);
+    reader.readParameters(transition.values, nnz);
+    if (!transition.validStructure())
+        throw std::runtime_error("Corrupted model file");
+    reader.readParameters(exit_transition, size());
+    codebook = SingleClassGMM(shared_parameters);
+    if (reader.readBool()) {
+        codebook.readBinary(reader);
+        if (codebook.components.empty())
+            throw std::runtime_error("Corrupted model file");
+    }
+    for (auto &model : models)
+        if (model.parameters.tied_mixtures.get() &&
+            model.parameters.shared_codebook.get() &&
+            codebook.components.size() != model.parameters.gaussians.get())
+            throw std::runtime_error("Corrupted model file");
+    codebook_likelihoods_.clear();
+    attachCodebook();
+    forward_initialized_ = false;
+}
+
 // void xmm::HierarchicalHMM::makeBimodal(unsigned int dimension_input)
 //{
 //    checkTraining();
@@ -548,7 +886,7 @@ void xmm::HierarchicalHMM::fromJson(Json::Value const &root) {
 //    bimodal_ = true;
 //    for (model_iterator it=this->models.begin(); it != this->models.end();
 //    ++it) {
-//        model.second.makeBimodal(dimension_input);
+//        model.makeBimodal(dimension_input);
 //    }
 //    set_trainingSet(NULL);
 //    results.output_values.resize(dimension() - this->dimension_input());
@@ -563,7 +901,7 @@ void xmm::HierarchicalHMM::fromJson(Json::Value const &root) {
 //    this->referenceModel_.makeUnimodal();
 //    for (model_iterator it=this->models.begin(); it != this->models.end();
 //    ++it) {
-//        model.second.makeUnimodal();
+//        model.makeUnimodal();
 //    }
 //    set_trainingSet(NULL);
 //    results.output_values.clear();
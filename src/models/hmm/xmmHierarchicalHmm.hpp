@@ -34,6 +34,7 @@
 #ifndef xmm_lib_hierarchical_hmm_h
 #define xmm_lib_hierarchical_hmm_h
 
+#include "../../core/common/xmmMatrix.hpp"
 #include "../../core/model/xmmModel.hpp"
 #include "../gmm/xmmGmm.hpp"
 #include "xmmHmmSingleClass.hpp"
@@ -63,6 +64,12 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      */
     HierarchicalHMM(HierarchicalHMM const& src);
 
+    /**
+     @brief Move Constructor
+     @param src Source Model
+     */
+    HierarchicalHMM(HierarchicalHMM&& src);
+
     /**
      @brief Constructor from Json Structure
      @param root Json Value
@@ -75,6 +82,12 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      */
     HierarchicalHMM& operator=(HierarchicalHMM const& src);
 
+    /**
+     @brief Move Assignment
+     @param src Source Model
+     */
+    HierarchicalHMM& operator=(HierarchicalHMM&& src);
+
     /** @name Class Manipulation */
     ///@{
 
@@ -96,6 +109,32 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
 
     void addExitPoint(int state, float proba);
 
+    /**
+     @brief Set the high-level transitions from a grammar
+     @details Each class can only transition to its successors in the grammar,
+     with equal probabilities. Classes that do not appear as keys of the
+     grammar have no successor (they can only go back to the root).
+     @param grammar list of successors of each class (by label)
+     @throws out_of_range if a label does not exist in the model
+     @warning the transitions are reset to ergodic if a class is added or
+     removed
+     */
+    void setTransitionGrammar(
+        std::map<std::string, std::vector<std::string>> const& grammar);
+
+    /**
+     @brief Estimate the high-level transitions from a labelled sequence of
+     phrases
+     @details The phrases of the training set are considered as a sequence
+     ordered by phrase index. Transition probabilities are estimated by
+     counting the transitions between the labels of consecutive phrases.
+     Phrases with labels that do not exist in the model break the sequence.
+     @param trainingSet training set containing the sequence of phrases
+     @warning the transitions are reset to ergodic if a class is added or
+     removed
+     */
+    void estimateTransitions(TrainingSet* trainingSet);
+
     ///@}
 
     /** @name Performance */
@@ -114,6 +153,23 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      */
     virtual void filter(std::vector<float> const& observation);
 
+    /**
+     @brief Compiles the trained classes into a flat representation for
+     low-latency filtering
+     @details the parameters of the states of all classes are copied into a
+     single aligned arena, that is the only source of the observation
+     probabilities computed by filter(). Classes with tied mixtures keep
+     evaluating their codebook. The model stays frozen until its classes are
+     trained or removed, or until unfreeze() is called.
+     @throws runtime_error if the model is training
+     */
+    void freeze();
+
+    /**
+     @brief Discards the compiled representation of a frozen model
+     */
+    virtual void unfreeze();
+
     ///@}
 
     /** @name Json I/O */
@@ -190,11 +246,6 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
     //         */
     //        HierarchicalHMM extract_inverse_model() const;
 
-    /**
-     @brief Results of the Filtering Process (Recognition + Regression)
-     */
-    Results<HMM> results;
-
     /**
      @brief Prior probabilities of the models
      */
@@ -208,10 +259,91 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
 
     /**
      @brief Transition probabilities between models
+     @details stored as a sparse matrix (only allowed transitions are stored)
      */
-    std::vector<std::vector<double>> transition;
+    SparseMatrix<double> transition;
+
+    /**
+     @brief Codebook of Gaussian components shared by the classes
+     @details only trained if the configuration uses a shared codebook (see
+     ClassParameters<HMM>::shared_codebook). The codebook is trained on the
+     phrases of all classes before the training of the classes. When a single
+     class is trained, it reuses the existing codebook.
+     */
+    SingleClassGMM codebook;
 
   protected:
+    /**
+     @brief Type of the model in the header of the binary model files
+     */
+    virtual unsigned int binaryType() const { return 2; }
+
+    /**
+     @brief Writes the parameters of the model to the payload of a binary
+     model file
+     @details the high-level prior, transition and exit probabilities are
+     written after the classes
+     @param writer binary writer
+     */
+    virtual void writeBinaryPayload(BinaryWriter& writer) const;
+
+    /**
+     @brief Reads the parameters of the model in place from the payload of a
+     binary model file
+     @param reader binary reader
+     */
+    virtual void readBinaryPayload(BinaryReader& reader);
+
+    /**
+     @brief Writes the high-level prior, transition and exit probabilities to
+     the JSON object of the model
+     @param writer streaming JSON writer
+     */
+    virtual void writeJsonMembers(JsonStreamWriter& writer) const;
+
+    /**
+     @brief Reads the high-level prior, transition and exit probabilities from
+     the JSON structure of the model
+     @param root members of the model, except the classes
+     @throws JsonException if the JSON value has a wrong format
+     */
+    virtual void readJsonMembers(Json::Value const& root);
+
+    /**
+     @brief Trains the shared codebook on the phrases of all classes
+     @details the codebook is only trained if the configuration uses a shared
+     codebook, and if it is not already trained when a single class is
+     trained.
+     @param trainingSet training set containing the phrases of all classes
+     */
+    virtual void trainSharedParameters(TrainingSet* trainingSet);
+
+    /**
+     @brief Trains the shared codebook on the phrases of all classes of a
+     phrase store (out-of-core training)
+     @param store phrase store containing the phrases of all classes
+     */
+    virtual void trainSharedParameters(PhraseStore const* store);
+
+    /**
+     @brief Prepares the training of the shared codebook
+     @return true if the codebook must be trained
+     */
+    bool initSharedCodebook();
+
+    /**
+     @brief Attaches the classes that use the shared codebook to the codebook
+     and to its likelihoods
+     */
+    void attachCodebook();
+
+    /**
+     @brief Computes the likelihood of each component of the shared codebook
+     for an observation (once per frame for all classes)
+     @param observation observation vector
+     */
+    void updateCodebookLikelihoods(std::vector<float> const& observation);
+
     /**
      @brief Finishes the background training process by joining threads and
      deleting the models which training failed
@@ -242,6 +374,12 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      */
     void updateExitProbabilities();
 
+    /**
+     @brief Update training set for a specific label
+     @details the class uses the shared codebook if the configuration of the
+     model requires it
+     @param label label of the class
+     */
     virtual void addModelForClass(std::string const& label);
 
     /**
@@ -277,6 +415,15 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      */
     void forward_update(std::vector<float> const& observation);
 
+    /**
+     @brief Computes the observation probabilities of the states of a class
+     from the frozen representation, if any
+     @param class_index index of the class
+     @param observation observation vector
+     */
+    void updateFrozenLikelihoods(unsigned int class_index,
+                                 std::vector<float> const& observation);
+
     /**
      @brief get instantaneous likelihood
      *
@@ -298,6 +445,12 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      */
     bool forward_initialized_;
 
+    /**
+     @brief Likelihood of each component of the shared codebook for the
+     current observation (only allocated if a class uses the shared codebook)
+     */
+    std::vector<double> codebook_likelihoods_;
+
     /**
      @brief intermediate Forward variable (used in Frontier algorithm)
      */
@@ -307,6 +460,18 @@ class HierarchicalHMM : public Model<SingleClassHMM, HMM> {
      @brief intermediate Forward variable (used in Frontier algorithm)
      */
     std::vector<double> frontier_v2_;
+
+    /**
+     @brief Probability mass transiting to each model at the class level (used
+     in Frontier algorithm)
+     */
+    std::vector<double> transition_mass_;
+
+    /**
+     @brief Frontier variable of the forward algorithm (intermediate
+     computation variable, allocated by reset())
+     */
+    std::vector<double> front_;
 };
 }
 
@@ -41,7 +41,10 @@ xmm::ClassParameters<xmm::HMM>::ClassParameters()
       covariance_mode(GaussianDistribution::CovarianceMode::Full),
       transition_mode(HMM::TransitionMode::LeftRight),
       regression_estimator(HMM::RegressionEstimator::Full),
-      hierarchical(true) {
+      hierarchical(true),
+      tied_mixtures(false),
+      shared_codebook(false),
+      max_skip(2, 1) {
     states.onAttributeChange(
         this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
     gaussians.onAttributeChange(
@@ -58,6 +61,12 @@ xmm::ClassParameters<xmm::HMM>::ClassParameters()
         this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
     hierarchical.onAttributeChange(
         this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+    tied_mixtures.onAttributeChange(
+        this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+    shared_codebook.onAttributeChange(
+        this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+    max_skip.onAttributeChange(
+        this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
 }
 
 xmm::ClassParameters<xmm::HMM>::ClassParameters(ClassParameters<HMM> const& src)
@@ -69,7 +78,10 @@ xmm::ClassParameters<xmm::HMM>::ClassParameters(ClassParameters<HMM> const& src)
       covariance_mode(src.covariance_mode),
       transition_mode(src.transition_mode),
       regression_estimator(src.regression_estimator),
-      hierarchical(src.hierarchical) {
+      hierarchical(src.hierarchical),
+      tied_mixtures(src.tied_mixtures),
+      shared_codebook(src.shared_codebook),
+      max_skip(src.max_skip) {
     states.onAttributeChange(
         this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
     gaussians.onAttributeChange(
@@ -86,6 +98,12 @@ xmm::ClassParameters<xmm::HMM>::ClassParameters(ClassParameters<HMM> const& src)
         this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
     hierarchical.onAttributeChange(
         this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+    tied_mixtures.onAttributeChange(
+        this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+    shared_codebook.onAttributeChange(
+        this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+    max_skip.onAttributeChange(
+        this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
 }
 
 xmm::ClassParameters<xmm::HMM>::ClassParameters(Json::Value const& root)
@@ -101,6 +119,9 @@ xmm::ClassParameters<xmm::HMM>::ClassParameters(Json::Value const& root)
     regression_estimator.set(static_cast<HMM::RegressionEstimator>(
         root["regression_estimator"].asInt()));
     hierarchical.set(root["hierarchical"].asBool());
+    tied_mixtures.set(root.get("tied_mixtures", false).asBool());
+    shared_codebook.set(root.get("shared_codebook", false).asBool());
+    max_skip.set(root.get("max_skip", 2).asInt());
 }
 
 xmm::ClassParameters<xmm::HMM>& xmm::ClassParameters<xmm::HMM>::operator=(
@@ -114,6 +135,9 @@ xmm::ClassParameters<xmm::HMM>& xmm::ClassParameters<xmm::HMM>::operator=(
         covariance_mode = src.covariance_mode;
         transition_mode = src.transition_mode;
         regression_estimator = src.regression_estimator;
+        tied_mixtures = src.tied_mixtures;
+        shared_codebook = src.shared_codebook;
+        max_skip = src.max_skip;
         states.onAttributeChange(
             this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
         gaussians.onAttributeChange(
@@ -130,6 +154,12 @@ xmm::ClassParameters<xmm::HMM>& xmm::ClassParameters<xmm::HMM>::operator=(
             this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
         hierarchical.onAttributeChange(
             this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+        tied_mixtures.onAttributeChange(
+            this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+        shared_codebook.onAttributeChange(
+            this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
+        max_skip.onAttributeChange(
+            this, &xmm::ClassParameters<xmm::HMM>::onAttributeChange);
     }
     return *this;
 }
@@ -144,6 +174,9 @@ Json::Value xmm::ClassParameters<xmm::HMM>::toJson() const {
     root["transition_mode"] = static_cast<int>(transition_mode.get());
     root["regression_estimator"] = static_cast<int>(regression_estimator.get());
     root["hierarchical"] = hierarchical.get();
+    root["tied_mixtures"] = tied_mixtures.get();
+    root["shared_codebook"] = shared_codebook.get();
+    root["max_skip"] = static_cast<int>(max_skip.get());
     return root;
 }
 
@@ -156,6 +189,37 @@ void xmm::ClassParameters<xmm::HMM>::fromJson(Json::Value const& root) {
     }
 }
 
+void xmm::ClassParameters<xmm::HMM>::writeBinary(BinaryWriter& writer) const {
+    writer.writeUInt(states.get());
+    writer.writeUInt(gaussians.get());
+    writer.writeDouble(relative_regularization.get());
+    writer.writeDouble(absolute_regularization.get());
+    writer.writeUInt(static_cast<unsigned int>(covariance_mode.get()));
+    writer.writeUInt(static_cast<unsigned int>(transition_mode.get()));
+    writer.writeUInt(static_cast<unsigned int>(regression_estimator.get()));
+    writer.writeBool(hierarchical.get());
+    writer.writeBool(tied_mixtures.get());
+    writer.writeBool(shared_codebook.get());
+    writer.writeUInt(max_skip.get());
+}
+
+void xmm::ClassParameters<xmm::HMM>::readBinary(BinaryReader& reader) {
+    states.set(reader.readUInt());
+    gaussians.set(reader.readUInt());
+    relative_regularization.set(reader.readDouble());
+    absolute_regularization.set(reader.readDouble());
+    covariance_mode.set(
+        static_cast<GaussianDistribution::CovarianceMode>(reader.readUInt()));
+    transition_mode.set(
+        static_cast<HMM::TransitionMode>(reader.readUInt()));
+    regression_estimator.set(
+        static_cast<HMM::RegressionEstimator>(reader.readUInt()));
+    hierarchical.set(reader.readBool());
+    tied_mixtures.set(reader.readBool());
+    shared_codebook.set(reader.readBool());
+    max_skip.set(reader.readUInt());
+}
+
 void xmm::ClassParameters<xmm::HMM>::onAttributeChange(
     AttributeBase* attr_pointer) {
     changed = true;
@@ -177,7 +241,7 @@ void xmm::checkLimits<xmm::HMM::TransitionMode>(
 template <>
 xmm::HMM::TransitionMode
 xmm::Attribute<xmm::HMM::TransitionMode>::defaultLimitMax() {
-    return xmm::HMM::TransitionMode::LeftRight;
+    return xmm::HMM::TransitionMode::Banded;
 }
 
 template <>
@@ -56,7 +56,15 @@ class HMM {
          @details The only authorized transitions are: auto-transition and
          transition to the next state
          */
-        LeftRight = 1
+        LeftRight = 1,
+
+        /**
+         @brief Banded Left-Right Transition model
+         @details Each state can transition to itself and to the 'max_skip'
+         following states. The transition matrix is stored as a band of
+         states x (max_skip + 1) probabilities.
+         */
+        Banded = 2
     };
 
     /**
@@ -132,6 +140,24 @@ class ClassParameters<HMM> {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    void readBinary(BinaryReader& reader);
+
+    ///@}
+
     /**
      @brief specifies if parameters have changed (model is invalid)
      */
@@ -180,6 +206,33 @@ class ClassParameters<HMM> {
      */
     Attribute<bool> hierarchical;
 
+    /**
+     @brief specifies if the states share a codebook of Gaussian components
+     (tied-mixture or semi-continuous HMM)
+     @details If true, each class owns a single codebook of 'gaussians'
+     components, and each state only stores the mixture weights of the
+     codebook components.
+     */
+    Attribute<bool> tied_mixtures;
+
+    /**
+     @brief specifies if all the classes of a HierarchicalHMM share a single
+     codebook of Gaussian components
+     @details If true, the codebook of 'gaussians' components is trained once
+     on the phrases of all classes, and the states of every class are tied
+     mixtures of this codebook: the likelihoods of the codebook components
+     are computed once per frame for all classes. Only the value of the
+     configuration of the model is used: it implies tied_mixtures, and the
+     number of Gaussians of the classes is the size of the shared codebook.
+     */
+    Attribute<bool> shared_codebook;
+
+    /**
+     @brief Maximum forward jump of the banded transition model: state i can
+     reach states i to i + max_skip (only used with TransitionMode::Banded)
+     */
+    Attribute<unsigned int> max_skip;
+
   protected:
     /**
      @brief notification function called when a member attribute is changed
@@ -31,27 +31,68 @@
  */
 
 #include "xmmHmmSingleClass.hpp"
+#include <algorithm>
 
 xmm::SingleClassHMM::SingleClassHMM(std::shared_ptr<SharedParameters> p)
-    : SingleClassProbabilisticModel(p), is_hierarchical_(true) {}
+    : SingleClassProbabilisticModel(p),
+      codebook(p),
+      is_hierarchical_(true),
+      frozen_likelihoods_(NULL),
+      shared_codebook_(NULL),
+      shared_codebook_likelihoods_(NULL) {
+    selectKernels();
+}
 
 xmm::SingleClassHMM::SingleClassHMM(SingleClassHMM const& src)
     : SingleClassProbabilisticModel(src),
       parameters(src.parameters),
       states(src.states),
+      codebook(src.codebook),
       prior(src.prior),
       transition(src.transition),
       is_hierarchical_(src.is_hierarchical_),
-      exit_probabilities_(src.exit_probabilities_) {
+      exit_probabilities_(src.exit_probabilities_),
+      codebook_weights_(src.codebook_weights_),
+      frozen_likelihoods_(NULL),
+      shared_codebook_(src.shared_codebook_),
+      shared_codebook_likelihoods_(NULL) {
+    codebook_likelihoods_.resize(src.codebook_likelihoods_.size());
     alpha.resize(parameters.states.get());
     previous_alpha_.resize(parameters.states.get());
     beta_.resize(parameters.states.get());
     previous_beta_.resize(parameters.states.get());
+    selectKernels();
+}
+
+xmm::SingleClassHMM::SingleClassHMM(SingleClassHMM&& src)
+    : SingleClassProbabilisticModel(src),
+      parameters(src.parameters),
+      states(std::move(src.states)),
+      codebook(std::move(src.codebook)),
+      prior(std::move(src.prior)),
+      transition(std::move(src.transition)),
+      is_hierarchical_(src.is_hierarchical_),
+      exit_probabilities_(std::move(src.exit_probabilities_)),
+      codebook_weights_(std::move(src.codebook_weights_)),
+      frozen_likelihoods_(NULL),
+      shared_codebook_(src.shared_codebook_),
+      shared_codebook_likelihoods_(NULL) {
+    codebook_likelihoods_.resize(src.codebook_likelihoods_.size());
+    alpha.resize(parameters.states.get());
+    previous_alpha_.resize(parameters.states.get());
+    beta_.resize(parameters.states.get());
+    previous_beta_.resize(parameters.states.get());
+    selectKernels();
 }
 
 xmm::SingleClassHMM::SingleClassHMM(std::shared_ptr<SharedParameters> p,
                                     Json::Value const& root)
-    : SingleClassProbabilisticModel(p, root), is_hierarchical_(true) {
+    : SingleClassProbabilisticModel(p, root),
+      codebook(p),
+      is_hierarchical_(true),
+      frozen_likelihoods_(NULL),
+      shared_codebook_(NULL),
+      shared_codebook_likelihoods_(NULL) {
     parameters.fromJson(root["parameters"]);
 
     allocate();
@@ -62,7 +103,7 @@ xmm::SingleClassHMM::SingleClassHMM(std::shared_ptr<SharedParameters> p,
                     parameters.states.get() * parameters.states.get());
     } else {
         json2vector(root["transition"], transition,
-                    2 * parameters.states.get());
+                    transitionWidth() * parameters.states.get());
     }
     if (root.isMember("exitProbabilities")) {
         json2vector(root["exitProbabilities"], exit_probabilities_,
@@ -73,6 +114,13 @@ xmm::SingleClassHMM::SingleClassHMM(std::shared_ptr<SharedParameters> p,
     for (auto p : root["states"]) {
         states[s++].fromJson(p);
     }
+
+    if (parameters.tied_mixtures.get()) {
+        if (!parameters.shared_codebook.get())
+            codebook.fromJson(root["codebook"]);
+        for (auto& state : states) state.components.clear();
+        updateCodebookWeights();
+    }
 }
 
 xmm::SingleClassHMM& xmm::SingleClassHMM::operator=(SingleClassHMM const& src) {
@@ -85,11 +133,44 @@ xmm::SingleClassHMM& xmm::SingleClassHMM::operator=(SingleClassHMM const& src) {
         prior = src.prior;
         exit_probabilities_ = src.exit_probabilities_;
         states = src.states;
+        codebook = src.codebook;
+        codebook_weights_ = src.codebook_weights_;
+        codebook_likelihoods_.resize(src.codebook_likelihoods_.size());
+        frozen_likelihoods_ = NULL;
+        shared_codebook_ = src.shared_codebook_;
+        shared_codebook_likelihoods_ = NULL;
+
+        alpha.resize(parameters.states.get());
+        previous_alpha_.resize(parameters.states.get());
+        beta_.resize(parameters.states.get());
+        previous_beta_.resize(parameters.states.get());
+        selectKernels();
+    }
+    return *this;
+}
+
+xmm::SingleClassHMM& xmm::SingleClassHMM::operator=(SingleClassHMM&& src) {
+    if (this != &src) {
+        SingleClassProbabilisticModel::operator=(src);
+
+        is_hierarchical_ = src.is_hierarchical_;
+        parameters = src.parameters;
+        transition = std::move(src.transition);
+        prior = std::move(src.prior);
+        exit_probabilities_ = std::move(src.exit_probabilities_);
+        states = std::move(src.states);
+        codebook = std::move(src.codebook);
+        codebook_weights_ = std::move(src.codebook_weights_);
+        codebook_likelihoods_.resize(src.codebook_likelihoods_.size());
+        frozen_likelihoods_ = NULL;
+        shared_codebook_ = src.shared_codebook_;
+        shared_codebook_likelihoods_ = NULL;
 
         alpha.resize(parameters.states.get());
         previous_alpha_.resize(parameters.states.get());
         beta_.resize(parameters.states.get());
         previous_beta_.resize(parameters.states.get());
+        selectKernels();
     }
     return *this;
 }
@@ -104,7 +185,7 @@ void xmm::SingleClassHMM::allocate() {
         transition.resize(numStates * numStates);
     } else {
         prior.clear();
-        transition.resize(numStates * 2);
+        transition.resize(numStates * transitionWidth());
     }
     alpha.resize(numStates);
     previous_alpha_.resize(numStates);
@@ -117,22 +198,52 @@ void xmm::SingleClassHMM::allocate() {
     tmpGMM.parameters.absolute_regularization.set(
         parameters.absolute_regularization.get());
     tmpGMM.parameters.covariance_mode.set(parameters.covariance_mode.get());
-    states.assign(numStates, tmpGMM);
-    for (auto& state : states) {
-        state.allocate();
+    states.clear();
+    states.reserve(numStates);
+    for (unsigned int i = 0; i < numStates; i++) {
+        states.push_back(tmpGMM);
+        states.back().allocate();
+    }
+    if (parameters.tied_mixtures.get()) {
+        for (auto& state : states) state.components.clear();
+        if (parameters.shared_codebook.get()) {
+            codebook = SingleClassGMM(shared_parameters);
+        } else {
+            codebook = std::move(tmpGMM);
+            codebook.allocate();
+        }
+        codebook_likelihoods_.resize(parameters.gaussians.get());
+    } else {
+        codebook = SingleClassGMM(shared_parameters);
+        codebook_weights_.clear();
+        codebook_likelihoods_.clear();
     }
     if (is_hierarchical_) updateExitProbabilities(NULL);
+    selectKernels();
 }
 
 void xmm::SingleClassHMM::initParametersToDefault(
     std::vector<float> const& dataStddev) {
     if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
         setErgodic();
+    } else if (parameters.transition_mode.get() ==
+               HMM::TransitionMode::Banded) {
+        setBanded();
     } else {
         setLeftRight();
     }
-    for (int i = 0; i < parameters.states.get(); i++) {
-        states[i].initParametersToDefault(dataStddev);
+    if (parameters.tied_mixtures.get()) {
+        if (!parameters.shared_codebook.get())
+            codebook.initParametersToDefault(dataStddev);
+        for (auto& state : states) {
+            state.mixture_coeffs.assign(
+                parameters.gaussians.get(),
+                1. / float(parameters.gaussians.get()));
+        }
+    } else {
+        for (int i = 0; i < parameters.states.get(); i++) {
+            states[i].initParametersToDefault(dataStddev);
+        }
     }
 }
 
@@ -146,15 +257,19 @@ void xmm::SingleClassHMM::initMeansWithAllPhrases(TrainingSet* trainingSet) {
             states[n].components[0].mean[d] = 0.0;
 
     std::vector<int> factor(numStates, 0);
+    std::vector<float> frame_buffer(dimension);
     for (auto phrase_it = trainingSet->begin(); phrase_it != trainingSet->end();
          phrase_it++) {
-        unsigned int step = phrase_it->second->size() / numStates;
+        Phrase::FrameView frames = phrase_it->second->frames();
+        unsigned int step = frames.size() / numStates;
         unsigned int offset(0);
         for (unsigned int n = 0; n < numStates; n++) {
+            double* mean = states[n].components[0].mean.data();
             for (unsigned int t = 0; t < step; t++) {
+                const float* frame =
+                    frames.frame(offset + t, frame_buffer.data());
                 for (unsigned int d = 0; d < dimension; d++) {
-                    states[n].components[0].mean[d] +=
-                        phrase_it->second->getValue(offset + t, d);
+                    mean[d] += frame[d];
                 }
             }
             offset += step;
@@ -169,7 +284,6 @@ void xmm::SingleClassHMM::initMeansWithAllPhrases(TrainingSet* trainingSet) {
 
 void xmm::SingleClassHMM::initCovariances_fullyObserved(
     TrainingSet* trainingSet) {
-    // TODO: simplify with covariance symmetricity.
     if (!trainingSet || trainingSet->empty()) return;
     int dimension = static_cast<int>(shared_parameters->dimension.get());
     unsigned int numStates = parameters.states.get();
@@ -177,7 +291,7 @@ void xmm::SingleClassHMM::initCovariances_fullyObserved(
     if (parameters.covariance_mode.get() ==
         GaussianDistribution::CovarianceMode::Full) {
         for (int n = 0; n < numStates; n++)
-            states[n].components[0].covariance.assign(dimension * dimension,
+            states[n].components[0].covariance.assign(packedSize(dimension),
                                                       0.0);
     } else {
         for (int n = 0; n < numStates; n++)
@@ -186,27 +300,29 @@ void xmm::SingleClassHMM::initCovariances_fullyObserved(
 
     std::vector<int> factor(numStates, 0);
     std::vector<double> othermeans(numStates * dimension, 0.0);
+    std::vector<float> frame_buffer(dimension);
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
     for (auto phrase_it = trainingSet->begin(); phrase_it != trainingSet->end();
          phrase_it++) {
-        unsigned int step = phrase_it->second->size() / numStates;
+        Phrase::FrameView frames = phrase_it->second->frames();
+        unsigned int step = frames.size() / numStates;
         unsigned int offset(0);
         for (unsigned int n = 0; n < numStates; n++) {
+            double* mean = &othermeans[n * dimension];
+            double* covariance = states[n].components[0].covariance.data();
             for (unsigned int t = 0; t < step; t++) {
+                const float* frame =
+                    frames.frame(offset + t, frame_buffer.data());
+                double* packed = covariance;
                 for (unsigned int d1 = 0; d1 < dimension; d1++) {
-                    othermeans[n * dimension + d1] +=
-                        phrase_it->second->getValue(offset + t, d1);
-                    if (parameters.covariance_mode.get() ==
-                        GaussianDistribution::CovarianceMode::Full) {
-                        for (int d2 = 0; d2 < dimension; d2++) {
-                            states[n].components[0].covariance[d1 * dimension +
-                                                               d2] +=
-                                phrase_it->second->getValue(offset + t, d1) *
-                                phrase_it->second->getValue(offset + t, d2);
+                    mean[d1] += frame[d1];
+                    if (full_covariance) {
+                        for (int d2 = d1; d2 < dimension; d2++) {
+                            *packed++ += frame[d1] * frame[d2];
                         }
                     } else {
-                        float value =
-                            phrase_it->second->getValue(offset + t, d1);
-                        states[n].components[0].covariance[d1] += value * value;
+                        covariance[d1] += frame[d1] * frame[d1];
                     }
                 }
             }
@@ -215,27 +331,21 @@ void xmm::SingleClassHMM::initCovariances_fullyObserved(
         }
     }
 
-    for (unsigned int n = 0; n < numStates; n++)
-        for (unsigned int d1 = 0; d1 < dimension; d1++) {
+    for (unsigned int n = 0; n < numStates; n++) {
+        for (unsigned int d1 = 0; d1 < dimension; d1++)
             othermeans[n * dimension + d1] /= factor[n];
-            if (parameters.covariance_mode.get() ==
-                GaussianDistribution::CovarianceMode::Full) {
-                for (int d2 = 0; d2 < dimension; d2++)
-                    states[n].components[0].covariance[d1 * dimension + d2] /=
-                        factor[n];
-            } else {
-                states[n].components[0].covariance[d1] /= factor[n];
-            }
-        }
+        for (auto& value : states[n].components[0].covariance)
+            value /= factor[n];
+    }
 
     for (int n = 0; n < numStates; n++) {
+        double* packed = states[n].components[0].covariance.data();
         for (int d1 = 0; d1 < dimension; d1++) {
             if (parameters.covariance_mode.get() ==
                 GaussianDistribution::CovarianceMode::Full) {
-                for (int d2 = 0; d2 < dimension; d2++)
-                    states[n].components[0].covariance[d1 * dimension + d2] -=
-                        othermeans[n * dimension + d1] *
-                        othermeans[n * dimension + d2];
+                for (int d2 = d1; d2 < dimension; d2++)
+                    *packed++ -= othermeans[n * dimension + d1] *
+                                 othermeans[n * dimension + d2];
             } else {
                 states[n].components[0].covariance[d1] -=
                     othermeans[n * dimension + d1] *
@@ -290,6 +400,127 @@ void xmm::SingleClassHMM::initMeansCovariancesWithGMMEM(
     }
 }
 
+void xmm::SingleClassHMM::initCodebookWithGMMEM(TrainingSet* trainingSet) {
+    unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
+
+    // a shared codebook is trained by the parent model on all classes
+    if (!parameters.shared_codebook.get()) {
+        SingleClassGMM tmpGMM(shared_parameters);
+        tmpGMM.parameters.gaussians.set(numGaussians);
+        tmpGMM.parameters.relative_regularization.set(
+            parameters.relative_regularization.get());
+        tmpGMM.parameters.absolute_regularization.set(
+            parameters.absolute_regularization.get());
+        tmpGMM.parameters.covariance_mode.set(
+            parameters.covariance_mode.get());
+        tmpGMM.train(trainingSet);
+        for (unsigned int c = 0; c < numGaussians; c++) {
+            codebook.components[c].mean = tmpGMM.components[c].mean;
+            codebook.components[c].covariance =
+                tmpGMM.components[c].covariance;
+        }
+        codebook.mixture_coeffs = tmpGMM.mixture_coeffs;
+        codebook.updateInverseCovariances();
+    }
+    SingleClassGMM const& tied_codebook = tiedCodebook();
+
+    // Initialize the weights of each state with the posterior probabilities
+    // of the codebook components over a segment of each phrase
+    for (auto& state : states) state.mixture_coeffs.assign(numGaussians, 0.0);
+    for (auto phrase_it = trainingSet->begin(); phrase_it != trainingSet->end();
+         phrase_it++) {
+        unsigned int step = phrase_it->second->size() / numStates;
+        for (unsigned int n = 0; n < numStates; n++) {
+            for (unsigned int t = n * step; t < (n + 1) * step; t++) {
+                if (shared_parameters->bimodal.get())
+                    updateCodebookLikelihoods(
+                        phrase_it->second->getPointer_input(t),
+                        phrase_it->second->getPointer_output(t));
+                else
+                    updateCodebookLikelihoods(phrase_it->second->getPointer(t));
+                double norm_const(0.);
+                for (unsigned int c = 0; c < numGaussians; c++)
+                    norm_const += tied_codebook.mixture_coeffs[c] *
+                                  codebook_likelihoods_[c];
+                if (norm_const <= 0.) continue;
+                for (unsigned int c = 0; c < numGaussians; c++)
+                    states[n].mixture_coeffs[c] +=
+                        tied_codebook.mixture_coeffs[c] *
+                        codebook_likelihoods_[c] / norm_const;
+            }
+        }
+    }
+    for (auto& state : states) state.normalizeMixtureCoeffs();
+    updateCodebookWeights();
+}
+
+void xmm::SingleClassHMM::updateCodebookWeights() {
+    unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
+
+    codebook_weights_.resize(numStates, numGaussians);
+    for (unsigned int i = 0; i < numStates; i++) {
+        for (unsigned int c = 0; c < numGaussians; c++) {
+            if (states[i].mixture_coeffs[c] > CODEBOOK_WEIGHT_THRESHOLD()) {
+                codebook_weights_.column_indices.push_back(c);
+                codebook_weights_.values.push_back(states[i].mixture_coeffs[c]);
+            }
+        }
+        codebook_weights_.row_pointers[i + 1] =
+            static_cast<unsigned int>(codebook_weights_.values.size());
+    }
+}
+
+void xmm::SingleClassHMM::updateCodebookLikelihoods(
+    const float* observation, const float* observation_output) {
+    if (!parameters.tied_mixtures.get()) return;
+    // the likelihoods of a shared codebook are computed by the parent model
+    if (shared_codebook_likelihoods_ && !observation_output) return;
+    SingleClassGMM const& tied_codebook = tiedCodebook();
+    for (unsigned int c = 0; c < parameters.gaussians.get(); c++) {
+        if (shared_parameters->bimodal.get()) {
+            if (observation_output)
+                codebook_likelihoods_[c] =
+                    tied_codebook.components[c].likelihood_bimodal(
+                        observation, observation_output);
+            else
+                codebook_likelihoods_[c] =
+                    tied_codebook.components[c].likelihood_input(observation);
+        } else {
+            codebook_likelihoods_[c] =
+                tied_codebook.components[c].likelihood(observation);
+        }
+    }
+}
+
+double xmm::SingleClassHMM::obsProb(unsigned int stateIndex,
+                                    const float* observation,
+                                    const float* observation_output) const {
+    if (frozen_likelihoods_ && !observation_output)
+        return frozen_likelihoods_[stateIndex];
+    if (parameters.tied_mixtures.get()) {
+        const double* likelihoods = (shared_codebook_likelihoods_ &&
+                                     !observation_output)
+                                        ? shared_codebook_likelihoods_
+                                        : codebook_likelihoods_.data();
+        double p(0.);
+        for (unsigned int k = codebook_weights_.row_pointers[stateIndex];
+             k < codebook_weights_.row_pointers[stateIndex + 1]; k++) {
+            p += codebook_weights_.values[k] *
+                 likelihoods[codebook_weights_.column_indices[k]];
+        }
+        return p;
+    }
+    if (shared_parameters->bimodal.get()) {
+        if (observation_output)
+            return states[stateIndex].obsProb_bimodal(observation,
+                                                      observation_output);
+        return states[stateIndex].obsProb_input(observation);
+    }
+    return states[stateIndex].obsProb(observation);
+}
+
 void xmm::SingleClassHMM::setErgodic() {
     unsigned int numStates = parameters.states.get();
 
@@ -309,6 +540,26 @@ void xmm::SingleClassHMM::setLeftRight() {
     transition[(numStates - 1) * 2 + 1] = 0.;
 }
 
+void xmm::SingleClassHMM::setBanded() {
+    unsigned int numStates = parameters.states.get();
+    unsigned int width = transitionWidth();
+
+    transition.assign(numStates * width, 0.);
+    for (unsigned int i = 0; i < numStates; i++) {
+        unsigned int reachable = std::min(width, numStates - i);
+        for (unsigned int k = 0; k < reachable; k++)
+            transition[i * width + k] = 1. / float(reachable);
+    }
+}
+
+unsigned int xmm::SingleClassHMM::transitionWidth() const {
+    if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic)
+        return parameters.states.get();
+    if (parameters.transition_mode.get() == HMM::TransitionMode::Banded)
+        return parameters.max_skip.get() + 1;
+    return 2;
+}
+
 void xmm::SingleClassHMM::normalizeTransitions() {
     unsigned int numStates = parameters.states.get();
 
@@ -325,10 +576,231 @@ void xmm::SingleClassHMM::normalizeTransitions() {
         }
         for (int i = 0; i < numStates; i++) prior[i] /= norm_prior;
     } else {
+        unsigned int width = transitionWidth();
         for (int i = 0; i < numStates; i++) {
-            norm_transition = transition[i * 2] + transition[i * 2 + 1];
-            transition[i * 2] /= norm_transition;
-            transition[i * 2 + 1] /= norm_transition;
+            norm_transition = 0.;
+            for (unsigned int k = 0; k < width; k++)
+                norm_transition += transition[i * width + k];
+            for (unsigned int k = 0; k < width; k++)
+                transition[i * width + k] /= norm_transition;
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Inference kernels
+namespace {
+/**
+ @brief Transitions of an ergodic model (full transition matrix)
+ */
+struct ErgodicTransitions {
+    static void forward(double* alpha, const double* previous_alpha,
+                        const float* transition, unsigned int numStates,
+                        unsigned int) {
+        for (unsigned int j = 0; j < numStates; j++) alpha[j] = 0.;
+        for (unsigned int i = 0; i < numStates; i++) {
+            double previous = previous_alpha[i];
+            const float* row = transition + i * numStates;
+            for (unsigned int j = 0; j < numStates; j++)
+                alpha[j] += previous * row[j];
+        }
+    }
+
+    static void backward(double* beta, const double* weighted_beta,
+                         const float* transition, unsigned int numStates,
+                         unsigned int) {
+        for (unsigned int i = 0; i < numStates; i++) {
+            const float* row = transition + i * numStates;
+            double sum(0.);
+            for (unsigned int j = 0; j < numStates; j++)
+                sum += row[j] * weighted_beta[j];
+            beta[i] = sum;
+        }
+    }
+};
+
+/**
+ @brief Transitions of a left-right model (self and next-state transitions,
+ the last state can loop to the first one)
+ */
+struct LeftRightTransitions {
+    static void forward(double* alpha, const double* previous_alpha,
+                        const float* transition, unsigned int numStates,
+                        unsigned int) {
+        alpha[0] = previous_alpha[0] * transition[0] +
+                   previous_alpha[numStates - 1] * transition[numStates * 2 - 1];
+        for (unsigned int j = 1; j < numStates; j++)
+            alpha[j] = previous_alpha[j] * transition[j * 2] +
+                       previous_alpha[j - 1] * transition[j * 2 - 1];
+    }
+
+    static void backward(double* beta, const double* weighted_beta,
+                         const float* transition, unsigned int numStates,
+                         unsigned int) {
+        for (unsigned int i = 0; i + 1 < numStates; i++)
+            beta[i] = transition[i * 2] * weighted_beta[i] +
+                      transition[i * 2 + 1] * weighted_beta[i + 1];
+        beta[numStates - 1] =
+            transition[(numStates - 1) * 2] * weighted_beta[numStates - 1];
+    }
+};
+
+/**
+ @brief Transitions of a banded left-right model (transitions from each state
+ to itself and to the (width - 1) following states, the last state can loop to
+ the first one). The transition matrix is stored as numStates x width.
+ */
+struct BandedTransitions {
+    static void forward(double* alpha, const double* previous_alpha,
+                        const float* transition, unsigned int numStates,
+                        unsigned int width) {
+        for (unsigned int j = 0; j < numStates; j++) {
+            unsigned int band = std::min(j + 1, width);
+            double sum(0.);
+            for (unsigned int k = 0; k < band; k++)
+                sum += previous_alpha[j - k] * transition[(j - k) * width + k];
+            alpha[j] = sum;
+        }
+        alpha[0] += previous_alpha[numStates - 1] *
+                    transition[(numStates - 1) * width + 1];
+    }
+
+    static void backward(double* beta, const double* weighted_beta,
+                         const float* transition, unsigned int numStates,
+                         unsigned int width) {
+        for (unsigned int i = 0; i < numStates; i++) {
+            unsigned int band = std::min(width, numStates - i);
+            const float* row = transition + i * width;
+            double sum(0.);
+            for (unsigned int k = 0; k < band; k++)
+                sum += row[k] * weighted_beta[i + k];
+            beta[i] = sum;
+        }
+    }
+};
+
+/**
+ @brief Observation probabilities on the full observation vector
+ */
+struct UnimodalObservation {
+    static double likelihood(xmm::GaussianDistribution const& component,
+                             const float* observation, const float*) {
+        return component.likelihood(observation);
+    }
+};
+
+/**
+ @brief Observation probabilities on the input modality
+ */
+struct InputObservation {
+    static double likelihood(xmm::GaussianDistribution const& component,
+                             const float* observation, const float*) {
+        return component.likelihood_input(observation);
+    }
+};
+
+/**
+ @brief Observation probabilities on both modalities
+ */
+struct BimodalObservation {
+    static double likelihood(xmm::GaussianDistribution const& component,
+                             const float* observation,
+                             const float* observation_output) {
+        return component.likelihood_bimodal(observation, observation_output);
+    }
+};
+}
+
+void xmm::SingleClassHMM::selectKernels() {
+    if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
+        forward_kernel_ = &SingleClassHMM::forwardKernel<ErgodicTransitions>;
+        backward_kernel_ = &SingleClassHMM::backwardKernel<ErgodicTransitions>;
+    } else if (parameters.transition_mode.get() ==
+               HMM::TransitionMode::Banded) {
+        forward_kernel_ = &SingleClassHMM::forwardKernel<BandedTransitions>;
+        backward_kernel_ = &SingleClassHMM::backwardKernel<BandedTransitions>;
+    } else {
+        forward_kernel_ = &SingleClassHMM::forwardKernel<LeftRightTransitions>;
+        backward_kernel_ =
+            &SingleClassHMM::backwardKernel<LeftRightTransitions>;
+    }
+    observation_probabilities_.resize(parameters.states.get());
+}
+
+void xmm::SingleClassHMM::updateObservationProbabilities(
+    const float* observation, const float* observation_output) {
+    if (frozen_likelihoods_ || parameters.tied_mixtures.get()) {
+        updateCodebookLikelihoods(observation, observation_output);
+        for (unsigned int i = 0; i < parameters.states.get(); i++)
+            observation_probabilities_[i] =
+                obsProb(i, observation, observation_output);
+    } else if (!shared_parameters->bimodal.get()) {
+        observationKernel<UnimodalObservation>(observation, NULL);
+    } else if (observation_output) {
+        observationKernel<BimodalObservation>(observation, observation_output);
+    } else {
+        observationKernel<InputObservation>(observation, NULL);
+    }
+}
+
+template <typename Modality>
+void xmm::SingleClassHMM::observationKernel(const float* observation,
+                                            const float* observation_output) {
+    unsigned int numStates = parameters.states.get();
+    for (unsigned int i = 0; i < numStates; i++) {
+        SingleClassGMM const& state = states[i];
+        unsigned int numComponents =
+            static_cast<unsigned int>(state.components.size());
+        double p(0.);
+        for (unsigned int c = 0; c < numComponents; c++)
+            p += state.mixture_coeffs[c] *
+                 Modality::likelihood(state.components[c], observation,
+                                      observation_output);
+        observation_probabilities_[i] = p;
+    }
+}
+
+template <typename Topology>
+double xmm::SingleClassHMM::forwardKernel(
+    const double* observation_probabilities) {
+    unsigned int numStates = parameters.states.get();
+
+    previous_alpha_.swap(alpha);
+    previous_alpha_.resize(numStates);
+    alpha.resize(numStates);
+    Topology::forward(&alpha[0], &previous_alpha_[0], &transition[0],
+                      numStates, transitionWidth());
+    double norm_const(0.);
+    for (unsigned int j = 0; j < numStates; j++) {
+        alpha[j] *= observation_probabilities[j];
+        norm_const += alpha[j];
+    }
+    if (norm_const > 1e-300) {
+        for (unsigned int j = 0; j < numStates; j++) alpha[j] /= norm_const;
+        return 1. / norm_const;
+    } else {
+        return 0.;
+    }
+}
+
+template <typename Topology>
+void xmm::SingleClassHMM::backwardKernel(
+    double ct, const double* observation_probabilities) {
+    unsigned int numStates = parameters.states.get();
+
+    // previous_beta_ holds the previous backward variable weighted by the
+    // observation probabilities
+    previous_beta_.swap(beta_);
+    previous_beta_.resize(numStates);
+    beta_.resize(numStates);
+    for (unsigned int j = 0; j < numStates; j++)
+        previous_beta_[j] *= observation_probabilities[j];
+    Topology::backward(&beta_[0], &previous_beta_[0], &transition[0],
+                       numStates, transitionWidth());
+    for (unsigned int i = 0; i < numStates; i++) {
+        beta_[i] *= ct;
+        if (std::isnan(beta_[i]) || std::isinf(fabs(beta_[i]))) {
+            beta_[i] = 1e100;
         }
     }
 }
@@ -340,31 +812,16 @@ double xmm::SingleClassHMM::forward_init(const float* observation,
     unsigned int numStates = parameters.states.get();
 
     double norm_const(0.);
+    updateObservationProbabilities(observation, observation_output);
     if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
+        alpha.resize(numStates);
         for (int i = 0; i < numStates; i++) {
-            if (shared_parameters->bimodal.get()) {
-                if (observation_output)
-                    alpha[i] = prior[i] *
-                               states[i].obsProb_bimodal(observation,
-                                                         observation_output);
-                else
-                    alpha[i] = prior[i] * states[i].obsProb_input(observation);
-            } else {
-                alpha[i] = prior[i] * states[i].obsProb(observation);
-            }
+            alpha[i] = prior[i] * observation_probabilities_[i];
             norm_const += alpha[i];
         }
     } else {
         alpha.assign(numStates, 0.0);
-        if (shared_parameters->bimodal.get()) {
-            if (observation_output)
-                alpha[0] =
-                    states[0].obsProb_bimodal(observation, observation_output);
-            else
-                alpha[0] = states[0].obsProb_input(observation);
-        } else {
-            alpha[0] = states[0].obsProb(observation);
-        }
+        alpha[0] = observation_probabilities_[0];
         norm_const += alpha[0];
     }
     if (norm_const > 0) {
@@ -382,45 +839,8 @@ double xmm::SingleClassHMM::forward_init(const float* observation,
 
 double xmm::SingleClassHMM::forward_update(const float* observation,
                                            const float* observation_output) {
-    unsigned int numStates = parameters.states.get();
-
-    double norm_const(0.);
-    previous_alpha_ = alpha;
-    for (int j = 0; j < numStates; j++) {
-        alpha[j] = 0.;
-        if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
-            for (int i = 0; i < numStates; i++) {
-                alpha[j] += previous_alpha_[i] * transition[i * numStates + j];
-            }
-        } else {
-            alpha[j] += previous_alpha_[j] * transition[j * 2];
-            if (j > 0) {
-                alpha[j] +=
-                    previous_alpha_[j - 1] * transition[(j - 1) * 2 + 1];
-            } else {
-                alpha[0] += previous_alpha_[numStates - 1] *
-                            transition[numStates * 2 - 1];
-            }
-        }
-        if (shared_parameters->bimodal.get()) {
-            if (observation_output)
-                alpha[j] *=
-                    states[j].obsProb_bimodal(observation, observation_output);
-            else
-                alpha[j] *= states[j].obsProb_input(observation);
-        } else {
-            alpha[j] *= states[j].obsProb(observation);
-        }
-        norm_const += alpha[j];
-    }
-    if (norm_const > 1e-300) {
-        for (int j = 0; j < numStates; j++) {
-            alpha[j] /= norm_const;
-        }
-        return 1. / norm_const;
-    } else {
-        return 0.;
-    }
+    updateObservationProbabilities(observation, observation_output);
+    return (this->*forward_kernel_)(&observation_probabilities_[0]);
 }
 
 void xmm::SingleClassHMM::backward_init(double ct) {
@@ -429,64 +849,8 @@ void xmm::SingleClassHMM::backward_init(double ct) {
 
 void xmm::SingleClassHMM::backward_update(double ct, const float* observation,
                                           const float* observation_output) {
-    unsigned int numStates = parameters.states.get();
-
-    previous_beta_ = beta_;
-    for (int i = 0; i < numStates; i++) {
-        beta_[i] = 0.;
-        if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
-            for (int j = 0; j < numStates; j++) {
-                if (shared_parameters->bimodal.get()) {
-                    if (observation_output)
-                        beta_[i] += transition[i * numStates + j] *
-                                    previous_beta_[j] *
-                                    states[j].obsProb_bimodal(
-                                        observation, observation_output);
-                    else
-                        beta_[i] += transition[i * numStates + j] *
-                                    previous_beta_[j] *
-                                    states[j].obsProb_input(observation);
-                } else {
-                    beta_[i] += transition[i * numStates + j] *
-                                previous_beta_[j] *
-                                states[j].obsProb(observation);
-                }
-            }
-        } else {
-            if (shared_parameters->bimodal.get()) {
-                if (observation_output)
-                    beta_[i] += transition[i * 2] * previous_beta_[i] *
-                                states[i].obsProb_bimodal(observation,
-                                                          observation_output);
-                else
-                    beta_[i] += transition[i * 2] * previous_beta_[i] *
-                                states[i].obsProb_input(observation);
-            } else {
-                beta_[i] += transition[i * 2] * previous_beta_[i] *
-                            states[i].obsProb(observation);
-            }
-            if (i < numStates - 1) {
-                if (shared_parameters->bimodal.get()) {
-                    if (observation_output)
-                        beta_[i] += transition[i * 2 + 1] *
-                                    previous_beta_[i + 1] *
-                                    states[i + 1].obsProb_bimodal(
-                                        observation, observation_output);
-                    else
-                        beta_[i] += transition[i * 2 + 1] *
-                                    previous_beta_[i + 1] *
-                                    states[i + 1].obsProb_input(observation);
-                } else {
-                    beta_[i] += transition[i * 2 + 1] * previous_beta_[i + 1] *
-                                states[i + 1].obsProb(observation);
-                }
-            }
-        }
-        beta_[i] *= ct;
-        if (std::isnan(beta_[i]) || std::isinf(fabs(beta_[i]))) {
-            beta_[i] = 1e100;
-        }
-    }
+    updateObservationProbabilities(observation, observation_output);
+    (this->*backward_kernel_)(ct, &observation_probabilities_[0]);
 }
 
 #pragma mark -
@@ -496,19 +860,42 @@ void xmm::SingleClassHMM::emAlgorithmInit(TrainingSet* trainingSet) {
     unsigned int numStates = parameters.states.get();
     unsigned int numGaussians = parameters.gaussians.get();
 
+    shared_codebook_likelihoods_ = NULL;
+    if (parameters.shared_codebook.get() &&
+        (!shared_codebook_ ||
+         shared_codebook_->components.size() != numGaussians))
+        throw std::runtime_error("The shared codebook is not trained");
+
     initParametersToDefault(trainingSet->standardDeviation());
 
-    if (numGaussians > 0) {  // TODO: weird > 0
+    if (parameters.tied_mixtures.get()) {
+        initCodebookWithGMMEM(trainingSet);
+    } else if (numGaussians > 0) {  // TODO: weird > 0
         initMeansCovariancesWithGMMEM(trainingSet);
     } else {
         initMeansWithAllPhrases(trainingSet);
         initCovariances_fullyObserved(trainingSet);
     }
 
+    baumWelch_allocateSequences(trainingSet);
+    gamma_sum_.resize(numStates);
+    gamma_sum_per_mixture_.resize(numStates * numGaussians);
+}
+
+void xmm::SingleClassHMM::emAlgorithmCacheMoments(TrainingSet* trainingSet) {
+    if (parameters.tied_mixtures.get()) return;
+    moment_cache_.build(
+        trainingSet, parameters.covariance_mode.get() ==
+                         GaussianDistribution::CovarianceMode::Full,
+        momentCacheBudget());
+}
+
+void xmm::SingleClassHMM::baumWelch_allocateSequences(
+    TrainingSet* trainingSet) {
+    unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
     unsigned int nbPhrases = trainingSet->size();
 
-    // Initialize Algorithm variables
-    // ---------------------------------------
     gamma_sequence_.resize(nbPhrases);
     epsilon_sequence_.resize(nbPhrases);
     gamma_sequence_per_mixture_.resize(nbPhrases);
@@ -520,7 +907,7 @@ void xmm::SingleClassHMM::emAlgorithmInit(TrainingSet* trainingSet) {
         if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
             epsilon_sequence_[i].resize(T * numStates * numStates);
         } else {
-            epsilon_sequence_[i].resize(T * 2 * numStates);
+            epsilon_sequence_[i].resize(T * transitionWidth() * numStates);
         }
         gamma_sequence_per_mixture_[i].resize(numGaussians);
         for (int c = 0; c < numGaussians; c++) {
@@ -533,9 +920,6 @@ void xmm::SingleClassHMM::emAlgorithmInit(TrainingSet* trainingSet) {
     }
     alpha_seq_.resize(maxT * numStates);
     beta_seq_.resize(maxT * numStates);
-
-    gamma_sum_.resize(numStates);
-    gamma_sum_per_mixture_.resize(numStates * numGaussians);
 }
 
 void xmm::SingleClassHMM::emAlgorithmTerminate() {
@@ -547,6 +931,9 @@ void xmm::SingleClassHMM::emAlgorithmTerminate() {
     beta_seq_.clear();
     gamma_sum_.clear();
     gamma_sum_per_mixture_.clear();
+    component_statistics_.clear();
+    prior_statistics_.clear();
+    transition_statistics_.clear();
     SingleClassProbabilisticModel::emAlgorithmTerminate();
 }
 
@@ -574,9 +961,10 @@ double xmm::SingleClassHMM::emAlgorithmUpdate(TrainingSet* trainingSet) {
     for (int i = 0; i < numStates; i++) {
         for (int c = 0; c < parameters.gaussians.get(); c++) {
             states[i].mixture_coeffs[c] = 0.;
+            if (parameters.tied_mixtures.get()) continue;
             if (parameters.covariance_mode.get() ==
                 GaussianDistribution::CovarianceMode::Full) {
-                states[i].components[c].covariance.assign(dimension * dimension,
+                states[i].components[c].covariance.assign(packedSize(dimension),
                                                           0.0);
             } else {
                 states[i].components[c].covariance.assign(dimension, 0.0);
@@ -585,8 +973,14 @@ double xmm::SingleClassHMM::emAlgorithmUpdate(TrainingSet* trainingSet) {
     }
 
     baumWelch_estimateMixtureCoefficients(trainingSet);
-    baumWelch_estimateMeans(trainingSet);
-    baumWelch_estimateCovariances(trainingSet);
+    if (parameters.tied_mixtures.get()) {
+        if (!parameters.shared_codebook.get())
+            baumWelch_estimateCodebook(trainingSet);
+        updateCodebookWeights();
+    } else {
+        baumWelch_estimateMeans(trainingSet);
+        baumWelch_estimateCovariances(trainingSet);
+    }
     if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic)
         baumWelch_estimatePrior(trainingSet);
     baumWelch_estimateTransitions(trainingSet);
@@ -594,66 +988,172 @@ double xmm::SingleClassHMM::emAlgorithmUpdate(TrainingSet* trainingSet) {
     return log_prob;
 }
 
-double xmm::SingleClassHMM::baumWelch_forward_update(
-    std::vector<double>::iterator observation_likelihoods) {
+void xmm::SingleClassHMM::emAlgorithmResetStatistics() {
+    unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
+
+    gamma_sum_.assign(numStates, 0.);
+    gamma_sum_per_mixture_.assign(numStates * numGaussians, 0.);
+    if (parameters.shared_codebook.get()) {
+        component_statistics_.clear();
+    } else if (parameters.tied_mixtures.get()) {
+        component_statistics_.resize(numGaussians);
+        for (unsigned int c = 0; c < numGaussians; c++)
+            component_statistics_[c].reset(codebook.components[c].mean,
+                                           full_covariance);
+    } else {
+        component_statistics_.resize(numStates * numGaussians);
+        for (unsigned int i = 0; i < numStates; i++)
+            for (unsigned int c = 0; c < numGaussians; c++)
+                component_statistics_[i * numGaussians + c].reset(
+                    states[i].components[c].mean, full_covariance);
+    }
+    prior_statistics_.assign(numStates, 0.);
+    if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
+        transition_statistics_.assign(numStates * numStates, 0.0);
+    } else {
+        transition_statistics_.assign(numStates * transitionWidth(), 0.0);
+    }
+}
+
+double xmm::SingleClassHMM::emAlgorithmAccumulate(TrainingSet* trainingSet) {
+    int dimension = static_cast<int>(shared_parameters->dimension.get());
     unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
+    bool tied_mixtures = parameters.tied_mixtures.get();
+    bool shared_codebook = parameters.shared_codebook.get();
+    bool ergodic =
+        (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic);
+    unsigned int width = transitionWidth();
 
-    double norm_const(0.);
-    previous_alpha_ = alpha;
-    for (int j = 0; j < numStates; j++) {
-        alpha[j] = 0.;
-        if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
-            for (int i = 0; i < numStates; i++) {
-                alpha[j] += previous_alpha_[i] * transition[i * numStates + j];
+    baumWelch_allocateSequences(trainingSet);
+
+    double log_prob(0.);
+    std::vector<float> frame_buffer(dimension);
+    std::vector<double> gamma_codebook(numGaussians);
+    int phraseIndex(0);
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend();
+         ++it, ++phraseIndex) {
+        Phrase::FrameView frames = it->second->frames();
+        unsigned int T = frames.size();
+        if (T == 0) continue;
+        log_prob += baumWelch_forwardBackward(it->second, phraseIndex);
+
+        // State and component posteriors
+        std::vector<double> const& gamma = gamma_sequence_[phraseIndex];
+        std::vector<std::vector<double> > const& gamma_per_mixture =
+            gamma_sequence_per_mixture_[phraseIndex];
+        for (unsigned int t = 0; t < T; t++) {
+            const float* frame = frames.frame(t, frame_buffer.data());
+            gamma_codebook.assign(numGaussians, 0.);
+            for (unsigned int i = 0; i < numStates; i++) {
+                gamma_sum_[i] += gamma[t * numStates + i];
+                for (unsigned int c = 0; c < numGaussians; c++) {
+                    double weight = gamma_per_mixture[c][t * numStates + i];
+                    gamma_sum_per_mixture_[i * numGaussians + c] += weight;
+                    if (tied_mixtures)
+                        gamma_codebook[c] += weight;
+                    else
+                        component_statistics_[i * numGaussians + c].accumulate(
+                            frame, weight);
+                }
             }
-        } else {
-            alpha[j] += previous_alpha_[j] * transition[j * 2];
-            if (j > 0) {
-                alpha[j] +=
-                    previous_alpha_[j - 1] * transition[(j - 1) * 2 + 1];
+            if (tied_mixtures && !shared_codebook)
+                for (unsigned int c = 0; c < numGaussians; c++)
+                    component_statistics_[c].accumulate(frame,
+                                                        gamma_codebook[c]);
+        }
+
+        // Prior and transitions
+        for (unsigned int i = 0; i < numStates; i++)
+            prior_statistics_[i] += gamma[i];
+        std::vector<double> const& epsilon = epsilon_sequence_[phraseIndex];
+        for (unsigned int i = 0; i < numStates; i++) {
+            if (ergodic) {
+                for (unsigned int j = 0; j < numStates; j++)
+                    for (unsigned int t = 0; t < T - 1; t++)
+                        transition_statistics_[i * numStates + j] +=
+                            epsilon[t * numStates * numStates + i * numStates +
+                                    j];
             } else {
-                alpha[0] += previous_alpha_[numStates - 1] *
-                            transition[numStates * 2 - 1];
+                // regularization (see baumWelch_estimateTransitions)
+                for (unsigned int k = 0; k < width; k++)
+                    transition_statistics_[i * width +
+                                           ((i + k < numStates) ? k : 0)] +=
+                        TRANSITION_REGULARIZATION();
+                unsigned int band = std::min(width, numStates - i);
+                for (unsigned int k = 0; k < band; k++)
+                    for (unsigned int t = 0; t < T - 1; t++)
+                        transition_statistics_[i * width + k] +=
+                            epsilon[t * width * numStates + i * width + k];
             }
         }
-        alpha[j] *= observation_likelihoods[j];
-        norm_const += alpha[j];
-    }
-    if (norm_const > 1e-300) {
-        for (int j = 0; j < numStates; j++) {
-            alpha[j] /= norm_const;
-        }
-        return 1. / norm_const;
-    } else {
-        return 0.;
     }
+    return log_prob;
 }
 
-void xmm::SingleClassHMM::baumWelch_backward_update(
-    double ct, std::vector<double>::iterator observation_likelihoods) {
+void xmm::SingleClassHMM::emAlgorithmEstimate() {
     unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
 
-    previous_beta_ = beta_;
-    for (int i = 0; i < numStates; i++) {
-        beta_[i] = 0.;
-        if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
-            for (int j = 0; j < numStates; j++) {
-                beta_[i] += transition[i * numStates + j] * previous_beta_[j] *
-                            observation_likelihoods[j];
-            }
-        } else {
-            beta_[i] += transition[i * 2] * previous_beta_[i] *
-                        observation_likelihoods[i];
-            if (i < numStates - 1) {
-                beta_[i] += transition[i * 2 + 1] * previous_beta_[i + 1] *
-                            observation_likelihoods[i + 1];
-            }
+    // Mixture coefficients
+    for (unsigned int i = 0; i < numStates; i++) {
+        for (unsigned int c = 0; c < numGaussians; c++)
+            states[i].mixture_coeffs[c] =
+                gamma_sum_per_mixture_[i * numGaussians + c];
+        states[i].normalizeMixtureCoeffs();
+    }
+
+    // Components
+    if (parameters.shared_codebook.get()) {
+        updateCodebookWeights();
+    } else if (parameters.tied_mixtures.get()) {
+        for (unsigned int c = 0; c < numGaussians; c++) {
+            component_statistics_[c].estimate(codebook.components[c]);
+            codebook.mixture_coeffs[c] = component_statistics_[c].weight;
         }
-        beta_[i] *= ct;
-        if (std::isnan(beta_[i]) || std::isinf(fabs(beta_[i]))) {
-            beta_[i] = 1e100;
+        codebook.addCovarianceOffset();
+        codebook.updateInverseCovariances();
+        codebook.normalizeMixtureCoeffs();
+        updateCodebookWeights();
+    } else {
+        for (unsigned int i = 0; i < numStates; i++) {
+            for (unsigned int c = 0; c < numGaussians; c++) {
+                GaussianDistribution& component = states[i].components[c];
+                component_statistics_[i * numGaussians + c].estimate(component);
+                for (auto value : component.mean)
+                    if (std::isnan(value))
+                        throw std::runtime_error("Convergence Error");
+            }
+            states[i].addCovarianceOffset();
+            states[i].updateInverseCovariances();
         }
     }
+
+    // Prior and transitions
+    if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
+        double sumprior(0.);
+        for (unsigned int i = 0; i < numStates; i++)
+            sumprior += prior_statistics_[i];
+        if (sumprior > 0.)
+            for (unsigned int i = 0; i < numStates; i++)
+                prior[i] = prior_statistics_[i] / sumprior;
+    }
+    transition.assign(transition_statistics_.begin(),
+                      transition_statistics_.end());
+    baumWelch_scaleTransitions();
+}
+
+double xmm::SingleClassHMM::baumWelch_forward_update(
+    std::vector<double>::iterator observation_likelihoods) {
+    return (this->*forward_kernel_)(&*observation_likelihoods);
+}
+
+void xmm::SingleClassHMM::baumWelch_backward_update(
+    double ct, std::vector<double>::iterator observation_likelihoods) {
+    (this->*backward_kernel_)(ct, &*observation_likelihoods);
 }
 
 double xmm::SingleClassHMM::baumWelch_forwardBackward(
@@ -666,19 +1166,27 @@ double xmm::SingleClassHMM::baumWelch_forwardBackward(
 
     double log_prob;
 
+    unsigned int numGaussians = parameters.gaussians.get();
     std::vector<double> observation_probabilities(numStates * T);
+    std::vector<double> codebook_probabilities;
+    if (parameters.tied_mixtures.get())
+        codebook_probabilities.resize(numGaussians * T);
     for (unsigned int t = 0; t < T; ++t) {
-        for (unsigned int i = 0; i < numStates; i++) {
-            if (shared_parameters->bimodal.get()) {
-                observation_probabilities[t * numStates + i] =
-                    states[i].obsProb_bimodal(
-                        currentPhrase->getPointer_input(t),
-                        currentPhrase->getPointer_output(t));
-            } else {
-                observation_probabilities[t * numStates + i] =
-                    states[i].obsProb(currentPhrase->getPointer(t));
-            }
-        }
+        const float* observation = shared_parameters->bimodal.get()
+                                       ? currentPhrase->getPointer_input(t)
+                                       : currentPhrase->getPointer(t);
+        const float* observation_output =
+            shared_parameters->bimodal.get()
+                ? currentPhrase->getPointer_output(t)
+                : NULL;
+        updateObservationProbabilities(observation, observation_output);
+        std::copy(observation_probabilities_.begin(),
+                  observation_probabilities_.end(),
+                  observation_probabilities.begin() + t * numStates);
+        if (parameters.tied_mixtures.get())
+            std::copy(codebook_likelihoods_.begin(),
+                      codebook_likelihoods_.end(),
+                      codebook_probabilities.begin() + t * numGaussians);
     }
 
     // Forward algorithm
@@ -733,7 +1241,10 @@ double xmm::SingleClassHMM::baumWelch_forwardBackward(
                 norm_const += oo;
             } else {
                 for (int c = 0; c < parameters.gaussians.get(); c++) {
-                    if (shared_parameters->bimodal.get()) {
+                    if (parameters.tied_mixtures.get()) {
+                        oo = states[i].mixture_coeffs[c] *
+                             codebook_probabilities[t * numGaussians + c];
+                    } else if (shared_parameters->bimodal.get()) {
                         oo = states[i].obsProb_bimodal(
                             currentPhrase->getPointer_input(t),
                             currentPhrase->getPointer_output(t), c);
@@ -771,21 +1282,17 @@ double xmm::SingleClassHMM::baumWelch_forwardBackward(
             }
         }
     } else {
+        unsigned int width = transitionWidth();
         for (int t = 0; t < T - 1; t++) {
             for (int i = 0; i < numStates; i++) {
-                epsilon_sequence_[phraseIndex][t * 2 * numStates + i * 2] =
-                    alpha_seq_[t * numStates + i] * transition[i * 2] *
-                    beta_seq_[(t + 1) * numStates + i];
-                epsilon_sequence_[phraseIndex][t * 2 * numStates + i * 2] *=
-                    observation_probabilities[(t + 1) * numStates + i];
-                if (i < numStates - 1) {
-                    epsilon_sequence_[phraseIndex][t * 2 * numStates + i * 2 +
-                                                   1] =
-                        alpha_seq_[t * numStates + i] * transition[i * 2 + 1] *
-                        beta_seq_[(t + 1) * numStates + i + 1];
-                    epsilon_sequence_[phraseIndex][t * 2 * numStates + i * 2 +
-                                                   1] *=
-                        observation_probabilities[(t + 1) * numStates + i + 1];
+                unsigned int band = std::min(width, numStates - i);
+                for (unsigned int k = 0; k < band; k++) {
+                    epsilon_sequence_[phraseIndex][t * width * numStates +
+                                                   i * width + k] =
+                        alpha_seq_[t * numStates + i] *
+                        transition[i * width + k] *
+                        beta_seq_[(t + 1) * numStates + i + k] *
+                        observation_probabilities[(t + 1) * numStates + i + k];
                 }
             }
         }
@@ -863,17 +1370,20 @@ void xmm::SingleClassHMM::baumWelch_estimateMeans(TrainingSet* trainingSet) {
     }
 
     // Re-estimate Mean
+    std::vector<float> frame_buffer(dimension);
     int phraseIndex(0);
     for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); it++) {
-        phraseLength = it->second->size();
-        for (int i = 0; i < numStates; i++) {
-            for (int t = 0; t < phraseLength; t++) {
+        Phrase::FrameView frames = it->second->frames();
+        phraseLength = frames.size();
+        for (int t = 0; t < phraseLength; t++) {
+            const float* frame = frames.frame(t, frame_buffer.data());
+            for (int i = 0; i < numStates; i++) {
                 for (int c = 0; c < numGaussians; c++) {
+                    double gamma = gamma_sequence_per_mixture_[phraseIndex][c]
+                                                              [t * numStates + i];
+                    double* mean = states[i].components[c].mean.data();
                     for (int d = 0; d < dimension; d++) {
-                        states[i].components[c].mean[d] +=
-                            gamma_sequence_per_mixture_[phraseIndex][c]
-                                                       [t * numStates + i] *
-                            it->second->getValue(t, d);
+                        mean[d] += gamma * frame[d];
                     }
                 }
             }
@@ -904,33 +1414,45 @@ void xmm::SingleClassHMM::baumWelch_estimateCovariances(
 
     unsigned int phraseLength;
 
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
+    // with the moment cache, the raw second moments are accumulated and
+    // corrected by the means after the summation
+    bool use_cache = !moment_cache_.empty();
+    std::vector<float> frame_buffer(dimension);
+    std::vector<double> centered(dimension);
     int phraseIndex(0);
+    std::size_t frameIndex(0);
     for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); it++) {
-        phraseLength = it->second->size();
-        for (int i = 0; i < numStates; i++) {
-            for (int t = 0; t < phraseLength; t++) {
+        Phrase::FrameView frames = it->second->frames();
+        phraseLength = frames.size();
+        for (int t = 0; t < phraseLength; t++, frameIndex++) {
+            const float* frame = (frameIndex < moment_cache_.size())
+                                     ? NULL
+                                     : frames.frame(t, frame_buffer.data());
+            for (int i = 0; i < numStates; i++) {
                 for (int c = 0; c < numGaussians; c++) {
-                    for (int d1 = 0; d1 < dimension; d1++) {
-                        if (parameters.covariance_mode.get() ==
-                            GaussianDistribution::CovarianceMode::Full) {
+                    double gamma = gamma_sequence_per_mixture_[phraseIndex][c]
+                                                              [t * numStates + i];
+                    const double* mean = states[i].components[c].mean.data();
+                    double* covariance =
+                        states[i].components[c].covariance.data();
+                    if (use_cache) {
+                        moment_cache_.accumulate(frameIndex, frame, gamma,
+                                                 covariance);
+                    } else if (full_covariance) {
+                        for (int d = 0; d < dimension; d++)
+                            centered[d] = frame[d] - mean[d];
+                        for (int d1 = 0; d1 < dimension; d1++) {
+                            double weighted = gamma * centered[d1];
                             for (int d2 = d1; d2 < dimension; d2++) {
-                                states[i]
-                                    .components[c]
-                                    .covariance[d1 * dimension + d2] +=
-                                    gamma_sequence_per_mixture_
-                                        [phraseIndex][c][t * numStates + i] *
-                                    (it->second->getValue(t, d1) -
-                                     states[i].components[c].mean[d1]) *
-                                    (it->second->getValue(t, d2) -
-                                     states[i].components[c].mean[d2]);
+                                *covariance++ += weighted * centered[d2];
                             }
-                        } else {
-                            float value = it->second->getValue(t, d1) -
-                                          states[i].components[c].mean[d1];
-                            states[i].components[c].covariance[d1] +=
-                                gamma_sequence_per_mixture_[phraseIndex][c]
-                                                           [t * numStates + i] *
-                                value * value;
+                        }
+                    } else {
+                        for (int d1 = 0; d1 < dimension; d1++) {
+                            float value = frame[d1] - mean[d1];
+                            covariance[d1] += gamma * value * value;
                         }
                     }
                 }
@@ -942,32 +1464,122 @@ void xmm::SingleClassHMM::baumWelch_estimateCovariances(
     // Scale covariance
     for (int i = 0; i < numStates; i++) {
         for (int c = 0; c < numGaussians; c++) {
-            if (gamma_sum_per_mixture_[i * numGaussians + c] > 0) {
-                for (int d1 = 0; d1 < dimension; d1++) {
-                    if (parameters.covariance_mode.get() ==
-                        GaussianDistribution::CovarianceMode::Full) {
+            double gamma_sum = gamma_sum_per_mixture_[i * numGaussians + c];
+            if (gamma_sum <= 0) continue;
+            if (use_cache) {
+                MomentCache::toCovariance(states[i].components[c].covariance,
+                                          states[i].components[c].mean,
+                                          gamma_sum, full_covariance);
+            } else {
+                for (auto& value : states[i].components[c].covariance)
+                    value /= gamma_sum;
+            }
+        }
+        states[i].addCovarianceOffset();
+        states[i].updateInverseCovariances();
+    }
+}
+
+void xmm::SingleClassHMM::baumWelch_estimateCodebook(TrainingSet* trainingSet) {
+    int dimension = static_cast<int>(shared_parameters->dimension.get());
+    unsigned int numStates = parameters.states.get();
+    unsigned int numGaussians = parameters.gaussians.get();
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
+
+    // Posterior of each codebook component summed over all states
+    std::vector<double> gamma_sum_codebook(numGaussians, 0.0);
+    for (int c = 0; c < numGaussians; c++) {
+        for (int i = 0; i < numStates; i++) {
+            gamma_sum_codebook[c] +=
+                gamma_sum_per_mixture_[i * numGaussians + c];
+        }
+        codebook.components[c].mean.assign(dimension, 0.0);
+        codebook.components[c].covariance.assign(
+            full_covariance ? packedSize(dimension) : dimension, 0.0);
+    }
+
+    unsigned int phraseLength;
+
+    // Re-estimate Means
+    std::vector<float> frame_buffer(dimension);
+    int phraseIndex(0);
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); it++) {
+        Phrase::FrameView frames = it->second->frames();
+        phraseLength = frames.size();
+        for (int t = 0; t < phraseLength; t++) {
+            const float* frame = frames.frame(t, frame_buffer.data());
+            for (int c = 0; c < numGaussians; c++) {
+                double gamma(0.);
+                for (int i = 0; i < numStates; i++)
+                    gamma += gamma_sequence_per_mixture_[phraseIndex][c]
+                                                        [t * numStates + i];
+                double* mean = codebook.components[c].mean.data();
+                for (int d = 0; d < dimension; d++) {
+                    mean[d] += gamma * frame[d];
+                }
+            }
+        }
+        phraseIndex++;
+    }
+    for (int c = 0; c < numGaussians; c++) {
+        for (int d = 0; d < dimension; d++) {
+            if (gamma_sum_codebook[c] > 0)
+                codebook.components[c].mean[d] /= gamma_sum_codebook[c];
+            if (std::isnan(codebook.components[c].mean[d]))
+                throw std::runtime_error("Convergence Error");
+        }
+    }
+
+    // Re-estimate Covariances
+    std::vector<double> centered(dimension);
+    phraseIndex = 0;
+    for (auto it = trainingSet->cbegin(); it != trainingSet->cend(); it++) {
+        Phrase::FrameView frames = it->second->frames();
+        phraseLength = frames.size();
+        for (int t = 0; t < phraseLength; t++) {
+            const float* frame = frames.frame(t, frame_buffer.data());
+            for (int c = 0; c < numGaussians; c++) {
+                GaussianDistribution& component = codebook.components[c];
+                double gamma(0.);
+                for (int i = 0; i < numStates; i++)
+                    gamma += gamma_sequence_per_mixture_[phraseIndex][c]
+                                                        [t * numStates + i];
+                const double* mean = component.mean.data();
+                double* covariance = component.covariance.data();
+                if (full_covariance) {
+                    for (int d = 0; d < dimension; d++)
+                        centered[d] = frame[d] - mean[d];
+                    for (int d1 = 0; d1 < dimension; d1++) {
+                        float value1 = centered[d1];
+                        double weighted = gamma * value1;
                         for (int d2 = d1; d2 < dimension; d2++) {
-                            states[i].components[c].covariance[d1 * dimension +
-                                                               d2] /=
-                                gamma_sum_per_mixture_[i * numGaussians + c];
-                            if (d1 != d2)
-                                states[i]
-                                    .components[c]
-                                    .covariance[d2 * dimension + d1] =
-                                    states[i]
-                                        .components[c]
-                                        .covariance[d1 * dimension + d2];
+                            *covariance++ += weighted * centered[d2];
                         }
-                    } else {
-                        states[i].components[c].covariance[d1] /=
-                            gamma_sum_per_mixture_[i * numGaussians + c];
+                    }
+                } else {
+                    for (int d1 = 0; d1 < dimension; d1++) {
+                        float value = frame[d1] - mean[d1];
+                        covariance[d1] += gamma * value * value;
                     }
                 }
             }
         }
-        states[i].addCovarianceOffset();
-        states[i].updateInverseCovariances();
+        phraseIndex++;
+    }
+    for (int c = 0; c < numGaussians; c++) {
+        GaussianDistribution& component = codebook.components[c];
+        if (gamma_sum_codebook[c] <= 0) continue;
+        for (auto& value : component.covariance)
+            value /= gamma_sum_codebook[c];
     }
+    codebook.addCovarianceOffset();
+    codebook.updateInverseCovariances();
+
+    // Global weights of the codebook components
+    for (int c = 0; c < numGaussians; c++)
+        codebook.mixture_coeffs[c] = gamma_sum_codebook[c];
+    codebook.normalizeMixtureCoeffs();
 }
 
 void xmm::SingleClassHMM::baumWelch_estimatePrior(TrainingSet* trainingSet) {
@@ -1003,9 +1615,10 @@ void xmm::SingleClassHMM::baumWelch_estimateTransitions(
     if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
         transition.assign(numStates * numStates, 0.0);
     } else {
-        transition.assign(numStates * 2, 0.0);
+        transition.assign(numStates * transitionWidth(), 0.0);
     }
 
+    unsigned int width = transitionWidth();
     unsigned int phraseLength;
     // Re-estimate Prior and Transition probabilities
     unsigned int phraseIndex(0);
@@ -1016,13 +1629,16 @@ void xmm::SingleClassHMM::baumWelch_estimateTransitions(
                 // Experimental: A bit of regularization (sometimes avoids
                 // numerical
                 // errors)
-                if (parameters.transition_mode.get() ==
-                    HMM::TransitionMode::LeftRight) {
-                    transition[i * 2] += TRANSITION_REGULARIZATION();
-                    if (i < numStates - 1)
-                        transition[i * 2 + 1] += TRANSITION_REGULARIZATION();
-                    else
-                        transition[i * 2] += TRANSITION_REGULARIZATION();
+                if (parameters.transition_mode.get() !=
+                    HMM::TransitionMode::Ergodic) {
+                    for (unsigned int k = 0; k < width; k++) {
+                        if (i + k < numStates)
+                            transition[i * width + k] +=
+                                TRANSITION_REGULARIZATION();
+                        else
+                            transition[i * width] +=
+                                TRANSITION_REGULARIZATION();
+                    }
                 }
                 // End Regularization
                 if (parameters.transition_mode.get() ==
@@ -1037,17 +1653,13 @@ void xmm::SingleClassHMM::baumWelch_estimateTransitions(
                         }
                     }
                 } else {
-                    for (int t = 0; t < phraseLength - 1; t++) {
-                        transition[i * 2] +=
-                            epsilon_sequence_[phraseIndex][t * 2 * numStates +
-                                                           i * 2];
-                    }
-                    if (i < numStates - 1) {
+                    unsigned int band = std::min(width, numStates - i);
+                    for (unsigned int k = 0; k < band; k++) {
                         for (int t = 0; t < phraseLength - 1; t++) {
-                            transition[i * 2 + 1] +=
-                                epsilon_sequence_[phraseIndex][t * 2 *
-                                                                   numStates +
-                                                               i * 2 + 1];
+                            transition[i * width + k] +=
+                                epsilon_sequence_[phraseIndex]
+                                                 [t * width * numStates +
+                                                  i * width + k];
                         }
                     }
                 }
@@ -1056,7 +1668,12 @@ void xmm::SingleClassHMM::baumWelch_estimateTransitions(
         phraseIndex++;
     }
 
-    // Scale transition matrix
+    baumWelch_scaleTransitions();
+}
+
+void xmm::SingleClassHMM::baumWelch_scaleTransitions() {
+    unsigned int numStates = parameters.states.get();
+    unsigned int width = transitionWidth();
     if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
         for (int i = 0; i < numStates; i++) {
             for (int j = 0; j < numStates; j++) {
@@ -1070,16 +1687,11 @@ void xmm::SingleClassHMM::baumWelch_estimateTransitions(
         }
     } else {
         for (int i = 0; i < numStates; i++) {
-            transition[i * 2] /=
-                (gamma_sum_[i] + 2. * TRANSITION_REGULARIZATION());
-            if (std::isnan(transition[i * 2]))
-                throw std::runtime_error(
-                    "Convergence Error. Check your training data or increase "
-                    "the variance offset");
-            if (i < numStates - 1) {
-                transition[i * 2 + 1] /=
-                    (gamma_sum_[i] + 2. * TRANSITION_REGULARIZATION());
-                if (std::isnan(transition[i * 2 + 1]))
+            unsigned int band = std::min(width, numStates - i);
+            for (unsigned int k = 0; k < band; k++) {
+                transition[i * width + k] /=
+                    (gamma_sum_[i] + width * TRANSITION_REGULARIZATION());
+                if (std::isnan(transition[i * width + k]))
                     throw std::runtime_error(
                         "Convergence Error. Check your training data or "
                         "increase the variance offset");
@@ -1093,8 +1705,12 @@ void xmm::SingleClassHMM::baumWelch_estimateTransitions(
 
 void xmm::SingleClassHMM::reset() {
     check_training();
+    if (parameters.shared_codebook.get() && !shared_codebook_)
+        throw std::runtime_error(
+            "The class is not attached to a shared codebook");
     SingleClassProbabilisticModel::reset();
     forward_initialized_ = false;
+    selectKernels();
     if (is_hierarchical_) {
         for (int i = 0; i < 3; i++)
             alpha_h[i].resize(parameters.states.get(), 0.0);
@@ -1103,8 +1719,29 @@ void xmm::SingleClassHMM::reset() {
         beta_.clear();
         previous_beta_.clear();
     } else {
+        // the forward kernels swap alpha and previous_alpha_: both buffers
+        // must hold a frame to filter without allocation
+        alpha.resize(parameters.states.get(), 0.0);
+        previous_alpha_.resize(parameters.states.get(), 0.0);
         addCyclicTransition(0.05);
     }
+    for (auto& state : states) state.reset();
+    if (shared_parameters->bimodal.get()) {
+        unsigned int dimension_output =
+            shared_parameters->dimension.get() -
+            shared_parameters->dimension_input.get();
+        results.output_values.resize(dimension_output);
+        results.output_covariance.resize(
+            (parameters.covariance_mode.get() ==
+             GaussianDistribution::CovarianceMode::Full)
+                ? dimension_output * dimension_output
+                : dimension_output);
+        if (parameters.tied_mixtures.get()) {
+            codebook_output_values_.resize(parameters.gaussians.get());
+            for (auto& output_values : codebook_output_values_)
+                output_values.resize(dimension_output);
+        }
+    }
 }
 
 void xmm::SingleClassHMM::addCyclicTransition(double proba) {
@@ -1114,11 +1751,21 @@ void xmm::SingleClassHMM::addCyclicTransition(double proba) {
     if (parameters.transition_mode.get() == HMM::TransitionMode::Ergodic) {
         if (numStates > 1) transition[(numStates - 1) * numStates] = proba;
     } else {
-        if (numStates > 1) transition[(numStates - 1) * 2 + 1] = proba;
+        if (numStates > 1)
+            transition[(numStates - 1) * transitionWidth() + 1] = proba;
     }
 }
 
 double xmm::SingleClassHMM::filter(std::vector<float> const& observation) {
+    filterLikelihood(observation);
+    if (shared_parameters->bimodal.get()) {
+        regression(observation);
+    }
+    return results.instant_likelihood;
+}
+
+double xmm::SingleClassHMM::filterLikelihood(
+    std::vector<float> const& observation) {
     check_training();
     double ct;
 
@@ -1135,10 +1782,6 @@ double xmm::SingleClassHMM::filter(std::vector<float> const& observation) {
     updateAlphaWindow();
     updateResults();
 
-    if (shared_parameters->bimodal.get()) {
-        regression(observation);
-    }
-
     return results.instant_likelihood;
 }
 
@@ -1205,12 +1848,18 @@ void xmm::SingleClassHMM::regression(
             ? dimension_output * dimension_output
             : dimension_output,
         0.0);
-    std::vector<float> tmp_predicted_output(dimension_output);
+
+    if (parameters.tied_mixtures.get()) {
+        SingleClassGMM const& tied_codebook = tiedCodebook();
+        codebook_output_values_.resize(parameters.gaussians.get());
+        for (unsigned int c = 0; c < parameters.gaussians.get(); c++)
+            tied_codebook.components[c].regression(
+                observation_input, codebook_output_values_[c]);
+    }
 
     if (parameters.regression_estimator.get() ==
         HMM::RegressionEstimator::Likeliest) {
-        states[results.likeliest_state].likelihood(observation_input);
-        states[results.likeliest_state].regression(observation_input);
+        stateRegression(results.likeliest_state, observation_input);
         results.output_values =
             states[results.likeliest_state].results.output_values;
         return;
@@ -1233,9 +1882,9 @@ void xmm::SingleClassHMM::regression(
 
     // Compute Regression
     for (unsigned int i = clip_min_state; i < clip_max_state; ++i) {
-        states[i].likelihood(observation_input);
-        states[i].regression(observation_input);
-        tmp_predicted_output = states[i].results.output_values;
+        stateRegression(i, observation_input);
+        std::vector<float> const& tmp_predicted_output =
+            states[i].results.output_values;
         for (unsigned int d = 0; d < dimension_output; ++d) {
             if (is_hierarchical_) {
                 results.output_values[d] += (alpha_h[0][i] + alpha_h[1][i]) *
@@ -1282,14 +1931,64 @@ void xmm::SingleClassHMM::regression(
     }
 }
 
+void xmm::SingleClassHMM::stateRegression(
+    unsigned int stateIndex, std::vector<float> const& observation_input) {
+    if (!parameters.tied_mixtures.get()) {
+        states[stateIndex].likelihood(observation_input);
+        states[stateIndex].regression(observation_input);
+        return;
+    }
+    unsigned int dimension_output = shared_parameters->dimension.get() -
+                                   shared_parameters->dimension_input.get();
+    bool full_covariance = (parameters.covariance_mode.get() ==
+                            GaussianDistribution::CovarianceMode::Full);
+    ClassResults<GMM>& state_results = states[stateIndex].results;
+    state_results.output_values.assign(dimension_output, 0.0);
+    state_results.output_covariance.assign(
+        full_covariance ? dimension_output * dimension_output
+                        : dimension_output,
+        0.0);
+
+    // the codebook likelihoods of the input observation are computed by the
+    // forward algorithm
+    SingleClassGMM const& tied_codebook = tiedCodebook();
+    const double* likelihoods = shared_codebook_likelihoods_
+                                    ? shared_codebook_likelihoods_
+                                    : codebook_likelihoods_.data();
+    double norm_const(0.);
+    for (unsigned int k = codebook_weights_.row_pointers[stateIndex];
+         k < codebook_weights_.row_pointers[stateIndex + 1]; k++) {
+        norm_const += codebook_weights_.values[k] *
+                      likelihoods[codebook_weights_.column_indices[k]];
+    }
+    if (norm_const <= 0.) return;
+    for (unsigned int k = codebook_weights_.row_pointers[stateIndex];
+         k < codebook_weights_.row_pointers[stateIndex + 1]; k++) {
+        unsigned int c = codebook_weights_.column_indices[k];
+        double beta =
+            codebook_weights_.values[k] * likelihoods[c] / norm_const;
+        for (unsigned int d = 0; d < dimension_output; ++d) {
+            state_results.output_values[d] +=
+                beta * codebook_output_values_[c][d];
+            if (full_covariance) {
+                for (unsigned int d2 = 0; d2 < dimension_output; ++d2)
+                    state_results
+                        .output_covariance[d * dimension_output + d2] +=
+                        beta * beta *
+                        tied_codebook.components[c]
+                            .output_covariance[d * dimension_output + d2];
+            } else {
+                state_results.output_covariance[d] +=
+                    beta * beta *
+                    tied_codebook.components[c].output_covariance[d];
+            }
+        }
+    }
+}
+
 void xmm::SingleClassHMM::updateResults() {
     likelihood_buffer_.push(log(results.instant_likelihood));
-    results.log_likelihood = 0.0;
-    unsigned int bufSize = likelihood_buffer_.size_t();
-    for (unsigned int i = 0; i < bufSize; i++) {
-        results.log_likelihood += likelihood_buffer_(0, i);
-    }
-    results.log_likelihood /= double(bufSize);
+    results.log_likelihood = likelihood_buffer_.mean(0);
 
     results.progress = 0.0;
     for (int i = window_minindex_; i < window_maxindex_; ++i) {
@@ -1331,6 +2030,8 @@ Json::Value xmm::SingleClassHMM::toJson() const {
     for (int s = 0; s < parameters.states.get(); s++) {
         root["states"][s] = states[s].toJson();
     }
+    if (parameters.tied_mixtures.get() && !parameters.shared_codebook.get())
+        root["codebook"] = codebook.toJson();
     return root;
 }
 
@@ -1338,12 +2039,59 @@ void xmm::SingleClassHMM::fromJson(Json::Value const& root) {
     check_training();
     try {
         SingleClassHMM tmp(shared_parameters, root);
-        *this = tmp;
+        *this = std::move(tmp);
     } catch (JsonException& e) {
         throw e;
     }
 }
 
+void xmm::SingleClassHMM::writeBinary(BinaryWriter& writer) const {
+    SingleClassProbabilisticModel::writeBinary(writer);
+    parameters.writeBinary(writer);
+    writer.writeParameters(prior);
+    writer.writeParameters(transition);
+    writer.writeParameters(exit_probabilities_);
+    for (auto const& state : states) {
+        state.writeBinary(writer);
+    }
+    if (parameters.tied_mixtures.get() && !parameters.shared_codebook.get())
+        codebook.writeBinary(writer);
+}
+
+void xmm::SingleClassHMM::readBinary(BinaryReader& reader) {
+    SingleClassProbabilisticModel::readBinary(reader);
+    parameters.readBinary(reader);
+
+    allocate();
+
+    reader.readParameters(prior, prior.size());
+    reader.readParameters(transition, transition.size());
+    reader.readParameters(exit_probabilities_);
+    if (!exit_probabilities_.empty() &&
+        exit_probabilities_.size() != parameters.states.get())
+        throw std::runtime_error("Corrupted model file");
+
+    for (auto& state : states) {
+        state.readBinary(reader);
+        if (state.parameters.gaussians.get() != parameters.gaussians.get() ||
+            state.components.empty() != parameters.tied_mixtures.get())
+            throw std::runtime_error("Corrupted model file");
+    }
+
+    if (parameters.tied_mixtures.get()) {
+        // a shared codebook is read by the parent model
+        if (!parameters.shared_codebook.get()) {
+            codebook.readBinary(reader);
+            if (codebook.parameters.gaussians.get() !=
+                    parameters.gaussians.get() ||
+                codebook.components.empty())
+                throw std::runtime_error("Corrupted model file");
+        }
+        for (auto& state : states) state.components.clear();
+        updateCodebookWeights();
+    }
+}
+
 #pragma mark -
 #pragma mark Exit Probabilities
 
@@ -33,6 +33,7 @@
 #ifndef xmmHmmSingleClass_hpp
 #define xmmHmmSingleClass_hpp
 
+#include "../../core/common/xmmMatrix.hpp"
 #include "../gmm/xmmGmmSingleClass.hpp"
 #include "xmmHmmParameters.hpp"
 #include "xmmHmmResults.hpp"
@@ -53,6 +54,13 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
     static const float DEFAULT_EXITPROBABILITY_LAST_STATE() { return 0.1; }
     static const float TRANSITION_REGULARIZATION() { return 1.0e-5; }
 
+    /**
+     @brief Minimum weight of a codebook component in a state (tied mixtures)
+     @details smaller weights are ignored when computing the observation
+     probabilities of the states
+     */
+    static const float CODEBOOK_WEIGHT_THRESHOLD() { return 1.0e-6; }
+
     /**
      @brief Constructor
      @param p Shared Parameters (owned by a multiclass object)
@@ -65,6 +73,15 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     SingleClassHMM(SingleClassHMM const& src);
 
+    /**
+     @brief Move constructor
+     @details the states, the codebook and the transition parameters are moved
+     from the source model
+     @param src Source Model
+     @throws runtime_error if the source model is training
+     */
+    SingleClassHMM(SingleClassHMM&& src);
+
     /**
      @brief Copy constructor
      @param p pointer to a shared parameters object (owned by a Model)
@@ -79,6 +96,13 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     SingleClassHMM& operator=(SingleClassHMM const& src);
 
+    /**
+     @brief Move assignment
+     @param src Source Model
+     @throws runtime_error if the source or target model is training
+     */
+    SingleClassHMM& operator=(SingleClassHMM&& src);
+
     /** @name Accessors */
     ///@{
 
@@ -111,6 +135,15 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     double filter(std::vector<float> const& observation);
 
+    /**
+     @brief filters a incoming observation without computing the regression
+     @details used by multi-class models, which only compute the regression
+     for the classes required by the multi-class regression estimator
+     @param observation observation vector
+     @return likelihood of the observation
+     */
+    double filterLikelihood(std::vector<float> const& observation);
+
     ///@}
 
     /** @name Json I/O */
@@ -131,6 +164,26 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
 
     ///@}
 
+    /** @name Binary I/O */
+    ///@{
+
+    /**
+     @brief Write the object to the payload of a binary model file
+     @param writer binary writer
+     */
+    virtual void writeBinary(BinaryWriter& writer) const;
+
+    /**
+     @brief Read the object in place from the payload of a binary model file
+     @details the parameters are allocated from the shared parameters, that
+     must be read beforehand.
+     @param reader binary reader
+     @throws runtime_error if the payload has a wrong format
+     */
+    virtual void readBinary(BinaryReader& reader);
+
+    ///@}
+
     //        /**
     //         @brief Convert to bimodal HMM in place
     //         @param dimension_input dimension of the input modality
@@ -208,9 +261,20 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
 
     /**
      @brief States of the model (Gaussian Mixture Models)
+     @details with tied mixtures, the states only store the mixture weights of
+     the codebook components: their own components are not allocated.
      */
     std::vector<SingleClassGMM> states;
 
+    /**
+     @brief Codebook of Gaussian components shared by all states
+     @details only allocated with tied mixtures (see
+     ClassParameters<HMM>::tied_mixtures), if the class does not use the
+     codebook shared by the classes of its parent model (see
+     ClassParameters<HMM>::shared_codebook)
+     */
+    SingleClassGMM codebook;
+
     /**
      @brief Prior probabilities
      */
@@ -250,6 +314,58 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     void initMeansCovariancesWithGMMEM(TrainingSet* trainingSet);
 
+    /**
+     @brief initialize the codebook using GMM-EM on all training phrases, and
+     the mixture weights of each state from the posterior probabilities of the
+     codebook components over a segment of the phrases (tied mixtures).
+     */
+    void initCodebookWithGMMEM(TrainingSet* trainingSet);
+
+    /**
+     @brief Update the sparse mixture weights of the codebook components used
+     for filtering from the mixture coefficients of the states (tied mixtures)
+     */
+    void updateCodebookWeights();
+
+    /**
+     @brief Codebook of the tied mixtures
+     @return the codebook shared by the classes of the parent model if the
+     class is attached to it, the codebook of the class otherwise
+     */
+    SingleClassGMM const& tiedCodebook() const {
+        return shared_codebook_ ? *shared_codebook_ : codebook;
+    }
+
+    /**
+     @brief Compute the likelihood of each codebook component for an
+     observation
+     @details This method is idle if the model does not use tied mixtures, or
+     if the likelihoods of a shared codebook are computed by the parent model.
+     Otherwise, it must be called once per frame before computing the
+     observation probabilities of the states.
+     @param observation observation vector. If the model is bimodal, this
+     vector should be only the observation on the input modality.
+     @param observation_output observation on the output modality (only used
+     if the model is bimodal).
+     */
+    void updateCodebookLikelihoods(const float* observation,
+                                   const float* observation_output = NULL);
+
+    /**
+     @brief Observation probability of a state
+     @details With tied mixtures, the probability is computed as the weighted
+     sum of the codebook likelihoods computed by updateCodebookLikelihoods().
+     @param stateIndex index of the state
+     @param observation observation vector. If the model is bimodal, this
+     vector should be only the observation on the input modality.
+     @param observation_output observation on the output modality (only used
+     if the model is bimodal). If unspecified, the probability is computed on
+     the input modality only.
+     @return observation probability of the state
+     */
+    double obsProb(unsigned int stateIndex, const float* observation,
+                   const float* observation_output = NULL) const;
+
     /**
      @brief set the prior and transition matrix to ergodic
      */
@@ -260,6 +376,19 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     void setLeftRight();
 
+    /**
+     @brief set the transition matrix to banded left-right: each state
+     transitions uniformly to itself and to the 'max_skip' following states
+     */
+    void setBanded();
+
+    /**
+     @brief Get the number of transitions stored per state
+     @return the number of states for ergodic models, 2 for left-right models
+     and max_skip + 1 for banded models
+     */
+    unsigned int transitionWidth() const;
+
     /**
      @brief Normalize transition probabilities
      */
@@ -312,11 +441,65 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
     void backward_update(double ct, const float* observation,
                          const float* observation_output = NULL);
 
+    /**
+     @brief Selects the forward and backward kernels for the transition
+     topology of the model
+     @details called at reset and at the start of training, so that the
+     recursions do not test the transition mode for each state
+     */
+    void selectKernels();
+
+    /**
+     @brief Computes the observation probability of each state
+     @details the modality is selected once per frame. The probabilities are
+     stored in observation_probabilities_.
+     @param observation observation vector at time t (input modality if the
+     model is bimodal)
+     @param observation_output observation on the output modality. If NULL,
+     bimodal models only use the input modality.
+     */
+    void updateObservationProbabilities(const float* observation,
+                                        const float* observation_output = NULL);
+
+    /**
+     @brief Observation probabilities of the states for a given modality
+     @tparam Modality policy computing the likelihood of a Gaussian component
+     */
+    template <typename Modality>
+    void observationKernel(const float* observation,
+                           const float* observation_output);
+
+    /**
+     @brief Update of the forward algorithm for a given transition topology
+     @tparam Topology policy computing the transitions of the forward variable
+     @param observation_probabilities observation probability of each state
+     @return inverse of the instantaneous likelihood
+     */
+    template <typename Topology>
+    double forwardKernel(const double* observation_probabilities);
+
+    /**
+     @brief Update of the backward algorithm for a given transition topology
+     @tparam Topology policy computing the transitions of the backward variable
+     @param ct inverse of the likelihood at time step t computed
+     with the forward algorithm (see Rabiner 1989)
+     @param observation_probabilities observation probability of each state at
+     time t+1
+     */
+    template <typename Topology>
+    void backwardKernel(double ct, const double* observation_probabilities);
+
     /**
      @brief Initialization of the parameters before training
      */
     void emAlgorithmInit(TrainingSet* trainingSet);
 
+    /**
+     @brief Caches the second moments of the training frames, used to
+     re-estimate the covariances of the states (not used with tied mixtures)
+     */
+    void emAlgorithmCacheMoments(TrainingSet* trainingSet);
+
     /**
      @brief Termination of the training algorithm
      */
@@ -327,6 +510,30 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     virtual double emAlgorithmUpdate(TrainingSet* trainingSet);
 
+    /**
+     @brief Resets the sufficient statistics of the states, of the prior and of
+     the transitions
+     */
+    void emAlgorithmResetStatistics();
+
+    /**
+     @brief Runs the forward-backward algorithm on the phrases of a chunk of
+     the training data and accumulates the sufficient statistics
+     @return likelihood of the chunk given the current parameters
+     */
+    double emAlgorithmAccumulate(TrainingSet* trainingSet);
+
+    /**
+     @brief Estimates the parameters from the sufficient statistics
+     */
+    void emAlgorithmEstimate();
+
+    /**
+     @brief Allocates the sequences of the forward-backward algorithm for the
+     phrases of a training set
+     */
+    void baumWelch_allocateSequences(TrainingSet* trainingSet);
+
     /**
      @brief Compute the forward-backward algorithm on a phrase of the training
      set
@@ -378,6 +585,12 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     void baumWelch_estimateCovariances(TrainingSet* trainingSet);
 
+    /**
+     @brief Estimate the Means and Covariances of the components of the
+     codebook (tied mixtures)
+     */
+    void baumWelch_estimateCodebook(TrainingSet* trainingSet);
+
     /**
      @brief Estimate the Prior Probabilities
      */
@@ -388,6 +601,13 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     void baumWelch_estimateTransitions(TrainingSet* trainingSet);
 
+    /**
+     @brief Normalizes the accumulated transitions by the sums of the gamma
+     variable
+     @throws runtime_error if the transitions are not defined
+     */
+    void baumWelch_scaleTransitions();
+
     /**
      @brief Adds a cyclic Transition probability (from last state to first
      state)
@@ -414,6 +634,17 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     void regression(std::vector<float> const& observation_input);
 
+    /**
+     @brief Compute the regression of a state
+     @details predicted output parameters are stored in the result structure
+     of the state. With tied mixtures, the output of the state is mixed from
+     the outputs of the codebook components computed by regression().
+     @param stateIndex index of the state
+     @param observation_input observation on the input modality
+     */
+    void stateRegression(unsigned int stateIndex,
+                         std::vector<float> const& observation_input);
+
     /**
      @brief update the content of the likelihood buffer and return average
      likelihood.
@@ -491,6 +722,23 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      */
     std::vector<double> gamma_sum_per_mixture_;
 
+    /**
+     @brief Sufficient statistics of the components of each state, or of the
+     codebook with tied mixtures (out-of-core training)
+     */
+    std::vector<GaussianDistribution::SufficientStatistics>
+        component_statistics_;
+
+    /**
+     @brief Accumulated prior probabilities (out-of-core training)
+     */
+    std::vector<double> prior_statistics_;
+
+    /**
+     @brief Accumulated transition probabilities (out-of-core training)
+     */
+    std::vector<double> transition_statistics_;
+
     /**
      @brief Defines if the model is a submodel of a hierarchical HMM.
      @details in practice this adds exit probabilities to each state. These
@@ -521,6 +769,57 @@ class SingleClassHMM : public SingleClassProbabilisticModel {
      time progression)
      */
     double window_normalization_constant_;
+
+    /**
+     @brief Mixture weights of the codebook components for each state (states
+     x gaussians, tied mixtures only)
+     */
+    SparseMatrix<float> codebook_weights_;
+
+    /**
+     @brief Likelihood of each codebook component for the current observation
+     (tied mixtures only)
+     */
+    std::vector<double> codebook_likelihoods_;
+
+    /**
+     @brief Output predicted by each codebook component for the current
+     observation (tied mixtures only)
+     */
+    std::vector<std::vector<float> > codebook_output_values_;
+
+    /**
+     @brief Observation probabilities of the states computed from the frozen
+     representation of the parent HierarchicalHMM (NULL if not frozen)
+     */
+    const double* frozen_likelihoods_;
+
+    /**
+     @brief Codebook shared by the classes of the parent HierarchicalHMM (NULL
+     if the class owns its codebook)
+     */
+    SingleClassGMM const* shared_codebook_;
+
+    /**
+     @brief Likelihoods of the components of the shared codebook computed
+     once per frame by the parent HierarchicalHMM (NULL outside filtering)
+     */
+    const double* shared_codebook_likelihoods_;
+
+    /**
+     @brief Forward kernel selected for the transition topology
+     */
+    double (SingleClassHMM::*forward_kernel_)(const double*);
+
+    /**
+     @brief Backward kernel selected for the transition topology
+     */
+    void (SingleClassHMM::*backward_kernel_)(double, const double*);
+
+    /**
+     @brief Observation probability of each state for the current frame
+     */
+    std::vector<double> observation_probabilities_;
 };
 }
 
@@ -76,10 +76,11 @@ void xmm::KMeans::train(TrainingSet* trainingSet) {
     int dimension = static_cast<int>(shared_parameters->dimension.get());
     int clusters = static_cast<int>(configuration.clusters.get());
 
+    std::vector<float> previous_centers;
     for (int trainingNbIterations = 0;
          trainingNbIterations < configuration.max_iterations.get();
          ++trainingNbIterations) {
-        std::vector<float> previous_centers = centers;
+        previous_centers = centers;
 
         updateCenters(previous_centers, trainingSet);
 
@@ -111,15 +112,18 @@ void xmm::KMeans::initClustersWithFirstPhrase(std::shared_ptr<Phrase> phrase) {
     int dimension = static_cast<int>(shared_parameters->dimension.get());
     unsigned int step = phrase->size() / configuration.clusters.get();
 
+    Phrase::FrameView frames = phrase->frames();
+    std::vector<float> frame_buffer(dimension);
     unsigned int offset(0);
     for (unsigned int c = 0; c < configuration.clusters.get(); c++) {
+        float* center = &centers[c * dimension];
         for (unsigned int d = 0; d < dimension; d++) {
-            centers[c * dimension + d] = 0.0;
+            center[d] = 0.0;
         }
         for (unsigned int t = 0; t < step; t++) {
+            const float* frame = frames.frame(offset + t, frame_buffer.data());
             for (unsigned int d = 0; d < dimension; d++) {
-                centers[c * dimension + d] +=
-                    phrase->getValue(offset + t, d) / float(step);
+                center[d] += frame[d] / float(step);
             }
         }
         offset += step;
@@ -145,45 +149,28 @@ void xmm::KMeans::updateCenters(std::vector<float>& previous_centers,
     unsigned int phraseIndex(0);
     centers.assign(clusters * dimension, 0.0);
     std::vector<unsigned int> numFramesPerCluster(clusters, 0);
+    // bimodal phrases are not contiguous: frames are copied once per time step
+    std::vector<float> frame_buffer(dimension);
     for (auto it = trainingSet->begin(); it != trainingSet->end();
          ++it, ++phraseIndex) {
-        for (unsigned int t = 0; t < it->second->size(); ++t) {
-            float min_distance;
-            if (trainingSet->bimodal()) {
-                std::vector<float> frame(dimension);
-                for (unsigned int d = 0; d < dimension; ++d) {
-                    frame[d] = it->second->getValue(t, d);
-                }
-                min_distance = euclidean_distance(
-                    &frame[0], &previous_centers[0], dimension);
-            } else {
-                min_distance = euclidean_distance(
-                    it->second->getPointer(t), &previous_centers[0], dimension);
-            }
+        Phrase::FrameView frames = it->second->frames();
+        for (unsigned int t = 0; t < frames.size(); ++t) {
+            const float* observation = frames.frame(t, frame_buffer.data());
+            float min_distance = euclidean_distance(
+                observation, &previous_centers[0], dimension);
             unsigned int cluster_membership(0);
             for (unsigned int k = 1; k < clusters; ++k) {
-                float distance;
-                if (trainingSet->bimodal()) {
-                    std::vector<float> frame(dimension);
-                    for (unsigned int d = 0; d < dimension; ++d) {
-                        frame[d] = it->second->getValue(t, d);
-                    }
-                    distance = euclidean_distance(
-                        &frame[0], &previous_centers[k * dimension], dimension);
-                } else {
-                    distance = euclidean_distance(
-                        it->second->getPointer(t),
-                        &previous_centers[k * dimension], dimension);
-                }
+                float distance = euclidean_distance(
+                    observation, &previous_centers[k * dimension], dimension);
                 if (distance < min_distance) {
                     cluster_membership = k;
                     min_distance = distance;
                 }
             }
             numFramesPerCluster[cluster_membership]++;
+            float* center = &centers[cluster_membership * dimension];
             for (unsigned int d = 0; d < dimension; ++d) {
-                centers[cluster_membership * dimension + d] +=
-                    it->second->getValue(t, d);
+                center[d] += observation[d];
             }
         }
     }
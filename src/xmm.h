@@ -63,6 +63,7 @@
 
 #include "models/gmm/xmmGmm.hpp"
 #include "models/hmm/xmmHierarchicalHmm.hpp"
+#include "core/trainingset/xmmMappedTrainingSet.hpp"
 
 /**
  @mainpage About
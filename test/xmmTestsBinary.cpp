@@ -0,0 +1,396 @@
+/*
+ * xmmTestsBinary.cpp
+ *
+ * Test suite for the binary model format
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+template <typename ModelType>
+static void checkSameFiltering(ModelType& a, ModelType& b,
+                               xmm::TrainingSet& ts) {
+    unsigned int dimension = a.shared_parameters->bimodal.get()
+                                 ? a.shared_parameters->dimension_input.get()
+                                 : a.shared_parameters->dimension.get();
+    std::vector<float> observation(dimension);
+    a.reset();
+    b.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(1);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        for (unsigned int d = 0; d < dimension; d++)
+            observation[d] = phrase->getValue(t, d);
+        a.filter(observation);
+        b.filter(observation);
+        CHECK(a.results.likeliest == b.results.likeliest);
+        CHECK(a.results.instant_likelihoods == b.results.instant_likelihoods);
+        CHECK(a.results.smoothed_normalized_likelihoods ==
+              b.results.smoothed_normalized_likelihoods);
+        CHECK(a.results.output_values == b.results.output_values);
+    }
+}
+
+TEST_CASE("GMM: Binary IO", "[Binary I/O]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 6));
+        xmm::GMM a(bimodal);
+        a.configuration.gaussians.set(3);
+        a.configuration["1"].covariance_mode.set(
+            xmm::GaussianDistribution::CovarianceMode::Diagonal);
+        a.configuration.pruning_delay = 12;
+        a.shared_parameters->em_algorithm_max_iterations.set(5);
+        a.train(&ts);
+
+        std::stringstream stream;
+        a.writeBinary(stream);
+
+        xmm::GMM b;
+        b.readBinary(stream);
+        CHECK(b.size() == 2);
+        CHECK(b.configuration.pruning_delay == 12);
+        CHECK(b.configuration.includes("1"));
+        CHECK(b.toJson() == a.toJson());
+        checkSameFiltering(a, b, ts);
+
+        // loading again replaces the classes in place
+        stream.seekg(0);
+        b.readBinary(stream);
+        CHECK(b.size() == 2);
+        CHECK(b.toJson() == a.toJson());
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Binary IO", "[Binary I/O]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 6));
+        xmm::HierarchicalHMM a(bimodal);
+        a.configuration.states.set(4);
+        a.configuration["1"].states.set(6);
+        a.configuration["1"].gaussians.set(2);
+        a.configuration["1"].tied_mixtures.set(true);
+        a.shared_parameters->em_algorithm_max_iterations.set(5);
+        a.train(&ts);
+        a.setTransitionGrammar({{"0", {"1"}}, {"1", {"0"}}});
+
+        std::stringstream stream;
+        a.writeBinary(stream);
+
+        xmm::HierarchicalHMM b;
+        b.readBinary(stream);
+        CHECK(b.size() == 2);
+        CHECK(b.models[1].parameters.tied_mixtures.get());
+        CHECK(b.toJson() == a.toJson());
+        checkSameFiltering(a, b, ts);
+    }
+}
+
+TEST_CASE("Binary IO: Invalid files", "[Binary I/O]") {
+    xmm::TrainingSet ts(makeTrainingSet(false, 6));
+    xmm::GMM a;
+    a.configuration.gaussians.set(2);
+    a.shared_parameters->em_algorithm_max_iterations.set(5);
+    a.train(&ts);
+    std::stringstream stream;
+    a.writeBinary(stream);
+    std::string file = stream.str();
+
+    // wrong model type
+    xmm::HierarchicalHMM hmm;
+    std::stringstream hmm_stream(file);
+    CHECK_THROWS_AS(hmm.readBinary(hmm_stream), std::runtime_error);
+
+    // not a model file
+    xmm::GMM b;
+    std::stringstream json_stream(a.toJson().toStyledString());
+    CHECK_THROWS_AS(b.readBinary(json_stream), std::runtime_error);
+
+    // corrupted header
+    std::string corrupted(file);
+    corrupted[8] = char(corrupted[8] + 1);
+    std::stringstream header_stream(corrupted);
+    CHECK_THROWS_AS(b.readBinary(header_stream), std::runtime_error);
+
+    // truncated file
+    std::stringstream truncated_stream(file.substr(0, file.size() - 4));
+    CHECK_THROWS_AS(b.readBinary(truncated_stream), std::runtime_error);
+
+    // corrupted payload: the checksum is verified before loading
+    b.readBinary(stream);
+    REQUIRE(b.size() == 2);
+    corrupted = file;
+    corrupted[file.size() / 2] = char(corrupted[file.size() / 2] ^ 0x10);
+    std::stringstream payload_stream(corrupted);
+    CHECK_THROWS_AS(b.readBinary(payload_stream), std::runtime_error);
+    CHECK(b.toJson() == a.toJson());
+}
+
+template <typename ModelType>
+static void checkCompactModel(ModelType& a, xmm::TrainingSet& ts) {
+    std::stringstream full_stream;
+    a.writeBinary(full_stream);
+    CHECK(full_stream.str()[8] == 1);  // complete models remain in version 1
+
+    std::size_t previous_size = full_stream.str().size();
+    for (auto precision :
+         {xmm::BinaryPrecision::Full, xmm::BinaryPrecision::Float16,
+          xmm::BinaryPrecision::Int8}) {
+        std::stringstream stream;
+        a.writeCompactBinary(stream, precision);
+        CHECK(stream.str().size() < previous_size);
+        previous_size = stream.str().size();
+
+        ModelType b;
+        b.readBinary(stream);
+        REQUIRE(b.size() == a.size());
+        CHECK(b.shared_parameters->dimension.get() ==
+              a.shared_parameters->dimension.get());
+
+        xmm::AccuracyReport report = b.compare(a, &ts);
+        unsigned int frames(0);
+        for (auto it = ts.begin(); it != ts.end(); ++it)
+            frames += it->second->size();
+        CHECK(report.frames == frames);
+        if (precision == xmm::BinaryPrecision::Full) {
+            CHECK(report.label_agreement == 1.);
+            CHECK(report.max_likelihood_delta < 1e-4);
+            CHECK(report.max_output_delta < 1e-4);
+        } else if (precision == xmm::BinaryPrecision::Float16) {
+            CHECK(report.label_agreement > 0.95);
+            CHECK(report.mean_likelihood_delta < 0.02);
+            CHECK(report.mean_output_delta < 0.02);
+        } else {
+            CHECK(report.label_agreement > 0.9);
+            CHECK(report.mean_likelihood_delta < 0.05);
+            CHECK(report.mean_output_delta < 0.05);
+        }
+
+        // the loaded model is complete: it can be exported and loaded again
+        ModelType c(b.toJson());
+        xmm::AccuracyReport json_report = c.compare(b, &ts);
+        CHECK(json_report.label_agreement == 1.);
+        CHECK(json_report.max_likelihood_delta < 1e-6);
+        CHECK(json_report.max_output_delta < 1e-6);
+    }
+}
+
+TEST_CASE("GMM: Compact Binary IO", "[Binary I/O]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 6));
+        xmm::GMM a(bimodal);
+        a.configuration.gaussians.set(3);
+        a.configuration["1"].covariance_mode.set(
+            xmm::GaussianDistribution::CovarianceMode::Diagonal);
+        a.shared_parameters->em_algorithm_max_iterations.set(5);
+        a.train(&ts);
+        checkCompactModel(a, ts);
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Compact Binary IO", "[Binary I/O]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 6));
+        xmm::HierarchicalHMM a(bimodal);
+        a.configuration.states.set(4);
+        a.configuration["1"].gaussians.set(2);
+        a.configuration["1"].tied_mixtures.set(true);
+        a.shared_parameters->em_algorithm_max_iterations.set(5);
+        a.train(&ts);
+        a.setTransitionGrammar({{"0", {"1"}}, {"1", {"0"}}});
+        checkCompactModel(a, ts);
+    }
+}
+
+TEST_CASE("Compact Binary IO: Quantization", "[Binary I/O]") {
+    // half-precision values are rounded to nearest even, and the per-tensor
+    // power-of-two scale preserves their mantissa
+    xmm::SingleClassGMM gmm(std::make_shared<xmm::SharedParameters>());
+    gmm.mixture_coeffs = {1.f, 1.f + 1.f / 4096.f, 3.f / 4096.f, -1e-3f};
+    for (auto precision :
+         {xmm::BinaryPrecision::Float16, xmm::BinaryPrecision::Int8}) {
+        xmm::BinaryWriter writer(true, precision);
+        writer.writeParameters(gmm.mixture_coeffs);
+        writer.writeParameters(std::vector<double>({1., 2., 3.}));
+        std::stringstream stream;
+        writer.save(stream, 1);
+        xmm::BinaryReader reader(stream, 1);
+        CHECK(reader.compact());
+        CHECK(reader.precision() == precision);
+        std::vector<float> values;
+        reader.readParameters(values, 4);
+        std::vector<double> matrix;
+        reader.readSymmetric(matrix, 2);
+        CHECK_NOTHROW(reader.checkEnd());
+        if (precision == xmm::BinaryPrecision::Float16) {
+            CHECK(values[0] == 1.f);
+            CHECK(values[1] == 1.f);
+            CHECK(values[2] == 3.f / 4096.f);
+            CHECK(values[3] == Approx(-1e-3).epsilon(1e-3));
+            CHECK(matrix == std::vector<double>({1., 2., 3.}));
+        } else {
+            // 3 / 4096 would be rounded to zero with an 8-bit scale: the
+            // tensor is stored in half precision
+            CHECK(values[0] == 1.f);
+            CHECK(values[2] == 3.f / 4096.f);
+            CHECK(matrix.size() == 3);
+            CHECK(std::fabs(matrix[2] - 3.) < 1e-6);
+        }
+    }
+    xmm::BinaryWriter writer(true, xmm::BinaryPrecision::Int8);
+    CHECK_THROWS_AS(writer.writeParameters(std::vector<float>(
+                        {1.f, std::numeric_limits<float>::infinity()})),
+                    std::runtime_error);
+
+    // small nonzero values are not rounded to zero: the tensor is stored in
+    // half precision
+    xmm::BinaryWriter mixed_writer(true, xmm::BinaryPrecision::Int8);
+    mixed_writer.writeParameters(std::vector<double>({1e4, 1e-2, 0.}));
+    mixed_writer.writeParameters(std::vector<double>({2., 1.}));
+    std::stringstream mixed_stream;
+    mixed_writer.save(mixed_stream, 1);
+    xmm::BinaryReader mixed_reader(mixed_stream, 1);
+    std::vector<double> mixed_values, int8_values;
+    mixed_reader.readParameters(mixed_values, 3);
+    mixed_reader.readParameters(int8_values, 2);
+    CHECK_NOTHROW(mixed_reader.checkEnd());
+    CHECK(mixed_values[0] == Approx(1e4).epsilon(1e-3));
+    CHECK(mixed_values[1] == Approx(1e-2).epsilon(1e-3));
+    CHECK(mixed_values[2] == 0.);
+    CHECK(int8_values[0] == Approx(2.));
+    CHECK(int8_values[1] == Approx(1.).epsilon(1e-2));
+
+    // the range of half-precision values is bounded: variances and
+    // precisions outside of the range cannot be exported
+    for (auto precision :
+         {xmm::BinaryPrecision::Float16, xmm::BinaryPrecision::Int8}) {
+        xmm::BinaryWriter range_writer(true, precision);
+        CHECK_THROWS_AS(range_writer.writeParameters(
+                            std::vector<double>({1e10, 1e-10}), true),
+                        std::runtime_error);
+        CHECK_NOTHROW(range_writer.writeParameters(
+            std::vector<double>({1e10, 1e-10})));
+    }
+}
+
+TEST_CASE("GMM: Compact Binary IO with mixed-scale features",
+          "[Binary I/O]") {
+    // the variances of the features differ by 8 orders of magnitude: with a
+    // single 8-bit scale, the precisions of the small feature would be 0
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Unimodal);
+    ts.dimension.set(2);
+    srand(43);
+    for (int p = 0; p < 4; p++) {
+        ts.addPhrase(p, std::to_string(p % 2));
+        for (int t = 0; t < 50; t++) {
+            float noise = float(rand() % 100) / 100.f;
+            ts.getPhrase(p)->record(
+                {100.f * (float(p % 2) + noise),
+                 0.01f * (float(p % 2) + float(t % 10) / 10.f)});
+        }
+    }
+    xmm::GMM a;
+    a.configuration.gaussians.set(2);
+    a.configuration.covariance_mode.set(
+        xmm::GaussianDistribution::CovarianceMode::Diagonal);
+    a.configuration.relative_regularization.set(1e-4);
+    a.configuration.absolute_regularization.set(1e-8);
+    a.train(&ts);
+    REQUIRE(a.trained());
+    for (auto precision :
+         {xmm::BinaryPrecision::Full, xmm::BinaryPrecision::Float16,
+          xmm::BinaryPrecision::Int8}) {
+        std::stringstream stream;
+        a.writeCompactBinary(stream, precision);
+        xmm::GMM b;
+        CHECK_NOTHROW(b.readBinary(stream));
+        REQUIRE(b.size() == a.size());
+        xmm::AccuracyReport report = b.compare(a, &ts);
+        CHECK(report.label_agreement > 0.95);
+    }
+}
+
+TEST_CASE("Binary IO: Square covariance matrices", "[Binary I/O]") {
+    // files written before the packed storage of the covariance matrices
+    // contain square matrices, that are packed when reading
+    xmm::GaussianDistribution a(false, 3, 0);
+    a.mean = {0.2, 0.3, 0.1};
+    a.covariance = {1.3, 0.1, 0.2, 1.4, 0.7, 1.5};
+    a.updateInverseCovariance();
+    Json::Value root = a.toJson();
+    std::vector<double> covariance(9), inverse_covariance(9);
+    xmm::json2vector(root["covariance"], covariance, 9);
+    xmm::json2vector(root["inverse_covariance"], inverse_covariance, 9);
+    xmm::BinaryWriter writer;
+    writer.writeBool(false);
+    writer.writeUInt(3);
+    writer.writeUInt(0);
+    writer.writeUInt(static_cast<unsigned int>(
+        xmm::GaussianDistribution::CovarianceMode::Full));
+    writer.writeVector(a.mean);
+    writer.writeVector(covariance);
+    writer.writeVector(inverse_covariance);
+    writer.writeDouble(root["covariance_determinant"].asDouble());
+    writer.writeVector(std::vector<double>());
+    writer.writeDouble(0.);
+    writer.writeVector(std::vector<double>());
+    std::stringstream stream;
+    writer.save(stream, 1);
+
+    xmm::BinaryReader reader(stream, 1);
+    xmm::GaussianDistribution b;
+    b.readBinary(reader);
+    CHECK_NOTHROW(reader.checkEnd());
+    CHECK(b.covariance == a.covariance);
+    CHECK(b.toJson() == root);
+    std::vector<float> observation = {0.7f, 0.f, -0.3f};
+    CHECK(b.likelihood(observation.data()) ==
+          a.likelihood(observation.data()));
+
+    // the quadratic form of the packed matrix matches the square matrix
+    std::vector<double> diff(3);
+    for (unsigned int d = 0; d < 3; d++)
+        diff[d] = observation[d] - a.mean[d];
+    double expected(0.);
+    for (unsigned int l = 0; l < 3; l++)
+        for (unsigned int k = 0; k < 3; k++)
+            expected += diff[l] * inverse_covariance[l * 3 + k] * diff[k];
+    std::vector<double> precision(xmm::packedSize(3));
+    xmm::packSymmetric(inverse_covariance.begin(), 3, precision.begin());
+    CHECK(xmm::packedQuadraticForm(precision.data(), 3,
+                                   [&diff](unsigned int d) {
+                                       return diff[d];
+                                   }) == Approx(expected));
+    CHECK(a.covariance[xmm::packedIndex(2, 1, 3)] == covariance[1 * 3 + 2]);
+}
@@ -0,0 +1,136 @@
+/*
+ * xmmTestsCircularBuffer.cpp
+ *
+ * Test suite for the running aggregates of circular buffers
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+#include <algorithm>
+#include <deque>
+
+/**
+ @brief checks the running aggregates of a buffer against a direct
+ computation over its content
+ */
+template <unsigned int channels>
+static void checkAggregates(xmm::CircularBuffer<double, channels> const& buffer,
+                            std::deque<std::vector<double>> const& window) {
+    REQUIRE(buffer.size_t() == window.size());
+    for (unsigned int c = 0; c < channels; c++) {
+        double sum(0.), squares(0.);
+        double minimum(window[0][c]), maximum(window[0][c]);
+        for (auto const& frame : window) {
+            sum += frame[c];
+            minimum = std::min(minimum, frame[c]);
+            maximum = std::max(maximum, frame[c]);
+        }
+        double mean = sum / double(window.size());
+        for (auto const& frame : window)
+            squares += (frame[c] - mean) * (frame[c] - mean);
+        CHECK(buffer.sum(c) == Approx(sum).epsilon(1e-9));
+        CHECK(buffer.mean(c) == Approx(mean).epsilon(1e-9));
+        CHECK(buffer.variance(c) ==
+              Approx(squares / double(window.size())).epsilon(1e-6));
+        CHECK(buffer.min(c) == minimum);
+        CHECK(buffer.max(c) == maximum);
+    }
+}
+
+TEST_CASE("CircularBuffer: Running aggregates", "[CircularBuffer]") {
+    xmm::CircularBuffer<double, 2> buffer(7);
+    std::deque<std::vector<double>> window;
+    for (unsigned int t = 0; t < 100; t++) {
+        std::vector<double> frame = {-300. + 10. * sin(0.7 * t),
+                                     double((t * 37) % 11)};
+        buffer.push(frame);
+        window.push_back(frame);
+        if (window.size() > 7) window.pop_front();
+        checkAggregates(buffer, window);
+    }
+    std::vector<double> mean = buffer.mean();
+    CHECK(mean[0] == Approx(buffer.mean(0)));
+    CHECK(mean[1] == Approx(buffer.mean(1)));
+
+    // shrinking keeps the first elements of the storage
+    buffer.clear();
+    window.clear();
+    for (unsigned int t = 0; t < 5; t++) {
+        std::vector<double> frame = {double(t), -double(t)};
+        buffer.push(frame);
+        window.push_back(frame);
+    }
+    buffer.resize(3);
+    window.resize(3);
+    checkAggregates(buffer, window);
+    buffer.push({5., -5.});
+    window.pop_front();
+    window.push_back({5., -5.});
+    checkAggregates(buffer, window);
+
+    buffer.clear();
+    CHECK(buffer.size_t() == 0);
+    CHECK(std::isnan(buffer.mean(0)));
+    CHECK_THROWS(buffer.min(0));
+}
+
+TEST_CASE("CircularBuffer: Non-finite values", "[CircularBuffer]") {
+    xmm::CircularBuffer<double> buffer(3);
+    buffer.push(1.);
+    buffer.push(-std::numeric_limits<double>::infinity());
+    buffer.push(2.);
+    CHECK(std::isinf(buffer.mean(0)));
+    CHECK(buffer.mean(0) < 0.);
+    CHECK(buffer.min(0) == -std::numeric_limits<double>::infinity());
+    CHECK(std::isnan(buffer.variance(0)));
+    buffer.push(3.);
+    CHECK(std::isinf(buffer.mean(0)));
+    // the infinite value leaves the window
+    buffer.push(4.);
+    CHECK(buffer.mean(0) == Approx(3.));
+    CHECK(buffer.variance(0) == Approx(2. / 3.));
+    CHECK(buffer.min(0) == 2.);
+    buffer.push(std::nan(""));
+    CHECK(std::isnan(buffer.sum(0)));
+    CHECK(buffer.max(0) == 4.);
+}
+
+TEST_CASE("CircularBuffer: Long windows", "[CircularBuffer]") {
+    xmm::CircularBuffer<double> buffer(500);
+    std::deque<std::vector<double>> window;
+    for (unsigned int t = 0; t < 20000; t++) {
+        double value = -1e3 + 1e-3 * double(t % 97) + 1e2 * cos(0.01 * t);
+        buffer.push(value);
+        window.push_back({value});
+        if (window.size() > 500) window.pop_front();
+    }
+    checkAggregates(buffer, window);
+}
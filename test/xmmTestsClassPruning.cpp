@@ -0,0 +1,153 @@
+/*
+ * xmmTestsClassPruning.cpp
+ *
+ * Test suite for class pruning in multiclass models
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+
+static std::vector<float> frame(std::shared_ptr<xmm::Phrase> const& phrase,
+                                unsigned int t) {
+    return std::vector<float>(phrase->getPointer(t),
+                              phrase->getPointer(t) + phrase->dimension.get());
+}
+
+TEST_CASE("GMM: Class pruning", "[GMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(4, false, "", 10.f));
+    xmm::GMM a;
+    a.configuration.gaussians.set(2);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    a.configuration.pruning_threshold = 1e-3;
+    a.configuration.pruning_delay = 5;
+    a.configuration.pruning_period = 10;
+    a.reset();
+
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(0);
+    for (unsigned int t = 0; t < 10; t++) {
+        a.filter(frame(phrase, t));
+    }
+    CHECK(a.results.evaluated_classes.size() <= 2);
+    CHECK(a.results.evaluated_classes[0] == 0);
+    CHECK(a.results.likeliest == "0");
+
+    // Suspended classes are re-activated by the periodic evaluation
+    phrase = ts.getPhrase(3);
+    for (unsigned int t = 0; t < 20; t++) {
+        a.filter(frame(phrase, t));
+    }
+    CHECK(a.results.likeliest == "3");
+
+    xmm::GMM b(a);
+    b.configuration.pruning_threshold = 0.;
+    b.reset();
+    b.filter(frame(phrase, 0));
+    CHECK(b.results.evaluated_classes.size() == 4);
+
+    xmm::GMM c(a.toJson());
+    CHECK(c.configuration.pruning_threshold == Approx(1e-3));
+    CHECK(c.configuration.pruning_delay == 5);
+    CHECK(c.configuration.pruning_period == 10);
+}
+
+TEST_CASE("HierarchicalHMM: Class pruning", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(4, false, "", 10.f));
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(5);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    a.setTransitionGrammar({{"0", {"3"}}});
+    a.configuration.pruning_threshold = 1e-3;
+    a.configuration.pruning_delay = 5;
+    a.configuration.pruning_period = 0;
+    a.reset();
+
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(0);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        a.filter(frame(phrase, t));
+        if (t == phrase->size() / 2) {
+            CHECK(a.results.evaluated_classes.size() == 1);
+        }
+    }
+    CHECK(a.results.likeliest == "0");
+
+    // Suspended classes are re-activated by the class-level transitions
+    phrase = ts.getPhrase(3);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        a.filter(frame(phrase, t));
+    }
+    CHECK(a.results.likeliest == "3");
+}
+
+template <typename ModelType>
+static void checkSuspendedClassesAreNotLikeliest(ModelType& model,
+                                                 xmm::TrainingSet& ts) {
+    model.configuration.pruning_threshold = 1e-3;
+    model.configuration.pruning_delay = 5;
+    model.configuration.pruning_period = 1000;
+    model.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(1);
+    for (unsigned int t = 0; t < 10; t++) model.filter(frame(phrase, t));
+    REQUIRE(model.results.evaluated_classes.size() == 1);
+    REQUIRE(model.results.likeliest == "1");
+
+    // the active class becomes less likely than the last evaluation of the
+    // suspended classes, which are not evaluated again
+    for (unsigned int t = 0; t < 10; t++) {
+        model.filter({100.f, -100.f, 0.f});
+        CHECK(model.results.evaluated_classes.size() == 1);
+        CHECK(model.results.likeliest == "1");
+        CHECK(model.results.smoothed_normalized_likelihoods[1] == Approx(1.));
+        for (unsigned int i : {0, 2, 3})
+            CHECK(model.results.smoothed_normalized_likelihoods[i] == 0.);
+    }
+}
+
+TEST_CASE("GMM: Suspended classes are not likeliest", "[GMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(4, false, "", 10.f));
+    xmm::GMM a;
+    a.configuration.gaussians.set(2);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    checkSuspendedClassesAreNotLikeliest(a, ts);
+}
+
+TEST_CASE("HierarchicalHMM: Suspended classes are not likeliest",
+          "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(4, false, "", 10.f));
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(5);
+    a.configuration.hierarchical.set(false);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    checkSuspendedClassesAreNotLikeliest(a, ts);
+}
@@ -34,6 +34,7 @@
 #include "xmmTestsUtilities.hpp"
 #define XMM_TESTING
 #include "xmm.h"
+#include <chrono>
 #include <iostream>
 #include <random>
 
@@ -57,3 +58,73 @@ using namespace std;
 //        model.filter({dist(generator)});
 //    }
 //}
+
+TEST_CASE("Benchmark: Model loading and training start", "[.benchmark]") {
+    xmm::TrainingSet ts;
+    int num_classes = 64;
+    std::default_random_engine generator;
+    std::normal_distribution<float> dist;
+    ts.dimension.set(6);
+    for (int i = 0; i < num_classes; i++) {
+        ts.addPhrase(i, to_string(i + 1));
+        for (int frame_idx = 0; frame_idx < 100; frame_idx++) {
+            std::vector<float> frame(6);
+            for (auto& x : frame) x = dist(generator);
+            ts.getPhrase(i)->record(frame);
+        }
+    }
+    xmm::HierarchicalHMM model;
+    model.configuration.states.set(10);
+    model.configuration.gaussians.set(3);
+    model.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    model.configuration.changed = true;
+    model.shared_parameters->em_algorithm_min_iterations.set(1);
+    model.shared_parameters->em_algorithm_max_iterations.set(1);
+
+    int num_runs = 10;
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < num_runs; run++) model.train(&ts);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Training start (1 EM iteration): "
+              << std::chrono::duration<double, std::milli>(end - start)
+                         .count() /
+                     num_runs
+              << " ms" << std::endl;
+
+    Json::Value root = model.toJson();
+    xmm::HierarchicalHMM loaded;
+    start = std::chrono::steady_clock::now();
+    for (int run = 0; run < num_runs; run++) loaded.fromJson(root);
+    end = std::chrono::steady_clock::now();
+    std::cout << "Loading from Json: "
+              << std::chrono::duration<double, std::milli>(end - start)
+                         .count() /
+                     num_runs
+              << " ms" << std::endl;
+    CHECK(loaded.size() == static_cast<unsigned int>(num_classes));
+
+    for (auto mode : {xmm::MultithreadingMode::Sequential,
+                      xmm::MultithreadingMode::Parallel}) {
+        model.configuration.multithreading = mode;
+        std::string mode_name =
+            (mode == xmm::MultithreadingMode::Sequential) ? "sequential"
+                                                          : "parallel";
+        start = std::chrono::steady_clock::now();
+        for (int run = 0; run < num_runs; run++) root = model.toJson();
+        end = std::chrono::steady_clock::now();
+        std::cout << "Saving to Json (" << mode_name << " classes): "
+                  << std::chrono::duration<double, std::milli>(end - start)
+                             .count() /
+                         num_runs
+                  << " ms" << std::endl;
+        start = std::chrono::steady_clock::now();
+        for (int run = 0; run < num_runs; run++) loaded.fromJson(root);
+        end = std::chrono::steady_clock::now();
+        std::cout << "Loading from Json (" << mode_name << " classes): "
+                  << std::chrono::duration<double, std::milli>(end - start)
+                             .count() /
+                         num_runs
+                  << " ms" << std::endl;
+        CHECK(loaded.size() == static_cast<unsigned int>(num_classes));
+    }
+}
@@ -44,12 +44,9 @@ TEST_CASE("Diagonal covariance (unimodal)", "[GaussianDistribution]") {
     a.covariance[0] = 1.3;
     a.covariance[1] = 0.0;
     a.covariance[2] = 0.2;
-    a.covariance[3] = 0.0;
-    a.covariance[4] = 1.4;
-    a.covariance[5] = 0.7;
-    a.covariance[6] = 0.2;
-    a.covariance[7] = 0.7;
-    a.covariance[8] = 1.5;
+    a.covariance[3] = 1.4;
+    a.covariance[4] = 0.7;
+    a.covariance[5] = 1.5;
     a.updateInverseCovariance();
     float *observation = new float[3];
     observation[0] = 0.7;
@@ -60,8 +57,8 @@ TEST_CASE("Diagonal covariance (unimodal)", "[GaussianDistribution]") {
         xmm::GaussianDistribution::CovarianceMode::Diagonal));
     CHECK(a.mean == b.mean);
     CHECK(a.covariance[0] == b.covariance[0]);
-    CHECK(a.covariance[4] == b.covariance[1]);
-    CHECK(a.covariance[8] == b.covariance[2]);
+    CHECK(a.covariance[3] == b.covariance[1]);
+    CHECK(a.covariance[5] == b.covariance[2]);
     double likelihood_b = b.likelihood(observation);
     xmm::GaussianDistribution c(b);
     CHECK_NOTHROW(
@@ -69,8 +66,8 @@ TEST_CASE("Diagonal covariance (unimodal)", "[GaussianDistribution]") {
     CHECK(a.mean == c.mean);
     CHECK_FALSE(a.covariance == c.covariance);
     CHECK(c.covariance[0] == b.covariance[0]);
-    CHECK(c.covariance[4] == b.covariance[1]);
-    CHECK(c.covariance[8] == b.covariance[2]);
+    CHECK(c.covariance[3] == b.covariance[1]);
+    CHECK(c.covariance[5] == b.covariance[2]);
     double likelihood_c = c.likelihood(observation);
     CHECK(likelihood_b == likelihood_c);
     delete[] observation;
@@ -84,12 +81,9 @@ TEST_CASE("Diagonal covariance (bimodal)", "[GaussianDistribution]") {
     a.covariance[0] = 1.3;
     a.covariance[1] = 0.8;
     a.covariance[2] = 0.2;
-    a.covariance[3] = 0.8;
-    a.covariance[4] = 1.4;
-    a.covariance[5] = 0.7;
-    a.covariance[6] = 0.2;
-    a.covariance[7] = 0.7;
-    a.covariance[8] = 1.5;
+    a.covariance[3] = 1.4;
+    a.covariance[4] = 0.7;
+    a.covariance[5] = 1.5;
     a.updateInverseCovariance();
     float *observation = new float[3];
     observation[0] = 0.7;
@@ -100,16 +94,16 @@ TEST_CASE("Diagonal covariance (bimodal)", "[GaussianDistribution]") {
         xmm::GaussianDistribution::CovarianceMode::Diagonal));
     CHECK(a.mean == b.mean);
     CHECK(a.covariance[0] == b.covariance[0]);
-    CHECK(a.covariance[4] == b.covariance[1]);
-    CHECK(a.covariance[8] == b.covariance[2]);
+    CHECK(a.covariance[3] == b.covariance[1]);
+    CHECK(a.covariance[5] == b.covariance[2]);
     xmm::GaussianDistribution c(b);
     CHECK_NOTHROW(
         c.covariance_mode.set(xmm::GaussianDistribution::CovarianceMode::Full));
     CHECK(a.mean == c.mean);
     CHECK_FALSE(a.covariance == c.covariance);
     CHECK(c.covariance[0] == b.covariance[0]);
-    CHECK(c.covariance[4] == b.covariance[1]);
-    CHECK(c.covariance[8] == b.covariance[2]);
+    CHECK(c.covariance[3] == b.covariance[1]);
+    CHECK(c.covariance[5] == b.covariance[2]);
     CHECK(b.likelihood_input(observation) == c.likelihood_input(observation));
     CHECK_FALSE(b.likelihood_input(observation) ==
                 a.likelihood_input(observation));
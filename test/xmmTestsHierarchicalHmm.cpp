@@ -0,0 +1,501 @@
+/*
+ * xmmTestsHierarchicalHmm.cpp
+ *
+ * Test suite for the high-level structure of Hierarchical HMMs
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+
+static xmm::TrainingSet makeSequenceTrainingSet() {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Unimodal);
+    ts.dimension.set(2);
+    std::vector<std::string> sequence = {"a", "b", "a", "c", "a", "b"};
+    std::vector<float> observation(2);
+    for (unsigned int p = 0; p < sequence.size(); p++) {
+        ts.addPhrase(p, sequence[p]);
+        float offset = float(sequence[p][0] - 'a');
+        for (unsigned int i = 0; i < 50; i++) {
+            observation[0] = offset + float(i) / 50.;
+            observation[1] = offset - float(i) / 50.;
+            ts.getPhrase(p)->record(observation);
+        }
+    }
+    return ts;
+}
+
+TEST_CASE("HierarchicalHMM: Sparse transitions", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.train(&ts);
+    REQUIRE(a.size() == 3);
+    CHECK(a.transition.nonZeros() == 9);
+    CHECK(a.transition(1, 2) == Approx(1. / 3.));
+
+    xmm::HierarchicalHMM b(a);
+    b.setTransitionGrammar({{"a", {"a", "b", "c"}},
+                            {"b", {"a", "b", "c"}},
+                            {"c", {"a", "b", "c"}}});
+    CHECK(b.transition.nonZeros() == 9);
+
+    xmm::HierarchicalHMM c(a);
+    c.setTransitionGrammar({{"a", {"b", "c"}}, {"b", {"c"}}});
+    CHECK(c.transition.nonZeros() == 3);
+    CHECK(c.transition(0, 1) == Approx(0.5));
+    CHECK(c.transition(0, 0) == 0.);
+    CHECK(c.transition(1, 2) == Approx(1.));
+    CHECK(c.transition(2, 0) == 0.);
+    CHECK_THROWS_AS(c.setTransitionGrammar({{"a", {"d"}}}), std::out_of_range);
+
+    a.reset();
+    b.reset();
+    c.reset();
+    std::vector<double> likelihoods_a, likelihoods_b, likelihoods_c;
+    for (auto it = ts.begin(); it != ts.end(); ++it) {
+        for (unsigned int t = 0; t < it->second->size(); t++) {
+            std::vector<float> observation = {it->second->getValue(t, 0),
+                                              it->second->getValue(t, 1)};
+            a.filter(observation);
+            b.filter(observation);
+            c.filter(observation);
+            likelihoods_a.push_back(a.results.instant_normalized_likelihoods[2]);
+            likelihoods_b.push_back(b.results.instant_normalized_likelihoods[2]);
+            likelihoods_c.push_back(c.results.instant_normalized_likelihoods[2]);
+        }
+    }
+    CHECK_VECTOR_APPROX(likelihoods_a, likelihoods_b);
+    CHECK_FALSE(likelihoods_a == likelihoods_c);
+
+    xmm::HierarchicalHMM d(c.toJson());
+    CHECK(d.transition.nonZeros() == 3);
+    CHECK(d.toJson()["transition"] == c.toJson()["transition"]);
+
+    Json::Value dense_json = c.toJson();
+    dense_json["transition"] = Json::Value(Json::arrayValue);
+    std::vector<std::vector<double>> dense = c.transition.toDense();
+    for (unsigned int i = 0; i < dense.size(); i++)
+        dense_json["transition"][i] = xmm::vector2json(dense[i]);
+    xmm::HierarchicalHMM e(dense_json);
+    CHECK(e.toJson()["transition"] == c.toJson()["transition"]);
+}
+
+TEST_CASE("HierarchicalHMM: Corrupted sparse transitions",
+          "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.train(&ts);
+    a.setTransitionGrammar({{"a", {"b", "c"}}, {"b", {"c"}}});
+    Json::Value root = a.toJson();
+    REQUIRE(root["transition"]["row_pointers"] ==
+            xmm::vector2json(std::vector<unsigned int>({0, 2, 3, 3})));
+    CHECK_NOTHROW(xmm::HierarchicalHMM{root});
+
+    std::vector<std::vector<unsigned int>> row_pointers = {
+        {1, 2, 3, 3}, {0, 2, 1, 3}, {0, 2, 3, 1000000}, {0, 2, 3}};
+    for (auto const& pointers : row_pointers) {
+        Json::Value corrupted(root);
+        corrupted["transition"]["row_pointers"] = xmm::vector2json(pointers);
+        CHECK_THROWS_AS(xmm::HierarchicalHMM{corrupted}, xmm::JsonException);
+    }
+    std::vector<std::vector<unsigned int>> column_indices = {
+        {2, 1, 2}, {1, 1, 2}, {1, 2, 3}};
+    for (auto const& indices : column_indices) {
+        Json::Value corrupted(root);
+        corrupted["transition"]["column_indices"] = xmm::vector2json(indices);
+        CHECK_THROWS_AS(xmm::HierarchicalHMM{corrupted}, xmm::JsonException);
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Transitions estimated from a phrase sequence",
+          "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.train(&ts);
+    a.estimateTransitions(&ts);
+    CHECK(a.transition.nonZeros() == 4);
+    CHECK(a.transition(0, 1) == Approx(2. / 3.));
+    CHECK(a.transition(0, 2) == Approx(1. / 3.));
+    CHECK(a.transition(1, 0) == Approx(1.));
+    CHECK(a.transition(2, 0) == Approx(1.));
+    CHECK(a.transition(2, 2) == 0.);
+}
+
+TEST_CASE("HierarchicalHMM: Class IDs", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.train(&ts);
+    REQUIRE(a.size() == 3);
+    CHECK(a.getIndex("a") == 0);
+    CHECK(a.getIndex("c") == 2);
+    CHECK(a.getIndex("d") == -1);
+    CHECK(a.getClass("b").label == "b");
+    CHECK(&a.getClass("c") == &a.models[2]);
+    CHECK_THROWS_AS(a.getClass("d"), std::out_of_range);
+
+    a.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(3);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        CHECK(a.results.likeliest ==
+              a.models[a.results.likeliest_index].label);
+    }
+    CHECK(a.results.likeliest == "c");
+    CHECK(a.results.likeliest_index == 2);
+
+    a.removeClass("b");
+    REQUIRE(a.size() == 2);
+    CHECK(a.getIndex("b") == -1);
+    CHECK(a.getIndex("c") == 1);
+    CHECK(a.getClass("c").label == "c");
+
+    xmm::HierarchicalHMM b(a.toJson());
+    CHECK(b.getIndex("a") == 0);
+    CHECK(b.getIndex("c") == 1);
+}
+
+TEST_CASE("HierarchicalHMM: Tied mixtures", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.configuration.gaussians.set(6);
+    a.configuration.tied_mixtures.set(true);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    REQUIRE(a.size() == 3);
+    for (auto &model : a.models) {
+        CHECK(model.codebook.components.size() == 6);
+        for (auto &state : model.states) {
+            CHECK(state.components.empty());
+            REQUIRE(state.mixture_coeffs.size() == 6);
+            double sum(0.);
+            for (auto w : state.mixture_coeffs) sum += w;
+            CHECK(sum == Approx(1.));
+        }
+    }
+
+    xmm::HierarchicalHMM b(a.toJson());
+    CHECK(b.models[0].codebook.components.size() == 6);
+    CHECK(b.models[0].states[0].components.empty());
+
+    a.reset();
+    b.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(3);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        b.filter(observation);
+        CHECK_VECTOR_APPROX(a.results.instant_normalized_likelihoods,
+                            b.results.instant_normalized_likelihoods);
+    }
+    CHECK(a.results.likeliest == "c");
+}
+
+TEST_CASE("HierarchicalHMM: Shared codebook", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.configuration.gaussians.set(6);
+    a.configuration.shared_codebook.set(true);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    REQUIRE(a.size() == 3);
+    REQUIRE(a.codebook.components.size() == 6);
+    for (auto &model : a.models) {
+        CHECK(model.parameters.tied_mixtures.get());
+        CHECK(model.codebook.components.empty());
+        for (auto &state : model.states) {
+            CHECK(state.components.empty());
+            REQUIRE(state.mixture_coeffs.size() == 6);
+            double sum(0.);
+            for (auto w : state.mixture_coeffs) sum += w;
+            CHECK(sum == Approx(1.));
+        }
+    }
+
+    // training a single class reuses the shared codebook
+    std::vector<double> mean = a.codebook.components[0].mean;
+    a.train(&ts, "b");
+    REQUIRE(a.size() == 3);
+    CHECK(a.codebook.components[0].mean == mean);
+
+    xmm::HierarchicalHMM b(a.toJson());
+    CHECK(b.codebook.components.size() == 6);
+    std::stringstream stream;
+    a.writeBinary(stream);
+    xmm::HierarchicalHMM c;
+    c.readBinary(stream);
+    CHECK(c.toJson() == a.toJson());
+    xmm::HierarchicalHMM d(a);
+
+    a.reset();
+    b.reset();
+    c.reset();
+    d.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(3);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        b.filter(observation);
+        c.filter(observation);
+        d.filter(observation);
+        CHECK_VECTOR_APPROX(a.results.instant_normalized_likelihoods,
+                            b.results.instant_normalized_likelihoods);
+        CHECK_VECTOR_APPROX(a.results.instant_normalized_likelihoods,
+                            c.results.instant_normalized_likelihoods);
+        CHECK_VECTOR_APPROX(a.results.instant_normalized_likelihoods,
+                            d.results.instant_normalized_likelihoods);
+    }
+    CHECK(a.results.likeliest == "c");
+
+    a.clear();
+    CHECK(a.codebook.components.empty());
+}
+
+TEST_CASE("HierarchicalHMM: Frozen model", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.configuration.gaussians.set(2);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    CHECK_FALSE(a.frozen());
+
+    for (bool hierarchical : {true, false}) {
+        a.configuration.hierarchical.set(hierarchical);
+        xmm::HierarchicalHMM b(a);
+        b.freeze();
+        REQUIRE(b.frozen());
+        a.reset();
+        b.reset();
+        std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(3);
+        for (unsigned int t = 0; t < phrase->size(); t++) {
+            std::vector<float> observation = {phrase->getValue(t, 0),
+                                              phrase->getValue(t, 1)};
+            a.filter(observation);
+            b.filter(observation);
+            CHECK_VECTOR_APPROX(a.results.instant_normalized_likelihoods,
+                                b.results.instant_normalized_likelihoods);
+            CHECK_VECTOR_APPROX(a.results.smoothed_normalized_likelihoods,
+                                b.results.smoothed_normalized_likelihoods);
+        }
+        CHECK(b.results.likeliest == "c");
+
+        // copies keep the frozen representation, training discards it
+        xmm::HierarchicalHMM c(b);
+        CHECK(c.frozen());
+        c.train(&ts, "a");
+        CHECK_FALSE(c.frozen());
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Move semantics", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(4);
+    a.configuration.gaussians.set(2);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    a.freeze();
+
+    xmm::HierarchicalHMM tmp(a);
+    xmm::HierarchicalHMM b(std::move(tmp));
+    CHECK(tmp.size() == 0);
+    CHECK(b.toJson() == a.toJson());
+    CHECK(b.frozen());
+    CHECK(b.getIndex("c") == a.getIndex("c"));
+    xmm::HierarchicalHMM c;
+    c = std::move(b);
+    CHECK(b.size() == 0);
+    CHECK(c.toJson() == a.toJson());
+
+    a.reset();
+    c.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(3);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        c.filter(observation);
+        CHECK_VECTOR_APPROX(a.results.instant_normalized_likelihoods,
+                            c.results.instant_normalized_likelihoods);
+    }
+
+    // the classes notify the model they were moved to
+    c.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    c.train(&ts, "a");
+    CHECK(c.trained());
+    CHECK_FALSE(c.frozen());
+
+    // the classes of a GMM are moved with their components
+    xmm::GMM gmm;
+    gmm.configuration.gaussians.set(2);
+    gmm.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    gmm.train(&ts);
+    Json::Value reference = gmm.toJson();
+    xmm::GMM moved_gmm(std::move(gmm));
+    CHECK(gmm.size() == 0);
+    CHECK(moved_gmm.toJson() == reference);
+    gmm = std::move(moved_gmm);
+    CHECK(gmm.toJson() == reference);
+}
+
+TEST_CASE("SingleClassHMM: Forward kernels", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    for (auto mode : {xmm::HMM::TransitionMode::Ergodic,
+                      xmm::HMM::TransitionMode::LeftRight}) {
+        xmm::HierarchicalHMM a;
+        a.configuration.states.set(4);
+        a.configuration.gaussians.set(2);
+        a.configuration.transition_mode.set(mode);
+        a.configuration.hierarchical.set(false);
+        a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+        a.train(&ts);
+        a.reset();
+
+        xmm::SingleClassHMM const& model = a.models[1];
+        unsigned int N = model.parameters.states.get();
+        std::vector<double> alpha(N, 0.), previous_alpha(N);
+        std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(1);
+        for (unsigned int t = 0; t < phrase->size(); t++) {
+            std::vector<float> observation = {phrase->getValue(t, 0),
+                                              phrase->getValue(t, 1)};
+            a.filter(observation);
+
+            // reference forward algorithm
+            previous_alpha = alpha;
+            double norm(0.);
+            for (unsigned int j = 0; j < N; j++) {
+                double b(0.);
+                for (unsigned int c = 0; c < 2; c++)
+                    b += model.states[j].mixture_coeffs[c] *
+                         model.states[j].components[c].likelihood(
+                             &observation[0]);
+                if (t == 0) {
+                    alpha[j] = (mode == xmm::HMM::TransitionMode::Ergodic)
+                                   ? model.prior[j]
+                                   : (j == 0);
+                } else if (mode == xmm::HMM::TransitionMode::Ergodic) {
+                    alpha[j] = 0.;
+                    for (unsigned int i = 0; i < N; i++)
+                        alpha[j] += previous_alpha[i] *
+                                    model.transition[i * N + j];
+                } else {
+                    unsigned int i = (j == 0) ? N - 1 : j - 1;
+                    alpha[j] = previous_alpha[j] * model.transition[j * 2] +
+                               previous_alpha[i] * model.transition[i * 2 + 1];
+                }
+                alpha[j] *= b;
+                norm += alpha[j];
+            }
+            for (auto& value : alpha) value /= norm;
+            CHECK_VECTOR_APPROX(model.alpha, alpha);
+            CHECK(a.results.instant_likelihoods[1] == Approx(norm));
+        }
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Banded transitions", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeSequenceTrainingSet());
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(5);
+    a.configuration.gaussians.set(2);
+    a.configuration.transition_mode.set(xmm::HMM::TransitionMode::Banded);
+    a.configuration.max_skip.set(2);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    REQUIRE(a.size() == 3);
+    for (auto &model : a.models) {
+        REQUIRE(model.transition.size() == 5 * 3);
+        for (unsigned int i = 0; i < 5; i++) {
+            double sum(0.);
+            for (unsigned int k = 0; k < 3; k++) {
+                if (i + k < 5)
+                    sum += model.transition[i * 3 + k];
+                else
+                    CHECK(model.transition[i * 3 + k] == 0.);
+            }
+            CHECK(sum == Approx(1.));
+        }
+    }
+
+    xmm::HierarchicalHMM b(a.toJson());
+    CHECK(b.configuration.max_skip.get() == 2);
+    CHECK_VECTOR_APPROX(b.models[2].transition, a.models[2].transition);
+
+    for (bool hierarchical : {true, false}) {
+        a.configuration.hierarchical.set(hierarchical);
+        b.configuration.hierarchical.set(hierarchical);
+        a.reset();
+        b.reset();
+        std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(3);
+        for (unsigned int t = 0; t < phrase->size(); t++) {
+            std::vector<float> observation = {phrase->getValue(t, 0),
+                                              phrase->getValue(t, 1)};
+            a.filter(observation);
+            b.filter(observation);
+            CHECK_VECTOR_APPROX(a.results.smoothed_normalized_likelihoods,
+                                b.results.smoothed_normalized_likelihoods);
+        }
+        CHECK(a.results.likeliest == "c");
+    }
+
+    // a band of width 2 is a left-right model
+    xmm::HierarchicalHMM lr;
+    lr.configuration.states.set(5);
+    lr.configuration.gaussians.set(2);
+    lr.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    xmm::HierarchicalHMM banded(lr);
+    banded.configuration.transition_mode.set(xmm::HMM::TransitionMode::Banded);
+    banded.configuration.max_skip.set(1);
+    lr.train(&ts);
+    banded.train(&ts);
+    CHECK_VECTOR_APPROX(lr.models[0].transition, banded.models[0].transition);
+    lr.reset();
+    banded.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(1);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        lr.filter(observation);
+        banded.filter(observation);
+        CHECK_VECTOR_APPROX(lr.results.smoothed_normalized_likelihoods,
+                            banded.results.smoothed_normalized_likelihoods);
+    }
+}
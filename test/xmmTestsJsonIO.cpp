@@ -34,7 +34,9 @@
 #include "xmmTestsUtilities.hpp"
 #define XMM_TESTING
 #include "xmm.h"
+#include <cmath>
 #include <ctime>
+#include <sstream>
 
 TEST_CASE("Phrase: Json IO", "[JSON I/O]") {
     xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
@@ -127,7 +129,8 @@ TEST_CASE("GaussianDistribution: Json IO", "[JSON I/O]") {
     xmm::GaussianDistribution a;
     a.dimension.set(3);
     a.mean = {1, 2, 3};
-    a.covariance = {1, 0, 0, 0, 2, 0, 0, 0, 3};
+    a.covariance = {1, 0.5, 0, 2, 0, 3};
+    a.updateInverseCovariance();
 
     // std::cout << a.toJson() << std::endl;
     xmm::GaussianDistribution b(a.toJson());
@@ -135,6 +138,17 @@ TEST_CASE("GaussianDistribution: Json IO", "[JSON I/O]") {
 
     xmm::GaussianDistribution c;
     CHECK_NOTHROW(c.fromJson(a.toJson()));
+
+    // covariance matrices are stored as packed symmetric matrices, but
+    // written as square matrices in Json. Both forms can be read.
+    Json::Value root = a.toJson();
+    CHECK(root["covariance"].size() == 9);
+    CHECK(root["covariance"][1].asDouble() == 0.5);
+    CHECK(root["covariance"][3].asDouble() == 0.5);
+    root["covariance"] = xmm::vector2json(a.covariance);
+    xmm::GaussianDistribution d(root);
+    CHECK(d.covariance == a.covariance);
+    CHECK(d.toJson() == a.toJson());
 }
 
 TEST_CASE("GMM: Json IO", "[JSON I/O]") {
@@ -200,3 +214,246 @@ TEST_CASE("HierarchicalHMM: Json IO", "[JSON I/O]") {
     c.fromJson(a.toJson());
     CHECK(c.toJson() == a.toJson());
 }
+
+TEST_CASE("Streaming Json: Writer and Reader", "[JSON I/O]") {
+    Json::Value root;
+    root["string"] = "quote \" backslash \\ tab \t newline \n \xc3\xa9";
+    root["integers"][0] = 0;
+    root["integers"][1] = -12;
+    root["integers"][2] = 2147483647;
+    root["reals"][0] = 0.1;
+    root["reals"][1] = -1.5e-300;
+    root["reals"][2] = 1. / 3.;
+    root["bool"] = true;
+    root["null"] = Json::Value();
+    root["nested"]["empty_array"] = Json::Value(Json::arrayValue);
+    root["nested"]["empty_object"] = Json::Value(Json::objectValue);
+
+    // the streaming writer is read by jsoncpp
+    std::stringstream stream;
+    xmm::JsonStreamWriter writer(stream);
+    writer.value(root);
+    Json::Value parsed;
+    Json::Reader json_reader;
+    REQUIRE(json_reader.parse(stream.str(), parsed));
+    CHECK(parsed == root);
+
+    // the streaming reader reads jsoncpp documents
+    std::stringstream styled;
+    styled << root;
+    xmm::JsonStreamReader reader(styled);
+    CHECK(reader.readValue() == root);
+    CHECK_NOTHROW(reader.checkEnd());
+
+    std::stringstream escaped("[\"\\u00e9\\ud83d\\ude00\\/\", 1e+9999, null]");
+    xmm::JsonStreamReader escaped_reader(escaped);
+    escaped_reader.beginArray();
+    REQUIRE(escaped_reader.nextElement());
+    CHECK(escaped_reader.readString() == "\xc3\xa9\xf0\x9f\x98\x80/");
+    REQUIRE(escaped_reader.nextElement());
+    CHECK(std::isinf(escaped_reader.readDouble()));
+    REQUIRE(escaped_reader.nextElement());
+    CHECK(escaped_reader.readDouble() == 0.);
+    CHECK_FALSE(escaped_reader.nextElement());
+
+    // syntax and type errors
+    for (std::string invalid :
+         {"{\"a\": 1", "{\"a\": 1,}", "[1 2]", "{\"a\": tru}", "[1] 2", ""}) {
+        std::stringstream invalid_stream(invalid);
+        xmm::JsonStreamReader invalid_reader(invalid_stream);
+        CHECK_THROWS_AS(
+            {
+                invalid_reader.skipValue();
+                invalid_reader.checkEnd();
+            },
+            std::runtime_error);
+    }
+    std::stringstream wrong_type("{\"a\": \"1\"}");
+    xmm::JsonStreamReader wrong_type_reader(wrong_type);
+    std::string name;
+    wrong_type_reader.beginObject();
+    REQUIRE(wrong_type_reader.nextMember(name));
+    CHECK(name == "a");
+    CHECK_THROWS_AS(wrong_type_reader.readDouble(), xmm::JsonException);
+}
+
+TEST_CASE("Training Set: Streaming Json IO", "[JSON I/O]") {
+    for (auto multimodality :
+         {xmm::Multimodality::Unimodal, xmm::Multimodality::Bimodal}) {
+        xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory, multimodality);
+        ts.dimension.set(3);
+        if (multimodality == xmm::Multimodality::Bimodal)
+            ts.dimension_input.set(2);
+        ts.column_names.set({"x", "y", "z"});
+        ts.addPhrase(12, "a");
+        ts.addPhrase(18, "b");
+        ts.addPhrase(20, "a");
+        std::vector<float> observation(3);
+        for (unsigned int i = 0; i < 100; i++) {
+            observation[0] = float(i) / 100.;
+            observation[1] = pow(float(i) / 100., 2.);
+            observation[2] = -pow(float(i) / 100., 3.) / 3.;
+            ts.getPhrase(12)->record(observation);
+            if (i < 40) ts.getPhrase(18)->record(observation);
+        }
+
+        std::stringstream stream;
+        ts.writeJson(stream);
+        xmm::TrainingSet ts2;
+        ts2.readJson(stream);
+        CHECK(ts2.toJson() == ts.toJson());
+        CHECK(ts2.bimodal() == ts.bimodal());
+        REQUIRE(ts2.getPhrasesOfClass("a") != nullptr);
+        CHECK(ts2.getPhrasesOfClass("a")->size() == 2);
+
+        // the phrases notify the training set they were read into
+        ts2.getPhrase(20)->label.set("c");
+        CHECK(ts2.getPhrasesOfClass("a")->size() == 1);
+        CHECK(ts2.getPhrasesOfClass("c") != nullptr);
+
+        // compatibility with the Json::Value serialization
+        Json::Value root;
+        Json::Reader json_reader;
+        REQUIRE(json_reader.parse(stream.str(), root));
+        xmm::TrainingSet ts3;
+        ts3.fromJson(root);
+        CHECK(ts3.toJson() == ts.toJson());
+        std::stringstream styled;
+        styled << ts.toJson();
+        xmm::TrainingSet ts4;
+        ts4.readJson(styled);
+        CHECK(ts4.toJson() == ts.toJson());
+
+        std::stringstream phrase_stream;
+        ts.getPhrase(12)->writeJson(phrase_stream);
+        xmm::Phrase phrase;
+        phrase.readJson(phrase_stream);
+        CHECK(phrase.toJson() == ts.getPhrase(12)->toJson());
+    }
+
+    std::stringstream wrong_length(
+        "{\"dimension\": 2, \"phrases\": [{\"length\": 2, \"data\": [1, 2, "
+        "3]}]}");
+    xmm::TrainingSet ts;
+    CHECK_THROWS_AS(ts.readJson(wrong_length), xmm::JsonException);
+}
+
+TEST_CASE("Models: Streaming Json IO", "[JSON I/O]") {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Unimodal);
+    ts.dimension.set(3);
+    std::vector<float> observation(3);
+    ts.addPhrase(0, "a");
+    ts.addPhrase(1, "b");
+    for (unsigned int i = 0; i < 100; i++) {
+        observation[0] = float(i) / 100.;
+        observation[1] = pow(float(i) / 100., 2.);
+        observation[2] = pow(float(i) / 100., 3.);
+        ts.getPhrase(0)->record(observation);
+        observation[2] = -observation[2];
+        ts.getPhrase(1)->record(observation);
+    }
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(3);
+    a.configuration["b"].states.set(5);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    a.setTransitionGrammar({{"a", {"b"}}, {"b", {"a", "b"}}});
+    // the regularization is read as a float by fromJson()
+    xmm::HierarchicalHMM reference(a.toJson());
+
+    std::stringstream stream;
+    a.writeJson(stream);
+    xmm::HierarchicalHMM b;
+    b.readJson(stream);
+    CHECK(b.toJson() == reference.toJson());
+
+    // documents written by toJson() list the classes before the shared
+    // parameters
+    std::stringstream styled;
+    styled << a.toJson();
+    xmm::HierarchicalHMM c;
+    c.readJson(styled);
+    CHECK(c.toJson() == reference.toJson());
+    Json::Value root;
+    Json::Reader json_reader;
+    REQUIRE(json_reader.parse(stream.str(), root));
+    xmm::HierarchicalHMM d(root);
+    CHECK(d.toJson() == reference.toJson());
+
+    xmm::GMM gmm;
+    gmm.configuration.gaussians.set(2);
+    gmm.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    gmm.train(&ts);
+    xmm::GMM gmm_reference(gmm.toJson());
+    std::stringstream gmm_stream;
+    gmm.writeJson(gmm_stream);
+    xmm::GMM gmm2;
+    gmm2.readJson(gmm_stream);
+    CHECK(gmm2.toJson() == gmm_reference.toJson());
+
+    // an invalid document leaves the model empty
+    std::string truncated = stream.str().substr(0, stream.str().size() / 2);
+    std::stringstream truncated_stream(truncated);
+    CHECK_THROWS_AS(b.readJson(truncated_stream), std::runtime_error);
+    CHECK(b.size() == 0);
+}
+
+TEST_CASE("Models: Parallel Json IO", "[JSON I/O]") {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Unimodal);
+    ts.dimension.set(2);
+    unsigned int num_classes = 40;
+    std::vector<float> observation(2);
+    for (unsigned int c = 0; c < num_classes; c++) {
+        ts.addPhrase(c, "class" + std::to_string(c));
+        for (unsigned int i = 0; i < 20; i++) {
+            observation[0] = float(i) / 20.;
+            observation[1] = std::sin(float(i * (c + 1)) / 20.);
+            ts.getPhrase(c)->record(observation);
+        }
+    }
+    xmm::HierarchicalHMM a;
+    a.configuration.states.set(3);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    Json::Value sequential_root = a.toJson();
+    std::stringstream sequential_stream;
+    a.writeJson(sequential_stream);
+
+    // the parallel encoding matches the sequential encoding
+    a.configuration.multithreading = xmm::MultithreadingMode::Parallel;
+    Json::Value root = a.toJson();
+    root["configuration"]["multithreading"] =
+        sequential_root["configuration"]["multithreading"];
+    CHECK(root == sequential_root);
+    std::stringstream stream;
+    a.writeJson(stream);
+    std::string classes = stream.str().substr(stream.str().find("\"models\""));
+    std::string sequential_classes = sequential_stream.str().substr(
+        sequential_stream.str().find("\"models\""));
+    CHECK(classes == sequential_classes);
+
+    // the parallel decoding matches the sequential decoding
+    xmm::HierarchicalHMM b(a.toJson());
+    xmm::HierarchicalHMM reference(sequential_root);
+    REQUIRE(b.size() == num_classes);
+    CHECK(b.toJson()["models"] == reference.toJson()["models"]);
+    xmm::HierarchicalHMM c;
+    c.readJson(stream);
+    CHECK(c.toJson() == b.toJson());
+    xmm::HierarchicalHMM d;
+    d.readJson(sequential_stream);
+    CHECK(d.toJson() == reference.toJson());
+
+    // a decoded model can be trained again
+    ts.getPhrase(0)->label.set("class1");
+    b.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    b.train(&ts);
+    CHECK(b.size() == num_classes - 1);
+
+    // an invalid class is reported from the worker threads
+    Json::Value invalid = a.toJson();
+    invalid["models"][21]["transition"] = Json::Value(2);
+    CHECK_THROWS_AS(xmm::HierarchicalHMM e(invalid), xmm::JsonException);
+}
@@ -0,0 +1,198 @@
+/*
+ * xmmTestsMomentCache.cpp
+ *
+ * Test suite for the cache of the second moments of the training frames
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+
+TEST_CASE("Moment Cache: Covariance", "[TrainingSet]") {
+    xmm::TrainingSet ts(makeTrainingSet(false, 6));
+    std::size_t frames(0);
+    for (auto it = ts.cbegin(); it != ts.cend(); ++it)
+        frames += it->second->size();
+
+    for (bool full : {true, false}) {
+        std::size_t moment_size = full ? xmm::packedSize(3) : 3;
+        xmm::MomentCache cache;
+        CHECK(cache.empty());
+        cache.build(&ts, full, 0);
+        CHECK(cache.empty());
+
+        // the budget bounds the number of cached frames, the moments of the
+        // other frames are computed on the fly
+        for (std::size_t budget :
+             {frames * moment_size * sizeof(double), std::size_t(1000)}) {
+            cache.build(&ts, full, budget);
+            CHECK(cache.momentSize() == moment_size);
+            CHECK(cache.size() ==
+                  std::min(frames, budget / (moment_size * sizeof(double))));
+
+            // weighted covariance computed with the centered frames
+            std::vector<double> mean(3, 0.), expected(moment_size, 0.);
+            std::vector<double> moment(moment_size, 0.);
+            double weight_sum(0.);
+            std::size_t index(0);
+            for (auto it = ts.cbegin(); it != ts.cend(); ++it) {
+                for (unsigned int t = 0; t < it->second->size(); t++) {
+                    double weight = 1. + double(index % 7);
+                    for (unsigned int d = 0; d < 3; d++)
+                        mean[d] += weight * it->second->getValue(t, d);
+                    weight_sum += weight;
+                    index++;
+                }
+            }
+            for (auto& value : mean) value /= weight_sum;
+            index = 0;
+            for (auto it = ts.cbegin(); it != ts.cend(); ++it) {
+                for (unsigned int t = 0; t < it->second->size(); t++) {
+                    double weight = 1. + double(index % 7);
+                    for (unsigned int d1 = 0; d1 < 3; d1++) {
+                        double v1 = it->second->getValue(t, d1) - mean[d1];
+                        for (unsigned int d2 = d1; d2 < 3; d2++) {
+                            double v2 =
+                                it->second->getValue(t, d2) - mean[d2];
+                            if (full)
+                                expected[xmm::packedIndex(d1, d2, 3)] +=
+                                    weight * v1 * v2 / weight_sum;
+                            else if (d1 == d2)
+                                expected[d1] += weight * v1 * v2 / weight_sum;
+                        }
+                    }
+                    cache.accumulate(index, it->second->getPointer(t),
+                                     weight, moment.data());
+                    index++;
+                }
+            }
+            xmm::MomentCache::toCovariance(moment, mean, weight_sum, full);
+            CHECK_VECTOR_APPROX(moment, expected, 1e-6);
+        }
+        cache.clear();
+        CHECK(cache.empty());
+    }
+}
+
+TEST_CASE("GMM: Training with moment cache", "[GMM]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 6));
+        for (auto mode :
+             {xmm::GaussianDistribution::CovarianceMode::Full,
+              xmm::GaussianDistribution::CovarianceMode::Diagonal}) {
+            xmm::GMM a(bimodal);
+            a.configuration.gaussians.set(3);
+            a.configuration.covariance_mode.set(mode);
+            a.configuration.multithreading =
+                xmm::MultithreadingMode::Sequential;
+            xmm::GMM b(a);
+            b.shared_parameters->em_algorithm_cache_size.set(16);
+            CHECK(a.shared_parameters->em_algorithm_cache_size.get() == 0);
+            srand(1);
+            a.train(&ts);
+            srand(1);
+            b.train(&ts);
+            REQUIRE(b.trained());
+            for (unsigned int i = 0; i < a.size(); i++) {
+                CHECK_VECTOR_APPROX(b.models[i].mixture_coeffs,
+                                    a.models[i].mixture_coeffs, 1e-4);
+                for (unsigned int c = 0; c < 3; c++) {
+                    CHECK_VECTOR_APPROX(b.models[i].components[c].mean,
+                                        a.models[i].components[c].mean, 1e-4);
+                    CHECK_VECTOR_APPROX(b.models[i].components[c].covariance,
+                                        a.models[i].components[c].covariance,
+                                        1e-3);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Training with moment cache", "[HierarchicalHMM]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 6));
+        for (auto mode :
+             {xmm::GaussianDistribution::CovarianceMode::Full,
+              xmm::GaussianDistribution::CovarianceMode::Diagonal}) {
+            xmm::HierarchicalHMM a(bimodal);
+            a.configuration.states.set(4);
+            a.configuration.gaussians.set(2);
+            a.configuration.covariance_mode.set(mode);
+            a.configuration.multithreading =
+                xmm::MultithreadingMode::Sequential;
+            xmm::HierarchicalHMM b(a);
+            b.shared_parameters->em_algorithm_cache_size.set(16);
+            srand(1);
+            a.train(&ts);
+            srand(1);
+            b.train(&ts);
+            REQUIRE(b.trained());
+            for (unsigned int i = 0; i < a.size(); i++) {
+                CHECK_VECTOR_APPROX(b.models[i].transition,
+                                    a.models[i].transition, 1e-3);
+                for (unsigned int s = 0; s < 4; s++) {
+                    for (unsigned int c = 0; c < 2; c++) {
+                        CHECK_VECTOR_APPROX(
+                            b.models[i].states[s].components[c].mean,
+                            a.models[i].states[s].components[c].mean, 1e-3);
+                        CHECK_VECTOR_APPROX(
+                            b.models[i].states[s].components[c].covariance,
+                            a.models[i].states[s].components[c].covariance,
+                            1e-3);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("GMM: Moment cache budget of parallel classes", "[GMM]") {
+    xmm::TrainingSet ts(makeTrainingSet(false, 6));
+    xmm::GMM a;
+    a.configuration.gaussians.set(3);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.shared_parameters->em_algorithm_cache_size.set(16);
+    xmm::GMM b(a);
+    b.configuration.multithreading = xmm::MultithreadingMode::Parallel;
+    srand(1);
+    a.train(&ts);
+    srand(1);
+    b.train(&ts);
+    REQUIRE(a.size() == 2);
+    REQUIRE(b.trained());
+    for (unsigned int i = 0; i < a.size(); i++) {
+        CHECK(a.models[i].momentCacheBudget() == std::size_t(16) << 20);
+        CHECK(b.models[i].momentCacheBudget() == std::size_t(8) << 20);
+    }
+    b.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    b.train(&ts, "1");
+    REQUIRE(b.models[1].label == "1");
+    CHECK(b.models[1].momentCacheBudget() == std::size_t(16) << 20);
+}
@@ -93,18 +93,15 @@ TEST_CASE("Training with MultithreadingMode::Sequential", "[GMM]") {
     mixtureCoeffs[0] = 0.410568;
     mixtureCoeffs[1] = 0.309933;
     mixtureCoeffs[2] = 0.2795;
-    CHECK_VECTOR_APPROX(a.models[label_a].mixture_coeffs, mixtureCoeffs);
-    std::vector<double> cov_c0(9);
+    CHECK_VECTOR_APPROX(a.getClass(label_a).mixture_coeffs, mixtureCoeffs);
+    std::vector<double> cov_c0(6);
     cov_c0[0] = 0.018729;
     cov_c0[1] = 0.00683308;
     cov_c0[2] = 0.00271096;
-    cov_c0[3] = 0.00683308;
-    cov_c0[4] = 0.00614827;
-    cov_c0[5] = 0.00133768;
-    cov_c0[6] = 0.00271096;
-    cov_c0[7] = 0.00133768;
-    cov_c0[8] = 0.00337321;
-    CHECK_VECTOR_APPROX(a.models[label_a].components[0].covariance, cov_c0);
+    cov_c0[3] = 0.00614827;
+    cov_c0[4] = 0.00133768;
+    cov_c0[5] = 0.00337321;
+    CHECK_VECTOR_APPROX(a.getClass(label_a).components[0].covariance, cov_c0);
 }
 
 TEST_CASE("Training with MultithreadingMode::MultithreadingMode", "[GMM]") {
@@ -135,18 +132,15 @@ TEST_CASE("Training with MultithreadingMode::MultithreadingMode", "[GMM]") {
     mixtureCoeffs[0] = 0.410568;
     mixtureCoeffs[1] = 0.309933;
     mixtureCoeffs[2] = 0.2795;
-    CHECK_VECTOR_APPROX(a.models[label_a].mixture_coeffs, mixtureCoeffs);
-    std::vector<double> cov_c0(9);
+    CHECK_VECTOR_APPROX(a.getClass(label_a).mixture_coeffs, mixtureCoeffs);
+    std::vector<double> cov_c0(6);
     cov_c0[0] = 0.018729;
     cov_c0[1] = 0.00683308;
     cov_c0[2] = 0.00271096;
-    cov_c0[3] = 0.00683308;
-    cov_c0[4] = 0.00614827;
-    cov_c0[5] = 0.00133768;
-    cov_c0[6] = 0.00271096;
-    cov_c0[7] = 0.00133768;
-    cov_c0[8] = 0.00337321;
-    CHECK_VECTOR_APPROX(a.models[label_a].components[0].covariance, cov_c0);
+    cov_c0[3] = 0.00614827;
+    cov_c0[4] = 0.00133768;
+    cov_c0[5] = 0.00337321;
+    CHECK_VECTOR_APPROX(a.getClass(label_a).components[0].covariance, cov_c0);
 }
 
 class BackgroundListener {
@@ -195,18 +189,15 @@ TEST_CASE("Training with MultithreadingMode::Background", "[GMM]") {
     mixtureCoeffs[0] = 0.410568;
     mixtureCoeffs[1] = 0.309933;
     mixtureCoeffs[2] = 0.2795;
-    CHECK_VECTOR_APPROX(a.models[label_a].mixture_coeffs, mixtureCoeffs);
-    std::vector<double> cov_c0(9);
+    CHECK_VECTOR_APPROX(a.getClass(label_a).mixture_coeffs, mixtureCoeffs);
+    std::vector<double> cov_c0(6);
     cov_c0[0] = 0.018729;
     cov_c0[1] = 0.00683308;
     cov_c0[2] = 0.00271096;
-    cov_c0[3] = 0.00683308;
-    cov_c0[4] = 0.00614827;
-    cov_c0[5] = 0.00133768;
-    cov_c0[6] = 0.00271096;
-    cov_c0[7] = 0.00133768;
-    cov_c0[8] = 0.00337321;
-    CHECK_VECTOR_APPROX(a.models[label_a].components[0].covariance, cov_c0);
+    cov_c0[3] = 0.00614827;
+    cov_c0[4] = 0.00133768;
+    cov_c0[5] = 0.00337321;
+    CHECK_VECTOR_APPROX(a.getClass(label_a).components[0].covariance, cov_c0);
     a.reset();
     std::vector<double> log_likelihood(100, 0.0);
     for (unsigned int i = 0; i < 100; i++) {
@@ -253,3 +244,65 @@ TEST_CASE("Cancel Training", "[GMM]") {
     a.cancelTraining();
     CHECK(a.size() == 2);
 }
+
+TEST_CASE("Parallel filtering", "[GMM]") {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Unimodal);
+    ts.dimension.set(3);
+    for (unsigned int p = 0; p < 12; p++) {
+        ts.addPhrase(p, std::to_string(p));
+        for (unsigned int i = 0; i < 50; i++) {
+            ts.getPhrase(p)->record({float(p) + float(i) / 50.f,
+                                     float(i) / 50.f, float(p * i) / 50.f});
+        }
+    }
+    xmm::GMM gmm;
+    gmm.configuration.gaussians.set(2);
+    gmm.train(&ts);
+    xmm::GMM gmm_parallel(gmm);
+    gmm_parallel.configuration.filtering_threads = 4;
+    gmm_parallel.configuration.filtering_work_threshold = 0;
+
+    xmm::HierarchicalHMM hmm;
+    hmm.configuration.states.set(4);
+    hmm.configuration.hierarchical.set(false);
+    hmm.train(&ts);
+    xmm::HierarchicalHMM hmm_parallel(hmm);
+    hmm_parallel.configuration.filtering_threads = 4;
+    hmm_parallel.configuration.filtering_work_threshold = 0;
+
+    gmm.reset();
+    gmm_parallel.reset();
+    hmm.reset();
+    hmm_parallel.reset();
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(5);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation(phrase->getPointer(t),
+                                       phrase->getPointer(t) + 3);
+        gmm.filter(observation);
+        gmm_parallel.filter(observation);
+        CHECK_VECTOR_APPROX(gmm.results.smoothed_log_likelihoods,
+                            gmm_parallel.results.smoothed_log_likelihoods);
+        hmm.filter(observation);
+        hmm_parallel.filter(observation);
+        CHECK_VECTOR_APPROX(hmm.results.smoothed_log_likelihoods,
+                            hmm_parallel.results.smoothed_log_likelihoods);
+    }
+    CHECK(gmm_parallel.results.evaluated_classes.size() == 12);
+    CHECK(gmm_parallel.results.likeliest == "5");
+    CHECK(hmm_parallel.results.likeliest == "5");
+}
+
+TEST_CASE("Worker pool without pinning", "[GMM]") {
+    xmm::WorkerPool pool(4, xmm::WorkerPool::DEFAULT_SPIN_ITERATIONS, false);
+    CHECK(pool.size() == 4);
+    CHECK_FALSE(pool.pinned());
+    std::vector<unsigned int> counts(100, 0);
+    xmm::WorkerPool::Task task = [&counts](unsigned int begin,
+                                           unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) counts[i]++;
+    };
+    pool.run(100, task);
+    pool.run(100, task);
+    for (unsigned int i = 0; i < 100; i++) CHECK(counts[i] == 2);
+}
@@ -0,0 +1,208 @@
+/*
+ * xmmTestsOutOfCore.cpp
+ *
+ * Test suite for out-of-core training over phrase stores
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+#include <cstdio>
+
+TEST_CASE("Phrase Store: Chunks", "[TrainingSet]") {
+    std::string filename = "xmm_test_phrase_store.bin";
+    xmm::TrainingSet ts(makeTrainingSet(true, 12));
+    xmm::MappedTrainingSet::write(ts, filename);
+
+    // each phrase is larger than the chunk size
+    xmm::PhraseStore store(filename, 64);
+    CHECK(store.bimodal());
+    CHECK(store.dimension() == 3);
+    CHECK(store.dimension_input() == 2);
+    CHECK(store.size() == ts.size());
+    CHECK(store.labels() == ts.labels());
+    CHECK(store.chunks() == ts.size());
+
+    xmm::PhraseStore chunked(filename, 3 * 60 * sizeof(float) * 3);
+    CHECK(chunked.chunks() > 1);
+    CHECK(chunked.chunks() < ts.size());
+    std::vector<int> indices;
+    chunked.forEachChunk([&](xmm::TrainingSet* chunk) {
+        CHECK(chunk->ownMemory());
+        CHECK(chunk->dimension.get() == 3);
+        for (auto& phrase : *chunk) {
+            indices.push_back(phrase.first);
+            std::shared_ptr<xmm::Phrase> original = ts.getPhrase(phrase.first);
+            REQUIRE(phrase.second->size() == original->size());
+            CHECK(phrase.second->label.get() == original->label.get());
+            for (unsigned int t = 0; t < original->size(); t++)
+                for (unsigned int d = 0; d < 3; d++)
+                    CHECK(phrase.second->getValue(t, d) ==
+                          original->getValue(t, d));
+        }
+    });
+    CHECK(indices == std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}));
+
+    xmm::PhraseStore const* odd = chunked.getPhrasesOfClass("1");
+    REQUIRE(odd != NULL);
+    CHECK(odd->size() == 6);
+    CHECK(odd->labels() == std::set<std::string>({"1"}));
+    CHECK(chunked.getPhrasesOfClass("2") == NULL);
+    unsigned int odd_phrases(0);
+    odd->forEachChunk([&](xmm::TrainingSet* chunk) {
+        for (auto& phrase : *chunk) {
+            CHECK((phrase.first % 2) == 1);
+            odd_phrases++;
+        }
+    });
+    CHECK(odd_phrases == 6);
+
+    // exceptions of the callback are propagated
+    CHECK_THROWS_AS(chunked.forEachChunk([](xmm::TrainingSet*) {
+        throw std::runtime_error("error");
+    }),
+                    std::runtime_error);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("GMM: Out-of-core training", "[GMM]") {
+    std::string filename = "xmm_test_phrase_store.bin";
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 12));
+        xmm::MappedTrainingSet::write(ts, filename);
+
+        // a single chunk gives the same model as in-memory training (with the
+        // same random initialization)
+        xmm::GMM a(bimodal);
+        a.configuration.gaussians.set(3);
+        a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+        xmm::GMM b(a);
+        srand(1);
+        a.train(&ts);
+        xmm::PhraseStore store(filename);
+        REQUIRE(store.chunks() == 1);
+        srand(1);
+        b.train(&store);
+        REQUIRE(b.trained());
+        REQUIRE(b.size() == a.size());
+        for (unsigned int i = 0; i < a.size(); i++) {
+            CHECK_VECTOR_APPROX(b.models[i].mixture_coeffs,
+                                a.models[i].mixture_coeffs, 1e-4);
+            for (unsigned int c = 0; c < 3; c++) {
+                CHECK_VECTOR_APPROX(b.models[i].components[c].mean,
+                                    a.models[i].components[c].mean, 1e-4);
+                CHECK_VECTOR_APPROX(b.models[i].components[c].covariance,
+                                    a.models[i].components[c].covariance,
+                                    1e-3);
+            }
+        }
+
+        // with a single component, the estimates do not depend on the
+        // initialization on the first chunk
+        xmm::GMM c(bimodal);
+        c.configuration.gaussians.set(1);
+        c.configuration.relative_regularization.set(1e-20);
+        c.configuration.multithreading = xmm::MultithreadingMode::Parallel;
+        xmm::GMM d(c);
+        c.train(&ts);
+        xmm::PhraseStore chunked(filename, 512);
+        REQUIRE(chunked.chunks() > 2);
+        d.train(&chunked);
+        REQUIRE(d.trained());
+        for (unsigned int i = 0; i < c.size(); i++) {
+            CHECK_VECTOR_APPROX(d.models[i].components[0].mean,
+                                c.models[i].components[0].mean, 1e-4);
+            CHECK_VECTOR_APPROX(d.models[i].components[0].covariance,
+                                c.models[i].components[0].covariance, 1e-3);
+        }
+    }
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("HierarchicalHMM: Out-of-core training", "[HierarchicalHMM]") {
+    std::string filename = "xmm_test_phrase_store.bin";
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(makeTrainingSet(bimodal, 12));
+        xmm::MappedTrainingSet::write(ts, filename);
+        for (bool tied : {false, true}) {
+            for (auto mode : {xmm::HMM::TransitionMode::LeftRight,
+                              xmm::HMM::TransitionMode::Ergodic}) {
+                xmm::HierarchicalHMM a(bimodal);
+                a.configuration.states.set(4);
+                a.configuration.gaussians.set(2);
+                a.configuration.tied_mixtures.set(tied);
+                a.configuration.transition_mode.set(mode);
+                a.configuration.multithreading =
+                    xmm::MultithreadingMode::Sequential;
+                xmm::HierarchicalHMM b(a);
+                srand(1);
+                a.train(&ts);
+                xmm::PhraseStore store(filename);
+                srand(1);
+                b.train(&store);
+                REQUIRE(b.trained());
+                REQUIRE(b.size() == a.size());
+                for (unsigned int i = 0; i < a.size(); i++) {
+                    CHECK_VECTOR_APPROX(b.models[i].transition,
+                                        a.models[i].transition, 1e-3);
+                    CHECK_VECTOR_APPROX(b.models[i].prior,
+                                        a.models[i].prior, 1e-3);
+                    for (unsigned int s = 0; s < 4; s++) {
+                        CHECK_VECTOR_APPROX(
+                            b.models[i].states[s].mixture_coeffs,
+                            a.models[i].states[s].mixture_coeffs, 1e-3);
+                        if (tied) continue;
+                        for (unsigned int c = 0; c < 2; c++)
+                            CHECK_VECTOR_APPROX(
+                                b.models[i].states[s].components[c].mean,
+                                a.models[i].states[s].components[c].mean,
+                                1e-3);
+                    }
+                    if (tied)
+                        for (unsigned int c = 0; c < 2; c++)
+                            CHECK_VECTOR_APPROX(
+                                b.models[i].codebook.components[c].mean,
+                                a.models[i].codebook.components[c].mean,
+                                1e-3);
+                }
+
+                // training over several chunks
+                xmm::HierarchicalHMM c(a);
+                xmm::PhraseStore chunked(filename, 512);
+                REQUIRE(chunked.chunks() > 2);
+                c.train(&chunked);
+                REQUIRE(c.trained());
+                REQUIRE(c.size() == a.size());
+            }
+        }
+    }
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,161 @@
+/*
+ * xmmTestsPhrase.cpp
+ *
+ * Test suite for the recording of data phrases
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+
+TEST_CASE("Phrase: Geometric growth", "[TrainingSet]") {
+    xmm::Phrase phrase(xmm::MemoryMode::OwnMemory,
+                       xmm::Multimodality::Unimodal);
+    phrase.dimension.set(2);
+    CHECK(phrase.capacity() == 0);
+    unsigned int num_reallocations(0);
+    unsigned int capacity(0);
+    for (unsigned int t = 0; t < 10000; t++) {
+        phrase.record({float(t), -float(t)});
+        if (phrase.capacity() != capacity) {
+            CHECK(phrase.capacity() >= 2 * capacity);
+            capacity = phrase.capacity();
+            num_reallocations++;
+        }
+    }
+    CHECK(num_reallocations < 10);
+    REQUIRE(phrase.size() == 10000);
+    CHECK(phrase.getValue(0, 1) == 0.f);
+    CHECK(phrase.getValue(9999, 0) == 9999.f);
+    CHECK(phrase.getValue(9999, 1) == -9999.f);
+
+    xmm::Phrase reserved(xmm::MemoryMode::OwnMemory,
+                         xmm::Multimodality::Unimodal);
+    reserved.dimension.set(2);
+    reserved.reserve(10000);
+    CHECK(reserved.capacity() == 10000);
+    for (unsigned int t = 0; t < 10000; t++)
+        reserved.record({float(t), -float(t)});
+    CHECK(reserved.capacity() == 10000);
+    CHECK(reserved.toJson() == phrase.toJson());
+    reserved.reserve(10);
+    CHECK(reserved.capacity() == 10000);
+
+    xmm::Phrase shared(xmm::MemoryMode::SharedMemory,
+                       xmm::Multimodality::Unimodal);
+    CHECK_THROWS(shared.reserve(10));
+}
+
+TEST_CASE("Phrase: Block recording", "[TrainingSet]") {
+    std::vector<float> block(3 * 1000);
+    for (std::size_t i = 0; i < block.size(); i++) block[i] = float(i) / 7.f;
+
+    xmm::Phrase a(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Unimodal);
+    xmm::Phrase b(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Unimodal);
+    a.dimension.set(3);
+    b.dimension.set(3);
+    for (unsigned int t = 0; t < 1000; t++)
+        a.record({block[3 * t], block[3 * t + 1], block[3 * t + 2]});
+    b.recordBlock(block.data(), 10);
+    b.recordBlock(block.data() + 30, 990);
+    b.recordBlock(block.data(), 0);
+    CHECK(b.size() == 1000);
+    CHECK(b.toJson() == a.toJson());
+    CHECK_THROWS_AS(b.recordBlock_input(block.data(), 1), std::runtime_error);
+
+    xmm::Phrase c(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Bimodal);
+    xmm::Phrase d(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Bimodal);
+    xmm::Phrase e(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Bimodal);
+    for (xmm::Phrase* p : {&c, &d, &e}) {
+        p->dimension.set(3);
+        p->dimension_input.set(2);
+    }
+    std::vector<float> input, output;
+    for (unsigned int t = 0; t < 1000; t++) {
+        c.record({block[3 * t], block[3 * t + 1], block[3 * t + 2]});
+        input.push_back(block[3 * t]);
+        input.push_back(block[3 * t + 1]);
+        output.push_back(block[3 * t + 2]);
+    }
+    d.recordBlock(block.data(), 1000);
+    CHECK(d.toJson() == c.toJson());
+    e.recordBlock_input(input.data(), 1000);
+    CHECK(e.size() == 0);
+    CHECK(e.inputSize() == 1000);
+    e.recordBlock_output(output.data(), 400);
+    CHECK(e.size() == 400);
+    e.recordBlock_output(output.data() + 400, 600);
+    CHECK(e.size() == 1000);
+    CHECK(e.toJson() == c.toJson());
+
+    xmm::Phrase shared(xmm::MemoryMode::SharedMemory,
+                       xmm::Multimodality::Unimodal);
+    CHECK_THROWS_AS(shared.recordBlock(block.data(), 1), std::runtime_error);
+}
+
+TEST_CASE("Phrase: Frame views", "[TrainingSet]") {
+    xmm::Phrase a(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Unimodal);
+    a.dimension.set(3);
+    for (unsigned int t = 0; t < 20; t++)
+        a.record({float(t), float(t) + 0.5f, -float(t)});
+    xmm::Phrase::FrameView frames = a.frames();
+    CHECK(frames.size() == 20);
+    CHECK(frames.dimension() == 3);
+    CHECK(frames.dimension_input() == 3);
+    CHECK(frames.dimension_output() == 0);
+    CHECK_FALSE(frames.bimodal());
+    std::vector<float> buffer(3);
+    for (unsigned int t = 0; t < 20; t++) {
+        CHECK(frames.input(t) == a.getPointer(t));
+        CHECK(frames.frame(t, buffer.data()) == a.getPointer(t));
+    }
+
+    xmm::Phrase b(xmm::MemoryMode::OwnMemory, xmm::Multimodality::Bimodal);
+    b.dimension.set(3);
+    b.dimension_input.set(2);
+    for (unsigned int t = 0; t < 20; t++)
+        b.record({float(t), float(t) + 0.5f, -float(t)});
+    frames = b.frames();
+    CHECK(frames.size() == 20);
+    CHECK(frames.dimension() == 3);
+    CHECK(frames.dimension_input() == 2);
+    CHECK(frames.dimension_output() == 1);
+    CHECK(frames.bimodal());
+    unsigned int mismatches(0);
+    for (unsigned int t = 0; t < 20; t++) {
+        CHECK(frames.input(t) == b.getPointer_input(t));
+        CHECK(frames.output(t) == b.getPointer_output(t));
+        const float* frame = frames.frame(t, buffer.data());
+        CHECK(frame == buffer.data());
+        for (unsigned int d = 0; d < 3; d++)
+            if (frame[d] != b.getValue(t, d)) mismatches++;
+    }
+    CHECK(mismatches == 0);
+}
@@ -0,0 +1,242 @@
+/*
+ * xmmTestsRealtime.cpp
+ *
+ * Test suite for the allocation-free real-time filtering
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+#include "xmmKMeans.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+namespace {
+std::atomic<bool> count_allocations(false);
+std::atomic<unsigned long> num_allocations(0);
+}
+
+// the global allocation functions are replaced to count the allocations
+// performed by the filtering process
+void* operator new(std::size_t size) {
+    if (count_allocations) num_allocations++;
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+/**
+ @brief filters a phrase and returns the maximum number of allocations
+ performed during the filtering of a frame
+ */
+template <typename ModelType>
+static unsigned long filterAllocations(ModelType& model,
+                                       std::shared_ptr<xmm::Phrase> phrase,
+                                       unsigned int dimension) {
+    std::vector<std::vector<float>> frames(phrase->size(),
+                                           std::vector<float>(dimension));
+    for (unsigned int t = 0; t < phrase->size(); t++)
+        for (unsigned int d = 0; d < dimension; d++)
+            frames[t][d] = phrase->getValue(t, d);
+    unsigned long max_allocations(0);
+    for (auto const& frame : frames) {
+        num_allocations = 0;
+        count_allocations = true;
+        model.filter(frame);
+        count_allocations = false;
+        if (num_allocations > max_allocations)
+            max_allocations = num_allocations;
+    }
+    return max_allocations;
+}
+
+// labels longer than the small string buffer, so that copying a label
+// allocates
+static const std::string long_label_prefix = "class_with_a_long_label_";
+
+TEST_CASE("GMM: Allocation-free filtering", "[GMM]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(
+            makeClassesTrainingSet(3, bimodal, long_label_prefix));
+        unsigned int dimension = bimodal ? 2 : 3;
+        xmm::GMM a(bimodal);
+        a.configuration.gaussians.set(3);
+        a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+        a.train(&ts);
+        for (auto estimator : {xmm::MultiClassRegressionEstimator::Likeliest,
+                               xmm::MultiClassRegressionEstimator::Mixture}) {
+            a.configuration.multiClass_regression_estimator = estimator;
+            a.reset();
+            CHECK(filterAllocations(a, ts.getPhrase(1), dimension) == 0);
+            CHECK(filterAllocations(a, ts.getPhrase(2), dimension) == 0);
+        }
+        a.freeze();
+        a.reset();
+        CHECK(filterAllocations(a, ts.getPhrase(0), dimension) == 0);
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Allocation-free filtering", "[HierarchicalHMM]") {
+    for (bool bimodal : {false, true}) {
+        xmm::TrainingSet ts(
+            makeClassesTrainingSet(3, bimodal, long_label_prefix));
+        unsigned int dimension = bimodal ? 2 : 3;
+        for (auto mode : {xmm::HMM::TransitionMode::Ergodic,
+                          xmm::HMM::TransitionMode::LeftRight,
+                          xmm::HMM::TransitionMode::Banded}) {
+            for (bool tied : {false, true}) {
+                xmm::HierarchicalHMM a(bimodal);
+                a.configuration.states.set(5);
+                a.configuration.gaussians.set(2);
+                a.configuration.transition_mode.set(mode);
+                a.configuration.tied_mixtures.set(tied);
+                a.configuration.multithreading =
+                    xmm::MultithreadingMode::Sequential;
+                a.configuration.multiClass_regression_estimator =
+                    xmm::MultiClassRegressionEstimator::Mixture;
+                a.train(&ts);
+                for (bool hierarchical : {true, false}) {
+                    a.configuration.hierarchical.set(hierarchical);
+                    a.reset();
+                    CHECK(filterAllocations(a, ts.getPhrase(1), dimension) ==
+                          0);
+                    CHECK(filterAllocations(a, ts.getPhrase(2), dimension) ==
+                          0);
+                }
+            }
+        }
+    }
+
+    xmm::TrainingSet ts(makeClassesTrainingSet(3, true, long_label_prefix));
+    xmm::HierarchicalHMM a(true);
+    a.configuration.states.set(5);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    for (auto estimator : {xmm::HMM::RegressionEstimator::Windowed,
+                           xmm::HMM::RegressionEstimator::Likeliest}) {
+        a.configuration.regression_estimator.set(estimator);
+        a.freeze();
+        a.reset();
+        CHECK(filterAllocations(a, ts.getPhrase(0), 2) == 0);
+    }
+}
+
+TEST_CASE("KMeans: Allocation-free filtering", "[KMeans]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(3, false, long_label_prefix));
+    xmm::KMeans a(3);
+    a.train(&ts);
+    a.reset();
+    CHECK(filterAllocations(a, ts.getPhrase(0), 3) == 0);
+}
+
+TEST_CASE("HierarchicalHMM: Asynchronous filtering", "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(3, false, long_label_prefix));
+    xmm::HierarchicalHMM a(false);
+    a.configuration.states.set(5);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    xmm::HierarchicalHMM reference(a);
+
+    std::vector<std::vector<float>> frames;
+    for (unsigned int repetition = 0; repetition < 3; repetition++)
+        for (unsigned int p = 0; p < 3; p++)
+            for (unsigned int t = 0; t < ts.getPhrase(p)->size(); t++)
+                frames.push_back({ts.getPhrase(p)->getValue(t, 0),
+                                  ts.getPhrase(p)->getValue(t, 1),
+                                  ts.getPhrase(p)->getValue(t, 2)});
+    std::vector<xmm::Results<xmm::HMM>> expected;
+    reference.reset();
+    for (auto const& frame : frames) {
+        reference.filter(frame);
+        expected.push_back(reference.results);
+    }
+
+    // queued frames are filtered without allocations
+    a.reset();
+    a.allocateQueues(16);
+    for (unsigned int t = 0; t < 10; t++)
+        CHECK(a.pending_observations.push(frames[t]));
+    num_allocations = 0;
+    count_allocations = true;
+    unsigned int filtered = a.filterPending();
+    count_allocations = false;
+    CHECK(filtered == 10);
+    CHECK(num_allocations == 0);
+    CHECK(a.pending_observations.empty());
+    CHECK(a.pending_results.size() == 10);
+
+    // 1 kHz producer, filtering thread and polling consumer
+    a.reset();
+    a.allocateQueues(static_cast<unsigned int>(frames.size()));
+    std::atomic<bool> producer_done(false);
+    std::thread producer([&]() {
+        for (auto const& frame : frames) {
+            std::vector<float>* slot;
+            while (!(slot = a.pending_observations.writeSlot()))
+                std::this_thread::yield();
+            std::copy(frame.begin(), frame.end(), slot->begin());
+            a.pending_observations.commit();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        producer_done = true;
+    });
+    std::thread worker([&]() {
+        while (!producer_done || !a.pending_observations.empty()) {
+            if (a.filterPending() == 0) std::this_thread::yield();
+        }
+    });
+    std::vector<xmm::Results<xmm::HMM>> received;
+    xmm::Results<xmm::HMM> result;
+    while (received.size() < frames.size()) {
+        if (a.pending_results.pop(result))
+            received.push_back(result);
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    worker.join();
+
+    REQUIRE(received.size() == expected.size());
+    unsigned int mismatches(0);
+    for (std::size_t t = 0; t < expected.size(); t++) {
+        if (received[t].likeliest != expected[t].likeliest ||
+            received[t].smoothed_log_likelihoods !=
+                expected[t].smoothed_log_likelihoods ||
+            received[t].instant_likelihoods != expected[t].instant_likelihoods)
+            mismatches++;
+    }
+    CHECK(mismatches == 0);
+    CHECK(a.pending_results.empty());
+}
@@ -0,0 +1,194 @@
+/*
+ * xmmTestsRegression.cpp
+ *
+ * Test suite for the regression in multiclass models
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+
+static unsigned int argmax(std::vector<double> const& v) {
+    return static_cast<unsigned int>(
+        std::max_element(v.begin(), v.end()) - v.begin());
+}
+
+TEST_CASE("GMM: Lazy multi-class regression", "[GMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(4, true));
+    xmm::GMM a(true);
+    a.configuration.gaussians.set(2);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    a.configuration.multiClass_regression_estimator =
+        xmm::MultiClassRegressionEstimator::Mixture;
+    xmm::GMM b(a);
+    b.configuration.regression_mass_threshold = 0.;
+    a.reset();
+    b.reset();
+
+    // single-class models compute their own regression
+    std::vector<xmm::SingleClassGMM> references(a.models);
+    for (auto& reference : references) reference.reset();
+
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(1);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        b.filter(observation);
+        double expected(0.);
+        for (unsigned int i = 0; i < references.size(); i++) {
+            references[i].filter(observation);
+            expected += a.results.smoothed_normalized_likelihoods[i] *
+                        references[i].results.output_values[0];
+        }
+        CHECK(a.results.output_values[0] == Approx(expected));
+        unsigned int top = argmax(b.results.smoothed_normalized_likelihoods);
+        CHECK(b.results.output_values[0] ==
+              Approx(references[top].results.output_values[0]));
+    }
+
+    a.configuration.multiClass_regression_estimator =
+        xmm::MultiClassRegressionEstimator::Likeliest;
+    a.reset();
+    for (auto& reference : references) reference.reset();
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        for (auto& reference : references) reference.filter(observation);
+        CHECK(a.results.output_values[0] ==
+              Approx(references[a.results.likeliest_index]
+                         .results.output_values[0]));
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Lazy multi-class regression",
+          "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(4, true));
+    xmm::HierarchicalHMM a(true);
+    a.configuration.states.set(5);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    a.configuration.multiClass_regression_estimator =
+        xmm::MultiClassRegressionEstimator::Mixture;
+    xmm::HierarchicalHMM b(a);
+    b.configuration.regression_mass_threshold = 0.9;
+    a.reset();
+    b.reset();
+
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(2);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        b.filter(observation);
+        double expected(0.);
+        for (unsigned int i = 0; i < a.size(); i++) {
+            expected += a.results.smoothed_normalized_likelihoods[i] *
+                        a.models[i].results.output_values[0];
+        }
+        CHECK(a.results.output_values[0] == Approx(expected));
+
+        // the mixture restricted to 90% of the likelihood mass only uses the
+        // regression of the likeliest classes
+        std::vector<double> likelihoods =
+            b.results.smoothed_normalized_likelihoods;
+        double mass(0.), output(0.);
+        while (mass < 0.9) {
+            unsigned int top = argmax(likelihoods);
+            mass += likelihoods[top];
+            output += likelihoods[top] * b.models[top].results.output_values[0];
+            likelihoods[top] = -1.;
+        }
+        CHECK(b.results.output_values[0] == Approx(output / mass));
+    }
+}
+
+TEST_CASE("HierarchicalHMM: Regression with tied mixtures",
+          "[HierarchicalHMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(2, true));
+    xmm::HierarchicalHMM a(true);
+    a.configuration.states.set(5);
+    a.configuration.gaussians.set(4);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    xmm::HierarchicalHMM b(a);
+    b.configuration.tied_mixtures.set(true);
+    a.train(&ts);
+    b.train(&ts);
+    REQUIRE(b.size() == 2);
+    a.reset();
+    b.reset();
+
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(1);
+    double error(0.), error_tied(0.);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        b.filter(observation);
+        error += fabs(a.results.output_values[0] - phrase->getValue(t, 2));
+        error_tied +=
+            fabs(b.results.output_values[0] - phrase->getValue(t, 2));
+    }
+    error /= phrase->size();
+    error_tied /= phrase->size();
+    CHECK(b.results.likeliest == "1");
+    CHECK(error_tied < 0.2);
+    CHECK(error < 0.2);
+}
+
+TEST_CASE("GMM: Frozen model", "[GMM]") {
+    xmm::TrainingSet ts(makeClassesTrainingSet(3, true));
+    xmm::GMM a(true);
+    a.configuration.gaussians.set(3);
+    a.configuration.multithreading = xmm::MultithreadingMode::Sequential;
+    a.train(&ts);
+    xmm::GMM b(a);
+    b.freeze();
+    REQUIRE(b.frozen());
+    a.reset();
+    b.reset();
+
+    std::shared_ptr<xmm::Phrase> phrase = ts.getPhrase(2);
+    for (unsigned int t = 0; t < phrase->size(); t++) {
+        std::vector<float> observation = {phrase->getValue(t, 0),
+                                          phrase->getValue(t, 1)};
+        a.filter(observation);
+        b.filter(observation);
+        CHECK_VECTOR_APPROX(a.results.instant_likelihoods,
+                            b.results.instant_likelihoods);
+        CHECK_VECTOR_APPROX(a.results.output_values, b.results.output_values);
+    }
+    CHECK(b.results.likeliest == "2");
+
+    b.unfreeze();
+    CHECK_FALSE(b.frozen());
+}
@@ -0,0 +1,317 @@
+/*
+ * xmmTestsTrainingSet.cpp
+ *
+ * Test suite for the label index of training sets
+ *
+ * Contact:
+ * - Jules Francoise <jules.francoise@ircam.fr>
+ *
+ * This code has been initially authored by Jules Francoise
+ * <http://julesfrancoise.com> during his PhD thesis, supervised by Frederic
+ * Bevilacqua <href="http://frederic-bevilacqua.net>, in the Sound Music
+ * Movement Interaction team <http://ismm.ircam.fr> of the
+ * STMS Lab - IRCAM, CNRS, UPMC (2011-2015).
+ *
+ * Copyright (C) 2015 UPMC, Ircam-Centre Pompidou.
+ *
+ * This File is part of XMM.
+ *
+ * XMM is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * XMM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMM.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+#include "xmmTestsUtilities.hpp"
+#define XMM_TESTING
+#include "xmm.h"
+#include <cstdio>
+#include <fstream>
+
+/**
+ @brief checks the label index against a scan of all phrases
+ @return the number of inconsistencies
+ */
+static unsigned int checkLabelIndex(xmm::TrainingSet& ts) {
+    std::map<std::string, std::set<int>> expected;
+    for (auto it = ts.begin(); it != ts.end(); ++it)
+        expected[it->second->label.get()].insert(it->first);
+    unsigned int errors(0);
+    if (ts.labels().size() != expected.size()) errors++;
+    for (auto& label : expected) {
+        if (ts.labels().count(label.first) == 0) errors++;
+        xmm::TrainingSet* subset = ts.getPhrasesOfClass(label.first);
+        if (!subset || subset->size() != label.second.size()) {
+            errors++;
+            continue;
+        }
+        for (auto it = subset->begin(); it != subset->end(); ++it)
+            if (label.second.count(it->first) == 0 ||
+                it->second != ts.getPhrase(it->first))
+                errors++;
+    }
+    return errors;
+}
+
+TEST_CASE("Training Set: Label index", "[TrainingSet]") {
+    xmm::TrainingSet ts;
+    ts.dimension.set(2);
+    ts.addPhrase(0, "a");
+    ts.addPhrase(1, "b");
+    ts.addPhrase(2, "a");
+    CHECK(ts.labels() == std::set<std::string>({"a", "b"}));
+    REQUIRE(ts.getPhrasesOfClass("a") != nullptr);
+    CHECK(ts.getPhrasesOfClass("a")->size() == 2);
+    CHECK(ts.getPhrasesOfClass("a")->dimension.get() == 2);
+    CHECK(checkLabelIndex(ts) == 0);
+
+    // relabeling a phrase only touches its previous and new labels
+    xmm::TrainingSet* subset_b = ts.getPhrasesOfClass("b");
+    xmm::TrainingSet* subset_a = ts.getPhrasesOfClass("a");
+    ts.getPhrase(0)->label.set("c");
+    CHECK(ts.getPhrasesOfClass("b") == subset_b);
+    CHECK(ts.getPhrasesOfClass("a") == subset_a);
+    CHECK(subset_a->size() == 1);
+    CHECK(ts.getPhrasesOfClass("c")->size() == 1);
+    CHECK(checkLabelIndex(ts) == 0);
+    ts.getPhrase(2)->label.set("b");
+    CHECK(ts.getPhrasesOfClass("a") == nullptr);
+    CHECK(ts.labels() == std::set<std::string>({"b", "c"}));
+    CHECK(subset_b->size() == 2);
+    CHECK(checkLabelIndex(ts) == 0);
+
+    // shared phrases are indexed at each of their indices
+    std::shared_ptr<xmm::Phrase> shared = ts.getPhrase(1);
+    ts.addPhrase(10, shared);
+    CHECK(ts.getPhrasesOfClass("b")->size() == 3);
+    shared->label.set("d");
+    CHECK(ts.getPhrasesOfClass("d")->size() == 2);
+    CHECK(checkLabelIndex(ts) == 0);
+    ts.removePhrase(1);
+    shared->label.set("e");
+    CHECK(ts.getPhrasesOfClass("e")->size() == 1);
+    CHECK(checkLabelIndex(ts) == 0);
+
+    // replaced and removed phrases leave the index
+    std::shared_ptr<xmm::Phrase> replaced = ts.getPhrase(2);
+    ts.addPhrase(2, "f");
+    replaced->label.set("g");
+    CHECK(ts.labels().count("g") == 0);
+    CHECK(checkLabelIndex(ts) == 0);
+    ts.removePhrasesOfClass("e");
+    CHECK(ts.getPhrase(10) == nullptr);
+    CHECK(checkLabelIndex(ts) == 0);
+
+    // random sessions
+    srand(12);
+    for (unsigned int i = 0; i < 500; i++) {
+        int index = rand() % 40;
+        std::string label = std::to_string(rand() % 7);
+        switch (rand() % 4) {
+            case 0:
+                ts.addPhrase(index, label);
+                break;
+            case 1:
+                ts.removePhrase(index);
+                break;
+            default:
+                if (ts.getPhrase(index)) ts.getPhrase(index)->label.set(label);
+        }
+    }
+    CHECK(checkLabelIndex(ts) == 0);
+    xmm::TrainingSet copy(ts);
+    CHECK(checkLabelIndex(copy) == 0);
+
+    // moved phrases notify the new training set
+    unsigned int num_phrases = copy.size();
+    xmm::TrainingSet moved(std::move(copy));
+    CHECK(copy.empty());
+    CHECK(copy.labels().empty());
+    REQUIRE(moved.size() == num_phrases);
+    CHECK(checkLabelIndex(moved) == 0);
+    moved.begin()->second->label.set("moved");
+    CHECK(moved.getPhrasesOfClass("moved") != nullptr);
+    CHECK(checkLabelIndex(moved) == 0);
+    copy = std::move(moved);
+    CHECK(moved.empty());
+    copy.begin()->second->label.set("moved again");
+    CHECK(copy.getPhrasesOfClass("moved again") != nullptr);
+    CHECK(checkLabelIndex(copy) == 0);
+    ts.clear();
+    CHECK(ts.labels().empty());
+    CHECK(checkLabelIndex(ts) == 0);
+}
+
+/**
+ @brief checks the cached statistics against a two-pass computation over all
+ frames
+ */
+static void checkStatistics(xmm::TrainingSet& ts) {
+    unsigned int dimension = ts.dimension.get();
+    std::vector<double> mean(dimension, 0.), variance(dimension, 0.);
+    unsigned int length(0);
+    for (auto& phrase : ts) {
+        for (unsigned int t = 0; t < phrase.second->size(); t++) {
+            for (unsigned int d = 0; d < dimension; d++)
+                mean[d] += phrase.second->getValue(t, d);
+            length++;
+        }
+    }
+    for (unsigned int d = 0; d < dimension; d++) mean[d] /= length;
+    for (auto& phrase : ts) {
+        for (unsigned int t = 0; t < phrase.second->size(); t++) {
+            for (unsigned int d = 0; d < dimension; d++) {
+                double delta = phrase.second->getValue(t, d) - mean[d];
+                variance[d] += delta * delta;
+            }
+        }
+    }
+    REQUIRE(ts.statistics().length == length);
+    std::vector<float> cached_mean = ts.mean();
+    std::vector<float> cached_stddev = ts.standardDeviation();
+    for (unsigned int d = 0; d < dimension; d++) {
+        CHECK(cached_mean[d] == Approx(mean[d]).epsilon(1e-5));
+        CHECK(cached_stddev[d] ==
+              Approx(sqrt(variance[d] / length)).epsilon(1e-5));
+    }
+}
+
+TEST_CASE("Training Set: Cached statistics", "[TrainingSet]") {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Bimodal);
+    ts.dimension.set(3);
+    ts.dimension_input.set(2);
+    srand(41);
+    for (int i = 0; i < 6; i++) {
+        ts.addPhrase(i, (i % 2) ? "a" : "b");
+        for (int t = 0; t < 20 + i; t++) {
+            float frame[3] = {float(rand() % 100) / 10.f + i,
+                              float(rand() % 100) / 50.f,
+                              float(rand() % 100) - 50.f};
+            ts.getPhrase(i)->record(std::vector<float>(frame, frame + 3));
+        }
+    }
+    checkStatistics(ts);
+    checkStatistics(*ts.getPhrasesOfClass("a"));
+    checkStatistics(*ts.getPhrasesOfClass("b"));
+    std::vector<std::pair<float, float>> minmax = ts.minmax();
+    CHECK(minmax[2].first >= -50.f);
+    CHECK(minmax[2].second < 50.f);
+
+    // the cache is invalidated when the phrases change
+    ts.getPhrase(3)->record(std::vector<float>(3, 1000.f));
+    CHECK(ts.minmax()[2].second == 1000.f);
+    checkStatistics(ts);
+    checkStatistics(*ts.getPhrasesOfClass("a"));
+    ts.getPhrase(3)->label.set("b");
+    checkStatistics(*ts.getPhrasesOfClass("a"));
+    checkStatistics(*ts.getPhrasesOfClass("b"));
+    CHECK(ts.getPhrasesOfClass("b")->minmax()[2].second == 1000.f);
+    ts.removePhrase(3);
+    checkStatistics(ts);
+    CHECK(ts.minmax()[2].second < 50.f);
+    ts.getPhrase(0)->rescale(std::vector<float>(3, 1.f),
+                             std::vector<float>(3, 2.f));
+    checkStatistics(ts);
+    checkStatistics(*ts.getPhrasesOfClass("b"));
+
+    // parallel computation over a large training set
+    xmm::TrainingSet large;
+    large.dimension.set(4);
+    for (int i = 0; i < 16; i++) {
+        large.addPhrase(i, std::to_string(i % 3));
+        std::vector<float> block(4 * 2000);
+        for (auto& value : block) value = float(rand() % 1000) / 100.f + i;
+        large.getPhrase(i)->recordBlock(block.data(), 2000);
+    }
+    checkStatistics(large);
+    for (auto const& label : large.labels())
+        checkStatistics(*large.getPhrasesOfClass(label));
+}
+
+TEST_CASE("Training Set: Binary file", "[TrainingSet]") {
+    std::string filename = "xmm_test_training_set.bin";
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        xmm::Multimodality::Bimodal);
+    ts.dimension.set(3);
+    ts.dimension_input.set(1);
+    ts.column_names.set({"x", "y", "z"});
+    srand(42);
+    for (int i = -1; i < 5; i++) {
+        ts.addPhrase(i, (i % 2) ? "odd" : "even");
+        std::vector<float> input(10 + i), output(2 * (12 + i));
+        for (auto& value : input) value = float(rand() % 100) / 7.f;
+        for (auto& value : output) value = float(rand() % 100) / 3.f;
+        ts.getPhrase(i)->recordBlock_input(input.data(), 10 + i);
+        ts.getPhrase(i)->recordBlock_output(output.data(), 12 + i);
+    }
+    ts.addPhrase(7, "empty");
+    xmm::MappedTrainingSet::write(ts, filename);
+
+    {
+        xmm::MappedTrainingSet mapped(filename);
+        CHECK_FALSE(mapped.ownMemory());
+        CHECK(mapped.bimodal());
+        CHECK(mapped.dimension.get() == 3);
+        CHECK(mapped.dimension_input.get() == 1);
+        CHECK(mapped.column_names.get() == ts.column_names.get());
+        CHECK(mapped.labels() == ts.labels());
+        REQUIRE(mapped.size() == ts.size());
+        for (auto& phrase : ts) {
+            std::shared_ptr<xmm::Phrase> copy =
+                mapped.getPhrase(phrase.first);
+            REQUIRE(copy != nullptr);
+            CHECK(copy->label.get() == phrase.second->label.get());
+            REQUIRE(copy->inputSize() == phrase.second->inputSize());
+            REQUIRE(copy->outputSize() == phrase.second->outputSize());
+            for (unsigned int t = 0; t < copy->outputSize(); t++)
+                for (unsigned int d = 1; d < 3; d++)
+                    CHECK(copy->getValue(t, d) ==
+                          phrase.second->getValue(t, d));
+            for (unsigned int t = 0; t < copy->inputSize(); t++)
+                CHECK(copy->getValue(t, 0) == phrase.second->getValue(t, 0));
+        }
+        std::vector<float> mean = ts.mean(), mapped_mean = mapped.mean();
+        for (unsigned int d = 0; d < 3; d++)
+            CHECK(mapped_mean[d] == Approx(mean[d]));
+
+        // modifications of the phrases are not written to the file
+        mapped.getPhrase(0)->rescale(std::vector<float>(3, 0.f),
+                                     std::vector<float>(3, 2.f));
+    }
+    xmm::MappedTrainingSet reopened(filename);
+    CHECK(reopened.getPhrase(0)->getValue(0, 0) ==
+          ts.getPhrase(0)->getValue(0, 0));
+
+    // unimodal training sets
+    xmm::TrainingSet unimodal;
+    unimodal.dimension.set(2);
+    unimodal.addPhrase(3, "a");
+    for (int t = 0; t < 15; t++)
+        unimodal.getPhrase(3)->record({float(t), float(-t)});
+    xmm::MappedTrainingSet::write(unimodal, filename);
+    xmm::MappedTrainingSet mapped_unimodal(filename);
+    CHECK_FALSE(mapped_unimodal.bimodal());
+    REQUIRE(mapped_unimodal.getPhrase(3)->size() == 15);
+    CHECK(mapped_unimodal.getPhrase(3)->getValue(14, 1) == -14.f);
+
+    // invalid files
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file << "not a training set";
+    }
+    CHECK_THROWS_AS(xmm::MappedTrainingSet invalid(filename),
+                    std::runtime_error);
+    std::remove(filename.c_str());
+    CHECK_THROWS_AS(xmm::MappedTrainingSet missing(filename),
+                    std::runtime_error);
+}
@@ -34,6 +34,9 @@
 #define xmm_lib_catch_utilities_h
 
 #include "catch.hpp"
+#include "xmm.h"
+#include <cstdlib>
+#include <string>
 
 /**
  * @brief Check for vector approximate equality
@@ -62,4 +65,57 @@ void CHECK_VECTOR_APPROX(std::vector<T> const& a, std::vector<T> const& b,
     }
 };
 
+/**
+ * @brief Build a training set of noisy curves alternating between 2 classes
+ * @details the phrases have different lengths, and the data is generated from
+ * a fixed seed.
+ */
+inline xmm::TrainingSet makeTrainingSet(bool bimodal,
+                                        unsigned int num_phrases) {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        bimodal ? xmm::Multimodality::Bimodal
+                                : xmm::Multimodality::Unimodal);
+    ts.dimension.set(3);
+    if (bimodal) ts.dimension_input.set(2);
+    ts.column_names.set({"x", "y", "z"});
+    srand(43);
+    for (unsigned int p = 0; p < num_phrases; p++) {
+        ts.addPhrase(p, std::to_string(p % 2));
+        for (unsigned int t = 0; t < 40 + 3 * p; t++) {
+            float x = float(t) / float(40 + 3 * p);
+            float noise = float(rand() % 100) / 1000.f;
+            ts.getPhrase(p)->record({float(p % 2) + x + noise,
+                                     float(p % 2) - x * x,
+                                     x * (1.f - x) + noise});
+        }
+    }
+    return ts;
+}
+
+/**
+ * @brief Build a training set with one phrase of 50 frames per class
+ * @details phrase p follows {s * p + x, s * p - x, (p + 1) * x * x} for x in
+ * [0, 1), where the spacing s separates the classes. The last column is the
+ * output of bimodal training sets.
+ */
+inline xmm::TrainingSet makeClassesTrainingSet(
+    unsigned int num_classes, bool bimodal,
+    std::string const& label_prefix = "", float spacing = 1.f) {
+    xmm::TrainingSet ts(xmm::MemoryMode::OwnMemory,
+                        bimodal ? xmm::Multimodality::Bimodal
+                                : xmm::Multimodality::Unimodal);
+    ts.dimension.set(3);
+    if (bimodal) ts.dimension_input.set(2);
+    for (unsigned int p = 0; p < num_classes; p++) {
+        ts.addPhrase(p, label_prefix + std::to_string(p));
+        for (unsigned int i = 0; i < 50; i++) {
+            float x = float(i) / 50.f;
+            ts.getPhrase(p)->record({spacing * float(p) + x,
+                                     spacing * float(p) - x,
+                                     float(p + 1) * x * x});
+        }
+    }
+    return ts;
+}
+
 #endif